@@ -0,0 +1,139 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See app_tasks.h for what each task does.
+#include "app_tasks.h"
+#include <project.h>
+#include "task_scheduler.h"
+// The time base, the tick, and the telemetry timer.
+#include "timer_service.h"
+// Signals have to wake the main loop up.
+#include "idle_manager.h"
+// The UART line task.
+#include "uart_helper_fcns.h"
+// Everything the PWM task does at the start of a frame.
+#include "servo_bank.h"
+#include "trajectory.h"
+#include "keyframes.h"
+#include "motion_script.h"
+#include "presets.h"
+#include "motion_limiter.h"
+#include "pwm_frequency.h"
+#include "warm_restart.h"
+// Housekeeping.
+#include "clock_governor.h"
+// sprintf, for the report.
+#include "stdio.h"
+
+static TaskScheduler scheduler;
+static TimerService_Timer telemetry_timer;
+
+/**
+ * The PWM frame's work, in the same order it always had in the main loop.
+ */
+static void AppTasks_Pwm(uint32 events){
+    // Did a new PWM frame start since the last tick?
+    uint8 new_frame = ServoBank_PollFrame();
+    // If a trajectory is playing, that's one more point.
+    Trajectory_Step( new_frame );
+    // Or, if there are keyframes, the next point on the curve between them.
+    Keyframes_Step( new_frame );
+    // A motion script runs every tick, since it counts its waits in ticks.
+    MotionScript_Step();
+    // A preset the UART asked for goes in now, all channels at once, so the commit below (or the next one) has all of it.
+    if( events & APP_TASKS_EVENT_PRESET ){
+        (void) Presets_ApplyRequest();
+    }
+    // And servos with speed limits take one more step toward their targets.
+    MotionLimiter_Step( new_frame );
+    // A new frequency (and divider) goes in right at the start of a frame too.
+    if( PwmFrequency_ApplyAtFrame( new_frame ) ){
+        WarmRestart_Save( WarmRestart_GetSessionMode() );
+    }
+    // Write any servo changes at the start of the next PWM frame. If channel 0 changed,
+    // update the warm restart snapshot now that the PWM registers have the new values.
+    if( ServoBank_CommitAtFrame( new_frame ) & 1u ){
+        WarmRestart_Save( WarmRestart_GetSessionMode() );
+    }
+}
+
+static void AppTasks_UartLine(uint32 events){
+    UART_Helper_ProcessLine();
+}
+
+/**
+ * One line per task: how often it ran, how much of the time, and its longest run.
+ */
+static void AppTasks_Telemetry(uint32 events){
+    char line[96];
+    uint16 share;
+    uint16 total_share = 0;
+    uint8 i;
+    for( i = 0; i < APP_TASK_COUNT; i++){
+        const TaskScheduler_Task * task = &scheduler.tasks[i];
+        share = TaskScheduler_SharePerMille( &scheduler, i );
+        total_share += share;
+        sprintf( line, "%s: %lu runs, %u.%u%% of the CPU, longest %lu us \r\n", task->name, (unsigned long) task->runs,
+            share / 10u, share % 10u, (unsigned long) task->max_time);
+        UART_for_USB_PutString( line );
+    }
+    // The rest is the scheduler itself, the ISRs, and sleep.
+    share = (total_share < 1000u) ? (uint16)(1000u - total_share) : 0;
+    sprintf( line, "Everything else: %u.%u%% \r\n\r\n", share / 10u, share % 10u );
+    UART_for_USB_PutString( line );
+}
+
+static void AppTasks_Housekeeping(uint32 events){
+    // Run the callbacks of any software timers that ran out.
+    TimerService_Dispatch();
+    // Change the clock speed if the load changed.
+    ClockGovernor_Update();
+}
+
+// Runs every tick, after the timer service and the command schedule.
+static void AppTasks_SysTickCallback(void){
+    AppTasks_Signal( APP_TASK_PWM, APP_TASKS_EVENT_TICK );
+    AppTasks_Signal( APP_TASK_HOUSEKEEPING, APP_TASKS_EVENT_TICK );
+}
+
+static void AppTasks_TelemetryTimer(void * context){
+    AppTasks_Signal( APP_TASK_TELEMETRY, APP_TASKS_EVENT_REPORT );
+}
+
+void AppTasks_Init(void){
+    TaskScheduler_Init( &scheduler, TimerService_NowUs );
+    (void) TaskScheduler_Add( &scheduler, APP_TASK_PWM, "PWM", AppTasks_Pwm );
+    (void) TaskScheduler_Add( &scheduler, APP_TASK_UART_LINE, "UART line", AppTasks_UartLine );
+    (void) TaskScheduler_Add( &scheduler, APP_TASK_TELEMETRY, "Telemetry", AppTasks_Telemetry );
+    (void) TaskScheduler_Add( &scheduler, APP_TASK_HOUSEKEEPING, "Housekeeping", AppTasks_Housekeeping );
+    // Slot 0 is the timer service, and slot 1 the command schedule.
+    (void) CySysTickSetCallback( 2u, AppTasks_SysTickCallback );
+}
+
+void AppTasks_Signal(AppTasks_Id task, uint32 events){
+    TaskScheduler_Signal( &scheduler, (uint8) task, events );
+    IdleManager_NotifyWork();
+}
+
+uint8 AppTasks_RunNext(void){
+    return TaskScheduler_RunNext( &scheduler );
+}
+
+void AppTasks_SetTelemetryPeriod(uint16 ms){
+    if( ms == 0 ){
+        TimerService_Stop( &telemetry_timer );
+        return;
+    }
+    TimerService_Start( &telemetry_timer, ms, ms, AppTasks_TelemetryTimer, NULL );
+}
+
+void AppTasks_ResetStats(void){
+    TaskScheduler_ResetStats( &scheduler );
+}
+
+/* [] END OF FILE */
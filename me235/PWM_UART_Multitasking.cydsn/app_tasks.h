@@ -0,0 +1,64 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * app_tasks.h
+ * This project's tasks, on the task scheduler (task_scheduler.h). Most urgent first:
+ *   0) PWM: every tick, checks for a new PWM frame, and does the frame's work (trajectory, keyframes,
+ *      motion limits, frequency change, commit), runs the motion script (motion_script.h),
+ *      and recalls presets (presets.h).
+ *      This used to be the body of the main loop.
+ *   1) UART line: the UART ISR only collects characters now. When a line is done, it signals this task,
+ *      which parses and runs the command (see UART_Helper_ProcessLine).
+ *   2) Telemetry: prints how much of the CPU each task uses, when asked (T : 0), or every so often (T : ms).
+ *   3) Housekeeping: every tick, the software timers' callbacks and the clock governor.
+ * The time is measured with TimerService_NowUs, which keeps counting right through clock speed changes and sleep.
+ */
+
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+#include <project.h>
+
+typedef enum
+{
+    APP_TASK_PWM = 0,
+    APP_TASK_UART_LINE,
+    APP_TASK_TELEMETRY,
+    APP_TASK_HOUSEKEEPING,
+    APP_TASK_COUNT
+} AppTasks_Id;
+
+// The events.
+// From the SysTick, every tick.
+#define APP_TASKS_EVENT_TICK   (1u << 0)
+// A whole line came in on the UART.
+#define APP_TASKS_EVENT_LINE   (1u << 1)
+// Print the task report.
+#define APP_TASKS_EVENT_REPORT (1u << 2)
+// A preset recall byte came in on the UART.
+#define APP_TASKS_EVENT_PRESET (1u << 3)
+
+// Sets up the tasks, and starts the tick on the SysTick. Call after TimerService_Init.
+void AppTasks_Init(void);
+
+// Sends events to a task, and wakes the main loop up for it. OK from any ISR.
+void AppTasks_Signal(AppTasks_Id task, uint32 events);
+
+// The main loop: runs one task. Returns 0 when there's nothing left to do.
+uint8 AppTasks_RunNext(void);
+
+// Prints the task report every 'ms' milliseconds. 0 stops it.
+void AppTasks_SetTelemetryPeriod(uint16 ms);
+
+// Starts the task report's numbers over.
+void AppTasks_ResetStats(void);
+
+#endif //APP_TASKS_H
+
+/* [] END OF FILE */
@@ -0,0 +1,194 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See clock_governor.h for what this does and why.
+#include "clock_governor.h"
+#include <project.h>
+#include "cycle_counter.h"
+// The SysTick counts bus clocks, so its reload has to follow the bus clock.
+#include "timer_service.h"
+
+// The master clock division factors to try, fastest first.
+static const uint8 master_divs[CLOCK_GOVERNOR_NUM_LEVELS] = {1u, 2u, 4u, 8u};
+
+// Only the levels where both the UART and the PWM stay exact end up in here.
+static ClockGovernor_Level levels[CLOCK_GOVERNOR_NUM_LEVELS];
+static uint8 num_levels = 0;
+static uint8 current_level = 0;
+// The bus clock we're actually running at. Kept separately from the level table,
+// since the table can be rebuilt while we're running.
+static uint32 current_bus_hz = BCLK__BUS_CLK__HZ;
+
+// Full-speed divider values, as the fitter (or the application) set them.
+static uint16 uart_base_divider = 0;
+static uint16 pwm_base_divider = 0;
+
+// Set by the UART ISR, cleared by the main loop. volatile since an ISR writes it.
+static volatile uint8 activity_flag = 0;
+// Microseconds since the last activity, and TimerService_NowUs when we last checked.
+// Not the cycle counter: it stops while the CPU sleeps (idle_manager.h), which is most of the idle time,
+// and it counts at whatever clock level we were at.
+static uint32 idle_us = 0;
+static uint32 last_check_us = 0;
+
+static ClockGovernor_Stats stats;
+
+uint8 ClockGovernor_ComputeLevel(uint32 full_hz, uint16 uart_base, uint16 pwm_base, uint8 master_div, ClockGovernor_Level * level){
+    // The dividers divide by (value + 1), so work with the total division.
+    uint32 uart_total = (uint32) uart_base + 1u;
+    uint32 pwm_total = (uint32) pwm_base + 1u;
+    if( master_div == 0 || (full_hz % master_div) != 0 ){
+        return 0;
+    }
+    if( (uart_total % master_div) != 0 || (pwm_total % master_div) != 0 ){
+        return 0;
+    }
+    level->master_div = master_div;
+    level->bus_hz = full_hz / master_div;
+    level->uart_divider = (uint16)(uart_total / master_div - 1u);
+    level->pwm_divider = (uint16)(pwm_total / master_div - 1u);
+    return 1;
+}
+
+/**
+ * (Re)builds the table of allowed levels from the base dividers.
+ */
+static void ClockGovernor_BuildLevels(void){
+    uint8 i;
+    num_levels = 0;
+    for( i = 0; i < CLOCK_GOVERNOR_NUM_LEVELS; i++){
+        if( ClockGovernor_ComputeLevel(BCLK__BUS_CLK__HZ, uart_base_divider, pwm_base_divider, master_divs[i], &levels[num_levels]) ){
+            num_levels++;
+        }
+    }
+}
+
+/**
+ * Actually moves the hardware to a new level. Times itself with the cycle counter.
+ */
+static void ClockGovernor_Apply(uint8 new_level){
+    const ClockGovernor_Level * to = &levels[new_level];
+    uint32 old_hz = current_bus_hz;
+    // CyFlash_SetWaitCycles wants MHz, rounded up so we never wait too little.
+    uint8 new_mhz = (uint8)((to->bus_hz + 999999u) / 1000000u);
+    uint32 t0 = CycleCounter_Now();
+    uint8 interrupt_state = CyEnterCriticalSection();
+
+    // Flash needs more wait states BEFORE the CPU gets faster...
+    if( to->bus_hz > old_hz ){
+        CyFlash_SetWaitCycles( new_mhz );
+    }
+    // The peripheral dividers use the shadow load (restart = 0), so they switch over at
+    // their next terminal count, right around when the master clock switches. At most one
+    // divided clock period is off, instead of the whole thing running at the wrong rate.
+    UART_for_USB_IntClock_SetDividerRegister( to->uart_divider, 0u );
+    Clock_PWM_SetDividerRegister( to->pwm_divider, 0u );
+    CyMasterClk_SetDivider( (uint8)(to->master_div - 1u) );
+    // The bus clock stays at the master clock.
+    CyBusClk_SetDivider( 0u );
+    // ...and can use fewer wait states AFTER it gets slower.
+    if( to->bus_hz < old_hz ){
+        CyFlash_SetWaitCycles( new_mhz );
+    }
+    // Keep CyDelay honest.
+    CyDelayFreq( to->bus_hz );
+    TimerService_SetBusHz( to->bus_hz );
+    current_level = new_level;
+    current_bus_hz = to->bus_hz;
+
+    CyExitCriticalSection(interrupt_state);
+
+    stats.last_transition_cycles = CycleCounter_Now() - t0;
+    if( stats.transitions == 0 || stats.last_transition_cycles < stats.min_transition_cycles ){
+        stats.min_transition_cycles = stats.last_transition_cycles;
+    }
+    if( stats.last_transition_cycles > stats.max_transition_cycles ){
+        stats.max_transition_cycles = stats.last_transition_cycles;
+    }
+    stats.transitions++;
+    stats.level = current_level;
+}
+
+void ClockGovernor_Init(void){
+    CycleCounter_Start();
+    uart_base_divider = UART_for_USB_IntClock_GetDividerRegister();
+    pwm_base_divider = Clock_PWM_GetDividerRegister();
+    ClockGovernor_BuildLevels();
+    current_level = 0;
+    current_bus_hz = BCLK__BUS_CLK__HZ;
+    idle_us = 0;
+    last_check_us = TimerService_NowUs();
+}
+
+void ClockGovernor_NotifyActivity(void){
+    activity_flag = 1;
+}
+
+void ClockGovernor_Update(void){
+    uint32 now = TimerService_NowUs();
+    uint32 elapsed_us = now - last_check_us;
+    last_check_us = now;
+
+    if( activity_flag ){
+        activity_flag = 0;
+        idle_us = 0;
+        // Work is coming in: go straight to full speed.
+        if( current_level != 0 ){
+            ClockGovernor_Apply(0);
+        }
+        return;
+    }
+
+    idle_us += elapsed_us;
+    if( idle_us >= CLOCK_GOVERNOR_IDLE_STEP_US && (current_level + 1u) < num_levels ){
+        ClockGovernor_Apply( current_level + 1u );
+        idle_us = 0;
+    }
+}
+
+void ClockGovernor_SetPwmBaseDivider(uint16 pwm_base){
+    uint8 i;
+    uint8 interrupt_state = CyEnterCriticalSection();
+    uint32 current_div = BCLK__BUS_CLK__HZ / current_bus_hz;
+    pwm_base_divider = pwm_base;
+    ClockGovernor_BuildLevels();
+    // Find the level with the same master clock as before, if it's still allowed.
+    for( i = 0; i < num_levels; i++){
+        if( levels[i].master_div == current_div ){
+            break;
+        }
+    }
+    if( i == num_levels ){
+        // This speed isn't allowed with the new divider: go back to full speed (always level 0).
+        CyExitCriticalSection(interrupt_state);
+        ClockGovernor_Apply(0);
+        return;
+    }
+    current_level = i;
+    Clock_PWM_SetDividerRegister( levels[i].pwm_divider, 0u );
+    stats.level = current_level;
+    CyExitCriticalSection(interrupt_state);
+}
+
+uint16 ClockGovernor_GetPwmBaseDivider(void){
+    // Before ClockGovernor_Init, we're at full speed, so the register itself is the base.
+    if( num_levels == 0 ){
+        return Clock_PWM_GetDividerRegister();
+    }
+    return pwm_base_divider;
+}
+
+uint32 ClockGovernor_GetBusHz(void){
+    return current_bus_hz;
+}
+
+const ClockGovernor_Stats * ClockGovernor_GetStats(void){
+    return &stats;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,88 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * clock_governor.h
+ * Slows the whole chip down when nothing is happening, and speeds it back up
+ * as soon as characters start arriving over the UART. A slower clock uses less power.
+ *
+ * The tricky part: the UART's clock (UART_for_USB_IntClock) and the PWM's clock (Clock_PWM)
+ * are both divided down from the master clock. If the master clock gets 2x slower
+ * and we don't do anything, the baud rate and the PWM period get 2x slower too!
+ * So every time the master clock divider changes, the governor also changes those two
+ * dividers by the same factor, so the UART and PWM tick at exactly the same rate as before.
+ * That only works if the factor divides each clock's total division exactly,
+ * so some levels aren't allowed. (The UART's 24 MHz / 26 only allows divide-by-2, for example.)
+ *
+ * The top speed is whatever the Clock tab in the .cydwr set up (BCLK__BUS_CLK__HZ, 24 MHz here).
+ * The governor only divides down from it, and never touches the PLL.
+ *
+ * ClockGovernor_ComputeLevel only does arithmetic, so it can be checked on a regular computer.
+ */
+
+#ifndef CLOCK_GOVERNOR_H
+#define CLOCK_GOVERNOR_H
+
+#include <project.h>
+
+// Master clock division factors we'll try, fastest first. Must be powers of two.
+#define CLOCK_GOVERNOR_NUM_LEVELS 4u
+// How long there has to be no UART activity before stepping down one level, in microseconds.
+#define CLOCK_GOVERNOR_IDLE_STEP_US 50000u
+
+// The settings for one speed level. Dividers are register values: "divide by value + 1".
+typedef struct
+{
+    uint8 master_div;
+    uint32 bus_hz;
+    uint16 uart_divider;
+    uint16 pwm_divider;
+} ClockGovernor_Level;
+
+typedef struct
+{
+    // how many times the speed changed
+    uint32 transitions;
+    // CPU cycles spent inside the last, the shortest and the longest transition (0 until there's been one)
+    uint32 last_transition_cycles;
+    uint32 min_transition_cycles;
+    uint32 max_transition_cycles;
+    // which level we're at (0 = fastest)
+    uint8 level;
+} ClockGovernor_Stats;
+
+// Works out the dividers for running the master clock at full_hz / master_div.
+// uart_base and pwm_base are the divider register values at full speed.
+// Returns 1 and fills in level if both clocks can stay exact, 0 if not.
+uint8 ClockGovernor_ComputeLevel(uint32 full_hz, uint16 uart_base, uint16 pwm_base, uint8 master_div, ClockGovernor_Level * level);
+
+// Reads the current (full speed) dividers and builds the table of allowed levels.
+// Call after the UART and PWM are started, and after TimerService_Init (idle time is measured on its clock).
+void ClockGovernor_Init(void);
+
+// Call from the UART ISR (or anywhere there's work coming in). Only sets a flag, so it's quick.
+void ClockGovernor_NotifyActivity(void);
+
+// Call from the main loop. Boosts to full speed after activity, or steps down when idle.
+void ClockGovernor_Update(void);
+
+// The PWM clock's full-speed divider changed (for example someone called Clock_PWM_SetDividerRegister).
+// The governor re-applies it, scaled for the current level.
+void ClockGovernor_SetPwmBaseDivider(uint16 pwm_base);
+
+// The PWM clock's full-speed divider (register value), whatever level we're at.
+uint16 ClockGovernor_GetPwmBaseDivider(void);
+
+// The bus clock right now, in Hz.
+uint32 ClockGovernor_GetBusHz(void);
+
+const ClockGovernor_Stats * ClockGovernor_GetStats(void);
+
+#endif //CLOCK_GOVERNOR_H
+
+/* [] END OF FILE */
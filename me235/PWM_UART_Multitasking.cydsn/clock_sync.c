@@ -0,0 +1,176 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See clock_sync.h for how this works.
+#include "clock_sync.h"
+#include <project.h>
+// The PSoC's clock, for its side of the exchange.
+#include "timer_service.h"
+
+void ClockSync_Reset(ClockSync_Estimate * e){
+    e->offset_us = 0;
+    e->ref_device_us = 0;
+    e->skew_q32 = 0;
+    e->min_delay_us = 0;
+    e->last_delay_us = 0;
+    e->last_error_us = 0;
+    e->window_next = 0;
+    e->window_count = 0;
+    e->samples = 0;
+    e->accepted = 0;
+    e->valid = 0;
+}
+
+uint32 ClockSync_OffsetAt(const ClockSync_Estimate * e, uint32 device_us){
+    int32 since = (int32)(device_us - e->ref_device_us);
+    return e->offset_us + (uint32)(int32)(((int64) e->skew_q32 * since) >> 32);
+}
+
+/**
+ * Fits the line through the window, and puts it in offset_us, ref_device_us and skew_q32.
+ * Everything is relative to the newest sample, so the sums stay small.
+ */
+static void ClockSync_Fit(ClockSync_Estimate * e, uint8 newest){
+    uint32 t0 = e->window_device_us[newest];
+    uint32 m0 = e->window_offset_us[newest];
+    int64 n = e->window_count;
+    int64 sx = 0;
+    int64 sy = 0;
+    int64 sxx = 0;
+    int64 sxy = 0;
+    int64 cxx;
+    int64 cxy;
+    uint8 i;
+    for( i = 0; i < e->window_count; i++){
+        // x in units of 1024 us, so x * x can't overflow even for samples an hour apart.
+        int64 x = (int32)(e->window_device_us[i] - t0) >> 10;
+        // y without the drift the current skew already explains, so it's small too.
+        int64 y = (int32)(e->window_offset_us[i] - m0) - ((e->skew_q32 * ((int64)(int32)(e->window_device_us[i] - t0))) >> 32);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    // The slope of the line is cxy / cxx (microseconds per 1024 us), the intercept at x = 0 is (sy - slope sx) / n.
+    cxx = n * sxx - sx * sx;
+    cxy = n * sxy - sx * sy;
+    e->ref_device_us = t0;
+    if( n < 2 || cxx <= 0 ){
+        e->offset_us = m0;
+        return;
+    }
+    // The slope goes into the skew as (cxy << 22) / cxx (2^32 / 1024 = 2^22). Scale both down first if that won't fit.
+    while( cxy > ((int64) 1 << 40) || cxy < -((int64) 1 << 40) ){
+        cxy >>= 1;
+        cxx >>= 1;
+    }
+    if( cxx == 0 ){
+        e->offset_us = m0;
+        return;
+    }
+    e->skew_q32 += (int32)((cxy << 22) / cxx);
+    // The intercept: the average y, moved along the line to x = 0.
+    e->offset_us = m0 + (uint32)(int32)((sy - (cxy * sx) / cxx) / n);
+}
+
+uint8 ClockSync_AddSample(ClockSync_Estimate * e, uint32 t1, uint32 t2, uint32 t3, uint32 t4){
+    int32 delay = (int32)((t4 - t1) - (t3 - t2));
+    // offset = ((T2 - T1) + (T3 - T4)) / 2, without overflowing: the two halves are close to each other.
+    uint32 there = t2 - t1;
+    uint32 measured = there + (uint32)((int32)((t3 - t4) - there) / 2);
+    // When the PSoC's clock had that offset: halfway through its part of the exchange.
+    uint32 device_us = t2 + (t3 - t2) / 2u;
+    uint8 newest;
+    e->samples++;
+    if( delay < 0 ){
+        // The timestamps don't make sense (mixed up exchanges?).
+        return 0;
+    }
+    e->last_delay_us = (uint32) delay;
+    if( !e->valid ){
+        e->min_delay_us = (uint32) delay;
+        e->valid = 1;
+    }
+    else if( (uint32) delay < e->min_delay_us ){
+        e->min_delay_us = (uint32) delay;
+    }
+    else {
+        // Forget the best round trip slowly (1/16 of the way per sample), in case the link got slower for good.
+        e->min_delay_us += ((uint32) delay - e->min_delay_us) >> 4;
+    }
+    if( (uint32) delay > e->min_delay_us + CLOCK_SYNC_DELAY_MARGIN_US ){
+        return 0;
+    }
+    e->last_error_us = (e->accepted == 0) ? 0 : (int32)(measured - ClockSync_OffsetAt(e, device_us));
+    newest = e->window_next;
+    e->window_device_us[newest] = device_us;
+    e->window_offset_us[newest] = measured;
+    e->window_next = (uint8)((newest + 1u) % CLOCK_SYNC_WINDOW);
+    if( e->window_count < CLOCK_SYNC_WINDOW ){
+        e->window_count++;
+    }
+    ClockSync_Fit(e, newest);
+    e->accepted++;
+    return 1;
+}
+
+uint32 ClockSync_HostToDevice(const ClockSync_Estimate * e, uint32 host_us){
+    // The offset depends on the PSoC time we're looking for, but changes so slowly that
+    // the time from the last sample's offset is close enough to look it up.
+    uint32 about = host_us + e->offset_us;
+    return host_us + ClockSync_OffsetAt(e, about);
+}
+
+int32 ClockSync_SkewPpb(const ClockSync_Estimate * e){
+    // 10^9 / 2^32 is about 0.2328, or 15259 / 65536.
+    return (int32)(((int64) e->skew_q32 * 15259) >> 16);
+}
+
+// The PSoC's estimate, and the half of the last exchange that it knows (T1, T2 and T3).
+static ClockSync_Estimate estimate;
+static uint32 last_t1 = 0;
+static uint32 last_t2 = 0;
+static uint32 last_t3 = 0;
+static uint8 exchange_open = 0;
+
+uint32 ClockSync_Exchange(uint32 t1, uint32 t2, uint8 has_last_t4, uint32 last_t4){
+    if( has_last_t4 && exchange_open ){
+        (void) ClockSync_AddSample(&estimate, last_t1, last_t2, last_t3, last_t4);
+    }
+    last_t1 = t1;
+    last_t2 = t2;
+    last_t3 = TimerService_NowUs();
+    exchange_open = 1;
+    return last_t3;
+}
+
+const ClockSync_Estimate * ClockSync_GetEstimate(void){
+    return &estimate;
+}
+
+uint8 ClockSync_HostToTick(uint32 host_us, uint32 * tick){
+    uint32 now_tick;
+    uint32 now_us;
+    uint32 into_tick;
+    int32 until;
+    if( estimate.accepted == 0 ){
+        return 0;
+    }
+    // The microseconds and the tick have to be from the same tick.
+    do {
+        now_tick = TimerService_Now();
+        now_us = TimerService_NowUs();
+        into_tick = now_us - now_tick * 1000u;
+    } while( into_tick >= 1000u );
+    // Counting from the start of this tick, rounded to the nearest one.
+    until = (int32)(ClockSync_HostToDevice(&estimate, host_us) - now_us) + (int32) into_tick;
+    *tick = (until <= 0) ? now_tick : now_tick + ((uint32) until + 500u) / 1000u;
+    return 1;
+}
+
+/* [] END OF FILE */
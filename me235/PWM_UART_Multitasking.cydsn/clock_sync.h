@@ -0,0 +1,99 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * clock_sync.h
+ * Works out how the PC's clock and the PSoC's clock line up, so the PC can say
+ * "at 12:00:01.250" and the PSoC knows which of its ticks that is (for "@" commands, see command_schedule.h).
+ *
+ * It's the same exchange NTP uses, over the UART, with four timestamps in microseconds:
+ *   T1: the PC sends "s : T1" (its own clock)
+ *   T2: the PSoC gets the end of that line (the PSoC's clock)
+ *   T3: the PSoC starts sending its reply "Sync T1 T2 T3"
+ *   T4: the PC gets the reply (its clock)
+ * The round trip, not counting the time the PSoC took, is (T4 - T1) - (T3 - T2).
+ * If the trip there and the trip back take the same time, the PSoC's clock is ahead of the PC's by
+ *   offset = ((T2 - T1) + (T3 - T4)) / 2.
+ * The PC can work that out itself. To let the PSoC keep its own estimate too, the PC sends the T4 of the
+ * last exchange along with the next T1: "s : T1, T4".
+ *
+ * The two clocks also run at slightly different speeds (crystals are off by tens of ppm), so the
+ * offset drifts: the "skew". The estimate is a straight line fit (least squares) through the last
+ * CLOCK_SYNC_WINDOW samples of offset against PSoC time: the slope is the skew, and the line at the
+ * newest sample is the offset. Samples with a much longer round trip than the best one seen
+ * (the USB bridge was busy) are thrown away, since their error could be up to half the round trip.
+ *
+ * Once it's synced, "@h" with a PC time schedules a command, like "d : 150 @h 3000000000".
+ *
+ * All the timestamps are 32-bit microseconds that wrap around (about every 71 minutes); the math is
+ * all differences, so that's fine. The PSoC's clock is TimerService_NowUs.
+ * The estimate functions (ClockSync_Reset to ClockSync_SkewPpb) don't touch the hardware, so the same code
+ * works on the PC's side (ClockSync_HostToDevice turns a PC time into a PSoC time), and can be checked on a regular computer.
+ */
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <project.h>
+
+// How many samples the line is fit through.
+#define CLOCK_SYNC_WINDOW 16u
+// A sample is thrown away if its round trip is this much longer than the best one, in microseconds.
+#define CLOCK_SYNC_DELAY_MARGIN_US 250u
+
+typedef struct
+{
+    // The PSoC's clock minus the PC's, in microseconds (wraps around), at the PSoC time ref_device_us.
+    uint32 offset_us;
+    uint32 ref_device_us;
+    // How fast the offset changes: microseconds per PSoC microsecond, times 2^32. 1 ppm is about 4295.
+    int32 skew_q32;
+    // The shortest round trip seen (it slowly forgets, in case the link got slower), and the last one.
+    uint32 min_delay_us;
+    uint32 last_delay_us;
+    // How far off the last sample was from the prediction.
+    int32 last_error_us;
+    // The samples the line goes through: PSoC time, and the offset measured then.
+    uint32 window_device_us[CLOCK_SYNC_WINDOW];
+    uint32 window_offset_us[CLOCK_SYNC_WINDOW];
+    uint8 window_next;
+    uint8 window_count;
+    uint16 samples;
+    uint16 accepted;
+    uint8 valid;
+} ClockSync_Estimate;
+
+void ClockSync_Reset(ClockSync_Estimate * estimate);
+
+// One exchange's four timestamps. Returns 1 if it was used, 0 if it was thrown away.
+uint8 ClockSync_AddSample(ClockSync_Estimate * estimate, uint32 t1, uint32 t2, uint32 t3, uint32 t4);
+
+// The offset (PSoC minus PC) at PSoC time device_us.
+uint32 ClockSync_OffsetAt(const ClockSync_Estimate * estimate, uint32 device_us);
+
+// The PSoC time that goes with PC time host_us.
+uint32 ClockSync_HostToDevice(const ClockSync_Estimate * estimate, uint32 host_us);
+
+// The skew in parts per billion (positive: the PSoC's clock runs fast).
+int32 ClockSync_SkewPpb(const ClockSync_Estimate * estimate);
+
+// The PSoC's side of an exchange. t1 is from the PC, and t2 is when the line ended.
+// If has_last_t4, last_t4 finishes the previous exchange, and goes into the PSoC's estimate.
+// Returns T3, to send back right away.
+uint32 ClockSync_Exchange(uint32 t1, uint32 t2, uint8 has_last_t4, uint32 last_t4);
+
+// The PSoC's estimate.
+const ClockSync_Estimate * ClockSync_GetEstimate(void);
+
+// The timer service tick (TimerService_Now) that PC time host_us falls in.
+// Returns 0 if there's no estimate yet.
+uint8 ClockSync_HostToTick(uint32 host_us, uint32 * tick);
+
+#endif //CLOCK_SYNC_H
+
+/* [] END OF FILE */
@@ -0,0 +1,65 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See command_acks.h for what the acks mean.
+#include "command_acks.h"
+#include <project.h>
+#include "stdio.h"
+
+void CommandAcks_Reset(CommandAcks * acks, uint8 window){
+    acks->window = window;
+    acks->synced = 0;
+    acks->expected = 0;
+    acks->lost = 0;
+    acks->pending = 0;
+    acks->last_done = 0;
+}
+
+uint8 CommandAcks_Arrive(CommandAcks * acks, uint8 sequence, char * out){
+    out[0] = '\0';
+    if( acks->synced && sequence != acks->expected ){
+        // One went missing (or this one was sent again). Say which one we want, once,
+        // then skip everything until it comes. The ! covers the lines that are pending, too.
+        if( !acks->lost ){
+            acks->lost = 1;
+            acks->pending = 0;
+            sprintf( out, "!%u %u\r\n", acks->expected, (unsigned) COMMAND_ACKS_LOST );
+        }
+        return 0;
+    }
+    acks->synced = 1;
+    acks->lost = 0;
+    acks->expected = (uint8)(sequence + 1u);
+    return 1;
+}
+
+void CommandAcks_Done(CommandAcks * acks, uint8 sequence, CommandAcks_Status status, uint8 more_waiting, char * out){
+    out[0] = '\0';
+    if( status != COMMAND_ACKS_OK ){
+        // Right away, and it covers every line before it.
+        acks->pending = 0;
+        sprintf( out, "!%u %u\r\n", sequence, (unsigned) status );
+        return;
+    }
+    acks->pending++;
+    acks->last_done = sequence;
+    // Wait for more, unless there aren't any, or the PC would soon run out of window waiting for this.
+    if( !more_waiting || acks->pending * 2u >= acks->window ){
+        CommandAcks_Flush( acks, out );
+    }
+}
+
+void CommandAcks_Flush(CommandAcks * acks, char * out){
+    out[0] = '\0';
+    if( acks->pending != 0 ){
+        acks->pending = 0;
+        sprintf( out, "=%u\r\n", acks->last_done );
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,95 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * command_acks.h
+ * Short acknowledgements for numbered commands, so a program on the PC can keep several commands
+ * on their way at once instead of waiting for each reply.
+ *
+ * Normally every line gets echoed back, and then a sentence about what it did. A program has to wait for that
+ * sentence before sending the next line, or it can't tell which reply goes with which command, so every
+ * command costs a whole round trip (USB adds a millisecond or more each way), plus 50 or so bytes of reply.
+ *
+ * A line that starts with "#" and a number from 0 to 255, like "#17 d3 : 150", is numbered instead:
+ *   - it isn't echoed, and gets no sentence back.
+ *   - when it's done, the PSoC answers with one of:
+ *       "=17"     17 and every line before it worked. ("Cumulative": one = covers several lines.)
+ *       "!17 2"   17 didn't work, with a CommandAcks_Status (here 2, a bad number). Every line before it did.
+ *   - the PSoC holds up to a "window" of lines (the W command says how many), so the PC can send that many
+ *     before it hears back. A = comes when the PSoC runs out of lines to do, or has done half a window,
+ *     so it's never more than a few bytes per several commands.
+ * Numbers go up by one, and wrap from 255 to 0. If one goes missing (say the PC sent too many and the PSoC
+ * had to drop one), the next line has the wrong number, and the PSoC answers "!N 6" (COMMAND_ACKS_LOST):
+ * N is the one it's waiting for. It skips every line until N comes again, so the PC just sends everything from
+ * N again ("go back N"). That also means a line that's sent twice never runs twice.
+ * The first numbered line after startup (or after a W) can have any number.
+ *
+ * Lines without a # work just like before. uart_pipeline.py is a client for a program on the PC.
+ * This is just bookkeeping, so it can be checked on a regular computer.
+ */
+
+#ifndef COMMAND_ACKS_H
+#define COMMAND_ACKS_H
+
+#include <project.h>
+
+// Room for the longest ack, "!255 7\r\n" and the '\0'.
+#define COMMAND_ACKS_TEXT_LENGTH 12u
+
+// How a numbered line went. The number is what's in a ! ack.
+typedef enum
+{
+    COMMAND_ACKS_OK = 0,
+    // There's no such command.
+    COMMAND_ACKS_UNKNOWN,
+    // The number after the colon was missing, or out of range.
+    COMMAND_ACKS_BAD_NUMBER,
+    // There's no such channel, or the command only works on channel 0.
+    COMMAND_ACKS_BAD_CHANNEL,
+    // The command can't wait for an "@" tick, or the time couldn't be turned into one.
+    COMMAND_ACKS_BAD_AT,
+    // The command ran, but couldn't do it (like recalling an empty preset), or a scheduled one didn't fit.
+    COMMAND_ACKS_FAILED,
+    // The line before this one never arrived. Send again from the number in the ack.
+    COMMAND_ACKS_LOST,
+    // The line was longer than the PSoC can hold, so it didn't run. Sending it again won't help.
+    COMMAND_ACKS_TOO_LONG
+} CommandAcks_Status;
+
+typedef struct
+{
+    uint8 window;
+    // 0 until the first numbered line, which can have any number.
+    uint8 synced;
+    // The number the next line should have.
+    uint8 expected;
+    // 1 after a ! LOST, while skipping lines until the expected one comes back.
+    uint8 lost;
+    // Lines done but not acked yet, and the last of them.
+    uint8 pending;
+    uint8 last_done;
+} CommandAcks;
+
+// Starts over: no lines pending, and the next numbered line can have any number.
+void CommandAcks_Reset(CommandAcks * acks, uint8 window);
+
+// A numbered line arrived. Returns 1 if it should run, or 0 to skip it.
+// 'out' gets an ack to send now, or "" for none.
+uint8 CommandAcks_Arrive(CommandAcks * acks, uint8 sequence, char * out);
+
+// A numbered line that ran is done. 'more_waiting' is 1 if there are more lines to do right away.
+// 'out' gets an ack to send now, or "" for none.
+void CommandAcks_Done(CommandAcks * acks, uint8 sequence, CommandAcks_Status status, uint8 more_waiting, char * out);
+
+// The = for any lines that are done but not acked yet, or "" if there aren't any.
+// Before a line without a #, so its reply doesn't come ahead of the acks for lines before it.
+void CommandAcks_Flush(CommandAcks * acks, char * out);
+
+#endif //COMMAND_ACKS_H
+
+/* [] END OF FILE */
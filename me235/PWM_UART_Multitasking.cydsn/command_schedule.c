@@ -0,0 +1,260 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See command_schedule.h for how this works.
+#include "command_schedule.h"
+#include <project.h>
+// The wheel is shared between the UART line task and the SysTick.
+#include "priority_section.h"
+// The ticks, and the SysTick that drives them.
+#include "timer_service.h"
+// What the commands actually do.
+#include "servo_bank.h"
+#include "motion_limiter.h"
+
+#define COMMAND_SCHEDULE_WHEEL_MASK (COMMAND_SCHEDULE_WHEEL_SLOTS - 1u)
+// How far ahead all three wheels together reach.
+#define COMMAND_SCHEDULE_HORIZON (1uL << (COMMAND_SCHEDULE_WHEEL_BITS * COMMAND_SCHEDULE_LEVELS))
+
+/**
+ * Adds an entry to the end of a slot's circular list.
+ */
+static void CommandSchedule_Link(CommandSchedule_Entry ** slot, CommandSchedule_Entry * entry){
+    if( *slot == NULL ){
+        entry->next = entry;
+    }
+    else {
+        // The last entry points to the first, so the new one goes in between.
+        entry->next = (*slot)->next;
+        (*slot)->next = entry;
+    }
+    *slot = entry;
+}
+
+/**
+ * Empties a slot, and returns its entries as a regular list (first to last, ending in NULL).
+ */
+static CommandSchedule_Entry * CommandSchedule_Take(CommandSchedule_Entry ** slot){
+    CommandSchedule_Entry * last = *slot;
+    CommandSchedule_Entry * first;
+    if( last == NULL ){
+        return NULL;
+    }
+    first = last->next;
+    last->next = NULL;
+    *slot = NULL;
+    return first;
+}
+
+void CommandSchedule_WheelInit(CommandSchedule_Wheel * wheel, uint32 now){
+    uint8 level;
+    uint8 i;
+    for( level = 0; level < COMMAND_SCHEDULE_LEVELS; level++){
+        for( i = 0; i < COMMAND_SCHEDULE_WHEEL_SLOTS; i++){
+            wheel->slots[level][i] = NULL;
+        }
+    }
+    wheel->now = now;
+}
+
+void CommandSchedule_Insert(CommandSchedule_Wheel * wheel, CommandSchedule_Entry * entry){
+    int32 delta = (int32)(entry->at - wheel->now);
+    uint8 level = 0;
+    uint32 index;
+    if( delta <= 0 ){
+        // Already due (or late): the very next tick.
+        index = (wheel->now + 1u) & COMMAND_SCHEDULE_WHEEL_MASK;
+    }
+    else {
+        // The finest wheel that reaches that far.
+        while( level < COMMAND_SCHEDULE_LEVELS - 1u
+            && (uint32) delta >= (1uL << (COMMAND_SCHEDULE_WHEEL_BITS * (level + 1u))) ){
+            level++;
+        }
+        if( (uint32) delta >= COMMAND_SCHEDULE_HORIZON ){
+            // Past the end of the last wheel: the slot that comes around last, to be sorted out again then.
+            index = (wheel->now >> (COMMAND_SCHEDULE_WHEEL_BITS * level)) & COMMAND_SCHEDULE_WHEEL_MASK;
+        }
+        else {
+            index = (entry->at >> (COMMAND_SCHEDULE_WHEEL_BITS * level)) & COMMAND_SCHEDULE_WHEEL_MASK;
+        }
+    }
+    CommandSchedule_Link(&wheel->slots[level][index], entry);
+}
+
+uint16 CommandSchedule_Advance(CommandSchedule_Wheel * wheel, CommandSchedule_Action action){
+    CommandSchedule_Entry * entry;
+    CommandSchedule_Entry * next;
+    uint16 count = 0;
+    uint8 level;
+    uint32 now = ++wheel->now;
+    // Like a clock: when the first wheel comes back around to 0, the second one clicks over by one,
+    // and that slot's entries are close enough now to move down. Biggest wheel first.
+    for( level = COMMAND_SCHEDULE_LEVELS - 1u; level > 0; level--){
+        if( (now & ((1uL << (COMMAND_SCHEDULE_WHEEL_BITS * level)) - 1u)) == 0 ){
+            entry = CommandSchedule_Take(&wheel->slots[level][(now >> (COMMAND_SCHEDULE_WHEEL_BITS * level)) & COMMAND_SCHEDULE_WHEEL_MASK]);
+            while( entry != NULL ){
+                next = entry->next;
+                if( entry->at == now ){
+                    // Due this very tick (CommandSchedule_Insert would say "next tick", since this one's started).
+                    CommandSchedule_Link(&wheel->slots[0][now & COMMAND_SCHEDULE_WHEEL_MASK], entry);
+                }
+                else {
+                    CommandSchedule_Insert(wheel, entry);
+                }
+                entry = next;
+            }
+        }
+    }
+    // Everything in this tick's slot of the first wheel is due now.
+    entry = CommandSchedule_Take(&wheel->slots[0][now & COMMAND_SCHEDULE_WHEEL_MASK]);
+    while( entry != NULL ){
+        next = entry->next;
+        action(entry);
+        count++;
+        entry = next;
+    }
+    return count;
+}
+
+// The device's schedule.
+static CommandSchedule_Wheel wheel;
+static CommandSchedule_Entry pool[COMMAND_SCHEDULE_MAX_ENTRIES];
+static CommandSchedule_Entry * free_list = NULL;
+static volatile uint8 pending = 0;
+static uint16 next_id = 1;
+static CommandSchedule_Stats stats;
+// The lateness of the last few commands, by id.
+static uint16 log_ids[COMMAND_SCHEDULE_LOG_LENGTH];
+static uint32 log_late_us[COMMAND_SCHEDULE_LOG_LENGTH];
+static uint8 log_next = 0;
+
+/**
+ * Runs one command, from the SysTick interrupt.
+ */
+static void CommandSchedule_Run(CommandSchedule_Entry * entry){
+    // Both sides wrap around at 2^32 microseconds together, so the difference is still right.
+    int32 late_us = (int32)(TimerService_NowUs() - entry->at * 1000u);
+    if( late_us < 0 ){
+        late_us = 0;
+    }
+    if( entry->kind == COMMAND_SCHEDULE_PERIOD ){
+        (void) ServoBank_SetPeriod(entry->channel, entry->value);
+    }
+    else {
+        (void) MotionLimiter_SetTarget(entry->channel, entry->value);
+    }
+    stats.executed++;
+    if( (uint32) late_us >= 1000u ){
+        stats.late++;
+    }
+    stats.last_late_us = (uint32) late_us;
+    if( (uint32) late_us > stats.max_late_us ){
+        stats.max_late_us = (uint32) late_us;
+    }
+    log_ids[log_next] = entry->id;
+    log_late_us[log_next] = (uint32) late_us;
+    log_next = (uint8)((log_next + 1u) % COMMAND_SCHEDULE_LOG_LENGTH);
+    // Back to the pool.
+    entry->next = free_list;
+    free_list = entry;
+    pending--;
+}
+
+/**
+ * Runs every tick, right after the timer service counts it.
+ */
+static void CommandSchedule_SysTickCallback(void){
+    uint32 now = TimerService_Now();
+    // Keep out anything at this priority that adds commands while the wheel is changing.
+    uint8 interrupt_state = PrioritySection_Enter();
+    while( wheel.now != now ){
+        (void) CommandSchedule_Advance(&wheel, CommandSchedule_Run);
+    }
+    PrioritySection_Exit(interrupt_state);
+}
+
+void CommandSchedule_Init(void){
+    uint8 i;
+    CommandSchedule_WheelInit(&wheel, TimerService_Now());
+    free_list = NULL;
+    for( i = 0; i < COMMAND_SCHEDULE_MAX_ENTRIES; i++){
+        pool[i].next = free_list;
+        free_list = &pool[i];
+    }
+    pending = 0;
+    // Slot 0 is the timer service. The callbacks run in order, so the tick is already counted when this runs.
+    (void) CySysTickSetCallback(1u, CommandSchedule_SysTickCallback);
+}
+
+uint16 CommandSchedule_Add(CommandSchedule_Kind kind, uint8 channel, uint16 value, uint32 at){
+    CommandSchedule_Entry * entry;
+    uint16 id;
+    uint8 interrupt_state = PrioritySection_Enter();
+    entry = free_list;
+    if( entry == NULL ){
+        stats.dropped++;
+        PrioritySection_Exit(interrupt_state);
+        return 0;
+    }
+    free_list = entry->next;
+    id = next_id;
+    // 0 means "didn't fit", so skip it when the ids wrap around.
+    next_id = (next_id == 0xFFFFu) ? 1u : (uint16)(next_id + 1u);
+    entry->at = at;
+    entry->value = value;
+    entry->id = id;
+    entry->kind = (uint8) kind;
+    entry->channel = channel;
+    CommandSchedule_Insert(&wheel, entry);
+    pending++;
+    PrioritySection_Exit(interrupt_state);
+    return id;
+}
+
+void CommandSchedule_Clear(void){
+    uint8 level;
+    uint8 i;
+    CommandSchedule_Entry * entry;
+    CommandSchedule_Entry * next;
+    uint8 interrupt_state = PrioritySection_Enter();
+    for( level = 0; level < COMMAND_SCHEDULE_LEVELS; level++){
+        for( i = 0; i < COMMAND_SCHEDULE_WHEEL_SLOTS; i++){
+            entry = CommandSchedule_Take(&wheel.slots[level][i]);
+            while( entry != NULL ){
+                next = entry->next;
+                entry->next = free_list;
+                free_list = entry;
+                entry = next;
+            }
+        }
+    }
+    pending = 0;
+    PrioritySection_Exit(interrupt_state);
+}
+
+uint8 CommandSchedule_GetPending(void){
+    return pending;
+}
+
+uint8 CommandSchedule_GetLateness(uint16 id, uint32 * late_us){
+    uint8 i;
+    for( i = 0; i < COMMAND_SCHEDULE_LOG_LENGTH; i++){
+        if( id != 0 && log_ids[i] == id ){
+            *late_us = log_late_us[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const CommandSchedule_Stats * CommandSchedule_GetStats(void){
+    return &stats;
+}
+
+/* [] END OF FILE */
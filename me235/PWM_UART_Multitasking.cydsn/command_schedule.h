@@ -0,0 +1,121 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * command_schedule.h
+ * Commands that happen at a given tick, instead of whenever their line finishes arriving.
+ *
+ * The USB-UART bridge sends characters in bursts, every millisecond or so, and the PC adds its own delays.
+ * So "d : 150" typed (or sent) at one moment reaches the servo a few milliseconds later, a different
+ * amount every time. Add "@ tick" to the end of a p, d, w or % line, like "d3 : 150 @ 52000", and it
+ * waits here until TimerService_Now() gets to 52000, then happens right in the SysTick interrupt.
+ * Send the commands for several servos ahead of time with the same tick, and they all change together
+ * (in the same PWM frame, since the servo bank writes at the start of the next frame).
+ *
+ * Waiting commands are kept in a "hierarchical timing wheel": three wheels of 64 slots, like the hands
+ * of a clock. The first has one slot per tick (1 ms), the second one per 64 ticks, the third one per 4096 ticks.
+ * A command goes in the finest wheel that reaches far enough. Every 64 ticks, one slot of the second wheel
+ * gets "cascaded": its commands move down to the first wheel, now that they're close. Adding a command is O(1),
+ * and each tick only looks at the slot that's due, no matter how many are waiting. (timer_service.h has a
+ * single wheel, which is simpler, but has to skip over far-away timers that share a slot.)
+ * Commands more than 64^3 ticks (about 4 minutes) away wait in the last wheel and go around again.
+ *
+ * Every command gets an id, and how late it ran (in microseconds after its tick) is recorded, so you can
+ * check that it really happened on time.
+ *
+ * The wheel itself (CommandSchedule_WheelInit, _Insert, _Advance) doesn't touch the hardware,
+ * so it can be checked on a regular computer.
+ */
+
+#ifndef COMMAND_SCHEDULE_H
+#define COMMAND_SCHEDULE_H
+
+#include <project.h>
+
+#define COMMAND_SCHEDULE_WHEEL_BITS 6u
+#define COMMAND_SCHEDULE_WHEEL_SLOTS (1u << COMMAND_SCHEDULE_WHEEL_BITS)
+#define COMMAND_SCHEDULE_LEVELS 3u
+// Most commands waiting at once.
+#ifndef COMMAND_SCHEDULE_MAX_ENTRIES
+    #define COMMAND_SCHEDULE_MAX_ENTRIES 32u
+#endif
+// How many of the latest commands to remember the lateness of.
+#define COMMAND_SCHEDULE_LOG_LENGTH 8u
+
+typedef enum
+{
+    COMMAND_SCHEDULE_PERIOD = 0,
+    COMMAND_SCHEDULE_COMPARE = 1
+} CommandSchedule_Kind;
+
+// One waiting command.
+typedef struct CommandSchedule_Entry
+{
+    struct CommandSchedule_Entry * next;
+    // the tick it runs at
+    uint32 at;
+    uint16 value;
+    uint16 id;
+    uint8 kind;
+    uint8 channel;
+} CommandSchedule_Entry;
+
+// The wheels. Each slot points to the LAST entry of a circular list, so adding to the end is O(1)
+// and commands for the same tick run in the order they were sent.
+typedef struct
+{
+    CommandSchedule_Entry * slots[COMMAND_SCHEDULE_LEVELS][COMMAND_SCHEDULE_WHEEL_SLOTS];
+    // the last tick that was run
+    uint32 now;
+} CommandSchedule_Wheel;
+
+// Called for every entry that's due. The entry is out of the wheel by then, so it can be reused.
+typedef void (*CommandSchedule_Action)(CommandSchedule_Entry * entry);
+
+typedef struct
+{
+    // how many commands ran, and how many of those were a tick or more late
+    uint32 executed;
+    uint32 late;
+    // microseconds after their tick
+    uint32 last_late_us;
+    uint32 max_late_us;
+    // commands that didn't fit
+    uint32 dropped;
+} CommandSchedule_Stats;
+
+// Empties the wheel. 'now' is the tick that was just run (the next one to run is now + 1).
+void CommandSchedule_WheelInit(CommandSchedule_Wheel * wheel, uint32 now);
+
+// Adds an entry. One that's already due runs at the next tick.
+void CommandSchedule_Insert(CommandSchedule_Wheel * wheel, CommandSchedule_Entry * entry);
+
+// Moves on one tick, and calls action for everything due then. Returns how many there were.
+uint16 CommandSchedule_Advance(CommandSchedule_Wheel * wheel, CommandSchedule_Action action);
+
+// Starts the schedule on the SysTick. Call after TimerService_Init.
+void CommandSchedule_Init(void);
+
+// Runs "set kind to value on channel" at tick 'at' (compare on TimerService_Now()).
+// Returns the command's id, or 0 if too many are waiting.
+uint16 CommandSchedule_Add(CommandSchedule_Kind kind, uint8 channel, uint16 value, uint32 at);
+
+// Throws away everything that's waiting.
+void CommandSchedule_Clear(void);
+
+// How many commands are waiting.
+uint8 CommandSchedule_GetPending(void);
+
+// How late command 'id' ran, in microseconds. Returns 0 if it's not one of the latest few that ran.
+uint8 CommandSchedule_GetLateness(uint16 id, uint32 * late_us);
+
+const CommandSchedule_Stats * CommandSchedule_GetStats(void);
+
+#endif //COMMAND_SCHEDULE_H
+
+/* [] END OF FILE */
@@ -0,0 +1,41 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * cycle_counter.h
+ * The Cortex-M3 has a free-running counter of CPU clock cycles inside its
+ * DWT (Data Watchpoint and Trace) unit. It's the easiest way to time
+ * how long a piece of code takes, down to a single cycle.
+ * See core_cm3.h for the DWT and CoreDebug register definitions.
+ *
+ * Usage:
+ *   CycleCounter_Start();            // once, at startup
+ *   uint32 t0 = CycleCounter_Now();
+ *   ... code to time ...
+ *   uint32 elapsed = CycleCounter_Now() - t0;   // wraps correctly, since it's unsigned
+ */
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <project.h>
+
+// Turn on the trace block and then the cycle counter. Safe to call more than once.
+static inline void CycleCounter_Start(void){
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Current count of CPU cycles. Wraps around every 2^32 cycles (about 3 minutes at 24 MHz).
+static inline uint32 CycleCounter_Now(void){
+    return DWT->CYCCNT;
+}
+
+#endif //CYCLE_COUNTER_H
+
+/* [] END OF FILE */
@@ -0,0 +1,65 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See dither.h for how this works.
+#include "dither.h"
+#include <project.h>
+// Plays the pattern, one value per period.
+#include "trajectory.h"
+// The period of channel 0, which limits the compare.
+#include "servo_bank.h"
+
+// One pattern has to fit in the trajectory table.
+#if DITHER_TABLE_LENGTH > TRAJECTORY_MAX_POINTS
+    #error "DITHER_FRAC_BITS is too big for TRAJECTORY_MAX_POINTS"
+#endif
+
+void Dither_Init(Dither_State * state, uint32 compare_q8){
+    state->base = (uint16)(compare_q8 >> DITHER_FRAC_BITS);
+    state->fraction = (uint8)(compare_q8 & (DITHER_TABLE_LENGTH - 1u));
+    // Start halfway, so the first +1 comes in the middle of its share of periods, not at the end.
+    state->error = (uint8)(DITHER_TABLE_LENGTH / 2u);
+}
+
+uint16 Dither_Next(Dither_State * state){
+    // The accumulator is 8 bits, so "overflowing past 256" is just the carry out of this add.
+    uint16 sum = (uint16) state->error + state->fraction;
+    state->error = (uint8) sum;
+    return state->base + (uint16)(sum >> DITHER_FRAC_BITS);
+}
+
+void Dither_BuildTable(uint32 compare_q8, uint16 max_compare, uint16 * out){
+    Dither_State state;
+    uint16 i;
+    if( compare_q8 > ((uint32) max_compare << DITHER_FRAC_BITS) ){
+        compare_q8 = (uint32) max_compare << DITHER_FRAC_BITS;
+    }
+    Dither_Init(&state, compare_q8);
+    for( i = 0; i < DITHER_TABLE_LENGTH; i++){
+        out[i] = Dither_Next(&state);
+    }
+}
+
+uint32 Dither_SetCompareQ8(uint32 compare_q8){
+    uint16 max_compare = ServoBank_GetPeriod(0);
+    Dither_State state;
+    uint16 i;
+    if( compare_q8 > ((uint32) max_compare << DITHER_FRAC_BITS) ){
+        compare_q8 = (uint32) max_compare << DITHER_FRAC_BITS;
+    }
+    // Straight into the trajectory table, instead of keeping a second copy here.
+    Trajectory_Clear();
+    Dither_Init(&state, compare_q8);
+    for( i = 0; i < DITHER_TABLE_LENGTH; i++){
+        (void) Trajectory_Append( Dither_Next(&state) );
+    }
+    (void) Trajectory_Play(TRAJECTORY_LOOP);
+    return compare_q8;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,62 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * dither.h
+ * Duty cycles in between two compare values, like 150.25 ticks.
+ *
+ * At high PWM frequencies, the period is only a few hundred ticks, so each step of the compare
+ * is a big jump in duty cycle. "Dithering" gets in-between values on average: for 150.25,
+ * write 150 for three periods and 151 for the fourth, over and over.
+ *
+ * The compare value comes in "Q8" fixed point: the real number times 256, so 150.25 is 38464.
+ * The low 8 bits are the fraction. The pattern is made with an "error feedback" accumulator:
+ * each period, add the fraction to the accumulator, and when it overflows past 256, write
+ * one more than the base and keep the leftover. That spreads the +1s out as evenly as possible
+ * (150.5 gives 150, 151, 150, 151... instead of 150, 150, 151, 151), so the servo sees the
+ * smoothest average. After 256 periods the average is exactly the Q8 value.
+ *
+ * The pattern is played back by the trajectory engine (trajectory.h) as a loop, one value per PWM period,
+ * with the DMA if the schematic has it. So a dithered duty cycle and a trajectory can't play at the same time.
+ *
+ * Dither_Next and Dither_BuildTable are just arithmetic, so they can be checked on a regular computer.
+ */
+
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <project.h>
+
+// Fraction bits: 8 extra bits of resolution, averaged over 2^8 periods.
+#define DITHER_FRAC_BITS 8u
+#define DITHER_TABLE_LENGTH (1u << DITHER_FRAC_BITS)
+
+// The accumulator for one channel.
+typedef struct
+{
+    uint16 base;
+    uint8 fraction;
+    uint8 error;
+} Dither_State;
+
+// Starts a new pattern for compare_q8 (compare * 256).
+void Dither_Init(Dither_State * state, uint32 compare_q8);
+
+// The compare value to write this period.
+uint16 Dither_Next(Dither_State * state);
+
+// Fills a table with one full pattern (DITHER_TABLE_LENGTH values), clamped to max_compare.
+void Dither_BuildTable(uint32 compare_q8, uint16 max_compare, uint16 * table);
+
+// Plays the pattern for compare_q8 on PWM_Servo. Stops any trajectory that was playing.
+// Returns the compare value it rounds to, in Q8 (different from compare_q8 only if it was past the period).
+uint32 Dither_SetCompareQ8(uint32 compare_q8);
+
+#endif //DITHER_H
+
+/* [] END OF FILE */
@@ -0,0 +1,201 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See dma_init.h for the big picture.
+#include "dma_init.h"
+#include <project.h>
+// memcpy and memset, for when the DMA isn't available.
+#include <string.h>
+#include "cycle_counter.h"
+
+// Zero-fill TDs read this word over and over (without incrementing the source address).
+// It has to live in SRAM, not flash, so it can't be const.
+static uint32 zero_word = 0;
+
+// The plan and the hardware handles for the transfer that's currently running.
+static DmaInit_Plan plan;
+static uint8 channels[DMA_INIT_MAX_CHAINS];
+static uint8 td_handles[DMA_INIT_MAX_TDS];
+static uint8 num_channels = 0;
+static uint8 num_td_handles = 0;
+
+static DmaInit_Stats stats;
+// When DmaInit_Start returned, for measuring the overlap.
+static uint32 start_done_time = 0;
+#if DMA_INIT_MEASURE_CPU
+// The regions DmaInit_Start was given, to time the CPU doing the same work once the DMA is done.
+static const DmaInit_Region * started_regions = NULL;
+static uint8 num_started_regions = 0;
+#endif
+
+/**
+ * The slow way, used when there isn't enough DMA hardware left.
+ */
+static void DmaInit_CpuFallback(const DmaInit_Region * regions, uint8 num_regions){
+    uint8 r;
+    for( r = 0; r < num_regions; r++){
+        if( regions[r].zero_fill ){
+            memset( (void *) regions[r].dst, 0, regions[r].size);
+        }
+        else {
+            memcpy( (void *) regions[r].dst, (const void *) regions[r].src, regions[r].size);
+        }
+    }
+}
+
+/**
+ * Gives back every channel and TD we allocated.
+ */
+static void DmaInit_Release(void){
+    uint8 i;
+    for( i = 0; i < num_channels; i++){
+        (void) CyDmaChDisable( channels[i] );
+        (void) CyDmaChFree( channels[i] );
+    }
+    for( i = 0; i < num_td_handles; i++){
+        CyDmaTdFree( td_handles[i] );
+    }
+    num_channels = 0;
+    num_td_handles = 0;
+}
+
+/**
+ * DmaInit_Start couldn't use the DMA: the CPU does it all now, and that's what it cost.
+ */
+static void DmaInit_FallBack(const DmaInit_Region * regions, uint8 num_regions, uint32 t0){
+    DmaInit_CpuFallback(regions, num_regions);
+    stats.setup_cycles = CycleCounter_Now() - t0;
+    stats.cpu_cycles = stats.setup_cycles;
+#if DMA_INIT_MEASURE_CPU
+    num_started_regions = 0;
+#endif
+    start_done_time = CycleCounter_Now();
+}
+
+uint8 DmaInit_Start(const DmaInit_Region * regions, uint8 num_regions){
+    uint32 t0;
+    uint8 i;
+    uint8 c;
+    CycleCounter_Start();
+    t0 = CycleCounter_Now();
+    stats.setup_cycles = 0;
+    stats.overlap_cycles = 0;
+    stats.wait_cycles = 0;
+    stats.cpu_cycles = 0;
+    stats.saved_cycles = 0;
+    num_channels = 0;
+    num_td_handles = 0;
+#if DMA_INIT_MEASURE_CPU
+    started_regions = regions;
+    num_started_regions = num_regions;
+#endif
+
+#if (0u == DMA_CHANNELS_USED__MASK0)
+    // The schematic has no DMA component, so the startup code never called CyDmacConfigure,
+    // and the list of free TDs in TD memory is whatever was there at power-up. Build it now.
+    // (OK here: nothing else has a DMA channel running yet.)
+    CyDmacConfigure();
+#endif
+
+    if( !DmaInit_PlanRegions(regions, num_regions, (uint32) &zero_word, &plan) || CyDmaTdFreeCount() < plan.num_tds ){
+        DmaInit_FallBack(regions, num_regions, t0);
+        return 0;
+    }
+
+    // Grab all the TDs first, so each one can be pointed at the next one in its chain.
+    for( i = 0; i < plan.num_tds; i++){
+        td_handles[i] = CyDmaTdAllocate();
+        num_td_handles++;
+    }
+
+    for( c = 0; c < plan.num_chains; c++){
+        uint8 first_td = CY_DMA_INVALID_TD;
+        uint8 ch = CyDmaChAlloc();
+        if( ch == CY_DMA_INVALID_CHANNEL ){
+            DmaInit_Release();
+            DmaInit_FallBack(regions, num_regions, t0);
+            return 0;
+        }
+        channels[num_channels] = ch;
+        num_channels++;
+        // One CPU request runs the whole chain: requestPerBurst = 0, and each TD auto-starts the next.
+        (void) CyDmaChSetConfiguration(ch, DMA_INIT_BURST_BYTES, 0u, 0u, 0u, 0u);
+        (void) CyDmaChSetExtendedAddress(ch, plan.chains[c].src_hi, plan.chains[c].dst_hi);
+
+        for( i = 0; i < plan.num_tds; i++){
+            uint8 next = CY_DMA_DISABLE_TD;
+            uint8 flags = plan.tds[i].flags;
+            uint8 j;
+            if( plan.tds[i].chain != c ){
+                continue;
+            }
+            if( first_td == CY_DMA_INVALID_TD ){
+                first_td = td_handles[i];
+            }
+            // find the next TD in the same chain, if any
+            for( j = i + 1; j < plan.num_tds; j++){
+                if( plan.tds[j].chain == c ){
+                    next = td_handles[j];
+                    flags |= CY_DMA_TD_AUTO_EXEC_NEXT;
+                    break;
+                }
+            }
+            (void) CyDmaTdSetConfiguration(td_handles[i], plan.tds[i].count, next, flags);
+            (void) CyDmaTdSetAddress(td_handles[i], plan.tds[i].src_lo, plan.tds[i].dst_lo);
+        }
+        (void) CyDmaChSetInitialTd(ch, first_td);
+        (void) CyDmaChEnable(ch, 1u);
+    }
+
+    // Everything's programmed. Go!
+    for( c = 0; c < num_channels; c++){
+        (void) CyDmaChSetRequest(channels[c], CY_DMA_CPU_REQ);
+    }
+    stats.setup_cycles = CycleCounter_Now() - t0;
+    start_done_time = CycleCounter_Now();
+    // What it would have cost without the DMA. Working it out here is part of the overlap, not the setup.
+    stats.cpu_cycles = DmaInit_EstimateCpuCycles(regions, num_regions);
+    return 1;
+}
+
+void DmaInit_Wait(void){
+    uint32 t0 = CycleCounter_Now();
+    uint8 c;
+    stats.overlap_cycles = t0 - start_done_time;
+    for( c = 0; c < num_channels; c++){
+        uint8 current_td;
+        uint8 state;
+        // Done when the CPU request has been taken AND the chain isn't running anymore.
+        do {
+            (void) CyDmaChStatus(channels[c], &current_td, &state);
+        } while( (state & CY_DMA_STATUS_CHAIN_ACTIVE) != 0 || CyDmaChGetRequest(channels[c]) != 0 );
+    }
+    stats.wait_cycles = CycleCounter_Now() - t0;
+    if( num_channels == 0 ){
+        // The CPU did it in DmaInit_Start, so nothing was saved.
+        return;
+    }
+    DmaInit_Release();
+#if DMA_INIT_MEASURE_CPU
+    // Check the estimate: do the same copies and zero-fills again with the CPU, and time them.
+    // Nothing has touched the regions since, so this writes the same bytes that are already there.
+    t0 = CycleCounter_Now();
+    DmaInit_CpuFallback(started_regions, num_started_regions);
+    stats.cpu_cycles = CycleCounter_Now() - t0;
+    num_started_regions = 0;
+#endif
+    // The DMA way cost the CPU setup_cycles plus wait_cycles. Whatever ran during the overlap would have run anyway.
+    stats.saved_cycles = (stats.cpu_cycles > stats.setup_cycles + stats.wait_cycles)
+        ? (stats.cpu_cycles - stats.setup_cycles - stats.wait_cycles) : 0;
+}
+
+const DmaInit_Stats * DmaInit_GetStats(void){
+    return &stats;
+}
+
+/* [] END OF FILE */
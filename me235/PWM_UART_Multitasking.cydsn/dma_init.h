@@ -0,0 +1,82 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * dma_init.h
+ * Uses the DMA controller (the PHUB, see CyDmac.h) to copy and zero-fill big
+ * blocks of RAM, instead of the CPU doing it one word at a time.
+ * While the DMA works, the CPU is free to start up the UART and the PWM.
+ *
+ * Why not just speed up Start_c in Cm3Start.c?
+ * Cm3Start.c and cyfitter_cfg.c are re-generated by PSoC Creator on every build,
+ * and CyDmac.c keeps its own variables in .data/.bss, so the DMA API can't be used
+ * before those are initialized. So instead, large buffers are declared with
+ * DMA_INIT_ZEROED (which puts them in .noinit, so Start_c skips them), listed in a
+ * table of DmaInit_Region in main.c, and initialized here at the top of main().
+ *
+ * What it covers: only the UART's buffers in uart_helper_fcns.c are DMA_INIT_ZEROED, which is
+ * 128 + 128 + 8 x 128 bytes, about 1.25 KB. Everything else in .data and .bss (the __cy_regions table)
+ * still goes through Start_c, so the startup time this saves is small. It's the mechanism, ready for
+ * bigger buffers: mark them DMA_INIT_ZEROED and add them to the table.
+ *
+ * There are two halves:
+ * 1) the planner in dma_init_plan.h, which only does arithmetic (no hardware),
+ *    so it's checked on a regular computer, and
+ * 2) DmaInit_Start / DmaInit_Wait, here, which program the planned transfer descriptors (TDs).
+ */
+
+#ifndef DMA_INIT_H
+#define DMA_INIT_H
+
+#include <project.h>
+// DmaInit_Region, and the planner.
+#include "dma_init_plan.h"
+
+// Put this in front of a big static buffer so Start_c leaves it alone, and DMA zeroes it instead.
+#define DMA_INIT_ZEROED CY_NOINIT
+
+// 1 to time memset/memcpy of the regions for real after the DMA is done (writing the same bytes again),
+// instead of estimating it from their size. That takes as long as the work the DMA just saved,
+// on every boot, so it's only for checking the estimate.
+#ifndef DMA_INIT_MEASURE_CPU
+    #define DMA_INIT_MEASURE_CPU 0
+#endif
+
+// Bytes moved per burst. 4 = one 32-bit SRAM access.
+#define DMA_INIT_BURST_BYTES 4u
+
+// Timing of the last DMA init, in CPU cycles (see cycle_counter.h).
+typedef struct
+{
+    // time spent programming the channels and TDs
+    uint32 setup_cycles;
+    // time between DmaInit_Start returning and DmaInit_Wait being called: other init work ran here
+    uint32 overlap_cycles;
+    // time spent in DmaInit_Wait waiting for the DMA to finish
+    uint32 wait_cycles;
+    // about how long memset/memcpy of the same regions takes (DmaInit_EstimateCpuCycles, or timed, see DMA_INIT_MEASURE_CPU)
+    uint32 cpu_cycles;
+    // cpu_cycles - (setup_cycles + wait_cycles), or 0: how many fewer cycles the CPU spent on it than doing it itself
+    uint32 saved_cycles;
+} DmaInit_Stats;
+
+// Plans the regions, programs the DMA, and kicks it off. Returns right away.
+// With DMA_INIT_MEASURE_CPU, 'regions' has to stay around until DmaInit_Wait, which times the CPU doing the same work.
+// Returns 0 if planning failed or no DMA resources are left. In that case, the CPU already
+// did the work with memcpy/memset before returning, so the caller doesn't need to care.
+uint8 DmaInit_Start(const DmaInit_Region * regions, uint8 num_regions);
+
+// Blocks until the DMA from DmaInit_Start is finished, then frees the channels and TDs.
+void DmaInit_Wait(void);
+
+// Timing of the last Start/Wait pair.
+const DmaInit_Stats * DmaInit_GetStats(void);
+
+#endif //DMA_INIT_H
+
+/* [] END OF FILE */
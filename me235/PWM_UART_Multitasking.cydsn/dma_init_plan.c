@@ -0,0 +1,99 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See dma_init_plan.h. No hardware in here.
+#include "dma_init_plan.h"
+#include <project.h>
+
+/**
+ * Returns the index of the chain that uses these upper address bits,
+ * adding a new chain if there isn't one yet. Returns DMA_INIT_MAX_CHAINS if out of chains.
+ */
+static uint8 DmaInit_FindChain(DmaInit_Plan * p, uint16 src_hi, uint16 dst_hi){
+    uint8 i;
+    for( i = 0; i < p->num_chains; i++){
+        if( p->chains[i].src_hi == src_hi && p->chains[i].dst_hi == dst_hi ){
+            return i;
+        }
+    }
+    if( p->num_chains == DMA_INIT_MAX_CHAINS ){
+        return DMA_INIT_MAX_CHAINS;
+    }
+    p->chains[i].src_hi = src_hi;
+    p->chains[i].dst_hi = dst_hi;
+    p->chains[i].num_tds = 0;
+    p->num_chains++;
+    return i;
+}
+
+uint8 DmaInit_PlanRegions(const DmaInit_Region * regions, uint8 num_regions, uint32 zero_word_address, DmaInit_Plan * p){
+    uint8 r;
+    p->num_tds = 0;
+    p->num_chains = 0;
+    for( r = 0; r < num_regions; r++){
+        const DmaInit_Region * region = &regions[r];
+        uint32 src = region->zero_fill ? zero_word_address : region->src;
+        uint32 dst = region->dst;
+        uint32 remaining = region->size;
+        // Everything moves in whole 32-bit words.
+        if( ((src | dst | remaining) & 0x3u) != 0 ){
+            return 0;
+        }
+        while( remaining > 0 ){
+            uint32 chunk = remaining;
+            uint32 room;
+            uint8 chain;
+            DmaInit_TdPlan * td;
+            if( chunk > DMA_INIT_MAX_TD_BYTES ){
+                chunk = DMA_INIT_MAX_TD_BYTES;
+            }
+            // A TD can't cross a 64 KB boundary, because the upper 16 bits of the address are fixed per channel.
+            // (This matters: the PSoC 5LP's SRAM straddles 0x20000000.)
+            room = 0x10000u - (dst & 0xFFFFu);
+            if( chunk > room ){
+                chunk = room;
+            }
+            if( !region->zero_fill ){
+                room = 0x10000u - (src & 0xFFFFu);
+                if( chunk > room ){
+                    chunk = room;
+                }
+            }
+            chain = DmaInit_FindChain(p, (uint16)(src >> 16), (uint16)(dst >> 16));
+            if( chain == DMA_INIT_MAX_CHAINS || p->num_tds == DMA_INIT_MAX_TDS ){
+                return 0;
+            }
+            td = &p->tds[p->num_tds];
+            td->src_lo = (uint16)(src & 0xFFFFu);
+            td->dst_lo = (uint16)(dst & 0xFFFFu);
+            td->count = (uint16) chunk;
+            td->flags = region->zero_fill ? CY_DMA_TD_INC_DST_ADR : (CY_DMA_TD_INC_DST_ADR | CY_DMA_TD_INC_SRC_ADR);
+            td->chain = chain;
+            p->chains[chain].num_tds++;
+            p->num_tds++;
+            dst += chunk;
+            if( !region->zero_fill ){
+                src += chunk;
+            }
+            remaining -= chunk;
+        }
+    }
+    return 1;
+}
+
+uint32 DmaInit_EstimateCpuCycles(const DmaInit_Region * regions, uint8 num_regions){
+    uint8 r;
+    uint32 cycles = 0;
+    for( r = 0; r < num_regions; r++){
+        uint32 words = (regions[r].size + 3u) / 4u;
+        cycles += words * (regions[r].zero_fill ? DMA_INIT_CPU_ZERO_CYCLES_PER_WORD : DMA_INIT_CPU_COPY_CYCLES_PER_WORD);
+    }
+    return cycles;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,81 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * dma_init_plan.h
+ * The planning half of dma_init.h: splits blocks of memory into the DMA's transfer descriptors (TDs),
+ * and works out about how long the CPU would have taken to do the same thing.
+ * It only does arithmetic on addresses (nothing here touches the hardware), so it's checked
+ * on a regular computer in host_tests/test_dma_init.c. dma_init.c programs what it plans.
+ */
+
+#ifndef DMA_INIT_PLAN_H
+#define DMA_INIT_PLAN_H
+
+#include <project.h>
+
+// One TD can move at most 4095 bytes. We keep every TD a multiple of 4 bytes (one SRAM word).
+#define DMA_INIT_MAX_TD_BYTES 4092u
+// How many TDs and channels we're willing to use. There are 128 TDs total on the chip,
+// and the rest of the firmware needs a few too.
+#define DMA_INIT_MAX_TDS 16u
+#define DMA_INIT_MAX_CHAINS 4u
+
+// About how many CPU cycles a word-at-a-time loop takes per 32-bit word: a store, an add, a compare
+// and a branch to zero one, and a load on top of that to copy one. An estimate, not a measurement:
+// build with DMA_INIT_MEASURE_CPU set to 1 (see dma_init.h) to time the real memset/memcpy once and compare.
+#define DMA_INIT_CPU_ZERO_CYCLES_PER_WORD 4u
+#define DMA_INIT_CPU_COPY_CYCLES_PER_WORD 6u
+
+// One block of memory to set up: either a copy (src -> dst) or a zero-fill (src unused).
+typedef struct
+{
+    uint32 src;
+    uint32 dst;
+    uint32 size;
+    uint8 zero_fill;
+} DmaInit_Region;
+
+// What each planned TD should do. The DMA only stores the lower 16 bits of addresses
+// in a TD. The upper 16 bits are set once per channel, so every TD in a chain
+// has to share them. That's why TDs get grouped into chains.
+typedef struct
+{
+    uint16 src_lo;
+    uint16 dst_lo;
+    uint16 count;
+    uint8 flags;
+    uint8 chain;
+} DmaInit_TdPlan;
+
+typedef struct
+{
+    uint16 src_hi;
+    uint16 dst_hi;
+    uint8 num_tds;
+} DmaInit_ChainPlan;
+
+typedef struct
+{
+    DmaInit_TdPlan tds[DMA_INIT_MAX_TDS];
+    DmaInit_ChainPlan chains[DMA_INIT_MAX_CHAINS];
+    uint8 num_tds;
+    uint8 num_chains;
+} DmaInit_Plan;
+
+// Splits the regions into TDs. Returns 1 if it all fit, 0 if not (too many TDs/chains,
+// or a region that's not word-aligned). zero_word is the address of a 4-byte zero
+// that zero-fill TDs read from over and over.
+uint8 DmaInit_PlanRegions(const DmaInit_Region * regions, uint8 num_regions, uint32 zero_word, DmaInit_Plan * plan);
+
+// About how many cycles the CPU would take to do the same copies and zero-fills itself.
+uint32 DmaInit_EstimateCpuCycles(const DmaInit_Region * regions, uint8 num_regions);
+
+#endif //DMA_INIT_PLAN_H
+
+/* [] END OF FILE */
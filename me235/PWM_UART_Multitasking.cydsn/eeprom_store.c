@@ -0,0 +1,78 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See eeprom_store.h for how the EEPROM is split up.
+#include "eeprom_store.h"
+#include <project.h>
+// memcpy and memcmp, for the rows.
+#include <string.h>
+
+void EepromStore_Init(void){
+    CyEEPROM_Start();
+}
+
+const uint8 * EepromStore_Get(uint16 address){
+    return (const uint8 *)(CY_EEPROM_BASE + address);
+}
+
+uint8 EepromStore_Write(uint16 address, const void * data, uint16 size){
+    const uint8 * bytes = (const uint8 *) data;
+    uint8 row[EEPROM_STORE_ROW_SIZE];
+    uint16 row_number;
+    uint16 start;
+    uint16 count;
+    uint8 temperature_read = 0;
+    if( (uint32) address + size > EEPROM_STORE_SIZE ){
+        return 0;
+    }
+    while( size > 0 ){
+        row_number = address / EEPROM_STORE_ROW_SIZE;
+        start = address % EEPROM_STORE_ROW_SIZE;
+        count = EEPROM_STORE_ROW_SIZE - start;
+        if( count > size ){
+            count = size;
+        }
+        // A row is always written whole, so start from what's there now.
+        memcpy( row, EepromStore_Get( row_number * EEPROM_STORE_ROW_SIZE ), EEPROM_STORE_ROW_SIZE );
+        if( memcmp( &row[start], bytes, count ) != 0 ){
+            memcpy( &row[start], bytes, count );
+            // The write timing depends on the die temperature, which the SPC measures once before the first row.
+            if( !temperature_read ){
+                if( CySetTemp() != CYRET_SUCCESS ){
+                    return 0;
+                }
+                temperature_read = 1;
+            }
+            if( CyWriteRowData( CY_SPC_FIRST_EE_ARRAYID, row_number, row ) != CYRET_SUCCESS ){
+                return 0;
+            }
+        }
+        address += count;
+        bytes += count;
+        size -= count;
+    }
+    return 1;
+}
+
+/**
+ * Fletcher-16: two running sums, mod 255. Cheap to compute, and unlike a plain sum,
+ * it notices when bytes are swapped around.
+ */
+uint16 EepromStore_Checksum(const void * data, uint16 size){
+    const uint8 * bytes = (const uint8 *) data;
+    uint16 sum1 = 0;
+    uint16 sum2 = 0;
+    uint16 i;
+    for( i = 0; i < size; i++){
+        sum1 = (sum1 + bytes[i]) % 255u;
+        sum2 = (sum2 + sum1) % 255u;
+    }
+    return (uint16)((sum2 << 8) | sum1);
+}
+
+/* [] END OF FILE */
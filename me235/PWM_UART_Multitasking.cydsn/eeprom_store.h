@@ -0,0 +1,56 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * eeprom_store.h
+ * The PSoC 5LP has 2 KB of EEPROM, which keeps its contents with the power off.
+ * There's no EEPROM component in the schematic: cy_boot (CyFlash.h) can already start it and write it,
+ * one 16-byte row at a time. Reading is just reading memory, starting at CY_EEPROM_BASE.
+ *
+ * Each thing that's saved gets its own part of the EEPROM, below, starting on a row,
+ * so saving one never rewrites another.
+ * EepromStore_Write only writes the rows that actually changed, since every write wears the EEPROM out a little
+ * (it's good for about a million writes per row). A row takes a few milliseconds,
+ * and the CPU waits for it, so save things from the main loop, never from an ISR.
+ *
+ * EepromStore_Checksum doesn't touch the hardware, so it can be checked on a regular computer.
+ */
+
+#ifndef EEPROM_STORE_H
+#define EEPROM_STORE_H
+
+#include <project.h>
+
+#define EEPROM_STORE_ROW_SIZE CYDEV_EEPROM_ROW_SIZE
+#define EEPROM_STORE_SIZE CYDEV_EE_SIZE
+
+// Who gets which part. Addresses and sizes are in bytes, and have to be whole rows.
+// The motion script (motion_script.h).
+#define EEPROM_STORE_SCRIPT_ADDRESS 0u
+#define EEPROM_STORE_SCRIPT_SIZE 512u
+// The preset slots (presets.h), EEPROM_STORE_PRESET_SIZE each.
+#define EEPROM_STORE_PRESETS_ADDRESS 512u
+#define EEPROM_STORE_PRESET_SIZE 144u
+#define EEPROM_STORE_PRESETS_SIZE 1152u
+
+// Turns the EEPROM on. Call once at startup, before any other EepromStore_ function.
+void EepromStore_Init(void);
+
+// Where the EEPROM's bytes at 'address' can be read from.
+const uint8 * EepromStore_Get(uint16 address);
+
+// Writes 'size' bytes at 'address'. Returns 1 if they were all written, 0 if not
+// (out of range, or the EEPROM said no).
+uint8 EepromStore_Write(uint16 address, const void * data, uint16 size);
+
+// Fletcher-16 over 'size' bytes, to tell saved data from garbage. The warm restart snapshot uses it too.
+uint16 EepromStore_Checksum(const void * data, uint16 size);
+
+#endif //EEPROM_STORE_H
+
+/* [] END OF FILE */
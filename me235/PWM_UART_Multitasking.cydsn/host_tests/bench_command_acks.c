@@ -0,0 +1,245 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// command_acks: how many commands a second uart_pipeline.py gets through, with windows of 1, 2, 4 and 8.
+// The PSoC here is the firmware's UART ISR and line task, on one end of a pty. uart_pipeline.py runs
+// (with python3) on the other end, just like it would on /dev/ttyACM0.
+// A pty is as fast as the computer, so the link is slowed down to look like the real one: every byte
+// takes its time on the wire at 115200 baud, and the USB-UART bridge holds everything for a USB frame (1 ms)
+// each way. That latency is what a bigger window hides, until the wire is full.
+// These are the wire and the bridge as the numbers say, not measured on a real kit.
+#define _GNU_SOURCE
+#include "fake_psoc.h"
+#include "uart_helper_fcns.h"
+#include "servo_bank.h"
+#include "timer_service.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define COMMANDS 400u
+// 10 bits a byte at 115200 baud, and one USB frame.
+#define BYTE_NS 86806u
+#define LATENCY_NS 1000000u
+#define QUEUE_LENGTH 4096u
+
+// Bytes on their way one direction, and when each one gets to the other end.
+typedef struct {
+    uint8 bytes[QUEUE_LENGTH];
+    uint64 due[QUEUE_LENGTH];
+    uint32 head;
+    uint32 tail;
+    // When the wire is done with the last byte put on it.
+    uint64 wire_free;
+} Link;
+
+static Link to_psoc;
+static Link to_pc;
+static uint32 bytes_to_psoc;
+
+static void Link_Reset(Link * link){
+    link->head = 0;
+    link->tail = 0;
+    link->wire_free = 0;
+}
+
+static uint8 Link_Full(const Link * link){
+    return link->head - link->tail == QUEUE_LENGTH;
+}
+
+static void Link_Put(Link * link, uint8 byte, uint64 now){
+    if( link->wire_free < now + LATENCY_NS ){
+        link->wire_free = now + LATENCY_NS;
+    }
+    link->wire_free += BYTE_NS;
+    link->bytes[link->head % QUEUE_LENGTH] = byte;
+    link->due[link->head % QUEUE_LENGTH] = link->wire_free;
+    link->head++;
+}
+
+static uint8 Link_Due(const Link * link, uint64 now){
+    return link->head != link->tail && link->due[link->tail % QUEUE_LENGTH] <= now;
+}
+
+// Runs uart_pipeline.py with a window, and plays the PSoC until it's done. Returns 0 if it couldn't run.
+static uint8 Run(int master, const char * slave, const char * commands, uint8 window){
+    char command[256];
+    char output[4096];
+    char what[80];
+    uint32 output_length = 0;
+    unsigned long sent = 0;
+    unsigned long failed = 0;
+    unsigned long got_window = 0;
+    double seconds = 0;
+    const char * summary;
+    uint8 buffer[256];
+    FILE * client;
+    int client_fd;
+    uint8 running = 1;
+
+    Link_Reset( &to_psoc );
+    Link_Reset( &to_pc );
+    bytes_to_psoc = 0;
+    (void) tcflush( master, TCIOFLUSH );
+    Host_UartClear();
+
+    snprintf( command, sizeof(command), "python3 ../uart_pipeline.py --window %u %s %s 2>&1",
+        (unsigned) window, slave, commands );
+    client = popen( command, "r" );
+    if( client == NULL ){
+        return 0;
+    }
+    client_fd = fileno( client );
+    (void) fcntl( client_fd, F_SETFL, fcntl( client_fd, F_GETFL ) | O_NONBLOCK );
+
+    while( running ){
+        struct pollfd fds[2];
+        struct timespec wait = { 0, 5000000 };
+        uint64 now = Host_Nanoseconds();
+        uint64 next = now + 5000000u;
+        ssize_t got;
+        ssize_t i;
+
+        // Sleep until the next byte gets where it's going, or something comes in.
+        if( to_psoc.head != to_psoc.tail && to_psoc.due[to_psoc.tail % QUEUE_LENGTH] < next ){
+            next = to_psoc.due[to_psoc.tail % QUEUE_LENGTH];
+        }
+        if( to_pc.head != to_pc.tail && to_pc.due[to_pc.tail % QUEUE_LENGTH] < next ){
+            next = to_pc.due[to_pc.tail % QUEUE_LENGTH];
+        }
+        wait.tv_nsec = (next > now) ? (long)(next - now) : 0;
+        fds[0].fd = master;
+        fds[0].events = Link_Full( &to_psoc ) ? 0 : POLLIN;
+        fds[1].fd = client_fd;
+        fds[1].events = POLLIN;
+        (void) ppoll( fds, 2, &wait, NULL );
+        now = Host_Nanoseconds();
+
+        // From the PC, onto the wire.
+        if( fds[0].revents & POLLIN ){
+            got = read( master, buffer, QUEUE_LENGTH - (to_psoc.head - to_psoc.tail) < sizeof(buffer)
+                ? QUEUE_LENGTH - (to_psoc.head - to_psoc.tail) : sizeof(buffer) );
+            for( i = 0; i < got; i++){
+                Link_Put( &to_psoc, buffer[i], now );
+            }
+            bytes_to_psoc += (got > 0) ? (uint32) got : 0u;
+        }
+        // Off the wire, into the UART ISR. The line task runs right away, like it does on the PSoC,
+        // where a line takes a lot less time to run than the next one takes to come in.
+        if( Link_Due( &to_psoc, now ) ){
+            while( Link_Due( &to_psoc, now ) ){
+                Host_UartReceive( to_psoc.bytes[to_psoc.tail % QUEUE_LENGTH], Interrupt_Handler_UART_Receive );
+                to_psoc.tail++;
+            }
+            for( i = 0; i < 16; i++){
+                UART_Helper_ProcessLine();
+            }
+            for( i = 0; host_uart_out[i] != '\0'; i++){
+                Link_Put( &to_pc, (uint8) host_uart_out[i], now );
+            }
+            Host_UartClear();
+        }
+        // Back to the PC.
+        while( Link_Due( &to_pc, now ) ){
+            (void) write( master, &to_pc.bytes[to_pc.tail % QUEUE_LENGTH], 1 );
+            to_pc.tail++;
+        }
+        // What uart_pipeline.py prints. It's done when it closes.
+        if( fds[1].revents & (POLLIN | POLLHUP) ){
+            got = read( client_fd, output + output_length, sizeof(output) - 1u - output_length );
+            if( got > 0 ){
+                output_length += (uint32) got;
+            }
+            else if( got == 0 || output_length == sizeof(output) - 1u ){
+                running = 0;
+            }
+        }
+    }
+    output[output_length] = '\0';
+    if( pclose( client ) != 0 ){
+        printf( "%s", output );
+        return 0;
+    }
+
+    // "400 commands (0 failed) in 1.234 s with a window of 8: 324 commands a second"
+    summary = strstr( output, " commands (" );
+    while( summary != NULL && summary > output && summary[-1] != '\n' ){
+        summary--;
+    }
+    if( summary == NULL
+        || sscanf( summary, "%lu commands (%lu failed) in %lf s with a window of %lu",
+            &sent, &failed, &seconds, &got_window ) != 4 ){
+        printf( "%s", output );
+        CHECK( 0 );
+        return 1;
+    }
+    CHECK( sent == COMMANDS && failed == 0 && got_window == window );
+    snprintf( what, sizeof(what), "window of %u", (unsigned) window );
+    Host_BenchReport( what, (uint64)(seconds * 1e9), (uint32) sent );
+    return 1;
+}
+
+int main(void){
+    static const char * const kinds[] = { "d : %u", "d3 : %u", "d2 : %u", "d1 : %u" };
+    char commands[] = "/tmp/bench_command_acksXXXXXX";
+    struct termios raw;
+    const char * slave;
+    FILE * file;
+    uint8 windows[] = { 1, 2, 4, 8 };
+    uint32 i;
+    int master;
+    int slave_fd;
+
+    srand(50);
+    if( system( "python3 -c '' 2>/dev/null" ) != 0 ){
+        printf( "  no python3 to run uart_pipeline.py with, so nothing to time\n" );
+        return Host_Done("bench_command_acks");
+    }
+    host_pwm_period = 19999;
+    ServoBank_Init();
+    TimerService_Init();
+
+    // The commands, all ones that work.
+    CHECK( mkstemp( commands ) >= 0 );
+    file = fopen( commands, "w" );
+    CHECK( file != NULL );
+    for( i = 0; i < COMMANDS; i++){
+        fprintf( file, kinds[i % 4u], 1000u + (unsigned)(rand() % 1000) );
+        fprintf( file, "\n" );
+    }
+    fclose( file );
+
+    master = posix_openpt( O_RDWR | O_NOCTTY );
+    CHECK( master >= 0 && grantpt( master ) == 0 && unlockpt( master ) == 0 );
+    slave = ptsname( master );
+    // Held open here too, so the pty stays up between runs.
+    slave_fd = open( slave, O_RDWR | O_NOCTTY );
+    CHECK( slave_fd >= 0 && tcgetattr( slave_fd, &raw ) == 0 );
+    cfmakeraw( &raw );
+    (void) tcsetattr( slave_fd, TCSANOW, &raw );
+
+    printf( "%lu commands through uart_pipeline.py, 115200 baud and 1 ms each way:\n", (unsigned long) COMMANDS );
+    for( i = 0; i < sizeof(windows); i++){
+        if( !Run( master, slave, commands, windows[i] ) ){
+            printf( "  uart_pipeline.py didn't run, so nothing to time\n" );
+            break;
+        }
+    }
+    // The wire's limit, with the biggest window: every byte of every line, back to back.
+    Host_BenchReport( "just the bytes on the wire", (uint64) bytes_to_psoc * BYTE_NS, COMMANDS );
+
+    close( slave_fd );
+    close( master );
+    unlink( commands );
+    return Host_Done("bench_command_acks");
+}
+
+/* [] END OF FILE */
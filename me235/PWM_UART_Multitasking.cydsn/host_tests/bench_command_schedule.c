@@ -0,0 +1,88 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// command_schedule: what adding a command and running it costs, with thousands waiting,
+// a few ticks away or minutes away. Every command that runs is added again, so the number
+// waiting stays the same. The cost of running one includes its share of the cascades.
+#include "fake_psoc.h"
+#include "command_schedule.h"
+#include <stdlib.h>
+
+#define MAX_ENTRIES 10000u
+#define TICKS 20000u
+
+static CommandSchedule_Entry entries[MAX_ENTRIES];
+static CommandSchedule_Wheel wheel;
+// How far ahead commands are added, in ticks. Drawn ahead of time, so rand() isn't in the timing.
+static uint32 horizon = 1;
+static uint32 aheads[4096];
+static uint32 next_ahead = 0;
+static uint32 ran = 0;
+static uint32 late = 0;
+
+static uint32 Ahead(void){
+    next_ahead = (next_ahead + 1u) & 4095u;
+    return aheads[next_ahead];
+}
+
+static void Again(CommandSchedule_Entry * entry){
+    if( entry->at != wheel.now ){
+        late++;
+    }
+    ran++;
+    entry->at = wheel.now + Ahead();
+    CommandSchedule_Insert( &wheel, entry );
+}
+
+static void Bench(uint32 count, uint32 ahead){
+    char what[80];
+    uint64 start;
+    uint32 i;
+    uint32 tick;
+
+    horizon = ahead;
+    for( i = 0; i < 4096u; i++){
+        aheads[i] = 1u + (uint32) rand() % horizon;
+    }
+    CommandSchedule_WheelInit( &wheel, (uint32) rand() );
+    ran = 0;
+    printf( "%lu commands waiting, each up to %lu ticks away:\n", (unsigned long) count, (unsigned long) ahead );
+
+    start = Host_Nanoseconds();
+    for( i = 0; i < count; i++){
+        entries[i].at = wheel.now + Ahead();
+        entries[i].id = (uint16) i;
+        CommandSchedule_Insert( &wheel, &entries[i] );
+    }
+    Host_BenchReport( "CommandSchedule_Insert", Host_Nanoseconds() - start, count );
+
+    start = Host_Nanoseconds();
+    for( tick = 0; tick < TICKS; tick++){
+        (void) CommandSchedule_Advance( &wheel, Again );
+    }
+    start = Host_Nanoseconds() - start;
+    snprintf( what, sizeof(what), "CommandSchedule_Advance, per command run (%lu)", (unsigned long) ran );
+    Host_BenchReport( what, start, ran );
+    Host_BenchReport( "CommandSchedule_Advance, per tick", start, TICKS );
+}
+
+int main(void){
+    srand(39);
+    // The first wheel only, then the second, then all three.
+    Bench( 1000u, COMMAND_SCHEDULE_WHEEL_SLOTS );
+    Bench( 10000u, COMMAND_SCHEDULE_WHEEL_SLOTS );
+    Bench( 1000u, COMMAND_SCHEDULE_WHEEL_SLOTS * COMMAND_SCHEDULE_WHEEL_SLOTS );
+    Bench( 10000u, COMMAND_SCHEDULE_WHEEL_SLOTS * COMMAND_SCHEDULE_WHEEL_SLOTS );
+    Bench( 1000u, 250000u );
+    Bench( 10000u, 250000u );
+    // Every one of them ran on its own tick.
+    CHECK( late == 0 );
+    return Host_Done("bench_command_schedule");
+}
+
+/* [] END OF FILE */
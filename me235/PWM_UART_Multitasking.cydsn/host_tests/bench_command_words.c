@@ -0,0 +1,245 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// command words: finding a word with the perfect hash, against going down the list with strncmp.
+// First with the real command table and UART_Helper_FindWord. Then with made-up tables of 10, 50 and 200 words,
+// with hash tables built here the same way uart_command_hash.py builds them, and looked up the same way
+// UART_Helper_FindWord does. The hash should take the same time at every size; the list gets slower.
+#include "fake_psoc.h"
+#include "uart_helper_fcns.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LOOKUPS 1000000u
+#define MAX_WORDS 200u
+#define FNV_BASIS 0x811C9DC5u
+#define MAX_DISPLACE 0x7FFF
+
+// Every word from the real table, for the list search.
+#define WORD_OF(letter, word, Name, lowest, highest, flags, help) word,
+static const char * const real_words[] = { UART_COMMANDS(WORD_OF) };
+#define REAL_WORDS (sizeof(real_words) / sizeof(real_words[0]))
+
+// A made-up table, and its hash tables.
+static char words[MAX_WORDS][UART_COMMAND_WORD_LENGTH + 1u];
+static uint32 word_count;
+static int16 displace[MAX_WORDS];
+static uint8 slot_word[MAX_WORDS];
+
+// What to look up: which word, or a word that isn't in the table.
+static const char * queries[LOOKUPS];
+static uint8 query_lengths[LOOKUPS];
+static char misses[64][UART_COMMAND_WORD_LENGTH + 1u];
+static volatile uint32 sink;
+
+// FNV-1a, the same as UART_Helper_HashWord and uart_command_hash.py.
+static uint32 Hash(const char * word, uint8 length, uint32 seed){
+    uint32 hash = seed;
+    uint8 i;
+    for( i = 0; i < length; i++){
+        hash = (hash ^ (uint8) word[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Looked up like UART_Helper_FindWord. Returns the word's index, or word_count if it isn't one.
+static uint32 Hash_Find(const char * word, uint8 length){
+    int16 d = displace[Hash( word, length, FNV_BASIS ) % word_count];
+    uint8 slot = (d < 0) ? (uint8)(-d - 1) : (uint8)(Hash( word, length, (uint32) d ) % word_count);
+    uint32 found = slot_word[slot];
+    if( strncmp( words[found], word, length ) != 0 || words[found][length] != '\0' ){
+        return word_count;
+    }
+    return found;
+}
+
+// The way it would be without the hash.
+static uint32 List_Find(const char * word, uint8 length){
+    uint32 i;
+    for( i = 0; i < word_count; i++){
+        if( strncmp( words[i], word, length ) == 0 && words[i][length] == '\0' ){
+            return i;
+        }
+    }
+    return word_count;
+}
+
+static uint32 Real_List_Find(const char * word, uint8 length){
+    uint32 i;
+    for( i = 0; i < REAL_WORDS; i++){
+        if( strncmp( real_words[i], word, length ) == 0 && real_words[i][length] == '\0' ){
+            return i;
+        }
+    }
+    return REAL_WORDS;
+}
+
+static void Random_Word(char * word){
+    uint32 length = 3u + (uint32) rand() % 8u;
+    uint32 i;
+    for( i = 0; i < length; i++){
+        word[i] = (char)('a' + rand() % 26);
+    }
+    word[length] = '\0';
+}
+
+// uart_command_hash.py's build(), in C. Returns 0 if some bucket has no displacement that works.
+static uint8 Build(void){
+    static uint8 bucket_of[MAX_WORDS];
+    static uint8 bucket_size[MAX_WORDS];
+    static uint8 taken[MAX_WORDS];
+    uint32 size;
+    uint32 b;
+    uint32 w;
+    uint32 free_slot = 0;
+    memset( bucket_size, 0, sizeof(bucket_size) );
+    memset( taken, 0, sizeof(taken) );
+    for( w = 0; w < word_count; w++){
+        bucket_of[w] = (uint8)(Hash( words[w], (uint8) strlen( words[w] ), FNV_BASIS ) % word_count);
+        bucket_size[bucket_of[w]]++;
+    }
+    // The crowded buckets first, while there are lots of free slots.
+    for( size = MAX_WORDS; size > 1u; size--){
+        for( b = 0; b < word_count; b++){
+            int32 seed;
+            if( bucket_size[b] != size ){
+                continue;
+            }
+            for( seed = 1; seed <= MAX_DISPLACE; seed++){
+                uint8 trial[MAX_WORDS];
+                uint8 fits = 1;
+                memcpy( trial, taken, word_count );
+                for( w = 0; w < word_count && fits; w++){
+                    if( bucket_of[w] == b ){
+                        uint32 t = Hash( words[w], (uint8) strlen( words[w] ), (uint32) seed ) % word_count;
+                        fits = !trial[t];
+                        trial[t] = 1;
+                    }
+                }
+                if( fits ){
+                    break;
+                }
+            }
+            if( seed > MAX_DISPLACE ){
+                return 0;
+            }
+            displace[b] = (int16) seed;
+            for( w = 0; w < word_count; w++){
+                if( bucket_of[w] == b ){
+                    uint32 t = Hash( words[w], (uint8) strlen( words[w] ), (uint32) seed ) % word_count;
+                    taken[t] = 1;
+                    slot_word[t] = (uint8) w;
+                }
+            }
+        }
+    }
+    // Then the words alone in their bucket take any free slot.
+    for( w = 0; w < word_count; w++){
+        if( bucket_size[bucket_of[w]] == 1u ){
+            while( taken[free_slot] ){
+                free_slot++;
+            }
+            taken[free_slot] = 1;
+            slot_word[free_slot] = (uint8) w;
+            displace[bucket_of[w]] = (int16)(-(int32) free_slot - 1);
+        }
+    }
+    return 1;
+}
+
+// Three in four lookups are real words, the rest aren't.
+static void Make_Queries(const char * const * table, uint32 count){
+    uint32 i;
+    for( i = 0; i < LOOKUPS; i++){
+        queries[i] = (rand() % 4 != 0) ? table[(uint32) rand() % count] : misses[rand() % 64];
+        query_lengths[i] = (uint8) strlen( queries[i] );
+    }
+}
+
+static void Bench(uint32 count){
+    static const char * table[MAX_WORDS];
+    char what[80];
+    uint64 start;
+    uint32 sum = 0;
+    uint32 wrong = 0;
+    uint32 i;
+    uint32 j;
+
+    // Different words, none of them one of the misses.
+    word_count = 0;
+    while( word_count < count ){
+        Random_Word( words[word_count] );
+        for( j = 0; j < word_count && strcmp( words[j], words[word_count] ) != 0; j++){
+        }
+        for( i = 0; i < 64u && strcmp( misses[i], words[word_count] ) != 0; i++){
+        }
+        if( j == word_count && i == 64u ){
+            table[word_count] = words[word_count];
+            word_count++;
+        }
+    }
+    CHECK( Build() );
+    for( i = 0; i < count; i++){
+        if( Hash_Find( words[i], (uint8) strlen( words[i] ) ) != i ){
+            wrong++;
+        }
+    }
+    CHECK( wrong == 0 );
+    Make_Queries( table, count );
+
+    start = Host_Nanoseconds();
+    for( i = 0; i < LOOKUPS; i++){
+        sum += Hash_Find( queries[i], query_lengths[i] );
+    }
+    snprintf( what, sizeof(what), "%3lu words, perfect hash", (unsigned long) count );
+    Host_BenchReport( what, Host_Nanoseconds() - start, LOOKUPS );
+    sink = sum;
+
+    start = Host_Nanoseconds();
+    for( i = 0; i < LOOKUPS; i++){
+        sum -= List_Find( queries[i], query_lengths[i] );
+    }
+    snprintf( what, sizeof(what), "%3lu words, down the list", (unsigned long) count );
+    Host_BenchReport( what, Host_Nanoseconds() - start, LOOKUPS );
+    // Both found the same thing every time.
+    CHECK( sum == 0 );
+}
+
+int main(void){
+    uint64 start;
+    uint32 sum = 0;
+    uint32 i;
+
+    srand(46);
+    for( i = 0; i < 64u; i++){
+        Random_Word( misses[i] );
+    }
+
+    printf( "The real table (%lu words), 3 in 4 lookups a word in it:\n", (unsigned long) REAL_WORDS );
+    Make_Queries( real_words, REAL_WORDS );
+    start = Host_Nanoseconds();
+    for( i = 0; i < LOOKUPS; i++){
+        sum += (UART_Helper_FindWord( queries[i], query_lengths[i] ) != NULL);
+    }
+    Host_BenchReport( "UART_Helper_FindWord", Host_Nanoseconds() - start, LOOKUPS );
+    sink = sum;
+    start = Host_Nanoseconds();
+    for( i = 0; i < LOOKUPS; i++){
+        sum -= (Real_List_Find( queries[i], query_lengths[i] ) != REAL_WORDS);
+    }
+    Host_BenchReport( "down the list", Host_Nanoseconds() - start, LOOKUPS );
+    CHECK( sum == 0 );
+
+    printf( "Made-up tables, built here like uart_command_hash.py does:\n" );
+    Bench( 10u );
+    Bench( 50u );
+    Bench( 200u );
+    return Host_Done("bench_command_words");
+}
+
+/* [] END OF FILE */
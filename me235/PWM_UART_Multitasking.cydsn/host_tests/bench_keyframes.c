@@ -0,0 +1,115 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// keyframes: what one period of playback costs, linear and cubic, for short and long segments.
+// It should be the same however long the segment is, and wherever in the segment it is.
+// Also how far the fixed point ends up from the double-precision curve.
+#include "fake_psoc.h"
+#include "keyframes.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define SEGMENTS 2000u
+#define REPEATS 50u
+
+static Keyframes_Segment segments[SEGMENTS];
+static double p0s[SEGMENTS];
+static double p1s[SEGMENTS];
+static double m0s[SEGMENTS];
+static double m1s[SEGMENTS];
+static volatile int32 sink;
+
+// The cubic Hermite curve, in doubles, like test_keyframes.c.
+static double Hermite(double p0, double p1, double m0, double m1, double u){
+    double u2 = u * u;
+    double u3 = u2 * u;
+    return (2 * u3 - 3 * u2 + 1) * p0 + (u3 - 2 * u2 + u) * m0 + (-2 * u3 + 3 * u2) * p1 + (u3 - u2) * m1;
+}
+
+static void Bench(uint16 periods, uint8 linear){
+    uint64 start;
+    uint64 begin_ns;
+    uint64 total_ns = 0;
+    uint64 where_ns[3];
+    uint32 w;
+    int32 sum = 0;
+    double worst = 0;
+    uint32 s;
+    uint16 e;
+
+    // Servo-sized moves, with Catmull-Rom-sized slopes.
+    for( s = 0; s < SEGMENTS; s++){
+        p0s[s] = 1000 + rand() % 1000;
+        p1s[s] = 1000 + rand() % 1000;
+        m0s[s] = linear ? 0 : (double)(rand() % 1000) - 500;
+        m1s[s] = linear ? 0 : (double)(rand() % 1000) - 500;
+    }
+    start = Host_Nanoseconds();
+    for( s = 0; s < SEGMENTS; s++){
+        Keyframes_BeginSegment( &segments[s], (int32) p0s[s] * 256, (int32) p1s[s] * 256, periods,
+            (int32)(m0s[s] * 256), (int32)(m1s[s] * 256), linear );
+    }
+    begin_ns = Host_Nanoseconds() - start;
+
+    // Every period of every segment, in order, like playback.
+    start = Host_Nanoseconds();
+    for( s = 0; s < SEGMENTS; s++){
+        for( e = 1; e <= periods; e++){
+            sum += Keyframes_Evaluate( &segments[s], e );
+        }
+    }
+    total_ns = Host_Nanoseconds() - start;
+    // And just the start, middle and end of each, to show where it is in the segment doesn't matter.
+    // (The end is cheaper: it's the keyframe itself, with no curve to work out.)
+    for( w = 0; w < 3u; w++){
+        uint16 where = (w == 0) ? 1u : (w == 1) ? (uint16)(periods / 2u) : periods;
+        uint32 repeat;
+        start = Host_Nanoseconds();
+        for( repeat = 0; repeat < REPEATS; repeat++){
+            for( s = 0; s < SEGMENTS; s++){
+                sum += Keyframes_Evaluate( &segments[s], where );
+            }
+        }
+        where_ns[w] = Host_Nanoseconds() - start;
+    }
+    sink = sum;
+
+    // Accuracy, outside the timing.
+    for( s = 0; s < SEGMENTS; s++){
+        for( e = 0; e <= periods; e++){
+            double u = (double) e / periods;
+            double exact = linear ? p0s[s] + (p1s[s] - p0s[s]) * u : Hermite(p0s[s], p1s[s], m0s[s], m1s[s], u);
+            double error = fabs( Keyframes_Evaluate( &segments[s], e ) / 256.0 - exact );
+            if( error > worst ){
+                worst = error;
+            }
+        }
+    }
+    CHECK( worst < 0.02 );
+
+    printf( "%s segments of %u periods (worst %.4f ticks off the double curve):\n",
+        linear ? "Linear" : "Cubic", periods, worst );
+    Host_BenchReport( "Keyframes_BeginSegment, once a segment", begin_ns, SEGMENTS );
+    Host_BenchReport( "Keyframes_Evaluate, every period", total_ns, SEGMENTS * (uint32) periods );
+    Host_BenchReport( "Keyframes_Evaluate, first period", where_ns[0], REPEATS * SEGMENTS );
+    Host_BenchReport( "Keyframes_Evaluate, middle period", where_ns[1], REPEATS * SEGMENTS );
+    Host_BenchReport( "Keyframes_Evaluate, last period", where_ns[2], REPEATS * SEGMENTS );
+}
+
+int main(void){
+    srand(38);
+    Bench( 5u, 1u );
+    Bench( 50u, 1u );
+    Bench( 500u, 1u );
+    Bench( 5u, 0u );
+    Bench( 50u, 0u );
+    Bench( 500u, 0u );
+    return Host_Done("bench_keyframes");
+}
+
+/* [] END OF FILE */
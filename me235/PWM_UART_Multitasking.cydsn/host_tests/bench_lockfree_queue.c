@@ -0,0 +1,172 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// lockfree_queue: how long each item takes to get through each queue.
+// First on one thread, a push and then a pop, which is what the PSoC does: it has one core,
+// so an ISR's push never runs at the same time as the main loop's pop. Then with real threads pushing
+// against one popping, which is harder on the queues than the PSoC ever is, against a plain ring
+// behind a pthread mutex (the closest thing a computer has to turning interrupts off).
+// On the computer, __DMB is a full fence (see project.h), which costs a lot more than it does on the
+// Cortex-M3, so the one-thread numbers make the queues look slower next to the mutex than they are.
+#include "fake_psoc.h"
+#include "lockfree_queue.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define ITEMS 4000000u
+#define MAX_PRODUCERS 4u
+#define SIZE 256u
+
+static LockFreeQueue_Spsc spsc;
+static uint32 spsc_storage[SIZE];
+static LockFreeQueue_Mpsc mpsc;
+static LockFreeQueue_Slot mpsc_storage[SIZE];
+
+// The locked ring, for comparison.
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32 locked_storage[SIZE];
+static uint32 locked_head = 0;
+static uint32 locked_tail = 0;
+
+static uint8 Locked_Push(uint32 item){
+    uint8 pushed = 0;
+    pthread_mutex_lock( &lock );
+    if( locked_head - locked_tail < SIZE ){
+        locked_storage[locked_head & (SIZE - 1u)] = item;
+        locked_head++;
+        pushed = 1;
+    }
+    pthread_mutex_unlock( &lock );
+    return pushed;
+}
+
+static uint8 Locked_Pop(uint32 * item){
+    uint8 popped = 0;
+    pthread_mutex_lock( &lock );
+    if( locked_head != locked_tail ){
+        *item = locked_storage[locked_tail & (SIZE - 1u)];
+        locked_tail++;
+        popped = 1;
+    }
+    pthread_mutex_unlock( &lock );
+    return popped;
+}
+
+static uint32 producers = 1;
+
+static void * Spsc_Producer(void * unused){
+    uint32 i;
+    (void) unused;
+    for( i = 0; i < ITEMS; i++){
+        while( !LockFreeQueue_SpscPush( &spsc, i ) ){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void * Mpsc_Producer(void * unused){
+    uint32 i;
+    (void) unused;
+    for( i = 0; i < ITEMS / producers; i++){
+        while( !LockFreeQueue_MpscPush( &mpsc, i ) ){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void * Locked_Producer(void * unused){
+    uint32 i;
+    (void) unused;
+    for( i = 0; i < ITEMS / producers; i++){
+        while( !Locked_Push( i ) ){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Starts the producers, pops everything they push, and reports how long it took.
+static void Threaded(const char * what, void * (*producer)(void *), uint8 (*pop)(uint32 *), uint32 count){
+    pthread_t threads[MAX_PRODUCERS];
+    uint64 start;
+    uint32 item;
+    uint32 total = (ITEMS / count) * count;
+    uint32 i;
+
+    producers = count;
+    start = Host_Nanoseconds();
+    for( i = 0; i < count; i++){
+        (void) pthread_create( &threads[i], NULL, producer, NULL );
+    }
+    for( i = 0; i < total; i++){
+        while( !pop( &item ) ){
+            sched_yield();
+        }
+    }
+    for( i = 0; i < count; i++){
+        (void) pthread_join( threads[i], NULL );
+    }
+    Host_BenchReport( what, Host_Nanoseconds() - start, total );
+    CHECK( !pop( &item ) );
+}
+
+static uint8 Spsc_Pop(uint32 * item){
+    return LockFreeQueue_SpscPop( &spsc, item );
+}
+
+static uint8 Mpsc_Pop(uint32 * item){
+    return LockFreeQueue_MpscPop( &mpsc, item );
+}
+
+int main(void){
+    uint64 start;
+    uint32 item;
+    uint32 sum = 0;
+    uint32 i;
+
+    CHECK( LockFreeQueue_SpscInit( &spsc, spsc_storage, SIZE ) );
+    CHECK( LockFreeQueue_MpscInit( &mpsc, mpsc_storage, SIZE ) );
+
+    printf( "One thread, push then pop:\n" );
+    start = Host_Nanoseconds();
+    for( i = 0; i < ITEMS; i++){
+        (void) LockFreeQueue_SpscPush( &spsc, i );
+        (void) LockFreeQueue_SpscPop( &spsc, &item );
+        sum += item;
+    }
+    Host_BenchReport( "SPSC", Host_Nanoseconds() - start, ITEMS );
+    start = Host_Nanoseconds();
+    for( i = 0; i < ITEMS; i++){
+        (void) LockFreeQueue_MpscPush( &mpsc, i );
+        (void) LockFreeQueue_MpscPop( &mpsc, &item );
+        sum -= item;
+    }
+    Host_BenchReport( "MPSC", Host_Nanoseconds() - start, ITEMS );
+    start = Host_Nanoseconds();
+    for( i = 0; i < ITEMS; i++){
+        (void) Locked_Push( i );
+        (void) Locked_Pop( &item );
+        sum += item;
+    }
+    Host_BenchReport( "a ring behind a mutex", Host_Nanoseconds() - start, ITEMS );
+    CHECK( sum == (uint32)((uint64) ITEMS * (ITEMS - 1u) / 2u) );
+
+    printf( "Producer threads pushing, this thread popping:\n" );
+    Threaded( "SPSC, 1 producer", Spsc_Producer, Spsc_Pop, 1u );
+    Threaded( "MPSC, 1 producer", Mpsc_Producer, Mpsc_Pop, 1u );
+    Threaded( "MPSC, 2 producers", Mpsc_Producer, Mpsc_Pop, 2u );
+    Threaded( "MPSC, 4 producers", Mpsc_Producer, Mpsc_Pop, 4u );
+    Threaded( "a ring behind a mutex, 1 producer", Locked_Producer, Locked_Pop, 1u );
+    Threaded( "a ring behind a mutex, 4 producers", Locked_Producer, Locked_Pop, 4u );
+
+    return Host_Done("bench_lockfree_queue");
+}
+
+/* [] END OF FILE */
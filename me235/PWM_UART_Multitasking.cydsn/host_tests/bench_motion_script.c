@@ -0,0 +1,158 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// motion_script: what each opcode costs the interpreter.
+// Each one is timed in a script that does it over and over in a loop. Most opcodes take from the stack
+// or add to it, so they have to go in pairs to keep the stack from running out or over: DUP and DROP,
+// PUSH and DROP, PUSH and ADD, and so on. DUP and DROP are each taken as half their pair (both just move
+// the stack), and every other opcode is its pair minus its partner. The loop's own cost is timed
+// with an empty loop and taken off.
+// WAIT and RAMP end the tick's turn, so they're timed per tick instead.
+#include "fake_psoc.h"
+#include "motion_script.h"
+#include <stdlib.h>
+
+#define OP(name) MOTION_SCRIPT_OP_##name
+// Instructions per MotionScript_Execute call, and calls per timing.
+#define BUDGET 60000u
+#define CALLS 200u
+#define TICKS 200000u
+
+static uint16 compares[4] = { 1500, 1500, 1500, 1500 };
+static uint16 periods[4];
+static void Set_Compare(uint8 channel, uint16 compare){ compares[channel] = compare; }
+static void Set_Period(uint8 channel, uint16 period){ periods[channel] = period; }
+static uint16 Get_Compare(uint8 channel){ return compares[channel]; }
+static const MotionScript_Output output = { Set_Compare, Set_Period, Get_Compare };
+
+static uint16 program[MOTION_SCRIPT_MAX_LENGTH];
+static uint16 length;
+static MotionScript_Vm vm;
+
+// Empty loop, in nanoseconds a trip around.
+static double loop_ns = 0;
+
+static void Emit(uint16 value){
+    program[length++] = value;
+}
+
+// The pairs.
+static void Jump_Next(void){ Emit(OP(JUMP)); Emit(length + 1u); }
+static void Dup_Drop(void){ Emit(OP(DUP)); Emit(OP(DROP)); }
+static void Push_Drop(void){ Emit(OP(PUSH)); Emit(7); Emit(OP(DROP)); }
+static void Push_Add(void){ Emit(OP(PUSH)); Emit(0); Emit(OP(ADD)); }
+static void Push_Sub(void){ Emit(OP(PUSH)); Emit(0); Emit(OP(SUB)); }
+static void Dup_Compare(void){ Emit(OP(DUP)); Emit(OP(COMPARE)); Emit(0); }
+static void Dup_Period(void){ Emit(OP(DUP)); Emit(OP(PERIOD)); Emit(1); }
+static void Push_Count(void){ Emit(OP(PUSH)); Emit(50000u); Emit(OP(COUNT)); Emit(2); }
+static void Loop_Next(void){ Emit(OP(LOOP)); Emit(0); Emit(length + 1u); }
+static void Ifzero_Not(void){ Emit(OP(IFZERO)); Emit(1); Emit(0); }
+
+/**
+ * Builds "PUSH 1000, PUSH 5, COUNT 1, then around and around: PUSH 50000, COUNT 0, the body as many
+ * times as fits", and runs it. Returns nanoseconds per body, less the empty loop.
+ * 1000 is for DUP to copy, counter 1 is never 0 (for IFZERO), and counter 0 never gets to 0 (for LOOP).
+ */
+static double Time_Body(void (*body)(void), uint8 instructions_per_body){
+    uint16 start;
+    uint16 bodies = 0;
+    uint16 where;
+    uint32 executed;
+    uint32 loops;
+    uint32 i;
+    uint64 ns;
+
+    length = 0;
+    Emit(OP(PUSH)); Emit(1000);
+    Emit(OP(PUSH)); Emit(5); Emit(OP(COUNT)); Emit(1);
+    start = length;
+    Emit(OP(PUSH)); Emit(50000u); Emit(OP(COUNT)); Emit(0);
+    while( body != NULL && length + 8u + 2u <= MOTION_SCRIPT_MAX_LENGTH ){
+        body();
+        bodies++;
+    }
+    Emit(OP(JUMP)); Emit(start);
+    CHECK( MotionScript_Check( program, length, &where ) == MOTION_SCRIPT_OK );
+    MotionScript_Begin( &vm, program, length, &output );
+    (void) MotionScript_Execute( &vm, 0, BUDGET );
+
+    executed = vm.executed;
+    ns = Host_Nanoseconds();
+    for( i = 0; i < CALLS; i++){
+        (void) MotionScript_Execute( &vm, 0, BUDGET );
+    }
+    ns = Host_Nanoseconds() - ns;
+    CHECK( vm.state == MOTION_SCRIPT_RUNNING );
+    executed = vm.executed - executed;
+    // Each trip around: the bodies, PUSH, COUNT and JUMP.
+    loops = executed / ((uint32) bodies * instructions_per_body + 3u);
+    if( body == NULL ){
+        return (double) ns / loops;
+    }
+    return ((double) ns - loops * loop_ns) / ((double) loops * bodies);
+}
+
+static void Report(const char * opcode, double ns){
+    printf( "  %-52s %9.1f ns each\n", opcode, ns );
+}
+
+int main(void){
+    double jump;
+    double dup_drop;
+    double push;
+    uint16 where;
+    uint64 ns;
+    uint32 now;
+
+    loop_ns = Time_Body( NULL, 0 );
+    jump = Time_Body( Jump_Next, 1 );
+    dup_drop = Time_Body( Dup_Drop, 2 );
+    push = Time_Body( Push_Drop, 2 ) - dup_drop / 2;
+
+    printf( "Each opcode, in a loop (%lu instructions a call):\n", (unsigned long) BUDGET );
+    Report( "PUSH", push );
+    Report( "DUP", dup_drop / 2 );
+    Report( "DROP", dup_drop / 2 );
+    Report( "ADD", Time_Body( Push_Add, 2 ) - push );
+    Report( "SUB", Time_Body( Push_Sub, 2 ) - push );
+    Report( "COMPARE (to an array, not the motion limiter)", Time_Body( Dup_Compare, 2 ) - dup_drop / 2 );
+    Report( "PERIOD (to an array, not the servo bank)", Time_Body( Dup_Period, 2 ) - dup_drop / 2 );
+    Report( "COUNT", Time_Body( Push_Count, 2 ) - push );
+    Report( "LOOP", Time_Body( Loop_Next, 1 ) );
+    Report( "IFZERO", Time_Body( Ifzero_Not, 1 ) );
+    Report( "JUMP", jump );
+
+    printf( "Per tick:\n" );
+    // Wait a tick, every tick: the call, JUMP, PUSH and WAIT.
+    length = 0;
+    Emit(OP(PUSH)); Emit(1); Emit(OP(WAIT)); Emit(OP(JUMP)); Emit(0);
+    CHECK( MotionScript_Check( program, length, &where ) == MOTION_SCRIPT_OK );
+    MotionScript_Begin( &vm, program, length, &output );
+    ns = Host_Nanoseconds();
+    for( now = 0; now < TICKS; now++){
+        (void) MotionScript_Execute( &vm, now, MOTION_SCRIPT_BUDGET );
+    }
+    Host_BenchReport( "a tick that ends in PUSH 1, WAIT", Host_Nanoseconds() - ns, TICKS );
+    CHECK( vm.executed == 3u * TICKS - 1u );
+    // A ramp that takes longer than we're timing: every tick moves the servo a step.
+    length = 0;
+    Emit(OP(PUSH)); Emit(2000); Emit(OP(PUSH)); Emit(60000u); Emit(OP(RAMP)); Emit(0); Emit(OP(END));
+    CHECK( MotionScript_Check( program, length, &where ) == MOTION_SCRIPT_OK );
+    MotionScript_Begin( &vm, program, length, &output );
+    (void) MotionScript_Execute( &vm, 0, MOTION_SCRIPT_BUDGET );
+    ns = Host_Nanoseconds();
+    for( now = 1; now <= TICKS / 4u; now++){
+        (void) MotionScript_Execute( &vm, now, MOTION_SCRIPT_BUDGET );
+    }
+    Host_BenchReport( "a tick of a RAMP that's going", Host_Nanoseconds() - ns, TICKS / 4u );
+    CHECK( vm.state == MOTION_SCRIPT_RUNNING && compares[0] > 1500 && compares[0] < 2000 );
+
+    return Host_Done("bench_motion_script");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,93 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// pid_loop: what one time around the loop costs. First PidLoop_Update by itself, on noisy feedback
+// near the setpoint and with the output stuck at its limit (where anti-windup kicks in).
+// Then a whole sample on the SysTick, with the pretend plant as the input: feedback, PID and servo bank,
+// less what the SysTick costs without the loop.
+// These are nanoseconds on this computer. The PSoC counts its own cycles per iteration with the DWT
+// cycle counter, and L reports them (see PidLoop_Status).
+#include "fake_psoc.h"
+#include "pid_loop.h"
+#include "servo_bank.h"
+#include "timer_service.h"
+#include <stdlib.h>
+
+#define ITERATIONS 2000000u
+#define TICKS 500000u
+
+static int16 noise[4096];
+static volatile int32 sink;
+
+static void Time_Update(const char * what, int16 setpoint, int16 feedback){
+    PidLoop_Controller pid;
+    uint64 start;
+    int32 sum = 0;
+    uint32 i;
+
+    PidLoop_Configure( &pid, 0, PID_LOOP_Q15_ONE );
+    pid.kp = 2 * PID_LOOP_Q16_ONE;
+    pid.ki = PID_LOOP_Q16_ONE / 25;
+    pid.kd = PID_LOOP_Q16_ONE / 500;
+    pid.alpha = PID_LOOP_DERIVATIVE_ALPHA;
+    start = Host_Nanoseconds();
+    for( i = 0; i < ITERATIONS; i++){
+        sum += PidLoop_Update( &pid, setpoint, (int16)(feedback + noise[i & 4095u]) );
+    }
+    Host_BenchReport( what, Host_Nanoseconds() - start, ITERATIONS );
+    sink = sum;
+}
+
+static uint64 Time_Ticks(void){
+    uint64 start = Host_Nanoseconds();
+    uint32 i;
+    for( i = 0; i < TICKS; i++){
+        Host_SysTick();
+    }
+    return Host_Nanoseconds() - start;
+}
+
+int main(void){
+    PidLoop_Status status;
+    uint64 without;
+    uint64 with;
+    uint32 i;
+
+    srand(49);
+    for( i = 0; i < 4096u; i++){
+        noise[i] = (int16)(rand() % 201 - 100);
+    }
+    printf( "PidLoop_Update, P, I and filtered D:\n" );
+    Time_Update( "near the setpoint", 8192, 8100 );
+    Time_Update( "stuck at the limit", PID_LOOP_Q15_ONE, 0 );
+
+    // The loop on the SysTick, at 1 kHz (every tick).
+    host_pwm_period = 19999;
+    ServoBank_Init();
+    TimerService_Init();
+    PidLoop_Init();
+    PidLoop_SetInput( PidLoop_LoopbackInput );
+    PidLoop_SetGain( PID_LOOP_P, 2000 );
+    PidLoop_SetGain( PID_LOOP_I, 40000 );
+    PidLoop_SetSetpoint( 8192 );
+    without = Time_Ticks();
+    CHECK( PidLoop_Start( 0, PID_LOOP_MAX_HZ ) );
+    with = Time_Ticks();
+    PidLoop_GetStatus( &status );
+    PidLoop_Stop();
+    CHECK( status.iterations == TICKS );
+    // Long since settled on the pretend plant.
+    CHECK( abs( status.feedback - 8192 ) < 100 );
+    printf( "A sample on the SysTick, with the pretend plant:\n" );
+    Host_BenchReport( "the SysTick, without the loop", without, TICKS );
+    Host_BenchReport( "the loop's share of each tick", (with > without) ? with - without : 0, TICKS );
+
+    return Host_Done("bench_pid_loop");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,98 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// servo_bank: what a frame's commit costs, by how many channels there are and how many changed.
+// The outputs write into an array that stands in for each PWM block's period and compare registers.
+// For comparison, the simple way: write every channel's compare, every frame, whether it changed or not.
+#include "fake_psoc.h"
+#include "servo_bank.h"
+#include <stdlib.h>
+
+#define FRAMES 200000u
+
+static volatile uint16 registers[SERVO_BANK_MAX_CHANNELS][2];
+
+// Channel 0 is PWM_Servo itself (in fake_psoc.c), so 1 to 31, one pair of functions each like test_servo_bank.c.
+#define CHANNELS(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+#define CHANNEL_FUNCTIONS(n) \
+    static void Period_##n(uint16 value){ registers[n][0] = value; } \
+    static void Compare_##n(uint16 value){ registers[n][1] = value; }
+CHANNELS(CHANNEL_FUNCTIONS)
+#define CHANNEL_OUTPUT(n) [n] = { Period_##n, Compare_##n },
+static const ServoBank_Output outputs[SERVO_BANK_MAX_CHANNELS] = { CHANNELS(CHANNEL_OUTPUT) };
+
+// Which channels change in each frame: picked ahead of time, so rand() isn't in the timing.
+static uint8 picks[FRAMES];
+
+static void Bench(uint32 channels, uint32 changed){
+    char what[80];
+    uint64 start;
+    uint32 frame;
+    uint32 i;
+    uint32 written = 0;
+
+    for( frame = 0; frame < FRAMES; frame++){
+        picks[frame] = (uint8)((uint32) rand() % channels);
+    }
+    start = Host_Nanoseconds();
+    for( frame = 0; frame < FRAMES; frame++){
+        for( i = 0; i < changed; i++){
+            ServoBank_SetCompare( (uint8)((picks[frame] + i) % channels), (uint16)(100u + (frame & 0xFFu)) );
+        }
+        written += (ServoBank_Commit() != 0);
+    }
+    snprintf( what, sizeof(what), "%2lu channels, %2lu changed: set + ServoBank_Commit",
+        (unsigned long) channels, (unsigned long) changed );
+    Host_BenchReport( what, Host_Nanoseconds() - start, FRAMES );
+    CHECK( written == FRAMES );
+
+    start = Host_Nanoseconds();
+    for( frame = 0; frame < FRAMES; frame++){
+        for( i = 0; i < changed; i++){
+            ServoBank_SetCompare( (uint8)((picks[frame] + i) % channels), (uint16)(100u + (frame & 0xFFu)) );
+        }
+        for( i = 1; i < channels; i++){
+            outputs[i].write_compare( ServoBank_GetCompare( (uint8) i ) );
+        }
+        PWM_Servo_WriteCompare( ServoBank_GetCompare(0) );
+    }
+    snprintf( what, sizeof(what), "%2lu channels, %2lu changed: set + write them all",
+        (unsigned long) channels, (unsigned long) changed );
+    Host_BenchReport( what, Host_Nanoseconds() - start, FRAMES );
+    (void) ServoBank_Commit();
+}
+
+int main(void){
+    uint32 i;
+
+    host_pwm_period = 1000;
+    host_pwm_compare = 75;
+    ServoBank_Init();
+    for( i = 1; i < SERVO_BANK_MAX_CHANNELS; i++ ){
+        ServoBank_AttachOutput( (uint8) i, &outputs[i] );
+        ServoBank_SetPeriod( (uint8) i, 1000 );
+    }
+    (void) ServoBank_Commit();
+
+    srand(31);
+    printf( "Per frame, with the compares changing:\n" );
+    Bench( 1u, 1u );
+    Bench( 8u, 1u );
+    Bench( 8u, 8u );
+    Bench( 16u, 1u );
+    Bench( 16u, 4u );
+    Bench( 16u, 16u );
+    Bench( 32u, 1u );
+    Bench( 32u, 8u );
+    Bench( 32u, 32u );
+    return Host_Done("bench_servo_bank");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,100 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// soft_pwm: one channel changes. What does it cost to rebuild the edge table and draw the whole window,
+// against moving that channel's edge and re-drawing the slots between its old and new edge
+// (which is what SoftPwm_SetWidth does)? Both for small moves, like a servo tracking smoothly,
+// and for jumps anywhere in the window.
+#include "fake_psoc.h"
+#include "soft_pwm.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHANGES 200000u
+
+// Where every channel starts from.
+static const uint16 start_widths[SOFT_PWM_CHANNELS] = { 100, 150, 120, 200, 100, 180, 130, 110 };
+static uint8 channels[CHANGES];
+static uint16 new_widths[CHANGES];
+
+static void Bench(const char * how, uint16 biggest_move){
+    SoftPwm_EdgeTable full_table;
+    SoftPwm_EdgeTable table;
+    uint8 full_window[SOFT_PWM_WINDOW_SLOTS];
+    uint8 window[SOFT_PWM_WINDOW_SLOTS];
+    uint16 widths[SOFT_PWM_CHANNELS];
+    uint64 start;
+    uint32 i;
+
+    memcpy( widths, start_widths, sizeof(widths) );
+    // Pick the changes first, so rand() isn't in the timing.
+    for( i = 0; i < CHANGES; i++){
+        uint8 c = (uint8)((uint32) rand() % SOFT_PWM_CHANNELS);
+        int32 width = (int32) widths[c] + (int32)((uint32) rand() % (2u * biggest_move + 1u)) - (int32) biggest_move;
+        if( width < 1 ){
+            width = 1;
+        }
+        if( width > (int32) SOFT_PWM_WINDOW_SLOTS - 1 ){
+            width = (int32) SOFT_PWM_WINDOW_SLOTS - 1;
+        }
+        channels[i] = c;
+        new_widths[i] = (uint16) width;
+        widths[c] = (uint16) width;
+    }
+    printf( "One channel at a time, %s:\n", how );
+
+    memcpy( widths, start_widths, sizeof(widths) );
+    start = Host_Nanoseconds();
+    for( i = 0; i < CHANGES; i++){
+        widths[channels[i]] = new_widths[i];
+        SoftPwm_BuildEdges( &full_table, widths );
+        SoftPwm_RenderWindow( &full_table, full_window, 0, SOFT_PWM_WINDOW_SLOTS );
+    }
+    Host_BenchReport( "SoftPwm_BuildEdges + draw the whole window", Host_Nanoseconds() - start, CHANGES );
+
+    SoftPwm_BuildEdges( &table, start_widths );
+    SoftPwm_RenderWindow( &table, window, 0, SOFT_PWM_WINDOW_SLOTS );
+    start = Host_Nanoseconds();
+    for( i = 0; i < CHANGES; i++){
+        uint16 old_width = table.width[channels[i]];
+        uint16 width = new_widths[i];
+        (void) SoftPwm_UpdateEdge( &table, channels[i], width );
+        if( width < old_width ){
+            SoftPwm_RenderWindow( &table, window, width, old_width );
+        }
+        else if( width > old_width ){
+            SoftPwm_RenderWindow( &table, window, old_width, width );
+        }
+    }
+    Host_BenchReport( "SoftPwm_UpdateEdge + draw between the edges", Host_Nanoseconds() - start, CHANGES );
+    // Same table and window either way.
+    CHECK( memcmp( table.width, full_table.width, sizeof(table.width) ) == 0 );
+    CHECK( memcmp( window, full_window, sizeof(window) ) == 0 );
+
+    // And the edge table alone, without drawing.
+    start = Host_Nanoseconds();
+    for( i = 0; i < CHANGES; i++){
+        widths[channels[i]] = new_widths[i];
+        SoftPwm_BuildEdges( &full_table, widths );
+    }
+    Host_BenchReport( "SoftPwm_BuildEdges alone", Host_Nanoseconds() - start, CHANGES );
+    start = Host_Nanoseconds();
+    for( i = 0; i < CHANGES; i++){
+        (void) SoftPwm_UpdateEdge( &table, channels[i], new_widths[i] );
+    }
+    Host_BenchReport( "SoftPwm_UpdateEdge alone", Host_Nanoseconds() - start, CHANGES );
+}
+
+int main(void){
+    srand(32);
+    Bench( "moving up to 3 slots", 3u );
+    Bench( "jumping anywhere", SOFT_PWM_WINDOW_SLOTS );
+    return Host_Done("bench_soft_pwm");
+}
+
+/* [] END OF FILE */
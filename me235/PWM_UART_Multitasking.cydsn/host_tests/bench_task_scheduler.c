@@ -0,0 +1,116 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// task_scheduler: the overhead per event, over just calling the task's function like an ISR body would.
+// The tasks do nothing, so what's left is signaling, picking the task, and timing its run.
+// The clock is TimerService_NowUs (like app_tasks.c uses) on a simulated SysTick, or a bare counter to compare.
+#include "fake_psoc.h"
+#include "task_scheduler.h"
+#include "timer_service.h"
+#include <stdlib.h>
+
+#define EVENTS 2000000u
+// Events per simulated SysTick.
+#define EVENTS_PER_TICK 1000u
+
+static TaskScheduler scheduler;
+static uint32 counter = 0;
+static uint32 runs = 0;
+static uint8 picks[4096];
+
+static uint32 Counter_Clock(void){
+    return counter++;
+}
+
+static void Task(uint32 events){
+    runs += (events != 0);
+}
+
+// The same function, called through a pointer the compiler can't see through.
+static void (* volatile direct)(uint32 events) = Task;
+
+static void Add_Tasks(uint8 count){
+    uint8 t;
+    for( t = 0; t < count; t++){
+        (void) TaskScheduler_Add( &scheduler, t, "bench", Task );
+    }
+}
+
+// One event at a time, each to one of 'tasks' tasks, run straight away. Returns the nanoseconds.
+static uint64 Signal_And_Run(uint8 tasks, uint32 events_per_run){
+    uint64 start = Host_Nanoseconds();
+    uint32 i;
+    uint32 e;
+    for( i = 0; i < EVENTS / events_per_run; i++){
+        uint8 task = (uint8)(picks[i & 4095u] % tasks);
+        if( i % EVENTS_PER_TICK == 0 ){
+            Host_SysTick();
+        }
+        for( e = 0; e < events_per_run; e++){
+            TaskScheduler_Signal( &scheduler, task, 1u << e );
+        }
+        while( TaskScheduler_RunNext( &scheduler ) ){
+        }
+    }
+    return Host_Nanoseconds() - start;
+}
+
+int main(void){
+    uint64 start;
+    uint32 i;
+
+    srand(44);
+    for( i = 0; i < 4096u; i++){
+        picks[i] = (uint8) rand();
+    }
+    TimerService_Init();
+
+    start = Host_Nanoseconds();
+    for( i = 0; i < EVENTS; i++){
+        if( i % EVENTS_PER_TICK == 0 ){
+            Host_SysTick();
+        }
+        direct( 1u );
+    }
+    Host_BenchReport( "calling the function directly", Host_Nanoseconds() - start, EVENTS );
+    CHECK( runs == EVENTS );
+
+    TaskScheduler_Init( &scheduler, Counter_Clock );
+    Add_Tasks( 1u );
+    runs = 0;
+    Host_BenchReport( "signal + run, 1 task, counter clock", Signal_And_Run( 1u, 1u ), EVENTS );
+    CHECK( runs == EVENTS );
+
+    TaskScheduler_Init( &scheduler, TimerService_NowUs );
+    Add_Tasks( 1u );
+    runs = 0;
+    Host_BenchReport( "signal + run, 1 task, TimerService_NowUs clock", Signal_And_Run( 1u, 1u ), EVENTS );
+    CHECK( runs == EVENTS );
+
+    TaskScheduler_Init( &scheduler, TimerService_NowUs );
+    Add_Tasks( TASK_SCHEDULER_MAX_TASKS );
+    runs = 0;
+    Host_BenchReport( "signal + run, any of 8 tasks", Signal_And_Run( TASK_SCHEDULER_MAX_TASKS, 1u ), EVENTS );
+    CHECK( runs == EVENTS );
+
+    // Several events before the task gets to run turn into one run.
+    runs = 0;
+    Host_BenchReport( "4 signals, then 1 run, per event", Signal_And_Run( TASK_SCHEDULER_MAX_TASKS, 4u ), EVENTS );
+    CHECK( runs == EVENTS / 4u );
+
+    // Just the signal, like an ISR does, with nothing run in between.
+    start = Host_Nanoseconds();
+    for( i = 0; i < EVENTS; i++){
+        TaskScheduler_Signal( &scheduler, (uint8)(i & 7u), 1u << (i & 31u) );
+    }
+    Host_BenchReport( "TaskScheduler_Signal alone", Host_Nanoseconds() - start, EVENTS );
+
+    return Host_Done("bench_task_scheduler");
+}
+
+/* [] END OF FILE */
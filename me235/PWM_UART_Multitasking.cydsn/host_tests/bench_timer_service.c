@@ -0,0 +1,90 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// timer_service: what starting, restarting and running out costs, with few or many timers waiting.
+// Starting and stopping should cost the same however many are waiting. Running out should too,
+// as long as the timers are shorter than one trip around the wheel; longer ones share slots,
+// and every tick has to step over the ones that aren't due yet.
+#include "fake_psoc.h"
+#include "timer_service.h"
+#include <stdlib.h>
+
+#define MAX_TIMERS 10000u
+#define CHURN_TICKS 2000u
+
+static TimerService_Timer timers[MAX_TIMERS];
+// Longest a timer is restarted for, in ticks.
+static uint32 longest = 1;
+static uint32 expiries = 0;
+static uint32 late = 0;
+
+// Each time a timer runs out, it starts again for a random time: a steady churn.
+static void Restart(void * context){
+    TimerService_Timer * timer = (TimerService_Timer *) context;
+    if( timer->expires != TimerService_Now() ){
+        late++;
+    }
+    expiries++;
+    TimerService_Start( timer, 1u + (uint32) rand() % longest, 0, Restart, timer );
+}
+
+static void Churn(uint32 count, uint32 horizon){
+    char what[80];
+    uint64 start;
+    uint64 dispatch_ns = 0;
+    uint32 i;
+    uint32 tick;
+
+    TimerService_Init();
+    longest = horizon;
+    expiries = 0;
+    printf( "%lu timers, each running out within %lu ticks:\n", (unsigned long) count, (unsigned long) horizon );
+
+    start = Host_Nanoseconds();
+    for( i = 0; i < count; i++){
+        TimerService_Start( &timers[i], 1u + (uint32) rand() % horizon, 0, Restart, &timers[i] );
+    }
+    Host_BenchReport( "TimerService_Start", Host_Nanoseconds() - start, count );
+
+    // Restarting one that's already waiting: unlink, then link again somewhere else.
+    start = Host_Nanoseconds();
+    for( i = 0; i < 100000u; i++){
+        TimerService_Timer * timer = &timers[(uint32) rand() % count];
+        TimerService_Start( timer, 1u + (uint32) rand() % horizon, 0, Restart, timer );
+    }
+    Host_BenchReport( "TimerService_Start on a running timer", Host_Nanoseconds() - start, 100000u );
+
+    // Running out: every callback starts its timer again, so the number waiting stays the same.
+    for( tick = 0; tick < CHURN_TICKS; tick++){
+        Host_SysTick();
+        start = Host_Nanoseconds();
+        TimerService_Dispatch();
+        dispatch_ns += Host_Nanoseconds() - start;
+    }
+    snprintf( what, sizeof(what), "TimerService_Dispatch, per timer run out (%lu)", (unsigned long) expiries );
+    Host_BenchReport( what, dispatch_ns, expiries );
+    Host_BenchReport( "TimerService_Dispatch, per tick", dispatch_ns, CHURN_TICKS );
+
+    for( i = 0; i < count; i++){
+        TimerService_Stop( &timers[i] );
+    }
+}
+
+int main(void){
+    srand(30);
+    // Within one trip around the wheel, and then well past it.
+    Churn( 100u, TIMER_SERVICE_WHEEL_SLOTS );
+    Churn( 10000u, TIMER_SERVICE_WHEEL_SLOTS );
+    Churn( 100u, 16u * TIMER_SERVICE_WHEEL_SLOTS );
+    Churn( 10000u, 16u * TIMER_SERVICE_WHEEL_SLOTS );
+    // However busy, every timer still ran on its own tick.
+    CHECK( late == 0 );
+    return Host_Done("bench_timer_service");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,101 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// units: what one conversion costs with the cached fixed-point factors, against dividing every time,
+// and what getting the factors costs when they're cached and when they have to be worked out again.
+// (The Cortex-M3 has a hardware divide, but it takes 2 to 12 cycles and only does 32 bits:
+// the 64-bit divisions below would be a library call there. The divisors are read through a volatile,
+// so the computer can't turn them into multiplies either.)
+#include "fake_psoc.h"
+#include "units.h"
+#include <stdlib.h>
+
+#define CONVERSIONS 1000000u
+
+static uint32 inputs[CONVERSIONS];
+// Where the results go, so the compiler can't skip the work.
+static volatile uint32 sink;
+static volatile uint64 divisor;
+
+int main(void){
+    const Units_Scale * scale;
+    Units_Scale computed;
+    uint64 start;
+    uint32 sum;
+    uint32 reference_sum;
+    uint64 divide_by;
+    uint32 i;
+
+    srand(34);
+    for( i = 0; i < CONVERSIONS; i++){
+        inputs[i] = 500u + (uint32) rand() % 2000u;
+    }
+    Clock_PWM_SetDividerRegister( 23u, 1u );
+    scale = Units_GetScale();
+    printf( "With a %lu Hz PWM clock:\n", (unsigned long) scale->pwm_hz );
+
+    sum = 0;
+    start = Host_Nanoseconds();
+    for( i = 0; i < CONVERSIONS; i++){
+        sum += Units_UsToTicks( scale, inputs[i] );
+    }
+    Host_BenchReport( "Units_UsToTicks", Host_Nanoseconds() - start, CONVERSIONS );
+    sink = sum;
+
+    // The same thing, dividing: (us * bus Hz + half) / (a million * the clock's division).
+    divisor = 1000000uLL * (Clock_PWM_GetDividerRegister() + 1u);
+    divide_by = divisor;
+    reference_sum = 0;
+    start = Host_Nanoseconds();
+    for( i = 0; i < CONVERSIONS; i++){
+        uint64 ticks = ((uint64) inputs[i] * BCLK__BUS_CLK__HZ + divide_by / 2u) / divide_by;
+        reference_sum += (uint32)((ticks > 0xFFFFu) ? 0xFFFFu : ticks);
+    }
+    Host_BenchReport( "the same with a 64-bit division", Host_Nanoseconds() - start, CONVERSIONS );
+    sink = reference_sum;
+    // Both round to the nearest tick, so they only disagree on an exact half now and then.
+    CHECK( sum - reference_sum + 100u <= 200u );
+
+    sum = 0;
+    start = Host_Nanoseconds();
+    for( i = 0; i < CONVERSIONS; i++){
+        sum += Units_PercentToTicks( inputs[i] * 40u, 59999u );
+    }
+    Host_BenchReport( "Units_PercentToTicks", Host_Nanoseconds() - start, CONVERSIONS );
+    sink = sum;
+
+    divisor = UNITS_PERCENT_SCALE;
+    divide_by = divisor;
+    reference_sum = 0;
+    start = Host_Nanoseconds();
+    for( i = 0; i < CONVERSIONS; i++){
+        reference_sum += (uint32)(((uint64)(inputs[i] * 40u) * 60000u + divide_by / 2u) / divide_by);
+    }
+    Host_BenchReport( "the same with a 64-bit division", Host_Nanoseconds() - start, CONVERSIONS );
+    sink = reference_sum;
+    CHECK( sum - reference_sum + 100u <= 200u );
+
+    // Getting the factors: almost always cached. Working them out is the one place with a division.
+    start = Host_Nanoseconds();
+    for( i = 0; i < CONVERSIONS; i++){
+        sum += Units_GetScale()->saturate_us;
+    }
+    Host_BenchReport( "Units_GetScale, cached", Host_Nanoseconds() - start, CONVERSIONS );
+    sink = sum;
+    start = Host_Nanoseconds();
+    for( i = 0; i < CONVERSIONS; i++){
+        Units_ComputeScale( BCLK__BUS_CLK__HZ, (uint16)(inputs[i] & 0xFFu), &computed );
+        sum += computed.saturate_us;
+    }
+    Host_BenchReport( "Units_ComputeScale, when the divider changes", Host_Nanoseconds() - start, CONVERSIONS );
+    sink = sum;
+
+    return Host_Done("bench_units");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,350 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See project.h in this folder: just enough of the PSoC for the firmware to run on a regular computer.
+#include <project.h>
+#include "fake_psoc.h"
+#include <string.h>
+#include <time.h>
+
+_Thread_local uint32_t host_exclusive_value;
+uint32 host_basepri = 0;
+Host_DWT host_dwt;
+Host_CoreDebug host_core_debug;
+Host_SCB host_scb;
+uint8 host_interrupts_enabled = 1;
+uint8 CyResetStatus = 0;
+
+static uint32 systick_priority = 0;
+
+void NVIC_SetPriority(IRQn_Type irq, uint32 priority){
+    systick_priority = priority;
+}
+
+uint32 NVIC_GetPriority(IRQn_Type irq){
+    return systick_priority;
+}
+
+uint8 CyEnterCriticalSection(void){
+    uint8 saved = host_interrupts_enabled;
+    host_interrupts_enabled = 0;
+    return saved;
+}
+
+void CyExitCriticalSection(uint8 saved){
+    host_interrupts_enabled = saved;
+}
+
+void CyDelay(uint32 milliseconds){
+}
+
+void CyDelayFreq(uint32 hz){
+}
+
+/**
+ * The clock calls, in the order they came, so a test can check the flash wait states change on the right side
+ * of the master clock.
+ */
+char host_clock_log[HOST_CLOCK_LOG_LENGTH];
+static uint32 clock_log_length = 0;
+uint8 host_flash_mhz = 0;
+uint8 host_master_divider = 0;
+
+void Host_ClockLogClear(void){
+    clock_log_length = 0;
+    host_clock_log[0] = '\0';
+}
+
+static void Host_ClockLog(char call){
+    if( clock_log_length + 1u < HOST_CLOCK_LOG_LENGTH ){
+        host_clock_log[clock_log_length] = call;
+        clock_log_length++;
+        host_clock_log[clock_log_length] = '\0';
+    }
+}
+
+void CyFlash_SetWaitCycles(uint8 mhz){
+    host_flash_mhz = mhz;
+    Host_ClockLog('F');
+}
+
+void CyMasterClk_SetDivider(uint8 divider){
+    host_master_divider = divider;
+    Host_ClockLog('M');
+}
+
+void CyBusClk_SetDivider(uint16 divider){
+}
+
+void CyPmSaveClocks(void){
+}
+
+void CyPmRestoreClocks(void){
+}
+
+void CyPmSleep(uint8 wake_time, uint16 wake_source){
+}
+
+void (*host_alt_act_wakeup)(void) = NULL;
+
+void CyPmAltAct(uint16 wake_time, uint16 wake_source){
+    // Whatever interrupt the test says woke the CPU up.
+    if( host_alt_act_wakeup != NULL ){
+        host_alt_act_wakeup();
+    }
+}
+
+/**
+ * The SysTick: Host_SysTick does what the interrupt would, one tick.
+ */
+static cySysTickCallback systick_callbacks[CY_SYS_SYST_NUM_OF_CALLBACKS];
+static uint32 systick_reload = 0;
+uint32 host_systick_late = 0;
+
+void CySysTickStart(void){
+}
+
+void CySysTickSetReload(uint32 value){
+    systick_reload = value;
+}
+
+uint32 CySysTickGetValue(void){
+    // Right at the start of a tick, less however late the test says the interrupt is.
+    return systick_reload - host_systick_late;
+}
+
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function){
+    cySysTickCallback previous = systick_callbacks[number];
+    systick_callbacks[number] = function;
+    return previous;
+}
+
+void CySysTickServiceCallbacks(void){
+    uint32 i;
+    for( i = 0; i < CY_SYS_SYST_NUM_OF_CALLBACKS; i++){
+        if( systick_callbacks[i] != NULL ){
+            systick_callbacks[i]();
+        }
+    }
+}
+
+void Host_SysTick(void){
+    CySysTickServiceCallbacks();
+}
+
+/**
+ * The EEPROM, with a count of rows written so a test can see what got rewritten.
+ */
+uint8 host_eeprom[CYDEV_EE_SIZE];
+uint32 host_eeprom_rows_written = 0;
+
+void CyEEPROM_Start(void){
+}
+
+cystatus CySetTemp(void){
+    return CYRET_SUCCESS;
+}
+
+cystatus CyWriteRowData(uint8 array_id, uint16 row, const uint8 * data){
+    memcpy( &host_eeprom[row * CYDEV_EEPROM_ROW_SIZE], data, CYDEV_EEPROM_ROW_SIZE );
+    host_eeprom_rows_written++;
+    return CYRET_SUCCESS;
+}
+
+/**
+ * The DMA controller. Nothing on the host uses it (the DMA components aren't in project.h),
+ * so these just say no.
+ */
+cystatus CyDmaChEnable(uint8 channel, uint8 preserve_tds){
+    return CYRET_SUCCESS;
+}
+
+cystatus CyDmaChDisable(uint8 channel){
+    return CYRET_SUCCESS;
+}
+
+cystatus CyDmaChSetInitialTd(uint8 channel, uint8 td){
+    return CYRET_SUCCESS;
+}
+
+uint8 CyDmaTdAllocate(void){
+    return CY_DMA_INVALID_TD;
+}
+
+cystatus CyDmaTdSetConfiguration(uint8 td, uint16 count, uint8 next_td, uint8 configuration){
+    return CYRET_SUCCESS;
+}
+
+cystatus CyDmaTdSetAddress(uint8 td, uint16 source, uint16 destination){
+    return CYRET_SUCCESS;
+}
+
+/**
+ * PWM_Servo and Clock_PWM: their registers are variables.
+ */
+uint8 PWM_Servo_initVar = 0;
+uint16 host_pwm_period = 0;
+uint16 host_pwm_compare = 0;
+uint16 host_pwm_counter = 0;
+uint8 host_pwm_control = 0;
+uint8 host_pwm_status = 0;
+uint16 host_clock_pwm_divider = 0;
+
+void PWM_Servo_Start(void){
+    PWM_Servo_initVar = 1;
+    host_pwm_control |= PWM_Servo_CTRL_ENABLE;
+}
+
+void PWM_Servo_Stop(void){
+    host_pwm_control &= (uint8) ~PWM_Servo_CTRL_ENABLE;
+}
+
+void PWM_Servo_Init(void){
+    PWM_Servo_initVar = 1;
+}
+
+void PWM_Servo_Enable(void){
+    host_pwm_control |= PWM_Servo_CTRL_ENABLE;
+}
+
+void PWM_Servo_Sleep(void){
+}
+
+void PWM_Servo_Wakeup(void){
+}
+
+void PWM_Servo_WritePeriod(uint16 period){
+    host_pwm_period = period;
+}
+
+uint16 PWM_Servo_ReadPeriod(void){
+    return host_pwm_period;
+}
+
+void PWM_Servo_WriteCompare(uint16 compare){
+    host_pwm_compare = compare;
+}
+
+uint16 PWM_Servo_ReadCompare(void){
+    return host_pwm_compare;
+}
+
+void PWM_Servo_WriteCounter(uint16 counter){
+    host_pwm_counter = counter;
+}
+
+uint16 PWM_Servo_ReadCounter(void){
+    return host_pwm_counter;
+}
+
+uint8 PWM_Servo_ReadControlRegister(void){
+    return host_pwm_control;
+}
+
+uint8 PWM_Servo_ReadStatusRegister(void){
+    // Reading the status register clears it, like on the chip.
+    uint8 status = host_pwm_status;
+    host_pwm_status = 0;
+    return status;
+}
+
+void Clock_PWM_SetDividerRegister(uint16 divider, uint8 restart){
+    host_clock_pwm_divider = divider;
+}
+
+uint16 Clock_PWM_GetDividerRegister(void){
+    return host_clock_pwm_divider;
+}
+
+/**
+ * UART_for_USB: everything sent is kept in host_uart_out.
+ */
+char host_uart_out[HOST_UART_OUT_LENGTH];
+static uint32 uart_out_length = 0;
+static uint8 uart_next_byte = 0;
+
+void Host_UartClear(void){
+    uart_out_length = 0;
+    host_uart_out[0] = '\0';
+}
+
+void UART_for_USB_PutString(const char * string){
+    while( *string != '\0' ){
+        UART_for_USB_PutChar( (uint8) *string );
+        string++;
+    }
+}
+
+void UART_for_USB_PutChar(uint8 character){
+    if( uart_out_length + 1u < HOST_UART_OUT_LENGTH ){
+        host_uart_out[uart_out_length] = (char) character;
+        uart_out_length++;
+        host_uart_out[uart_out_length] = '\0';
+    }
+}
+
+uint8 UART_for_USB_GetChar(void){
+    return uart_next_byte;
+}
+
+void Host_UartReceive(uint8 byte, void (*isr)(void)){
+    uart_next_byte = byte;
+    isr();
+}
+
+void UART_for_USB_Sleep(void){
+}
+
+void UART_for_USB_Wakeup(void){
+}
+
+static uint16 uart_clock_divider = 0;
+
+void UART_for_USB_IntClock_SetDividerRegister(uint16 divider, uint8 restart){
+    uart_clock_divider = divider;
+}
+
+uint16 UART_for_USB_IntClock_GetDividerRegister(void){
+    return uart_clock_divider;
+}
+
+static uint8 uart_receive_priority = 0;
+
+void Interrupt_UART_Receive_SetPriority(uint8 priority){
+    uart_receive_priority = priority;
+}
+
+uint8 Interrupt_UART_Receive_GetPriority(void){
+    return uart_receive_priority;
+}
+
+/**
+ * The checks.
+ */
+int host_checks = 0;
+int host_failures = 0;
+
+int Host_Done(const char * name){
+    printf( "%s: %d checks, %d failed\n", name, host_checks, host_failures );
+    return host_failures;
+}
+
+/**
+ * The benchmarks.
+ */
+uint64 Host_Nanoseconds(void){
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint64) now.tv_sec * 1000000000u + (uint64) now.tv_nsec;
+}
+
+void Host_BenchReport(const char * what, uint64 ns, uint32 count){
+    printf( "  %-52s %9.1f ns each (%lu runs)\n", what, count ? (double) ns / count : 0.0, (unsigned long) count );
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,67 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * fake_psoc.h
+ * What the tests can do to the fake PSoC in fake_psoc.c, besides reading its registers (see project.h),
+ * and a CHECK macro that counts what failed.
+ *
+ * Each test is its own program: it CHECKs things, and ends with "return Host_Done(name);",
+ * which prints how many checks failed and returns that, so make stops at the first test that fails.
+ */
+
+#ifndef FAKE_PSOC_H
+#define FAKE_PSOC_H
+
+#include <project.h>
+#include <stdio.h>
+
+// One SysTick interrupt: runs every callback, like CySysTickServiceCallbacks does.
+void Host_SysTick(void);
+// How many cycles the SysTick has counted since it went pending (CySysTickGetValue is that much under reload).
+extern uint32 host_systick_late;
+
+// The interrupt that wakes the CPU up from CyPmAltAct, if any.
+extern void (*host_alt_act_wakeup)(void);
+
+// The clock calls so far: F for CyFlash_SetWaitCycles, M for CyMasterClk_SetDivider. And what they were given.
+#define HOST_CLOCK_LOG_LENGTH 64u
+extern char host_clock_log[HOST_CLOCK_LOG_LENGTH];
+extern uint8 host_flash_mhz;
+extern uint8 host_master_divider;
+void Host_ClockLogClear(void);
+
+// One byte arrives on the UART, and 'isr' runs for it.
+void Host_UartReceive(uint8 byte, void (*isr)(void));
+
+extern uint32 host_eeprom_rows_written;
+
+extern int host_checks;
+extern int host_failures;
+
+// Counts one check. If it's false, prints where it was and what it said.
+#define CHECK(condition) \
+    do { \
+        host_checks++; \
+        if( !(condition) ){ \
+            host_failures++; \
+            printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition ); \
+        } \
+    } while( 0 )
+
+// Prints how it went, and returns the number of failures (so 0 is a pass).
+int Host_Done(const char * name);
+
+// For the benchmarks (bench_*.c, see the Makefile): this computer's clock, in nanoseconds.
+uint64 Host_Nanoseconds(void);
+// Prints one line of results: 'count' runs of 'what' took 'ns' nanoseconds in all.
+void Host_BenchReport(const char * what, uint64 ns, uint32 count);
+
+#endif //FAKE_PSOC_H
+
+/* [] END OF FILE */
@@ -0,0 +1,209 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * host_tests/project.h
+ * Stands in for the project.h that PSoC Creator generates, so the firmware's .c files compile with gcc
+ * on a regular computer. The Makefile puts this folder first on the include path, so #include <project.h>
+ * finds this one instead.
+ *
+ * It has the PSoC's integer types, the few Cortex-M3 instructions and registers the code uses
+ * (written in plain C), and just enough of each component's API for the code to link.
+ * fake_psoc.c has the functions: the "hardware" is a few variables the tests can look at or set,
+ * like the PWM's registers and what went out over the UART.
+ */
+
+#ifndef HOST_PROJECT_H
+#define HOST_PROJECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef uint64_t uint64;
+typedef int64_t int64;
+typedef uint32 cystatus;
+
+#define CYRET_SUCCESS 0u
+#define CY_NOINIT
+#define CY_ISR(name) void name(void)
+#define LO16(x) ((uint16)(x))
+#define HI16(x) ((uint16)((uint32)(x) >> 16))
+
+/**
+ * The Cortex-M3 instructions, in C.
+ */
+static inline int32 __SSAT(int32 value, uint32 bits){
+    int32 highest = (int32)((1u << (bits - 1u)) - 1u);
+    int32 lowest = -highest - 1;
+    return (value > highest) ? highest : ((value < lowest) ? lowest : value);
+}
+static inline uint32 __USAT(int32 value, uint32 bits){
+    int32 highest = (int32)((1u << bits) - 1u);
+    return (value < 0) ? 0u : (uint32)((value > highest) ? highest : value);
+}
+static inline uint8 __CLZ(uint32 value){
+    return (value == 0) ? 32u : (uint8) __builtin_clz(value);
+}
+// LDREX remembers what it read, and STREX only stores if the word still holds it. That's what a compare-and-swap
+// does, so threads on the host can stand in for ISRs interrupting each other.
+extern _Thread_local uint32_t host_exclusive_value;
+static inline uint32_t __LDREXW(volatile uint32_t * address){
+    host_exclusive_value = atomic_load((_Atomic uint32_t *) address);
+    return host_exclusive_value;
+}
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t * address){
+    uint32_t expected = host_exclusive_value;
+    return atomic_compare_exchange_strong((_Atomic uint32_t *) address, &expected, value) ? 0u : 1u;
+}
+#define __CLREX() ((void) 0)
+// BASEPRI, which priority_section.c raises. Only test_priority_section looks at it.
+extern uint32 host_basepri;
+static inline uint32 __get_BASEPRI(void){
+    return host_basepri;
+}
+static inline void __set_BASEPRI(uint32 value){
+    host_basepri = value;
+}
+#define __DMB() atomic_thread_fence(memory_order_seq_cst)
+
+/**
+ * The core's registers that the code reads and writes directly.
+ */
+typedef struct { volatile uint32 CTRL; volatile uint32 CYCCNT; } Host_DWT;
+typedef struct { volatile uint32 DEMCR; } Host_CoreDebug;
+typedef struct { volatile uint32 ICSR; } Host_SCB;
+extern Host_DWT host_dwt;
+extern Host_CoreDebug host_core_debug;
+extern Host_SCB host_scb;
+#define DWT (&host_dwt)
+#define CoreDebug (&host_core_debug)
+#define SCB (&host_scb)
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define SCB_ICSR_PENDSTSET_Msk (1u << 26)
+#define __NVIC_PRIO_BITS 3u
+typedef enum { SysTick_IRQn = -1 } IRQn_Type;
+void NVIC_SetPriority(IRQn_Type irq, uint32 priority);
+uint32 NVIC_GetPriority(IRQn_Type irq);
+
+/**
+ * cy_boot: the parts of CyLib (and friends) the code calls.
+ */
+extern uint8 host_interrupts_enabled;
+#define CyGlobalIntEnable (host_interrupts_enabled = 1u)
+#define CyGlobalIntDisable (host_interrupts_enabled = 0u)
+uint8 CyEnterCriticalSection(void);
+void CyExitCriticalSection(uint8 saved);
+void CyDelay(uint32 milliseconds);
+void CyDelayFreq(uint32 hz);
+void CyFlash_SetWaitCycles(uint8 mhz);
+void CyMasterClk_SetDivider(uint8 divider);
+void CyBusClk_SetDivider(uint16 divider);
+extern uint8 CyResetStatus;
+#define CY_RESET_WD 0x08u
+#define CY_RESET_SW 0x20u
+// The bus clock, from cyfitter.h.
+#define BCLK__BUS_CLK__HZ 24000000u
+
+#define PM_SLEEP_TIME_NONE 0u
+#define PM_SLEEP_SRC_NONE 0u
+#define PM_ALT_ACT_TIME_NONE 0u
+#define PM_ALT_ACT_SRC_NONE 0u
+void CyPmSaveClocks(void);
+void CyPmRestoreClocks(void);
+void CyPmSleep(uint8 wake_time, uint16 wake_source);
+void CyPmAltAct(uint16 wake_time, uint16 wake_source);
+
+#define CY_SYS_SYST_NUM_OF_CALLBACKS 5u
+typedef void (*cySysTickCallback)(void);
+void CySysTickStart(void);
+void CySysTickSetReload(uint32 value);
+uint32 CySysTickGetValue(void);
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function);
+void CySysTickServiceCallbacks(void);
+
+// 2 KB of EEPROM, in RAM.
+#define CYDEV_EEPROM_ROW_SIZE 16u
+#define CYDEV_EE_SIZE 2048u
+#define CY_SPC_FIRST_EE_ARRAYID 0x40u
+extern uint8 host_eeprom[CYDEV_EE_SIZE];
+#define CY_EEPROM_BASE ((uintptr_t) host_eeprom)
+void CyEEPROM_Start(void);
+cystatus CySetTemp(void);
+cystatus CyWriteRowData(uint8 array_id, uint16 row, const uint8 * data);
+
+// The DMA controller, for the code that sets up its own TDs.
+#define CY_DMA_INVALID_CHANNEL 0xFFu
+#define CY_DMA_INVALID_TD 0xFFu
+#define CY_DMA_DISABLE_TD 0xFEu
+#define CY_DMA_TD_AUTO_EXEC_NEXT 0x20u
+#define CY_DMA_TD_INC_DST_ADR 0x02u
+#define CY_DMA_TD_INC_SRC_ADR 0x01u
+cystatus CyDmaChEnable(uint8 channel, uint8 preserve_tds);
+cystatus CyDmaChDisable(uint8 channel);
+cystatus CyDmaChSetInitialTd(uint8 channel, uint8 td);
+uint8 CyDmaTdAllocate(void);
+cystatus CyDmaTdSetConfiguration(uint8 td, uint16 count, uint8 next_td, uint8 configuration);
+cystatus CyDmaTdSetAddress(uint8 td, uint16 source, uint16 destination);
+
+/**
+ * The schematic's components.
+ */
+#define PWM_Servo_CTRL_ENABLE 0x80u
+#define PWM_Servo_STATUS_TC 0x02u
+extern uint8 PWM_Servo_initVar;
+// What the "registers" hold.
+extern uint16 host_pwm_period;
+extern uint16 host_pwm_compare;
+extern uint16 host_pwm_counter;
+extern uint8 host_pwm_control;
+extern uint8 host_pwm_status;
+void PWM_Servo_Start(void);
+void PWM_Servo_Stop(void);
+void PWM_Servo_Init(void);
+void PWM_Servo_Enable(void);
+void PWM_Servo_Sleep(void);
+void PWM_Servo_Wakeup(void);
+void PWM_Servo_WritePeriod(uint16 period);
+uint16 PWM_Servo_ReadPeriod(void);
+void PWM_Servo_WriteCompare(uint16 compare);
+uint16 PWM_Servo_ReadCompare(void);
+void PWM_Servo_WriteCounter(uint16 counter);
+uint16 PWM_Servo_ReadCounter(void);
+uint8 PWM_Servo_ReadControlRegister(void);
+uint8 PWM_Servo_ReadStatusRegister(void);
+
+extern uint16 host_clock_pwm_divider;
+void Clock_PWM_SetDividerRegister(uint16 divider, uint8 restart);
+uint16 Clock_PWM_GetDividerRegister(void);
+
+// Everything that went out over the UART, so a test can check the replies.
+#define HOST_UART_OUT_LENGTH 4096u
+extern char host_uart_out[HOST_UART_OUT_LENGTH];
+void Host_UartClear(void);
+void UART_for_USB_PutString(const char * string);
+void UART_for_USB_PutChar(uint8 character);
+uint8 UART_for_USB_GetChar(void);
+void UART_for_USB_Sleep(void);
+void UART_for_USB_Wakeup(void);
+void UART_for_USB_IntClock_SetDividerRegister(uint16 divider, uint8 restart);
+uint16 UART_for_USB_IntClock_GetDividerRegister(void);
+
+void Interrupt_UART_Receive_SetPriority(uint8 priority);
+uint8 Interrupt_UART_Receive_GetPriority(void);
+
+#endif //HOST_PROJECT_H
+
+/* [] END OF FILE */
@@ -0,0 +1,118 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// clock_governor: a level is only allowed when both the UART's and the PWM's clocks stay exact,
+// and the flash wait states go up before the clock speeds up, and down only after it slows down.
+#include "fake_psoc.h"
+#include "clock_governor.h"
+#include "timer_service.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FULL_HZ 24000000u
+
+static const uint8 master_divs[CLOCK_GOVERNOR_NUM_LEVELS] = {1u, 2u, 4u, 8u};
+
+// Long enough without any UART activity for the governor to step down one level.
+static void Idle_One_Step(void){
+    uint32 ms;
+    for( ms = 0; ms <= CLOCK_GOVERNOR_IDLE_STEP_US / 1000u; ms++){
+        Host_SysTick();
+    }
+    ClockGovernor_Update();
+}
+
+int main(void){
+    ClockGovernor_Level level;
+    const ClockGovernor_Stats * stats;
+    uint32 i;
+    uint32 pass;
+    uint32 wrong = 0;
+
+    // Exact at every level: 32 and 64 both divide by 1, 2, 4 and 8.
+    for( i = 0; i < CLOCK_GOVERNOR_NUM_LEVELS; i++){
+        CHECK( ClockGovernor_ComputeLevel(FULL_HZ, 31u, 63u, master_divs[i], &level) );
+        CHECK( level.master_div == master_divs[i] && level.bus_hz == FULL_HZ / master_divs[i] );
+        CHECK( level.uart_divider == 32u / master_divs[i] - 1u && level.pwm_divider == 64u / master_divs[i] - 1u );
+    }
+    // The UART's 24 MHz / 26 (115200 baud, 8 samples a bit): only divide-by-2 works, 4 and 8 would be 6.5 and 3.25.
+    CHECK( ClockGovernor_ComputeLevel(FULL_HZ, 25u, 63u, 1u, &level) && level.uart_divider == 25u );
+    CHECK( ClockGovernor_ComputeLevel(FULL_HZ, 25u, 63u, 2u, &level) && level.uart_divider == 12u );
+    CHECK( !ClockGovernor_ComputeLevel(FULL_HZ, 25u, 63u, 4u, &level) );
+    CHECK( !ClockGovernor_ComputeLevel(FULL_HZ, 25u, 63u, 8u, &level) );
+    // Same for the PWM: divide-by-12 is fine at 2 and 4, not at 8.
+    CHECK( ClockGovernor_ComputeLevel(FULL_HZ, 31u, 11u, 4u, &level) && level.pwm_divider == 2u );
+    CHECK( !ClockGovernor_ComputeLevel(FULL_HZ, 31u, 11u, 8u, &level) );
+    // Dividing the master clock itself has to come out even too, and by 0 never does.
+    CHECK( !ClockGovernor_ComputeLevel(FULL_HZ + 1u, 31u, 63u, 2u, &level) );
+    CHECK( !ClockGovernor_ComputeLevel(FULL_HZ, 31u, 63u, 0u, &level) );
+
+    // Every other pair of dividers: allowed exactly when both totals divide evenly, and then
+    // each new total times the master division is the old total, so the UART and PWM tick at the same rate.
+    srand(28);
+    for( pass = 0; pass < 20000u; pass++){
+        uint16 uart_base = (uint16)(rand() % 300);
+        uint16 pwm_base = (uint16) rand();
+        uint8 master_div = master_divs[pass % CLOCK_GOVERNOR_NUM_LEVELS];
+        uint8 exact = ((uart_base + 1u) % master_div == 0) && ((pwm_base + 1u) % master_div == 0);
+        if( ClockGovernor_ComputeLevel(FULL_HZ, uart_base, pwm_base, master_div, &level) != exact ){
+            wrong++;
+        }
+        else if( exact && ( ((uint32) level.uart_divider + 1u) * master_div != uart_base + 1u
+            || ((uint32) level.pwm_divider + 1u) * master_div != pwm_base + 1u ) ){
+            wrong++;
+        }
+    }
+    CHECK( wrong == 0 );
+
+    // Now on the "hardware": step all the way down, then back up.
+    UART_for_USB_IntClock_SetDividerRegister( 31u, 1u );
+    Clock_PWM_SetDividerRegister( 63u, 1u );
+    TimerService_Init();
+    ClockGovernor_Init();
+    stats = ClockGovernor_GetStats();
+    CHECK( stats->transitions == 0 && stats->min_transition_cycles == 0 );
+    for( i = 1; i < CLOCK_GOVERNOR_NUM_LEVELS; i++){
+        Host_ClockLogClear();
+        Idle_One_Step();
+        CHECK( stats->level == i && ClockGovernor_GetBusHz() == FULL_HZ / master_divs[i] );
+        CHECK( host_master_divider == master_divs[i] - 1u );
+        // Slowing down: the clock first, then fewer wait states, for the new speed rounded up.
+        CHECK( strcmp( host_clock_log, "MF" ) == 0 );
+        CHECK( host_flash_mhz == (FULL_HZ / master_divs[i] + 999999u) / 1000000u );
+        CHECK( UART_for_USB_IntClock_GetDividerRegister() == 32u / master_divs[i] - 1u );
+        CHECK( Clock_PWM_GetDividerRegister() == 64u / master_divs[i] - 1u );
+    }
+    // Already as slow as it goes.
+    Host_ClockLogClear();
+    Idle_One_Step();
+    CHECK( host_clock_log[0] == '\0' && stats->transitions == CLOCK_GOVERNOR_NUM_LEVELS - 1u );
+    // A character comes in: straight back to full speed, with the wait states up first.
+    ClockGovernor_NotifyActivity();
+    ClockGovernor_Update();
+    CHECK( stats->level == 0 && host_master_divider == 0 );
+    CHECK( strcmp( host_clock_log, "FM" ) == 0 );
+    CHECK( host_flash_mhz == 24u );
+    CHECK( stats->transitions == CLOCK_GOVERNOR_NUM_LEVELS );
+    CHECK( stats->min_transition_cycles <= stats->last_transition_cycles );
+    CHECK( stats->last_transition_cycles <= stats->max_transition_cycles );
+
+    // With the UART at /26, only divide-by-2 is left to step down to.
+    UART_for_USB_IntClock_SetDividerRegister( 25u, 1u );
+    ClockGovernor_Init();
+    Idle_One_Step();
+    Idle_One_Step();
+    CHECK( stats->level == 1 && UART_for_USB_IntClock_GetDividerRegister() == 12u );
+    ClockGovernor_NotifyActivity();
+    ClockGovernor_Update();
+    CHECK( stats->level == 0 && UART_for_USB_IntClock_GetDividerRegister() == 25u );
+
+    return Host_Done("clock_governor");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,147 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// clock_sync: with a PSoC clock that runs tens of ppm off, and a UART link that takes a millisecond
+// or so each way plus random delays and the odd long burst, the estimate gets a PC time to within a couple
+// hundred microseconds of the right PSoC time, finds the skew, and doesn't mind the 32-bit clocks wrapping.
+#include "fake_psoc.h"
+#include "clock_sync.h"
+#include "timer_service.h"
+#include <math.h>
+#include <stdlib.h>
+
+// A random number in (0, 1).
+static double Random(void){
+    return (rand() + 1.0) / (RAND_MAX + 2.0);
+}
+
+// One trip over the link: a fixed part, random (exponential) jitter, and one in ten stuck behind a burst.
+static double Latency(double base_us, double jitter_us){
+    double latency = base_us - jitter_us * log(Random());
+    if( Random() < 0.1 ){
+        latency += 8000.0;
+    }
+    return latency;
+}
+
+static uint32 Wrap(double us){
+    return (uint32) fmod(us, 4294967296.0);
+}
+
+typedef struct
+{
+    double ppm;
+    double period_s;
+    double jitter_us;
+    // How much longer the trip back is than the trip there (which the estimate can't see).
+    double asymmetry_us;
+    // What's allowed, once it's had 150 exchanges to settle.
+    double rms_us;
+    double worst_us;
+    double skew_ppm;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    { 50, 1, 0, 0, 5, 10, 0.1 },
+    { 50, 1, 300, 0, 100, 250, 5 },
+    { -80, 1, 300, 0, 100, 250, 5 },
+    { 50, 5, 300, 0, 100, 250, 5 },
+    { 20, 10, 500, 0, 200, 450, 5 },
+    // 16 samples a second apart can't pin down the slope through this much jitter, but the offset's still fine.
+    { 50, 1, 1000, 0, 300, 700, 25 },
+    // Half the asymmetry ends up in the offset, and there's no way to tell.
+    { 50, 1, 300, 400, 250, 500, 10 },
+};
+
+// Runs 300 exchanges, and checks how far off a PC time half a period later comes out.
+static void Run(const Scenario * s){
+    ClockSync_Estimate estimate;
+    double offset = 123456789.0 + rand() % 1000000;
+    // Just before the PC's clock wraps around.
+    double host = 4.2e9 - 5e6;
+    double sum_squares = 0;
+    double worst = 0;
+    uint32 n = 0;
+    uint32 i;
+    ClockSync_Reset(&estimate);
+    for( i = 0; i < 300u; i++){
+        double t1 = host;
+        double received = host + Latency(1000, s->jitter_us);
+        double sent = received + 200 + Random() * 1800;
+        double t4 = sent + Latency(1000 + s->asymmetry_us, s->jitter_us);
+        double later = t4 + s->period_s * 0.5e6;
+        double error;
+        #define DEVICE(host_us) (offset + (host_us) * (1.0 + s->ppm * 1e-6))
+        if( s->jitter_us == 0 ){
+            received = host + 1000;
+            sent = received + 500;
+            t4 = sent + 1000;
+        }
+        (void) ClockSync_AddSample( &estimate, Wrap(t1), Wrap(DEVICE(received)), Wrap(DEVICE(sent)), Wrap(t4) );
+        error = (double)(int32)(ClockSync_HostToDevice( &estimate, Wrap(later) ) - Wrap(DEVICE(later)));
+        #undef DEVICE
+        if( i >= 150u ){
+            sum_squares += error * error;
+            n++;
+            if( fabs(error) > worst ){
+                worst = fabs(error);
+            }
+        }
+        host += s->period_s * 1e6;
+    }
+    CHECK( sqrt(sum_squares / n) <= s->rms_us );
+    CHECK( worst <= s->worst_us );
+    CHECK( fabs(ClockSync_SkewPpb(&estimate) - s->ppm * 1000.0) <= s->skew_ppm * 1000.0 );
+    printf( "%4.0f ppm, every %2.0f s, %4.0f us jitter, %3.0f us asymmetry: rms %5.1f us, worst %3.0f us, skew %6d ppb\n",
+        s->ppm, s->period_s, s->jitter_us, s->asymmetry_us, sqrt(sum_squares / n), worst, (int) ClockSync_SkewPpb(&estimate) );
+}
+
+int main(void){
+    uint32 i;
+    uint32 tick;
+    uint32 t3;
+    ClockSync_Estimate estimate;
+
+    srand(5);
+    for( i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++){
+        Run(&scenarios[i]);
+    }
+
+    // A sample that took much longer than the best one is thrown away. One that went back in time too.
+    ClockSync_Reset(&estimate);
+    CHECK( ClockSync_AddSample( &estimate, 1000, 5000, 5100, 3100 ) );
+    CHECK( estimate.min_delay_us == 2000 );
+    CHECK( !ClockSync_AddSample( &estimate, 10000, 14000, 14100, 15000 ) );
+    CHECK( !ClockSync_AddSample( &estimate, 20000, 24000, 34100, 21000 ) );
+    // Clocks 3000 us apart, nothing to say they drift yet.
+    CHECK( ClockSync_OffsetAt( &estimate, 5000 ) == 3000 );
+    CHECK( ClockSync_HostToDevice( &estimate, 100000 ) == 103000 );
+
+    // The PSoC's side: the first exchange has nothing to finish, and the next one's T4 finishes it.
+    TimerService_Init();
+    CHECK( !ClockSync_HostToTick( 0, &tick ) );
+    for( i = 0; i < 10u; i++){
+        Host_SysTick();
+    }
+    // The PC's clock is 2 s behind. It took 500 us to get here, and 500 us back.
+    t3 = ClockSync_Exchange( 10000u - 2000000u - 500u, 10000, 0, 0 );
+    CHECK( t3 == 10000 );
+    CHECK( ClockSync_GetEstimate()->accepted == 0 );
+    (void) ClockSync_Exchange( 20000u - 2000000u, 20000, 1, 10000u - 2000000u + 500u );
+    CHECK( ClockSync_GetEstimate()->accepted == 1 );
+    CHECK( ClockSync_GetEstimate()->offset_us == 2000000u );
+    // PC time 50.4 ms (-2 s) is PSoC tick 50, rounded to the nearest.
+    CHECK( ClockSync_HostToTick( 50400u - 2000000u, &tick ) && tick == 50 );
+    CHECK( ClockSync_HostToTick( 50600u - 2000000u, &tick ) && tick == 51 );
+    // One that's already gone is now.
+    CHECK( ClockSync_HostToTick( 0u - 2000000u, &tick ) && tick == 10 );
+
+    return Host_Done("clock_sync");
+}
+
+/* [] END OF FILE */
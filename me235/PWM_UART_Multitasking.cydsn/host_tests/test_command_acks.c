@@ -0,0 +1,146 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// command_acks: one = covers every line before it and comes when the lines run out or half the window
+// is done, a ! comes right away, a missing line is asked for once and everything is skipped until it comes,
+// and numbered lines through the line task get only acks back.
+#include "fake_psoc.h"
+#include "command_acks.h"
+#include "uart_helper_fcns.h"
+#include "servo_bank.h"
+#include "timer_service.h"
+#include <string.h>
+
+// Types a line into the UART ISR, without running the line task, so several can be waiting.
+static void Send(const char * line){
+    while( *line != '\0' ){
+        Host_UartReceive( (uint8) *line, Interrupt_Handler_UART_Receive );
+        line++;
+    }
+    Host_UartReceive( '\r', Interrupt_Handler_UART_Receive );
+}
+
+// Runs the line task until every waiting line is done.
+static void Process_All(void){
+    uint32 i;
+    for( i = 0; i < 16u; i++){
+        UART_Helper_ProcessLine();
+    }
+}
+
+int main(void){
+    CommandAcks acks;
+    char out[COMMAND_ACKS_TEXT_LENGTH];
+    char line[200];
+    uint8 sequence;
+    uint16 compare;
+
+    // Three lines in a row, then the PC stops sending: one = for all three, when they run out.
+    CommandAcks_Reset( &acks, 8 );
+    CHECK( CommandAcks_Arrive( &acks, 5, out ) && out[0] == '\0' );
+    CommandAcks_Done( &acks, 5, COMMAND_ACKS_OK, 1, out );
+    CHECK( out[0] == '\0' );
+    CHECK( CommandAcks_Arrive( &acks, 6, out ) );
+    CommandAcks_Done( &acks, 6, COMMAND_ACKS_OK, 1, out );
+    CHECK( out[0] == '\0' );
+    CHECK( CommandAcks_Arrive( &acks, 7, out ) );
+    CommandAcks_Done( &acks, 7, COMMAND_ACKS_OK, 0, out );
+    CHECK( strcmp( out, "=7\r\n" ) == 0 );
+    CommandAcks_Flush( &acks, out );
+    CHECK( out[0] == '\0' );
+
+    // Lines that keep coming get a = every half window, so the PC never runs out. Numbers wrap from 255 to 0.
+    CommandAcks_Reset( &acks, 8 );
+    for( sequence = 253; sequence != 1u; sequence++){
+        CHECK( CommandAcks_Arrive( &acks, sequence, out ) );
+        CommandAcks_Done( &acks, sequence, COMMAND_ACKS_OK, 1, out );
+        CHECK( (out[0] != '\0') == (sequence == 0u) );
+    }
+    CHECK( strcmp( out, "=0\r\n" ) == 0 );
+
+    // A line that didn't work gets its ! right away, and it covers the lines done before it.
+    CHECK( CommandAcks_Arrive( &acks, 1, out ) );
+    CommandAcks_Done( &acks, 1, COMMAND_ACKS_OK, 1, out );
+    CHECK( CommandAcks_Arrive( &acks, 2, out ) );
+    CommandAcks_Done( &acks, 2, COMMAND_ACKS_BAD_NUMBER, 1, out );
+    CHECK( strcmp( out, "!2 2\r\n" ) == 0 );
+    CommandAcks_Flush( &acks, out );
+    CHECK( out[0] == '\0' );
+
+    // 4 goes missing: 5 gets a ! asking for 4, once, and 5 and 6 are skipped until 4 comes again.
+    CHECK( CommandAcks_Arrive( &acks, 3, out ) );
+    CommandAcks_Done( &acks, 3, COMMAND_ACKS_OK, 1, out );
+    CHECK( !CommandAcks_Arrive( &acks, 5, out ) );
+    CHECK( strcmp( out, "!4 6\r\n" ) == 0 );
+    CHECK( !CommandAcks_Arrive( &acks, 6, out ) && out[0] == '\0' );
+    // The ! covered 3, so there's no = for it later.
+    CommandAcks_Flush( &acks, out );
+    CHECK( out[0] == '\0' );
+    CHECK( CommandAcks_Arrive( &acks, 4, out ) && out[0] == '\0' );
+    CommandAcks_Done( &acks, 4, COMMAND_ACKS_OK, 0, out );
+    CHECK( strcmp( out, "=4\r\n" ) == 0 );
+    // A line sent twice doesn't run twice.
+    CHECK( !CommandAcks_Arrive( &acks, 4, out ) );
+    CHECK( strcmp( out, "!5 6\r\n" ) == 0 );
+
+    // The longest ack fits.
+    CommandAcks_Done( &acks, 255, COMMAND_ACKS_TOO_LONG, 0, out );
+    CHECK( strcmp( out, "!255 7\r\n" ) == 0 && strlen(out) < COMMAND_ACKS_TEXT_LENGTH );
+
+    // Through the line task: numbered lines aren't echoed and get no sentences, just the acks.
+    host_pwm_period = 19999;
+    host_pwm_compare = 1000;
+    ServoBank_Init();
+    TimerService_Init();
+    Host_UartClear();
+    Send( "#40 d : 1500" );
+    Send( "#41 d3 : 150" );
+    Send( "#42 d2 : 160" );
+    Process_All();
+    CHECK( strcmp( host_uart_out, "=42\r\n" ) == 0 );
+    CHECK( ServoBank_GetCompare(0) == 1500 && ServoBank_GetCompare(3) == 150 && ServoBank_GetCompare(2) == 160 );
+    // A bad number, then a line that's too long (which doesn't run).
+    Host_UartClear();
+    Send( "#43 g : 3" );
+    Process_All();
+    CHECK( strcmp( host_uart_out, "!43 2\r\n" ) == 0 );
+    memset( line, '5', sizeof(line) - 1u );
+    line[sizeof(line) - 1u] = '\0';
+    memcpy( line, "#44 d1 : ", 9 );
+    compare = ServoBank_GetCompare(1);
+    Host_UartClear();
+    Send( line );
+    Process_All();
+    CHECK( strcmp( host_uart_out, "!44 7\r\n" ) == 0 );
+    CHECK( ServoBank_GetCompare(1) == compare );
+    // A missing line, then sending again from it.
+    Host_UartClear();
+    Send( "#46 d : 1400" );
+    Send( "#47 d : 1300" );
+    Process_All();
+    CHECK( strcmp( host_uart_out, "!45 6\r\n" ) == 0 );
+    CHECK( ServoBank_GetCompare(0) == 1500 );
+    Host_UartClear();
+    Send( "#45 d : 1450" );
+    Send( "#46 d : 1400" );
+    Process_All();
+    CHECK( strcmp( host_uart_out, "=46\r\n" ) == 0 );
+    CHECK( ServoBank_GetCompare(0) == 1400 );
+    // A line without a # right behind a numbered one: the = for the numbered one comes before its reply.
+    Host_UartClear();
+    Send( "#47 d : 1300" );
+    Send( "d : 1200" );
+    Process_All();
+    CHECK( strstr( host_uart_out, "=47\r\n" ) != NULL );
+    CHECK( strstr( host_uart_out, "PWM 0 now has a duty cycle (in clock ticks) of: 1200" ) != NULL );
+    CHECK( strstr( host_uart_out, "=47\r\n" ) < strstr( host_uart_out, "PWM 0 now" ) );
+
+    return Host_Done("command_acks");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,121 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// command_schedule: thousands of commands, from the next tick to minutes away, each run exactly on its tick
+// and in the order they were sent, even when the tick counter wraps around.
+#include "fake_psoc.h"
+#include "command_schedule.h"
+#include "timer_service.h"
+#include "servo_bank.h"
+#include <stdlib.h>
+
+#define ENTRIES 5000u
+
+static CommandSchedule_Entry entries[ENTRIES];
+static CommandSchedule_Wheel wheel;
+// The tick being run, and the last entry that ran.
+static uint32 current;
+static uint32 ran = 0;
+static uint32 wrong_tick = 0;
+static uint32 wrong_order = 0;
+static uint32 last_at;
+static uint16 last_id;
+
+static void Record(CommandSchedule_Entry * entry){
+    if( entry->at != current ){
+        wrong_tick++;
+    }
+    // The same tick: in the order they went in (the ids count up).
+    if( ran > 0 && entry->at == last_at && entry->id < last_id ){
+        wrong_order++;
+    }
+    last_at = entry->at;
+    last_id = entry->id;
+    ran++;
+}
+
+int main(void){
+    uint32 round;
+    uint32 i;
+    uint32 tick;
+    uint16 id;
+    uint16 first_id;
+    uint32 late_us;
+
+    // Near (the first wheel), further (the second), minutes (the third), and past the end of the third
+    // (about 4.4 minutes), which go around again. The last round starts just before the counter wraps.
+    srand(3);
+    for( round = 0; round < 3u; round++ ){
+        uint32 start = (round == 2u) ? 0xFFFFF000u : (uint32) rand();
+        CommandSchedule_WheelInit( &wheel, start );
+        current = start;
+        ran = 0;
+        for( i = 0; i < ENTRIES; i++){
+            uint32 range[4] = { 64u, 4096u, 300000u, 700000u };
+            entries[i].at = start + 1u + (uint32) rand() % range[rand() % 4];
+            entries[i].id = (uint16) i;
+            CommandSchedule_Insert( &wheel, &entries[i] );
+        }
+        for( tick = 0; tick < 800000u && ran < ENTRIES; tick++ ){
+            current++;
+            (void) CommandSchedule_Advance( &wheel, Record );
+        }
+        CHECK( ran == ENTRIES );
+    }
+    CHECK( wrong_tick == 0 );
+    CHECK( wrong_order == 0 );
+
+    // One that's already due runs at the next tick.
+    CommandSchedule_WheelInit( &wheel, 1000 );
+    current = 1001;
+    ran = 0;
+    entries[0].at = 990;
+    CommandSchedule_Insert( &wheel, &entries[0] );
+    entries[0].at = 1001;
+    CHECK( CommandSchedule_Advance( &wheel, Record ) == 1 );
+    CHECK( ran == 1 && wrong_tick == 0 );
+
+    // On the SysTick, through the servo bank.
+    host_pwm_period = 19999;
+    host_pwm_compare = 1000;
+    ServoBank_Init();
+    TimerService_Init();
+    CommandSchedule_Init();
+    first_id = CommandSchedule_Add( COMMAND_SCHEDULE_COMPARE, 0, 1500, 10 );
+    CHECK( first_id != 0 );
+    id = CommandSchedule_Add( COMMAND_SCHEDULE_COMPARE, 0, 1600, 10 );
+    CHECK( CommandSchedule_GetPending() == 2 );
+    for( tick = 0; tick < 9u; tick++ ){
+        Host_SysTick();
+    }
+    CHECK( ServoBank_GetCompare(0) == 1000 );
+    Host_SysTick();
+    // Both ran on tick 10, the later one last, and right on time.
+    CHECK( ServoBank_GetCompare(0) == 1600 );
+    CHECK( CommandSchedule_GetPending() == 0 );
+    CHECK( CommandSchedule_GetLateness( first_id, &late_us ) && late_us == 0 );
+    CHECK( CommandSchedule_GetLateness( id, &late_us ) && late_us == 0 );
+    CHECK( CommandSchedule_GetStats()->executed == 2 && CommandSchedule_GetStats()->late == 0 );
+    // Only so many fit; Clear gives them all back.
+    for( i = 0; i < COMMAND_SCHEDULE_MAX_ENTRIES; i++){
+        CHECK( CommandSchedule_Add( COMMAND_SCHEDULE_COMPARE, 0, 1700, 100 ) != 0 );
+    }
+    CHECK( CommandSchedule_Add( COMMAND_SCHEDULE_COMPARE, 0, 1700, 100 ) == 0 );
+    CHECK( CommandSchedule_GetStats()->dropped == 1 );
+    CommandSchedule_Clear();
+    CHECK( CommandSchedule_GetPending() == 0 );
+    for( tick = 0; tick < 200u; tick++ ){
+        Host_SysTick();
+    }
+    CHECK( ServoBank_GetCompare(0) == 1600 );
+    CHECK( CommandSchedule_Add( COMMAND_SCHEDULE_COMPARE, 0, 1700, 0 ) != 0 );
+
+    return Host_Done("command_schedule");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,119 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// command words: the perfect hash finds every word in the table, and nothing that isn't one,
+// and a word works in a line just like its letter.
+#include "fake_psoc.h"
+#include "uart_helper_fcns.h"
+#include "servo_bank.h"
+#include "timer_service.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Every letter and word, from the table.
+#define LETTER_AND_WORD(letter, word, Name, lowest, highest, flags, help) { letter, word },
+static const struct { char letter; const char * word; } table[] = { UART_COMMANDS(LETTER_AND_WORD) };
+#define WORDS (sizeof(table) / sizeof(table[0]))
+
+// 1 if 'word' (length characters of it) is one of the table's.
+static uint8 In_Table(const char * word, uint8 length){
+    uint32 i;
+    for( i = 0; i < WORDS; i++){
+        if( strlen( table[i].word ) == length && strncmp( table[i].word, word, length ) == 0 ){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Types a line into the UART ISR and runs the line task on it.
+static void Type(const char * line){
+    while( *line != '\0' ){
+        Host_UartReceive( (uint8) *line, Interrupt_Handler_UART_Receive );
+        line++;
+    }
+    Host_UartReceive( '\r', Interrupt_Handler_UART_Receive );
+    Host_UartClear();
+    UART_Helper_ProcessLine();
+}
+
+int main(void){
+    uint32 i;
+    uint32 round;
+    uint32 wrong = 0;
+    char word[UART_COMMAND_WORD_LENGTH + 2u];
+
+    // Every word finds its own command.
+    for( i = 0; i < WORDS; i++){
+        const UART_Command * command = UART_Helper_FindWord( table[i].word, (uint8) strlen( table[i].word ) );
+        CHECK( command != NULL && command->letter == table[i].letter );
+        CHECK( strlen( table[i].word ) <= UART_COMMAND_WORD_LENGTH );
+    }
+
+    // Near misses: one letter short, one extra, one changed, and the first letter in capitals.
+    for( i = 0; i < WORDS; i++){
+        uint8 length = (uint8) strlen( table[i].word );
+        strcpy( word, table[i].word );
+        if( !In_Table( word, length - 1u ) && UART_Helper_FindWord( word, length - 1u ) != NULL ){
+            wrong++;
+        }
+        word[length] = 's';
+        if( !In_Table( word, length + 1u ) && UART_Helper_FindWord( word, length + 1u ) != NULL ){
+            wrong++;
+        }
+        word[length] = '\0';
+        word[length / 2u] = (word[length / 2u] == 'z') ? 'a' : (char)(word[length / 2u] + 1);
+        if( !In_Table( word, length ) && UART_Helper_FindWord( word, length ) != NULL ){
+            wrong++;
+        }
+        strcpy( word, table[i].word );
+        word[0] = (char)(word[0] - 'a' + 'A');
+        if( UART_Helper_FindWord( word, length ) != NULL ){
+            wrong++;
+        }
+    }
+    CHECK( wrong == 0 );
+
+    // A million random lowercase words: only the real ones are found.
+    srand(6);
+    for( round = 0; round < 1000000u; round++ ){
+        uint8 length = (uint8)(1 + rand() % UART_COMMAND_WORD_LENGTH);
+        const UART_Command * command;
+        for( i = 0; i < length; i++){
+            word[i] = (char)('a' + rand() % 26);
+        }
+        command = UART_Helper_FindWord( word, length );
+        if( (command != NULL) != In_Table( word, length ) ){
+            wrong++;
+        }
+    }
+    CHECK( wrong == 0 );
+
+    // In a line: a word with a channel number, and a word instead of an immediate letter.
+    host_pwm_period = 19999;
+    host_pwm_compare = 1000;
+    host_pwm_control = PWM_Servo_CTRL_ENABLE;
+    ServoBank_Init();
+    TimerService_Init();
+    Type( "duty3 : 150" );
+    CHECK( ServoBank_GetCompare(3) == 150 );
+    CHECK( strstr( host_uart_out, "PWM 3 now has a duty cycle (in clock ticks) of: 150" ) != NULL );
+    Type( "d3 : 160" );
+    CHECK( ServoBank_GetCompare(3) == 160 );
+    Type( "period : 2000" );
+    CHECK( strstr( host_uart_out, "PWM 0 now has a period of: 2000" ) != NULL );
+    Type( "stop" );
+    CHECK( (host_pwm_control & PWM_Servo_CTRL_ENABLE) == 0 );
+    // A word that's close but wrong isn't a command.
+    Type( "dutty : 150" );
+    CHECK( strstr( host_uart_out, "Error! Try " ) != NULL );
+
+    return Host_Done("command_words");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,83 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// dither: for every compare from 0 to 2000 and every fraction, one pattern averages out to exactly
+// the Q8 value, and on the way there the total is never more than half a tick off.
+#include "fake_psoc.h"
+#include "dither.h"
+#include "trajectory.h"
+#include "servo_bank.h"
+
+int main(void){
+    uint16 table[DITHER_TABLE_LENGTH];
+    uint32 compare_q8;
+    uint32 i;
+    uint32 wrong_average = 0;
+    uint32 wrong_values = 0;
+    // The furthest the running total got from n * compare, in 1/256 ticks.
+    int32 worst_drift = 0;
+    uint32 total;
+
+    for( compare_q8 = 0; compare_q8 <= (2000u << DITHER_FRAC_BITS); compare_q8++ ){
+        uint32 base = compare_q8 >> DITHER_FRAC_BITS;
+        int64 sum_q8 = 0;
+        Dither_BuildTable( compare_q8, 0xFFFFu, table );
+        for( i = 0; i < DITHER_TABLE_LENGTH; i++){
+            int32 drift;
+            // Only ever the two compares either side of it.
+            if( table[i] != base && table[i] != base + 1u ){
+                wrong_values++;
+            }
+            sum_q8 += (int64) table[i] << DITHER_FRAC_BITS;
+            drift = (int32)(sum_q8 - (int64)(i + 1u) * compare_q8);
+            if( drift < 0 ){
+                drift = -drift;
+            }
+            if( drift > worst_drift ){
+                worst_drift = drift;
+            }
+        }
+        // After the whole pattern, exactly right.
+        if( sum_q8 != (int64) compare_q8 * DITHER_TABLE_LENGTH ){
+            wrong_average++;
+        }
+    }
+    CHECK( wrong_values == 0 );
+    CHECK( wrong_average == 0 );
+    CHECK( worst_drift <= (int32)(DITHER_TABLE_LENGTH / 2u) );
+
+    // Spread out as evenly as possible: 150.5 takes turns.
+    Dither_BuildTable( 150u * 256u + 128u, 0xFFFFu, table );
+    for( i = 1; i < DITHER_TABLE_LENGTH; i++){
+        CHECK( table[i] != table[i - 1u] );
+    }
+    // Past the limit, it's clamped.
+    Dither_BuildTable( 3000u * 256u + 77u, 2000, table );
+    for( i = 0; i < DITHER_TABLE_LENGTH; i++){
+        CHECK( table[i] == 2000 );
+    }
+
+    // Played on PWM_Servo, through the trajectory engine: 256 frames add up to the Q8 value.
+    host_pwm_period = 1999;
+    ServoBank_Init();
+    CHECK( Dither_SetCompareQ8( 150u * 256u + 64u ) == 150u * 256u + 64u );
+    CHECK( Trajectory_IsPlaying() );
+    total = 0;
+    for( i = 0; i < DITHER_TABLE_LENGTH; i++){
+        Trajectory_Step(1);
+        (void) ServoBank_Commit();
+        total += host_pwm_compare;
+    }
+    CHECK( total == 150u * 256u + 64u );
+    // Past the period, it rounds to the period.
+    CHECK( Dither_SetCompareQ8( 2500u * 256u ) == 1999u * 256u );
+
+    return Host_Done("dither");
+}
+
+/* [] END OF FILE */
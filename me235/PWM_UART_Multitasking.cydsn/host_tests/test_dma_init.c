@@ -0,0 +1,153 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// dma_init_plan: the planner splits regions at 4092 bytes and at 64 KB boundaries, covers every byte
+// exactly once, and says no when a region isn't word-aligned or there aren't enough TDs or channels.
+#include "fake_psoc.h"
+#include "dma_init_plan.h"
+#include <stdlib.h>
+
+#define ZERO_WORD 0x20007FF0u
+
+// Where a planned TD writes, with the upper address bits from its chain.
+static uint32 Td_Dst(const DmaInit_Plan * plan, uint8 td){
+    return ((uint32) plan->chains[plan->tds[td].chain].dst_hi << 16) | plan->tds[td].dst_lo;
+}
+
+static uint32 Td_Src(const DmaInit_Plan * plan, uint8 td){
+    return ((uint32) plan->chains[plan->tds[td].chain].src_hi << 16) | plan->tds[td].src_lo;
+}
+
+int main(void){
+    DmaInit_Region regions[DMA_INIT_MAX_TDS + 1u];
+    DmaInit_Plan plan;
+    uint32 i;
+    uint32 pass;
+    uint32 wrong = 0;
+
+    // Nothing to do is fine, and takes no TDs.
+    regions[0].src = 0;
+    regions[0].dst = 0x20000000u;
+    regions[0].size = 0;
+    regions[0].zero_fill = 1;
+    CHECK( DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) && plan.num_tds == 0 && plan.num_chains == 0 );
+    CHECK( DmaInit_PlanRegions(regions, 0, ZERO_WORD, &plan) && plan.num_tds == 0 );
+    CHECK( DmaInit_EstimateCpuCycles(regions, 1) == 0 );
+
+    // Split at 4092, the biggest multiple of 4 one TD can do. Zero-fills keep reading the same word.
+    regions[0].size = 10000u;
+    CHECK( DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) );
+    CHECK( plan.num_tds == 3 && plan.num_chains == 1 && plan.chains[0].num_tds == 3 );
+    CHECK( plan.tds[0].count == 4092u && plan.tds[1].count == 4092u && plan.tds[2].count == 10000u - 2u * 4092u );
+    CHECK( Td_Dst(&plan, 0) == 0x20000000u && Td_Dst(&plan, 1) == 0x20000000u + 4092u && Td_Dst(&plan, 2) == 0x20000000u + 8184u );
+    CHECK( Td_Src(&plan, 0) == ZERO_WORD && Td_Src(&plan, 2) == ZERO_WORD );
+    CHECK( plan.tds[0].flags == CY_DMA_TD_INC_DST_ADR );
+    regions[0].size = 4092u;
+    CHECK( DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) && plan.num_tds == 1 );
+    regions[0].size = 4096u;
+    CHECK( DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) && plan.num_tds == 2 && plan.tds[1].count == 4u );
+
+    // Across 0x20000000, where the PSoC's SRAM is split: a TD each side, on different chains.
+    regions[0].dst = 0x1FFFF800u;
+    regions[0].size = 0x1000u;
+    CHECK( DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) );
+    CHECK( plan.num_tds == 2 && plan.num_chains == 2 );
+    CHECK( plan.tds[0].count == 0x800u && plan.tds[1].count == 0x800u );
+    CHECK( plan.chains[plan.tds[0].chain].dst_hi == 0x1FFFu && plan.chains[plan.tds[1].chain].dst_hi == 0x2000u );
+    // A copy splits where its source crosses too, and moves both addresses along.
+    regions[0].src = 0x1FFFFF00u;
+    regions[0].dst = 0x20001000u;
+    regions[0].size = 0x400u;
+    regions[0].zero_fill = 0;
+    CHECK( DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) );
+    CHECK( plan.num_tds == 2 && plan.tds[0].count == 0x100u && plan.tds[1].count == 0x300u );
+    CHECK( Td_Src(&plan, 1) == 0x20000000u && Td_Dst(&plan, 1) == 0x20001100u );
+    CHECK( plan.tds[0].flags == (CY_DMA_TD_INC_DST_ADR | CY_DMA_TD_INC_SRC_ADR) );
+
+    // Not word-aligned: the address, or the size.
+    regions[0].src = 0x1FFF8000u;
+    regions[0].dst = 0x20000002u;
+    CHECK( !DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) );
+    regions[0].dst = 0x20000000u;
+    regions[0].size = 6u;
+    CHECK( !DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) );
+
+    // Out of TDs: one per region fits up to DMA_INIT_MAX_TDS, and one more doesn't.
+    for( i = 0; i <= DMA_INIT_MAX_TDS; i++){
+        regions[i].src = 0;
+        regions[i].dst = 0x20000000u + i * 64u;
+        regions[i].size = 64u;
+        regions[i].zero_fill = 1;
+    }
+    CHECK( DmaInit_PlanRegions(regions, DMA_INIT_MAX_TDS, ZERO_WORD, &plan) && plan.num_tds == DMA_INIT_MAX_TDS );
+    CHECK( !DmaInit_PlanRegions(regions, DMA_INIT_MAX_TDS + 1u, ZERO_WORD, &plan) );
+    // Or one big region that needs too many.
+    regions[0].size = (DMA_INIT_MAX_TDS + 1u) * DMA_INIT_MAX_TD_BYTES;
+    CHECK( !DmaInit_PlanRegions(regions, 1, ZERO_WORD, &plan) );
+    // Out of channels: every region in its own 64 KB.
+    for( i = 0; i <= DMA_INIT_MAX_CHAINS; i++){
+        regions[i].dst = 0x20000000u + i * 0x10000u;
+        regions[i].size = 64u;
+    }
+    CHECK( DmaInit_PlanRegions(regions, DMA_INIT_MAX_CHAINS, ZERO_WORD, &plan) && plan.num_chains == DMA_INIT_MAX_CHAINS );
+    CHECK( !DmaInit_PlanRegions(regions, DMA_INIT_MAX_CHAINS + 1u, ZERO_WORD, &plan) );
+
+    // Random regions near the SRAM split: whenever it fits, the TDs cover each region in order,
+    // each within the limits, and none crossing a 64 KB boundary.
+    srand(27);
+    for( pass = 0; pass < 20000u; pass++){
+        uint8 num_regions = (uint8)(1 + rand() % 3);
+        uint8 td = 0;
+        uint8 r;
+        for( r = 0; r < num_regions; r++){
+            regions[r].zero_fill = (uint8)(rand() % 2);
+            regions[r].dst = 0x1FFF0000u + 4u * (uint32)(rand() % 0x8000);
+            regions[r].src = regions[r].zero_fill ? 0 : 0x1FFF0000u + 4u * (uint32)(rand() % 0x8000);
+            regions[r].size = 4u * (uint32)(rand() % 3000);
+        }
+        if( !DmaInit_PlanRegions(regions, num_regions, ZERO_WORD, &plan) ){
+            continue;
+        }
+        for( r = 0; r < num_regions; r++){
+            uint32 done = 0;
+            while( done < regions[r].size && td < plan.num_tds ){
+                uint32 dst = Td_Dst(&plan, td);
+                uint32 src = Td_Src(&plan, td);
+                uint32 count = plan.tds[td].count;
+                if( dst != regions[r].dst + done || count == 0 || count > DMA_INIT_MAX_TD_BYTES || (count & 3u) != 0
+                    || (dst >> 16) != ((dst + count - 1u) >> 16) ){
+                    wrong++;
+                }
+                if( regions[r].zero_fill ? (src != ZERO_WORD)
+                    : (src != regions[r].src + done || (src >> 16) != ((src + count - 1u) >> 16)) ){
+                    wrong++;
+                }
+                done += count;
+                td++;
+            }
+            if( done != regions[r].size ){
+                wrong++;
+            }
+        }
+        if( td != plan.num_tds ){
+            wrong++;
+        }
+    }
+    CHECK( wrong == 0 );
+
+    // The CPU estimate goes by words, and copying costs more than zeroing.
+    regions[0].size = 128u;
+    regions[0].zero_fill = 1;
+    regions[1].size = 8u;
+    regions[1].zero_fill = 0;
+    CHECK( DmaInit_EstimateCpuCycles(regions, 2) == 32u * DMA_INIT_CPU_ZERO_CYCLES_PER_WORD + 2u * DMA_INIT_CPU_COPY_CYCLES_PER_WORD );
+
+    return Host_Done("dma_init");
+}
+
+/* [] END OF FILE */
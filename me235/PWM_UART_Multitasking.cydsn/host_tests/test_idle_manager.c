@@ -0,0 +1,163 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// idle_manager: the policy picks the right mode for a made-up stream of events, the idle percentage
+// adds up, and a SysTick that wakes the CPU up gets timed from when it went pending.
+#include "fake_psoc.h"
+#include "idle_manager.h"
+#include "timer_service.h"
+#include <stdlib.h>
+
+// The wakeup sources for CyPmAltAct.
+static uint32 wakeups_called = 0;
+
+static void Tick_Wakes(void){
+    wakeups_called++;
+    Host_SysTick();
+}
+
+static void Uart_Wakes(void){
+    wakeups_called++;
+    IdleManager_NotifyWake();
+}
+
+int main(void){
+    IdleManager_Inputs inputs;
+    IdleManager_Stats stats = { 0 };
+    const IdleManager_Stats * live;
+    uint32 pass;
+    uint32 wrong_mode = 0;
+    uint32 slept_with_pwm = 0;
+    uint32 modes[3] = { 0, 0, 0 };
+    double idle_total = 0;
+    double all_total = 0;
+    double exact;
+
+    // The event stream: work comes and goes, the PWM gets stopped and started, deadlines come closer
+    // and go away. Each pass, check the mode against the rules in idle_manager.h, and add up the time.
+    srand(29);
+    inputs.pwm_running = 1;
+    for( pass = 0; pass < 100000u; pass++ ){
+        IdleManager_Mode mode;
+        IdleManager_Mode expected;
+        uint32 idle_us = 0;
+        uint32 awake_us = 50u + (uint32) rand() % 2000u;
+        if( rand() % 50 == 0 ){
+            inputs.pwm_running = !inputs.pwm_running;
+        }
+        inputs.work_pending = (rand() % 4 == 0);
+        inputs.uart_must_not_drop = (rand() % 2 == 0);
+        inputs.sleep_wake_available = (rand() % 2 == 0);
+        inputs.next_deadline_us = (rand() % 8 == 0) ? 0xFFFFFFFFu
+            : IDLE_MANAGER_SLEEP_BREAK_EVEN_US - 20u + (uint32) rand() % 40u;
+        mode = IdleManager_ChooseMode(&inputs);
+
+        if( inputs.work_pending ){
+            expected = IDLE_MODE_NONE;
+        }
+        else if( !inputs.pwm_running && !inputs.uart_must_not_drop && inputs.sleep_wake_available
+            && inputs.next_deadline_us >= IDLE_MANAGER_SLEEP_BREAK_EVEN_US ){
+            expected = IDLE_MODE_SLEEP;
+        }
+        else {
+            expected = IDLE_MODE_ALT_ACTIVE;
+        }
+        if( mode != expected ){
+            wrong_mode++;
+        }
+        if( mode == IDLE_MODE_SLEEP && inputs.pwm_running ){
+            slept_with_pwm++;
+        }
+        modes[mode]++;
+
+        if( mode != IDLE_MODE_NONE ){
+            idle_us = (uint32) rand() % 5000u;
+        }
+        IdleManager_Account(&stats, idle_us, awake_us);
+        idle_total += idle_us;
+        all_total += idle_us + awake_us;
+    }
+    CHECK( wrong_mode == 0 );
+    CHECK( slept_with_pwm == 0 );
+    // The stream went through every mode, a fair number of times.
+    CHECK( modes[IDLE_MODE_NONE] > 1000u && modes[IDLE_MODE_ALT_ACTIVE] > 1000u && modes[IDLE_MODE_SLEEP] > 1000u );
+    // Nothing overflowed yet, so the totals are exact, and the percentage is within the one it rounds down by.
+    CHECK( stats.idle_us == (uint32) idle_total );
+    CHECK( stats.total_us == (uint32) all_total );
+    exact = 100.0 * idle_total / all_total;
+    CHECK( IdleManager_IdlePercent(&stats) <= exact && IdleManager_IdlePercent(&stats) > exact - 1.0 );
+
+    // Hours of 3/4 idle, in big steps: the totals get halved instead of wrapping, and the percentage holds.
+    for( pass = 0; pass < 20000u; pass++ ){
+        IdleManager_Account(&stats, 750000u, 250000u);
+        if( stats.idle_us > stats.total_us ){
+            break;
+        }
+    }
+    CHECK( pass == 20000u );
+    CHECK( stats.total_us > 0x80000000u );
+    CHECK( IdleManager_IdlePercent(&stats) >= 74u && IdleManager_IdlePercent(&stats) <= 75u );
+    stats.idle_us = 0;
+    stats.total_us = 0;
+    CHECK( IdleManager_IdlePercent(&stats) == 0 );
+
+    // Reading the SysTick count in its callback: how long since it reloaded.
+    CHECK( IdleManager_TickLatency( 23999u, 23999u ) == 0 );
+    CHECK( IdleManager_TickLatency( 23999u, 23900u ) == 99u );
+    CHECK( IdleManager_TickLatency( 23999u, 0u ) == 23999u );
+    // Just after the reload got smaller (the clock governor slowing down): can't tell.
+    CHECK( IdleManager_TickLatency( 2999u, 23000u ) == IDLE_MANAGER_LATENCY_UNKNOWN );
+
+    IdleManager_AccountWake(&stats, 40u);
+    IdleManager_AccountWake(&stats, IDLE_MANAGER_LATENCY_UNKNOWN);
+    IdleManager_AccountWake(&stats, 12u);
+    CHECK( stats.wakeups == 3u && stats.timed_wakeups == 2u );
+    CHECK( stats.max_wake_cycles == 40u && stats.last_wake_cycles == 12u );
+
+    // The real thing: sleep, and let the SysTick wake us up a different number of cycles after it went pending.
+    TimerService_Init();
+    IdleManager_Init();
+    live = IdleManager_GetStats();
+    CHECK( live->wakeups == 0 && live->max_wake_cycles == 0 );
+    host_alt_act_wakeup = Tick_Wakes;
+    host_systick_late = 35u;
+    IdleManager_Idle(1);
+    CHECK( wakeups_called == 1u );
+    CHECK( live->wakeups == 1u && live->timed_wakeups == 1u );
+    CHECK( live->last_wake_cycles == 35u && live->max_wake_cycles == 35u );
+    host_systick_late = 80u;
+    IdleManager_Idle(1);
+    host_systick_late = 20u;
+    IdleManager_Idle(0);
+    CHECK( live->last_wake_cycles == 20u && live->max_wake_cycles == 80u );
+    CHECK( live->timed_wakeups == 3u );
+
+    // A tick while we're awake isn't a wakeup.
+    host_systick_late = 500u;
+    Host_SysTick();
+    CHECK( live->wakeups == 3u && live->max_wake_cycles == 80u );
+
+    // The UART wakes us up: counted, but not timed.
+    host_alt_act_wakeup = Uart_Wakes;
+    IdleManager_Idle(1);
+    CHECK( live->wakeups == 4u && live->timed_wakeups == 3u );
+    CHECK( live->last_wake_cycles == 20u && live->max_wake_cycles == 80u );
+
+    // With work waiting, no sleeping at all.
+    IdleManager_NotifyWork();
+    IdleManager_Idle(1);
+    CHECK( wakeups_called == 4u );
+    CHECK( IdleManager_TakeWork() == 1u );
+    CHECK( IdleManager_TakeWork() == 0 );
+    CHECK( host_interrupts_enabled );
+    host_systick_late = 0;
+
+    return Host_Done("idle_manager");
+}
+
+/* [] END OF FILE */
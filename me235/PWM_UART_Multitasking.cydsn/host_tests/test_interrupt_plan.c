@@ -0,0 +1,77 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// interrupt_plan: the project's plan passes, and a plan that breaks each rule is caught, at the right entry.
+#include "fake_psoc.h"
+#include "interrupt_plan.h"
+#include "priority_section.h"
+#include <string.h>
+
+#define MOST_ENTRIES 8u
+
+int main(void){
+    InterruptPlan_Entry broken[MOST_ENTRIES];
+    const InterruptPlan_Entry * plan;
+    uint8 count;
+    uint8 where = 0xFF;
+    uint8 i;
+    uint8 systick = 0xFF;
+    uint8 uart = 0xFF;
+
+    plan = InterruptPlan_Get(&count);
+    CHECK( count <= MOST_ENTRIES );
+    CHECK( InterruptPlan_Check( plan, count, PRIORITY_SECTION_CEILING, &where ) == INTERRUPT_PLAN_OK );
+    for( i = 0; i < count; i++){
+        if( strcmp( plan[i].name, "SysTick" ) == 0 ){
+            systick = i;
+        }
+        if( strcmp( plan[i].name, "UART receive" ) == 0 ){
+            uart = i;
+        }
+    }
+    CHECK( systick < count && uart < count );
+
+    // Rule 1: priorities are 0 to 7, and the ceiling 1 to 7.
+    CHECK( InterruptPlan_Check( plan, count, 0, &where ) == INTERRUPT_PLAN_BAD_CEILING );
+    CHECK( InterruptPlan_Check( plan, count, 8, &where ) == INTERRUPT_PLAN_BAD_CEILING );
+    memcpy( broken, plan, count * sizeof(plan[0]) );
+    broken[uart].priority = 8;
+    CHECK( InterruptPlan_Check( broken, count, PRIORITY_SECTION_CEILING, &where ) == INTERRUPT_PLAN_BAD_PRIORITY && where == uart );
+
+    // Rule 2: a lower ceiling than the SysTick leaves it out of the sections.
+    CHECK( InterruptPlan_Check( plan, count, plan[systick].priority + 1u, &where ) == INTERRUPT_PLAN_ABOVE_CEILING
+        && where == systick );
+    // So does touching section data from an ISR above the ceiling (the first entry is the most urgent).
+    memcpy( broken, plan, count * sizeof(plan[0]) );
+    broken[0].resources = INTERRUPT_PLAN_SERVO_BANK;
+    CHECK( InterruptPlan_Check( broken, count, PRIORITY_SECTION_CEILING, &where ) == INTERRUPT_PLAN_ABOVE_CEILING && where == 0 );
+
+    // Rule 3: the UART receive as urgent as the SysTick.
+    memcpy( broken, plan, count * sizeof(plan[0]) );
+    broken[uart].priority = plan[systick].priority;
+    CHECK( InterruptPlan_Check( broken, count, PRIORITY_SECTION_CEILING, &where ) == INTERRUPT_PLAN_SERIAL_BEFORE_MOTION
+        && where == uart );
+
+    // Rule 4: a second ISR pushing keyframes, after the UART's lines.
+    memcpy( broken, plan, count * sizeof(plan[0]) );
+    broken[uart].resources |= INTERRUPT_PLAN_KEYFRAMES;
+    broken[systick].resources |= INTERRUPT_PLAN_KEYFRAMES;
+    CHECK( InterruptPlan_Check( broken, count, PRIORITY_SECTION_CEILING, &where ) == INTERRUPT_PLAN_SECOND_WRITER
+        && where == ((uart > systick) ? uart : systick) );
+
+    // Applying it: every priority that has a function sticks.
+    CHECK( InterruptPlan_Apply(&where) == INTERRUPT_PLAN_OK );
+    CHECK( NVIC_GetPriority(SysTick_IRQn) == plan[systick].priority );
+    CHECK( Interrupt_UART_Receive_GetPriority() == plan[uart].priority );
+    CHECK( strcmp( InterruptPlan_Describe(INTERRUPT_PLAN_OK), "unknown" ) != 0 );
+    CHECK( strcmp( InterruptPlan_Describe(INTERRUPT_PLAN_NOT_APPLIED), "unknown" ) != 0 );
+
+    return Host_Done("interrupt_plan");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,155 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// keyframes: the fixed-point curve stays within 0.02 ticks of the real (double) Hermite curve
+// for servo-sized moves, and playback lands exactly on every keyframe, linear or cubic.
+#include "fake_psoc.h"
+#include "keyframes.h"
+#include "servo_bank.h"
+#include "motion_limiter.h"
+#include "trajectory.h"
+#include <math.h>
+#include <stdlib.h>
+
+// The cubic Hermite curve, in doubles.
+static double Hermite(double p0, double p1, double m0, double m1, double u){
+    double u2 = u * u;
+    double u3 = u2 * u;
+    return (2 * u3 - 3 * u2 + 1) * p0 + (u3 - 2 * u2 + u) * m0 + (-2 * u3 + 3 * u2) * p1 + (u3 - u2) * m1;
+}
+
+// Plays keyframes the way the PWM task does, topping up the ring so there's always one ahead.
+// Returns how many keyframes it didn't land on exactly. biggest_change is the biggest change in speed
+// from one period to the next, in ticks per period: how hard the servo gets jerked.
+static uint32 Play(const uint16 * compares, const uint16 * periods, uint8 count, int32 * biggest_change){
+    uint8 appended = 0;
+    uint8 reached = 0;
+    uint16 elapsed = 0;
+    int32 previous = ServoBank_GetCompare(0);
+    int32 previous_step = 0;
+    uint32 misses = 0;
+    uint32 frame;
+    *biggest_change = 0;
+    for( frame = 0; frame < 2000u && reached < count; frame++ ){
+        int32 now;
+        while( appended < count && Keyframes_GetQueued() < 2u ){
+            CHECK( Keyframes_Append( compares[appended], periods[appended] ) );
+            appended++;
+        }
+        Keyframes_Step(1);
+        now = ServoBank_GetCompare(0);
+        if( abs((now - previous) - previous_step) > *biggest_change ){
+            *biggest_change = abs((now - previous) - previous_step);
+        }
+        previous_step = now - previous;
+        previous = now;
+        elapsed++;
+        if( elapsed == periods[reached] ){
+            if( now != compares[reached] ){
+                misses++;
+            }
+            reached++;
+            elapsed = 0;
+        }
+    }
+    return misses + (count - reached);
+}
+
+int main(void){
+    uint32 round;
+    double worst = 0;
+    double worst_quantized = 0;
+    int32 cubic_change;
+    int32 linear_change;
+    static const uint16 compares[6] = { 1500, 2000, 1200, 1800, 1000, 1000 };
+    static const uint16 periods[6] = { 10, 25, 7, 40, 13, 5 };
+
+    // Servo-sized moves (1000 to 2000 ticks) with Catmull-Rom slopes, like playback makes.
+    srand(5);
+    for( round = 0; round < 100000u; round++ ){
+        double before = 1000 + rand() % 1000;
+        double p0 = 1000 + rand() % 1000;
+        double p1 = 1000 + rand() % 1000;
+        double after = 1000 + rand() % 1000;
+        int32 periods_before = 1 + rand() % 500;
+        int32 length = 1 + rand() % 500;
+        int32 periods_after = 1 + rand() % 500;
+        double m0 = (p1 - before) * length / (periods_before + length);
+        double m1 = (after - p0) * length / (length + periods_after);
+        Keyframes_Segment segment;
+        int32 elapsed;
+        Keyframes_BeginSegment( &segment, (int32)(p0 * 256), (int32)(p1 * 256), (uint16) length,
+            (int32)(m0 * 256), (int32)(m1 * 256), 0 );
+        for( elapsed = 0; elapsed <= length; elapsed++ ){
+            double got = Keyframes_Evaluate( &segment, (uint16) elapsed ) / 256.0;
+            // Against the exact u, and against u rounded to Q16 the way Evaluate does,
+            // which leaves only the rounding of the multiplies.
+            double u_quantized = floor(0.5 + elapsed * 65536.0 / length) / 65536.0;
+            if( fabs(got - Hermite(p0, p1, m0, m1, (double) elapsed / length)) > worst ){
+                worst = fabs(got - Hermite(p0, p1, m0, m1, (double) elapsed / length));
+            }
+            if( fabs(got - Hermite(p0, p1, m0, m1, u_quantized)) > worst_quantized ){
+                worst_quantized = fabs(got - Hermite(p0, p1, m0, m1, u_quantized));
+            }
+        }
+        // The end is exact.
+        CHECK( Keyframes_Evaluate( &segment, (uint16) length ) == (int32)(p1 * 256) );
+    }
+    CHECK( worst <= 0.02 );
+    CHECK( worst_quantized <= 0.02 );
+    printf( "worst: %.4f ticks off the curve, %.4f with u rounded\n", worst, worst_quantized );
+
+    // Linear is a straight line.
+    {
+        Keyframes_Segment segment;
+        Keyframes_BeginSegment( &segment, 1000 * 256, 2000 * 256, 4, 0, 0, 1 );
+        CHECK( Keyframes_Evaluate( &segment, 0 ) == 1000 * 256 );
+        CHECK( Keyframes_Evaluate( &segment, 1 ) == 1250 * 256 );
+        CHECK( Keyframes_Evaluate( &segment, 2 ) == 1500 * 256 );
+        CHECK( Keyframes_Evaluate( &segment, 4 ) == 2000 * 256 );
+        // A 0-period segment is 1 period long.
+        Keyframes_BeginSegment( &segment, 1000 * 256, 2000 * 256, 0, 0, 0, 1 );
+        CHECK( segment.periods == 1 );
+    }
+
+    // Playback lands on every keyframe, in both modes. Starting it stops a trajectory and a limited move.
+    host_pwm_period = 19999;
+    host_pwm_compare = 1000;
+    ServoBank_Init();
+    CHECK( Trajectory_Append(1700) );
+    CHECK( Trajectory_Play(TRAJECTORY_LOOP) );
+    MotionLimiter_SetMaxVelocity( 0, 256 );
+    MotionLimiter_SetMaxAcceleration( 0, 64 );
+    MotionLimiter_SetTarget( 0, 3000 );
+    CHECK( Keyframes_Append(0, 0) == 0 );
+    Keyframes_SetMode(KEYFRAMES_CUBIC);
+    CHECK( Play( compares, periods, 6, &cubic_change ) == 0 );
+    CHECK( !Trajectory_IsPlaying() );
+    CHECK( !MotionLimiter_InMotion(0) );
+    // It stays on the last one.
+    Keyframes_Step(1);
+    CHECK( ServoBank_GetCompare(0) == 1000 );
+    CHECK( !Keyframes_IsPlaying() );
+
+    Keyframes_SetMode(KEYFRAMES_LINEAR);
+    CHECK( Play( compares, periods, 6, &linear_change ) == 0 );
+    // The straight lines turn sharp corners at the keyframes. The curve keeps the speed going through them.
+    CHECK( cubic_change < linear_change );
+    printf( "biggest change in speed: %d ticks per period cubic, %d linear\n", (int) cubic_change, (int) linear_change );
+
+    // Full: the ring holds KEYFRAMES_RING_SIZE.
+    for( round = 0; round < KEYFRAMES_RING_SIZE; round++ ){
+        CHECK( Keyframes_Append( 1500, 10 ) );
+    }
+    CHECK( !Keyframes_Append( 1500, 10 ) );
+    CHECK( Keyframes_GetQueued() == KEYFRAMES_RING_SIZE );
+
+    return Host_Done("keyframes");
+}
+
+/* [] END OF FILE */
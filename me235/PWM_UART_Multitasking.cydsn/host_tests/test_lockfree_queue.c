@@ -0,0 +1,133 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// lockfree_queue: with real threads standing in for the ISRs, millions of items go through both queues
+// and every one comes out, once, in the order its producer pushed it.
+// (project.h turns __DMB, __LDREXW and __STREXW into C11 atomics, so this checks the ordering the code asks for,
+// on a CPU that reorders more than the Cortex-M3 does.)
+#include "fake_psoc.h"
+#include "lockfree_queue.h"
+#include "keyframes.h"
+#include "servo_bank.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define ITEMS 2000000u
+#define PRODUCERS 4u
+
+static LockFreeQueue_Spsc spsc;
+static uint32 spsc_storage[256];
+static LockFreeQueue_Mpsc mpsc;
+static LockFreeQueue_Slot mpsc_storage[256];
+
+static void * Spsc_Producer(void * unused){
+    uint32 i;
+    (void) unused;
+    for( i = 0; i < ITEMS; i++){
+        while( !LockFreeQueue_SpscPush( &spsc, i ) ){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Each producer puts its number in the top 4 bits, and counts in the rest.
+static void * Mpsc_Producer(void * context){
+    uint32 producer = (uint32)(uintptr_t) context;
+    uint32 i;
+    for( i = 0; i < ITEMS / PRODUCERS; i++){
+        while( !LockFreeQueue_MpscPush( &mpsc, (producer << 28) | i ) ){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(void){
+    pthread_t threads[PRODUCERS];
+    uint32 next[PRODUCERS] = { 0 };
+    uint32 wrong = 0;
+    uint32 item;
+    uint32 i;
+
+    // SPSC: everything, in order, and peeking looks at the right one.
+    CHECK( LockFreeQueue_SpscInit( &spsc, spsc_storage, 256 ) );
+    (void) pthread_create( &threads[0], NULL, Spsc_Producer, NULL );
+    for( i = 0; i < ITEMS; i++){
+        uint32 peeked;
+        while( !LockFreeQueue_SpscPeek( &spsc, 0, &peeked ) ){
+            sched_yield();
+        }
+        if( !LockFreeQueue_SpscPop( &spsc, &item ) || item != i || peeked != i ){
+            wrong++;
+        }
+    }
+    (void) pthread_join( threads[0], NULL );
+    CHECK( wrong == 0 );
+    CHECK( LockFreeQueue_SpscCount(&spsc) == 0 );
+
+    // MPSC: from each producer, everything, in that producer's order.
+    CHECK( LockFreeQueue_MpscInit( &mpsc, mpsc_storage, 256 ) );
+    for( i = 0; i < PRODUCERS; i++){
+        (void) pthread_create( &threads[i], NULL, Mpsc_Producer, (void *)(uintptr_t) i );
+    }
+    for( i = 0; i < (ITEMS / PRODUCERS) * PRODUCERS; i++){
+        uint32 producer;
+        while( !LockFreeQueue_MpscPop( &mpsc, &item ) ){
+            sched_yield();
+        }
+        producer = item >> 28;
+        if( producer >= PRODUCERS || (item & 0x0FFFFFFFu) != next[producer] ){
+            wrong++;
+        }
+        else {
+            next[producer]++;
+        }
+    }
+    for( i = 0; i < PRODUCERS; i++){
+        (void) pthread_join( threads[i], NULL );
+    }
+    CHECK( wrong == 0 );
+    CHECK( !LockFreeQueue_MpscPop( &mpsc, &item ) );
+
+    // The edges: full at the size, empty after, and only powers of two.
+    CHECK( LockFreeQueue_SpscInit( &spsc, spsc_storage, 4 ) );
+    for( i = 0; i < 4u; i++){
+        CHECK( LockFreeQueue_SpscPush( &spsc, i ) );
+    }
+    CHECK( !LockFreeQueue_SpscPush( &spsc, 4 ) );
+    CHECK( LockFreeQueue_SpscPeek( &spsc, 3, &item ) && item == 3 );
+    CHECK( !LockFreeQueue_SpscPeek( &spsc, 4, &item ) );
+    CHECK( !LockFreeQueue_SpscInit( &spsc, spsc_storage, 3 ) );
+    CHECK( LockFreeQueue_MpscInit( &mpsc, mpsc_storage, 4 ) );
+    for( i = 0; i < 4u; i++){
+        CHECK( LockFreeQueue_MpscPush( &mpsc, i ) );
+    }
+    CHECK( !LockFreeQueue_MpscPush( &mpsc, 4 ) );
+    CHECK( LockFreeQueue_MpscPop( &mpsc, &item ) && item == 0 );
+    CHECK( LockFreeQueue_MpscPush( &mpsc, 4 ) );
+    CHECK( !LockFreeQueue_MpscInit( &mpsc, mpsc_storage, 6 ) );
+
+    // Keyframes_Clear only drops what was queued before it, not what's pushed between it and the next step.
+    host_pwm_period = 19999;
+    ServoBank_Init();
+    CHECK( Keyframes_Append( 1500, 10 ) );
+    CHECK( Keyframes_Append( 1600, 10 ) );
+    Keyframes_Clear();
+    CHECK( Keyframes_Append( 1700, 10 ) );
+    CHECK( Keyframes_Append( 1800, 10 ) );
+    Keyframes_Step(1);
+    CHECK( Keyframes_GetQueued() == 2 && !Keyframes_IsPlaying() );
+    // And the next frame starts on them.
+    Keyframes_Step(1);
+    CHECK( Keyframes_GetQueued() == 1 && Keyframes_IsPlaying() );
+
+    return Host_Done("lockfree_queue");
+}
+
+/* [] END OF FILE */
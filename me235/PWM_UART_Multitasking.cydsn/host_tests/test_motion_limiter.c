@@ -0,0 +1,153 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// motion_limiter: the velocity and acceleration limits hold on every step of every move, even when the
+// target changes halfway, every move ends on its target, and the arrival estimate is close to how long it takes.
+#include "fake_psoc.h"
+#include "motion_limiter.h"
+#include "servo_bank.h"
+#include <math.h>
+#include <stdlib.h>
+
+static uint32 broken_limits = 0;
+static uint32 overshoots = 0;
+static uint32 never_arrived = 0;
+
+// Steps the axis until it arrives, checking the limits on the way. Returns the number of steps.
+static uint32 Run(MotionLimiter_Axis * a){
+    uint32 steps = 0;
+    int32 last_velocity = a->velocity;
+    int32 last_position = a->position;
+    int32 start_side = (a->target > a->position) ? 1 : -1;
+    uint8 moving = 1;
+    while( moving ){
+        int32 moved;
+        moving = MotionLimiter_StepAxis(a);
+        steps++;
+        moved = a->position - last_position;
+        // The speed limit, and speeding up or slowing down by at most the acceleration limit.
+        // (The last step lands on the target, which is never further than either limit.)
+        if( abs(moved) > a->max_velocity || abs(a->velocity) > a->max_velocity
+            || abs(a->velocity - last_velocity) > a->max_acceleration ){
+            broken_limits++;
+        }
+        // Braking can go past the target by less than a tick, never more.
+        if( last_velocity * start_side >= 0 && (a->position - a->target) * start_side >= 256 ){
+            overshoots++;
+        }
+        last_velocity = a->velocity;
+        last_position = a->position;
+        if( steps > 1000000u ){
+            never_arrived++;
+            break;
+        }
+    }
+    if( a->position != a->target || a->velocity != 0 ){
+        never_arrived++;
+    }
+    return steps;
+}
+
+int main(void){
+    int32 vmax;
+    int32 accel;
+    int32 distance;
+    double worst_time = 0;
+    double worst_estimate = 0;
+    uint32 round;
+
+    // From rest: every combination of limits, over distances up to 3000 ticks.
+    for( vmax = 16; vmax <= 4096; vmax *= 2 ){
+        for( accel = 4; accel <= 1024; accel *= 2 ){
+            for( distance = 1; distance <= 3000; distance += 37 ){
+                MotionLimiter_Axis a = { 0, 0, distance << MOTION_LIMITER_FRAC_BITS, vmax, accel };
+                uint32 estimate = MotionLimiter_EstimateAxis(&a);
+                uint32 steps = Run(&a);
+                // The ideal trapezoid (or triangle) takes this long.
+                double d = distance * 256.0;
+                double ideal = (d * accel >= (double) vmax * vmax) ? d / vmax + (double) vmax / accel : 2.0 * sqrt(d / accel);
+                // Whole steps only, so short moves can be a period or two over: hence the + 2.
+                if( fabs(steps - ideal) / (ideal + 2.0) > worst_time ){
+                    worst_time = fabs(steps - ideal) / (ideal + 2.0);
+                }
+                if( fabs(estimate - (double) steps) > worst_estimate ){
+                    worst_estimate = fabs(estimate - (double) steps);
+                }
+            }
+        }
+    }
+    CHECK( broken_limits == 0 );
+    CHECK( overshoots == 0 );
+    CHECK( never_arrived == 0 );
+    CHECK( worst_time < 0.35 );
+    // The estimate rounds up the ramps, so it's a period or two over, at most.
+    CHECK( worst_estimate <= 2.0 );
+    printf( "worst time vs ideal: %.3f, worst estimate: %.0f periods off\n", worst_time, worst_estimate );
+
+    // The target moves while it's going, even behind it: still within the limits, and it gets there.
+    srand(4);
+    for( round = 0; round < 20000u; round++ ){
+        MotionLimiter_Axis a = { 0, 0, 0, 16 + rand() % 2000, 4 + rand() % 300 };
+        uint32 i;
+        int32 last_velocity;
+        a.position = (rand() % 3000) << MOTION_LIMITER_FRAC_BITS;
+        a.target = (rand() % 3000) << MOTION_LIMITER_FRAC_BITS;
+        for( i = (uint32) rand() % 50u; i > 0; i-- ){
+            last_velocity = a.velocity;
+            (void) MotionLimiter_StepAxis(&a);
+            if( abs(a.velocity) > a.max_velocity || abs(a.velocity - last_velocity) > a.max_acceleration ){
+                broken_limits++;
+            }
+        }
+        a.target = (rand() % 3000) << MOTION_LIMITER_FRAC_BITS;
+        (void) Run(&a);
+    }
+    CHECK( broken_limits == 0 );
+    CHECK( never_arrived == 0 );
+
+    // Through the servo bank: a move in whole ticks, and no limits means a jump.
+    host_pwm_period = 19999;
+    host_pwm_compare = 1000;
+    ServoBank_Init();
+    CHECK( MotionLimiter_SetTarget( 0, 1500 ) == 1500 );
+    CHECK( ServoBank_GetCompare(0) == 1500 );
+    CHECK( !MotionLimiter_InMotion(0) );
+    // 2 ticks per period, speeding up by 0.25 ticks per period.
+    MotionLimiter_SetMaxVelocity( 0, 2u * 256u );
+    MotionLimiter_SetMaxAcceleration( 0, 64 );
+    CHECK( MotionLimiter_SetTarget( 0, 1000 ) == 1000 );
+    CHECK( MotionLimiter_InMotion(0) );
+    // 250 periods at full speed, plus 8 each way to get there, roughly.
+    CHECK( MotionLimiter_EstimatedArrival(0) == 258 );
+    for( round = 0; round < 1000u && MotionLimiter_InMotion(0); round++ ){
+        uint16 before = ServoBank_GetCompare(0);
+        MotionLimiter_Step(1);
+        CHECK( before - ServoBank_GetCompare(0) <= 2 );
+    }
+    CHECK( ServoBank_GetCompare(0) == 1000 );
+    CHECK( round > 250u && round < 270u );
+    CHECK( MotionLimiter_EstimatedArrival(0) == 0 );
+    // Stop: it stays where it is, and the next target starts from there.
+    MotionLimiter_SetTarget( 0, 2000 );
+    for( round = 0; round < 100u; round++ ){
+        MotionLimiter_Step(1);
+    }
+    MotionLimiter_Stop(0);
+    CHECK( !MotionLimiter_InMotion(0) );
+    distance = ServoBank_GetCompare(0);
+    MotionLimiter_Step(1);
+    CHECK( ServoBank_GetCompare(0) == distance );
+    // (The limits are still set, so this is a fresh move, starting from rest.)
+    MotionLimiter_SetTarget( 0, 2000 );
+    MotionLimiter_Step(1);
+    CHECK( ServoBank_GetCompare(0) == distance );
+
+    return Host_Done("motion_limiter");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,177 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// motion_script: a sweep script ramps in straight lines and takes exactly as long as it says,
+// every kind of broken script is caught before it runs (at the right place), and a saved script
+// comes back from the EEPROM unless it was damaged.
+#include "fake_psoc.h"
+#include "motion_script.h"
+#include "eeprom_store.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Where the script's output goes: just arrays.
+static uint16 compares[4] = { 1500, 1500, 1500, 1500 };
+static uint16 periods[4];
+static void Set_Compare(uint8 channel, uint16 compare){ compares[channel] = compare; }
+static void Set_Period(uint8 channel, uint16 period){ periods[channel] = period; }
+static uint16 Get_Compare(uint8 channel){ return compares[channel]; }
+static const MotionScript_Output output = { Set_Compare, Set_Period, Get_Compare };
+
+#define OP(name) MOTION_SCRIPT_OP_##name
+
+// sweep.txt from motion_script_asm.py's example: 5 times, to 2000 and back to 1000, 500 ticks each way, 250 ticks' rest.
+static const uint16 sweep[] = {
+    OP(PUSH), 5, OP(COUNT), 0,
+    OP(PUSH), 2000, OP(PUSH), 500, OP(RAMP), 0, OP(PUSH), 250, OP(WAIT),
+    OP(PUSH), 1000, OP(PUSH), 500, OP(RAMP), 0, OP(PUSH), 250, OP(WAIT),
+    OP(LOOP), 0, 4,
+    OP(END)
+};
+#define SWEEP_LENGTH ((uint16)(sizeof(sweep) / sizeof(sweep[0])))
+
+// Checks a broken script gets 'error' at 'where'.
+static void Check_Broken(const uint16 * program, uint16 length, MotionScript_Error error, uint16 where){
+    uint16 found = 0xFFFF;
+    CHECK( MotionScript_Check( program, length, &found ) == error && found == where );
+}
+
+int main(void){
+    MotionScript_Vm vm;
+    uint16 where;
+    uint32 now;
+    uint32 off_the_line = 0;
+
+    // The sweep: on the line from where it was to where it's going, every tick.
+    CHECK( MotionScript_Check( sweep, SWEEP_LENGTH, &where ) == MOTION_SCRIPT_OK );
+    MotionScript_Begin( &vm, sweep, SWEEP_LENGTH, &output );
+    for( now = 0; now < 10000u && vm.state != MOTION_SCRIPT_DONE; now++ ){
+        uint32 into = now % 1500u;
+        int32 expected;
+        (void) MotionScript_Execute( &vm, now, MOTION_SCRIPT_BUDGET );
+        if( into <= 500u ){
+            expected = ((now < 1500u) ? 1500 : 1000) + (int32)(((now < 1500u) ? 500 : 1000) * into / 500u);
+        }
+        else if( into <= 750u ){
+            expected = 2000;
+        }
+        else if( into <= 1250u ){
+            expected = 2000 - (int32)(1000u * (into - 750u) / 500u);
+        }
+        else {
+            expected = 1000;
+        }
+        if( abs( (int32) compares[0] - expected ) > 1 ){
+            off_the_line++;
+        }
+    }
+    CHECK( off_the_line == 0 );
+    CHECK( vm.state == MOTION_SCRIPT_DONE );
+    // 5 times 1500 ticks, and the END on the tick after the last wait.
+    CHECK( now == 5u * 1500u + 1u );
+
+    // Broken scripts, caught before they run.
+    {
+        static const uint16 unknown[] = { MOTION_SCRIPT_NUM_OPCODES };
+        static const uint16 short_push[] = { OP(PUSH) };
+        static const uint16 into_operand[] = { OP(PUSH), 1, OP(JUMP), 1 };
+        static const uint16 past_end[] = { OP(JUMP), 9 };
+        static const uint16 channel[] = { OP(PUSH), 5, OP(COMPARE), 32 };
+        static const uint16 counter[] = { OP(PUSH), 5, OP(COUNT), MOTION_SCRIPT_COUNTERS };
+        static const uint16 loop_counter[] = { OP(LOOP), MOTION_SCRIPT_COUNTERS, 0 };
+        Check_Broken( unknown, 1, MOTION_SCRIPT_BAD_OPCODE, 0 );
+        Check_Broken( short_push, 1, MOTION_SCRIPT_MISSING_OPERAND, 0 );
+        Check_Broken( into_operand, 4, MOTION_SCRIPT_BAD_ADDRESS, 2 );
+        Check_Broken( past_end, 2, MOTION_SCRIPT_BAD_ADDRESS, 0 );
+        Check_Broken( channel, 4, MOTION_SCRIPT_BAD_CHANNEL, 2 );
+        Check_Broken( counter, 4, MOTION_SCRIPT_BAD_COUNTER, 2 );
+        Check_Broken( loop_counter, 3, MOTION_SCRIPT_BAD_COUNTER, 0 );
+        CHECK( MotionScript_Check( sweep, 0, &where ) == MOTION_SCRIPT_EMPTY );
+        CHECK( MotionScript_Check( sweep, MOTION_SCRIPT_MAX_LENGTH + 1u, &where ) == MOTION_SCRIPT_TOO_LONG );
+    }
+
+    // And the ones only running can find: the stack.
+    {
+        static const uint16 empty[] = { OP(ADD) };
+        static const uint16 full[] = { OP(PUSH), 1, OP(JUMP), 0 };
+        MotionScript_Begin( &vm, empty, 1, &output );
+        CHECK( MotionScript_Execute( &vm, 0, MOTION_SCRIPT_BUDGET ) == MOTION_SCRIPT_FAILED );
+        CHECK( vm.error == MOTION_SCRIPT_STACK_EMPTY && vm.error_pc == 0 );
+        MotionScript_Begin( &vm, full, 4, &output );
+        CHECK( MotionScript_Execute( &vm, 0, MOTION_SCRIPT_BUDGET ) == MOTION_SCRIPT_FAILED );
+        CHECK( vm.error == MOTION_SCRIPT_STACK_FULL && vm.error_pc == 0 );
+    }
+
+    // A loop that never waits only gets its budget, then the next tick.
+    {
+        static const uint16 spin[] = { OP(JUMP), 0 };
+        MotionScript_Begin( &vm, spin, 2, &output );
+        CHECK( MotionScript_Execute( &vm, 0, MOTION_SCRIPT_BUDGET ) == MOTION_SCRIPT_RUNNING );
+        CHECK( vm.executed == MOTION_SCRIPT_BUDGET );
+    }
+
+    // Arithmetic, a period, and IFZERO on a counter that's run out.
+    {
+        static const uint16 math[] = {
+            OP(PUSH), 10, OP(PUSH), 3, OP(SUB), OP(DUP), OP(ADD), OP(COMPARE), 1,
+            OP(PUSH), 20000, OP(PERIOD), 2,
+            OP(IFZERO), 3, 18, OP(PUSH), 1,
+            OP(END)
+        };
+        MotionScript_Begin( &vm, math, (uint16)(sizeof(math) / sizeof(math[0])), &output );
+        CHECK( MotionScript_Check( math, (uint16)(sizeof(math) / sizeof(math[0])), &where ) == MOTION_SCRIPT_OK );
+        CHECK( MotionScript_Execute( &vm, 0, MOTION_SCRIPT_BUDGET ) == MOTION_SCRIPT_DONE );
+        CHECK( compares[1] == 14 && periods[2] == 20000 );
+        // The jump skipped the push.
+        CHECK( vm.depth == 0 );
+    }
+
+    // Saved and loaded, through the EEPROM.
+    EepromStore_Init();
+    MotionScript_Clear();
+    for( where = 0; where < SWEEP_LENGTH; where++){
+        CHECK( MotionScript_Append( sweep[where] ) );
+    }
+    host_eeprom_rows_written = 0;
+    CHECK( MotionScript_Save() );
+    CHECK( host_eeprom_rows_written > 0 );
+    // Saving it again doesn't write anything: the rows haven't changed.
+    host_eeprom_rows_written = 0;
+    CHECK( MotionScript_Save() );
+    CHECK( host_eeprom_rows_written == 0 );
+    MotionScript_Clear();
+    CHECK( MotionScript_GetLength() == 0 );
+    CHECK( MotionScript_Load() && MotionScript_GetLength() == SWEEP_LENGTH );
+    CHECK( MotionScript_Start(&where) == MOTION_SCRIPT_OK );
+    MotionScript_Stop();
+    // One bit flipped anywhere in the script (after its 8-byte header), or in the magic, length or checksum,
+    // and it's not loaded.
+    for( where = 0; where < 8u + 2u * SWEEP_LENGTH; where++){
+        if( where == 6u || where == 7u ){
+            // (Not used yet.)
+            continue;
+        }
+        host_eeprom[EEPROM_STORE_SCRIPT_ADDRESS + where] ^= 0x10u;
+        CHECK( !MotionScript_Load() );
+        host_eeprom[EEPROM_STORE_SCRIPT_ADDRESS + where] ^= 0x10u;
+    }
+    CHECK( MotionScript_Load() );
+    // A blank EEPROM has no script.
+    memset( host_eeprom, 0, EEPROM_STORE_SCRIPT_SIZE );
+    CHECK( !MotionScript_Load() );
+    // And the checksum sees swapped bytes, which a plain sum wouldn't.
+    {
+        static const uint8 forward[] = { 1, 2, 3, 4 };
+        static const uint8 swapped[] = { 1, 3, 2, 4 };
+        CHECK( EepromStore_Checksum( forward, 4 ) != EepromStore_Checksum( swapped, 4 ) );
+    }
+
+    return Host_Done("motion_script");
+}
+
+/* [] END OF FILE */
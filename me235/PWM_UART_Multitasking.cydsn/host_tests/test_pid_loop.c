@@ -0,0 +1,180 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// pid_loop: on a simulated plant (a first-order lag of 50 ms with 5 ms of dead time and a gain of 0.8,
+// sampled at 1 kHz), a step settles to within 1% without overshooting, it recovers quickly from
+// asking for more than the plant can give, and a new setpoint doesn't kick the output through D.
+#include "fake_psoc.h"
+#include "pid_loop.h"
+#include "servo_bank.h"
+#include "timer_service.h"
+#include <math.h>
+
+#define DEAD_TIME 5u
+#define TAU 50.0
+#define PLANT_GAIN 0.8
+
+// The plant: where it is (0 to 1), and the last few outputs, for the dead time.
+static double plant_y = 0;
+static double plant_history[DEAD_TIME + 1u];
+static uint32 plant_steps = 0;
+
+static void Plant_Reset(void){
+    uint32 i;
+    plant_y = 0;
+    plant_steps = 0;
+    for( i = 0; i <= DEAD_TIME; i++){
+        plant_history[i] = 0;
+    }
+}
+
+// One sample of the plant, driven by 'output' (Q15) from DEAD_TIME samples ago.
+static void Plant_Step(int16 output){
+    double delayed = plant_history[plant_steps % (DEAD_TIME + 1u)];
+    plant_history[plant_steps % (DEAD_TIME + 1u)] = output / (double) PID_LOOP_Q15_ONE;
+    plant_steps++;
+    plant_y += (PLANT_GAIN * delayed - plant_y) / TAU;
+}
+
+static int16 Plant_Feedback(void){
+    return (int16) lround( plant_y * PID_LOOP_Q15_ONE );
+}
+
+// Runs the loop for 'samples', and returns the last sample that was more than 1% off the setpoint
+// (so it settled right after), and the highest the plant got.
+static uint32 Run(PidLoop_Controller * pid, int16 setpoint, uint32 samples, double * peak){
+    uint32 k;
+    uint32 last_off = 0;
+    double target = setpoint / (double) PID_LOOP_Q15_ONE;
+    *peak = 0;
+    for( k = 0; k < samples; k++){
+        Plant_Step( PidLoop_Update( pid, setpoint, Plant_Feedback() ) );
+        if( fabs(plant_y - target) > 0.01 * target ){
+            last_off = k + 1u;
+        }
+        if( plant_y > *peak ){
+            *peak = plant_y;
+        }
+    }
+    return last_off;
+}
+
+// The device side's input: the same plant, stepped by the servo bank's duty cycle on channel 0.
+static int16 Device_Input(void){
+    uint16 period = ServoBank_GetPeriod(0);
+    Plant_Step( (int16)(((uint32) ServoBank_GetCompare(0) << 15) / (period + 1u)) );
+    return Plant_Feedback();
+}
+
+static void Set_Gains(PidLoop_Controller * pid){
+    // kp 2, ki 40 per second, kd 2 ms, at 1 kHz.
+    pid->kp = 2 * PID_LOOP_Q16_ONE;
+    pid->ki = (int32)(PID_LOOP_Q16_ONE * 40.0 / 1000.0);
+    pid->kd = 2 * PID_LOOP_Q16_ONE;
+    pid->alpha = PID_LOOP_DERIVATIVE_ALPHA;
+}
+
+int main(void){
+    PidLoop_Controller pid;
+    PidLoop_Status status;
+    uint32 settled;
+    double peak;
+    int16 before;
+    int16 after;
+    uint32 i;
+
+    // A step to half scale.
+    PidLoop_Configure( &pid, 0, PID_LOOP_Q15_ONE );
+    Set_Gains(&pid);
+    Plant_Reset();
+    settled = Run( &pid, 16384, 2000, &peak );
+    CHECK( settled <= 250u );
+    CHECK( peak <= 16384.0 / PID_LOOP_Q15_ONE * 1.01 );
+    printf( "a step to 0.5: settled to 1%% in %u samples, peak %.4f\n", (unsigned) settled, peak );
+
+    // Asking for 0.98 when the plant only goes to 0.8 pins the output at its limit. Without anti-windup,
+    // the I part would keep growing the whole time, and coming back to 0.5 would take ages.
+    PidLoop_Reset(&pid);
+    Plant_Reset();
+    (void) Run( &pid, 32000, 1500, &peak );
+    CHECK( peak <= PLANT_GAIN + 0.001 );
+    settled = Run( &pid, 16384, 1500, &peak );
+    CHECK( settled <= 400u );
+    printf( "back from 0.98 to 0.5: settled in %u samples\n", (unsigned) settled );
+
+    // A new setpoint doesn't change the D part: with only kd, the output stays the same.
+    PidLoop_Configure( &pid, -32768, 32767 );
+    pid.kd = 10 * PID_LOOP_Q16_ONE;
+    before = PidLoop_Update( &pid, 0, 1000 );
+    after = PidLoop_Update( &pid, 20000, 1000 );
+    CHECK( before == after );
+    // But the feedback moving does.
+    CHECK( PidLoop_Update( &pid, 20000, 1100 ) < after );
+
+    // Huge gains and errors stop at the limits, instead of wrapping around.
+    PidLoop_Configure( &pid, 0, PID_LOOP_Q15_ONE );
+    pid.kp = 0x7FFFFFFF;
+    pid.kd = 0x7FFFFFFF;
+    CHECK( PidLoop_Update( &pid, 32767, -32768 ) == PID_LOOP_Q15_ONE );
+    CHECK( PidLoop_Update( &pid, -32768, 32767 ) == 0 );
+
+    // On the SysTick, through the servo bank.
+    host_pwm_period = 19999;
+    host_pwm_compare = 5000;
+    ServoBank_Init();
+    TimerService_Init();
+    PidLoop_Init();
+    CHECK( !PidLoop_Start( 0, 1000 ) );
+    PidLoop_SetInput(Device_Input);
+    CHECK( !PidLoop_Start( SERVO_BANK_MAX_CHANNELS, 1000 ) );
+    CHECK( !PidLoop_Start( 0, PID_LOOP_MAX_HZ + 1u ) );
+    PidLoop_SetGain( PID_LOOP_P, 2000 );
+    PidLoop_SetGain( PID_LOOP_I, 40000 );
+    PidLoop_SetGain( PID_LOOP_D, 2 );
+    PidLoop_SetSetpoint(16384);
+    Plant_Reset();
+    CHECK( PidLoop_Start( 0, 1000 ) );
+    for( i = 0; i < 2000u; i++){
+        Host_SysTick();
+    }
+    PidLoop_GetStatus(&status);
+    CHECK( status.running && status.iterations == 2000 && status.rate_hz == 1000 );
+    CHECK( fabs(plant_y - 0.5) <= 0.005 );
+    // 300 Hz rounds to every 3 ticks.
+    CHECK( PidLoop_Start( 0, 300 ) );
+    PidLoop_GetStatus(&status);
+    CHECK( status.rate_hz == 333 );
+    for( i = 0; i < 30u; i++){
+        Host_SysTick();
+    }
+    PidLoop_GetStatus(&status);
+    CHECK( status.iterations == 10 );
+    // Stopped, the output stays where it was.
+    PidLoop_Stop();
+    before = (int16) ServoBank_GetCompare(0);
+    Host_SysTick();
+    CHECK( ServoBank_GetCompare(0) == (uint16) before );
+
+    // The pretend plant from a PID_LOOP_LOOPBACK build: the loop brings it to the setpoint by itself.
+    PidLoop_SetInput(PidLoop_LoopbackInput);
+    PidLoop_SetSetpoint(8192);
+    CHECK( PidLoop_Start( 0, 1000 ) );
+    for( i = 0; i < 3000u; i++){
+        Host_SysTick();
+    }
+    PidLoop_GetStatus(&status);
+    CHECK( status.iterations == 3000 );
+    CHECK( status.feedback >= 8192 - 82 && status.feedback <= 8192 + 82 );
+    // Its duty cycle is what holds it there: a quarter of the period.
+    CHECK( ServoBank_GetCompare(0) >= 4950u && ServoBank_GetCompare(0) <= 5050u );
+    PidLoop_Stop();
+
+    return Host_Done("pid_loop");
+}
+
+/* [] END OF FILE */
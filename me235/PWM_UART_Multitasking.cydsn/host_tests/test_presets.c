@@ -0,0 +1,119 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// presets: a stored pose comes back on every channel, the last recall byte before the PWM task runs wins,
+// and a saved slot comes back after a restart, only writes its own rows, and isn't loaded if it's damaged.
+#include "fake_psoc.h"
+#include "presets.h"
+#include "servo_bank.h"
+#include "eeprom_store.h"
+#include "uart_helper_fcns.h"
+#include <string.h>
+
+// Every channel gets its own period and compare, from 'base'.
+static void Pose(uint16 base){
+    uint8 channel;
+    for( channel = 0; channel < SERVO_BANK_MAX_CHANNELS; channel++){
+        (void) ServoBank_SetPeriod( channel, (uint16)(20000u + base) );
+        (void) ServoBank_SetCompare( channel, (uint16)(base + channel) );
+    }
+}
+
+static uint8 Is_Pose(uint16 base){
+    uint8 channel;
+    for( channel = 0; channel < SERVO_BANK_MAX_CHANNELS; channel++){
+        if( ServoBank_GetPeriod(channel) != 20000u + base || ServoBank_GetCompare(channel) != base + channel ){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void){
+    uint8 slot;
+    uint32 i;
+    uint32 first_save;
+
+    // An erased EEPROM has nothing in it.
+    memset( host_eeprom, 0xFF, sizeof(host_eeprom) );
+    host_pwm_period = 19999;
+    ServoBank_Init();
+    EepromStore_Init();
+    Presets_Init();
+    for( slot = 0; slot < PRESETS_MAX_SLOTS; slot++){
+        CHECK( !Presets_IsStored(slot) && Presets_Get(slot) == NULL );
+    }
+    CHECK( !Presets_Store(PRESETS_MAX_SLOTS) );
+    CHECK( !Presets_Recall(0) );
+    CHECK( !Presets_Save(0) );
+
+    // Store two, and get each back.
+    Pose(1000);
+    CHECK( Presets_Store(2) );
+    Pose(1500);
+    CHECK( Presets_Store(5) );
+    Pose(0);
+    CHECK( Presets_Recall(2) && Is_Pose(1000) );
+    CHECK( Presets_Recall(5) && Is_Pose(1500) );
+
+    // Recall bytes from the UART ISR: the last one before the PWM task runs is the one that happens, once.
+    Pose(0);
+    Host_UartReceive( PRESETS_RECALL_BYTE + 5u, Interrupt_Handler_UART_Receive );
+    Host_UartReceive( PRESETS_RECALL_BYTE + 2u, Interrupt_Handler_UART_Receive );
+    CHECK( Presets_ApplyRequest() == 3 );
+    CHECK( Is_Pose(1000) );
+    CHECK( Presets_ApplyRequest() == 0 );
+    // An empty slot doesn't do anything.
+    Presets_Request(7);
+    CHECK( Presets_ApplyRequest() == 0 );
+    CHECK( Is_Pose(1000) );
+
+    // Saved: only slot 2's rows, and saving it again writes nothing.
+    host_eeprom_rows_written = 0;
+    CHECK( Presets_Save(2) );
+    first_save = host_eeprom_rows_written;
+    CHECK( first_save > 0 && first_save <= EEPROM_STORE_PRESET_SIZE / EEPROM_STORE_ROW_SIZE );
+    host_eeprom_rows_written = 0;
+    CHECK( Presets_Save(2) );
+    CHECK( host_eeprom_rows_written == 0 );
+    for( i = 0; i < EEPROM_STORE_SIZE; i++){
+        if( i >= EEPROM_STORE_PRESETS_ADDRESS + 2u * EEPROM_STORE_PRESET_SIZE
+            && i < EEPROM_STORE_PRESETS_ADDRESS + 3u * EEPROM_STORE_PRESET_SIZE ){
+            continue;
+        }
+        if( host_eeprom[i] != 0xFF ){
+            break;
+        }
+    }
+    CHECK( i == EEPROM_STORE_SIZE );
+
+    // After a restart, slot 2 is back, and slot 5 (never saved) isn't.
+    Presets_Init();
+    CHECK( Presets_IsStored(2) && !Presets_IsStored(5) );
+    Pose(0);
+    CHECK( Presets_Recall(2) && Is_Pose(1000) );
+    // One bit flipped, and it's not loaded.
+    host_eeprom[EEPROM_STORE_PRESETS_ADDRESS + 2u * EEPROM_STORE_PRESET_SIZE + 40u] ^= 0x10u;
+    Presets_Init();
+    CHECK( !Presets_IsStored(2) );
+
+    // EepromStore_Write itself: across rows from the middle of one, and not past the end.
+    {
+        uint8 data[40];
+        for( i = 0; i < sizeof(data); i++){
+            data[i] = (uint8) i;
+        }
+        CHECK( EepromStore_Write( 1700, data, sizeof(data) ) );
+        CHECK( memcmp( EepromStore_Get(1700), data, sizeof(data) ) == 0 );
+        CHECK( !EepromStore_Write( EEPROM_STORE_SIZE - 8u, data, 16 ) );
+    }
+
+    return Host_Done("presets");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,71 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// priority_section: entering only ever masks more, exiting puts back exactly what was there,
+// and only the outermost section of a nest gets timed.
+#include "fake_psoc.h"
+#include "priority_section.h"
+
+int main(void){
+    PrioritySection_Stats stats = { 0 };
+    uint32 current;
+    uint32 ceiling;
+    uint8 outer;
+    uint8 inner;
+
+    // Every BASEPRI there could be, against every ceiling: at least the ceiling is masked after,
+    // and anything masked before still is.
+    for( current = 0; current < 8u; current++){
+        for( ceiling = 1; ceiling < 8u; ceiling++){
+            uint8 before = PRIORITY_SECTION_BASEPRI(current);
+            uint8 after = PrioritySection_Raise( before, PRIORITY_SECTION_BASEPRI(ceiling) );
+            CHECK( after != 0 && after <= PRIORITY_SECTION_BASEPRI(ceiling) );
+            CHECK( before == 0 || after <= before );
+            CHECK( after == before || after == PRIORITY_SECTION_BASEPRI(ceiling) );
+        }
+    }
+
+    // Nesting: the outer one from 100 to 300, the inner one from 150 to 170. Only the outer one counts.
+    PrioritySection_NoteEnter( &stats, 0, 100 );
+    PrioritySection_NoteEnter( &stats, PRIORITY_SECTION_BASEPRI(6), 150 );
+    PrioritySection_NoteExit( &stats, PRIORITY_SECTION_BASEPRI(6), 170 );
+    CHECK( stats.windows == 0 );
+    PrioritySection_NoteExit( &stats, 0, 300 );
+    CHECK( stats.windows == 1 && stats.longest_cycles == 200 && stats.last_cycles == 200 );
+    // Across the cycle counter wrapping around, and a shorter one doesn't change the longest.
+    PrioritySection_NoteEnter( &stats, 0, 0xFFFFFFF0u );
+    PrioritySection_NoteExit( &stats, 0, 0x10 );
+    CHECK( stats.windows == 2 && stats.last_cycles == 0x20 && stats.longest_cycles == 200 );
+
+    // The real thing, on the fake BASEPRI and cycle counter.
+    PrioritySection_Init();
+    CHECK( host_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk );
+    host_basepri = 0;
+    host_dwt.CYCCNT = 1000;
+    outer = PrioritySection_Enter();
+    CHECK( outer == 0 && host_basepri == PRIORITY_SECTION_BASEPRI(PRIORITY_SECTION_CEILING) );
+    host_dwt.CYCCNT = 1100;
+    inner = PrioritySection_Enter();
+    CHECK( inner == PRIORITY_SECTION_BASEPRI(PRIORITY_SECTION_CEILING) );
+    PrioritySection_Exit(inner);
+    CHECK( host_basepri == PRIORITY_SECTION_BASEPRI(PRIORITY_SECTION_CEILING) );
+    host_dwt.CYCCNT = 1500;
+    PrioritySection_Exit(outer);
+    CHECK( host_basepri == 0 );
+    CHECK( PrioritySection_GetStats()->last_cycles == 500 );
+    // Already masking more than the ceiling (in a more urgent ISR, say): it stays that way.
+    host_basepri = PRIORITY_SECTION_BASEPRI(2);
+    outer = PrioritySection_Enter();
+    CHECK( host_basepri == PRIORITY_SECTION_BASEPRI(2) );
+    PrioritySection_Exit(outer);
+    CHECK( host_basepri == PRIORITY_SECTION_BASEPRI(2) );
+
+    return Host_Done("priority_section");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,107 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// pwm_frequency: for every frequency from 1 Hz to 12 MHz, the divider is the smallest one that fits
+// the frame into 16 bits, and the frame is as close to the asked-for length as the rounding allows.
+#include "fake_psoc.h"
+#include "pwm_frequency.h"
+#include "clock_governor.h"
+#include "servo_bank.h"
+#include <math.h>
+
+int main(void){
+    PwmFrequency_Solution solution;
+    uint32 hz;
+    uint32 unsolved = 0;
+    uint32 too_big = 0;
+    uint32 not_smallest = 0;
+    uint32 too_far = 0;
+    uint32 wrong_actual = 0;
+
+    for( hz = 1; hz <= BCLK__BUS_CLK__HZ / 2u; hz++ ){
+        uint32 total;
+        uint32 counts;
+        double frame_clocks;
+        if( !PwmFrequency_Solve( BCLK__BUS_CLK__HZ, hz, &solution ) ){
+            unsolved++;
+            continue;
+        }
+        total = (uint32) solution.divider + 1u;
+        counts = (uint32) solution.period + 1u;
+        if( total > PWM_FREQUENCY_MAX_DIVISION || counts > PWM_FREQUENCY_MAX_COUNTS || counts < 2u ){
+            too_big++;
+        }
+        // One divider less and the frame wouldn't fit (rounded the same way Solve does).
+        frame_clocks = (double) BCLK__BUS_CLK__HZ / hz;
+        if( total > 1u && floor(floor(frame_clocks + 0.5) / (total - 1u) + 0.5) <= PWM_FREQUENCY_MAX_COUNTS ){
+            not_smallest++;
+        }
+        // The frame is off by at most the two roundings: half a bus clock, and half a tick.
+        if( fabs((double) total * counts - frame_clocks) > 0.5 + 0.5 * total + 1e-9 ){
+            too_far++;
+        }
+        if( fabs(solution.actual_millihz - 1000.0 * BCLK__BUS_CLK__HZ / ((double) total * counts)) > 0.5 ){
+            wrong_actual++;
+        }
+    }
+    CHECK( unsolved == 0 );
+    CHECK( too_big == 0 );
+    CHECK( not_smallest == 0 );
+    CHECK( too_far == 0 );
+    CHECK( wrong_actual == 0 );
+
+    // Some that can't be done.
+    CHECK( !PwmFrequency_Solve( BCLK__BUS_CLK__HZ, 0, &solution ) );
+    CHECK( !PwmFrequency_Solve( BCLK__BUS_CLK__HZ, 20000000u, &solution ) );
+    // Between half the bus clock and 2/3 of it, a frame rounds to 2 bus clocks.
+    CHECK( PwmFrequency_Solve( BCLK__BUS_CLK__HZ, 15000000u, &solution ) );
+    CHECK( solution.divider == 0 && solution.period == 1 && solution.actual_millihz == 12000000000uLL );
+
+    // A 50 Hz servo frame: 480000 bus clocks, so divide by 8, for 60000 ticks.
+    CHECK( PwmFrequency_Solve( BCLK__BUS_CLK__HZ, 50, &solution ) );
+    CHECK( solution.divider == 7 && solution.period == 59999 );
+    CHECK( solution.actual_millihz == 50000 );
+
+    // Rescaling keeps the pulse width, and stays inside the new period.
+    CHECK( PwmFrequency_RescaleCompare( 150, 239, 7, 59999 ) == 4500 );
+    CHECK( PwmFrequency_RescaleCompare( 4500, 7, 239, 1999 ) == 150 );
+    CHECK( PwmFrequency_RescaleCompare( 60000, 0, 0, 1999 ) == 1999 );
+
+    // Applying it: the fitter's 100 kHz clock with a 50 Hz frame and a 1.5 ms pulse.
+    host_clock_pwm_divider = 239;
+    host_pwm_period = 1999;
+    host_pwm_compare = 150;
+    host_pwm_control = PWM_Servo_CTRL_ENABLE;
+    ClockGovernor_Init();
+    ServoBank_Init();
+    CHECK( PwmFrequency_Request( 50, &solution ) );
+    // Running, and no new frame yet: it waits.
+    CHECK( !PwmFrequency_ApplyAtFrame(0) );
+    CHECK( host_pwm_period == 1999 );
+    // At the frame, with the counter past the pulse: the new clock, period, and compare go in,
+    // and the counter starts over from the new period.
+    host_pwm_counter = 1000;
+    CHECK( PwmFrequency_ApplyAtFrame(1) );
+    CHECK( ClockGovernor_GetPwmBaseDivider() == 7 );
+    CHECK( host_pwm_period == 59999 );
+    CHECK( host_pwm_compare == 4500 );
+    CHECK( host_pwm_counter == 59999 );
+    CHECK( ServoBank_GetCompare(0) == 4500 && ServoBank_DirtyMask() == 0 );
+    // Nothing's waiting anymore.
+    CHECK( !PwmFrequency_ApplyAtFrame(1) );
+    // Stopped: right away.
+    host_pwm_control = 0;
+    CHECK( PwmFrequency_Request( 100, &solution ) );
+    CHECK( PwmFrequency_ApplyAtFrame(0) );
+    CHECK( host_pwm_period == 59999 && ClockGovernor_GetPwmBaseDivider() == 3 );
+    CHECK( host_pwm_compare == 9000 );
+
+    return Host_Done("pwm_frequency");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,157 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// servo_bank: a commit writes exactly the channels that changed, lowest first, period before compare,
+// and always inside the limits.
+#include "fake_psoc.h"
+#include "servo_bank.h"
+#include <stdlib.h>
+
+// Every write to an output, in order. The outputs can't tell which channel they are,
+// so there's one pair of functions per channel, made by a macro.
+#define WRITES 4096u
+static struct { uint8 channel; uint8 is_compare; uint16 value; } writes[WRITES];
+static uint32 write_count = 0;
+
+static void Log(uint8 channel, uint8 is_compare, uint16 value){
+    if( write_count < WRITES ){
+        writes[write_count].channel = channel;
+        writes[write_count].is_compare = is_compare;
+        writes[write_count].value = value;
+    }
+    write_count++;
+}
+
+// Channel 0 is PWM_Servo itself, so 1 to 31.
+#define CHANNELS(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+#define CHANNEL_FUNCTIONS(n) \
+    static void Period_##n(uint16 value){ Log(n, 0, value); } \
+    static void Compare_##n(uint16 value){ Log(n, 1, value); }
+CHANNELS(CHANNEL_FUNCTIONS)
+#define CHANNEL_OUTPUT(n) [n] = { Period_##n, Compare_##n },
+static const ServoBank_Output outputs[SERVO_BANK_MAX_CHANNELS] = { CHANNELS(CHANNEL_OUTPUT) };
+
+int main(void){
+    uint32 round;
+    uint32 i;
+    uint16 model_period[SERVO_BANK_MAX_CHANNELS];
+    uint16 model_compare[SERVO_BANK_MAX_CHANNELS];
+    uint32 bad_order = 0;
+    uint32 bad_value = 0;
+
+    // Channel 0 starts from what PWM_Servo has, with nothing to write.
+    host_pwm_period = 1000;
+    host_pwm_compare = 75;
+    ServoBank_Init();
+    CHECK( ServoBank_GetPeriod(0) == 1000 );
+    CHECK( ServoBank_GetCompare(0) == 75 );
+    CHECK( ServoBank_DirtyMask() == 0 );
+
+    for( i = 1; i < SERVO_BANK_MAX_CHANNELS; i++ ){
+        ServoBank_AttachOutput( (uint8) i, &outputs[i] );
+    }
+    CHECK( ServoBank_DirtyMask() == 0xFFFFFFFEu );
+    CHECK( ServoBank_Commit() == 0xFFFFFFFEu );
+    CHECK( write_count == 2u * 31u );
+    for( i = 0; i < SERVO_BANK_MAX_CHANNELS; i++ ){
+        model_period[i] = ServoBank_GetPeriod( (uint8) i );
+        model_compare[i] = ServoBank_GetCompare( (uint8) i );
+    }
+
+    // Random changes to random channels: each commit writes exactly those, in order.
+    srand(2);
+    for( round = 0; round < 2000u; round++ ){
+        uint32 changed = 0;
+        uint32 written;
+        uint32 changes = (uint32) rand() % 6u;
+        while( changes-- > 0 ){
+            // Channel 0 is PWM_Servo: leave it out, so every write is logged.
+            uint8 channel = (uint8)(1u + (uint32) rand() % (SERVO_BANK_MAX_CHANNELS - 1u));
+            if( rand() % 3 == 0 ){
+                model_period[channel] = ServoBank_SetPeriod( channel, (uint16)(100 + rand() % 3000) );
+            }
+            else {
+                model_compare[channel] = ServoBank_SetCompare( channel, (uint16)(rand() % 4000) );
+            }
+            changed |= (1uL << channel);
+        }
+        CHECK( ServoBank_DirtyMask() == changed );
+        write_count = 0;
+        written = ServoBank_Commit();
+        CHECK( written == changed );
+        CHECK( ServoBank_DirtyMask() == 0 );
+        for( i = 0; i < write_count; i++ ){
+            uint8 channel = writes[i].channel;
+            // Pairs: period then compare for the same channel, and the channels going up.
+            if( (i & 1u) == 0 ){
+                if( writes[i].is_compare || (i >= 2u && writes[i - 2u].channel >= channel) ){
+                    bad_order++;
+                }
+            }
+            else if( !writes[i].is_compare || writes[i - 1u].channel != channel ){
+                bad_order++;
+            }
+            // A period change can pull the compare down, so check it against the bank, not the model.
+            model_compare[channel] = ServoBank_GetCompare(channel);
+            if( writes[i].value != (writes[i].is_compare ? model_compare[channel] : model_period[channel])
+                || model_compare[channel] > model_period[channel] ){
+                bad_value++;
+            }
+        }
+        CHECK( write_count == 2u * (uint32) __builtin_popcount(changed) );
+    }
+    CHECK( bad_order == 0 );
+    CHECK( bad_value == 0 );
+
+    // The limits: the compare stays inside them, and never goes past the period.
+    ServoBank_SetPeriod( 5, 2000 );
+    ServoBank_SetLimits( 5, 100, 200 );
+    CHECK( ServoBank_SetCompare( 5, 50 ) == 100 );
+    CHECK( ServoBank_SetCompare( 5, 500 ) == 200 );
+    CHECK( ServoBank_SetCompare( 5, 150 ) == 150 );
+    CHECK( ServoBank_ClampCompare( 5, 0xFFFFu ) == 200 );
+    ServoBank_SetLimits( 5, 0, 0xFFFFu );
+    ServoBank_SetCompare( 5, 1500 );
+    CHECK( ServoBank_SetPeriod( 5, 1000 ) == 1000 );
+    CHECK( ServoBank_GetCompare(5) == 1000 );
+    // Limits the wrong way around are ignored.
+    ServoBank_SetLimits( 5, 300, 200 );
+    CHECK( ServoBank_ClampCompare( 5, 0 ) == 0 );
+    // No such channel.
+    CHECK( ServoBank_SetCompare( SERVO_BANK_MAX_CHANNELS, 10 ) == 0 );
+    CHECK( ServoBank_GetPeriod( SERVO_BANK_MAX_CHANNELS ) == 0 );
+    (void) ServoBank_Commit();
+
+    // Adopt: the hardware was written already, so nothing is waiting.
+    ServoBank_SetCompare( 7, 10 );
+    ServoBank_Adopt( 7, 3000, 20 );
+    CHECK( ServoBank_DirtyMask() == 0 );
+    CHECK( ServoBank_GetCompare(7) == 20 );
+
+    // At a frame: while PWM_Servo runs, a change waits for the terminal count.
+    host_pwm_control = PWM_Servo_CTRL_ENABLE;
+    ServoBank_SetCompare( 0, 80 );
+    CHECK( ServoBank_CommitAtFrame( ServoBank_PollFrame() ) == 0 );
+    CHECK( host_pwm_compare == 75 );
+    host_pwm_status = PWM_Servo_STATUS_TC;
+    CHECK( ServoBank_CommitAtFrame( ServoBank_PollFrame() ) == 1 );
+    CHECK( host_pwm_compare == 80 );
+    // The TC bit was read, so it's cleared.
+    CHECK( ServoBank_PollFrame() == 0 );
+    // Stopped, it goes out right away.
+    host_pwm_control = 0;
+    ServoBank_SetCompare( 0, 90 );
+    CHECK( ServoBank_CommitAtFrame(0) == 1 );
+    CHECK( host_pwm_compare == 90 );
+
+    return Host_Done("servo_bank");
+}
+
+/* [] END OF FILE */
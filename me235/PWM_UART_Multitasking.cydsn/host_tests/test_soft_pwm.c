@@ -0,0 +1,115 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// soft_pwm: after any number of single-channel changes, the edge table is still right,
+// and re-drawing only the slots between the old and new edge gives the same window as drawing all of it.
+#include "fake_psoc.h"
+#include "soft_pwm.h"
+#include <stdlib.h>
+#include <string.h>
+
+// What the port should be in 'slot', worked out the slow way: pin c is high before its width.
+static uint8 Expected_Port(const uint16 * widths, uint16 slot){
+    uint8 port = 0;
+    uint8 c;
+    for( c = 0; c < SOFT_PWM_CHANNELS; c++){
+        if( slot < widths[c] ){
+            port |= (uint8)(1u << c);
+        }
+    }
+    return port;
+}
+
+// 1 if the table is sorted, has at most one edge per slot, and its port values follow from its masks.
+static uint8 Table_Is_Consistent(const SoftPwm_EdgeTable * t){
+    uint8 port = t->high_mask;
+    uint8 falling = 0;
+    uint8 i;
+    for( i = 0; i < t->num_edges; i++){
+        if( (i > 0 && t->edges[i].slot <= t->edges[i - 1u].slot) || t->edges[i].falling_mask == 0 ){
+            return 0;
+        }
+        // Each pin falls once at most.
+        if( (falling & t->edges[i].falling_mask) != 0 ){
+            return 0;
+        }
+        falling |= t->edges[i].falling_mask;
+        port &= (uint8) ~t->edges[i].falling_mask;
+        if( t->edges[i].port_after != port ){
+            return 0;
+        }
+    }
+    // Every pin that goes high comes back down.
+    return (falling == t->high_mask) ? 1 : 0;
+}
+
+int main(void){
+    SoftPwm_EdgeTable table;
+    uint16 widths[SOFT_PWM_CHANNELS] = { 150, 100, 0, 255, 150, 1, 300, 20 };
+    uint8 window[SOFT_PWM_WINDOW_SLOTS];
+    uint32 round;
+    uint16 s;
+    uint32 bad_window = 0;
+    uint32 bad_table = 0;
+
+    // From scratch. Channel 6 is past the window, so it's clamped to the same edge as 3; 0 and 4 share one too.
+    SoftPwm_BuildEdges( &table, widths );
+    widths[6] = SOFT_PWM_WINDOW_SLOTS;
+    CHECK( Table_Is_Consistent(&table) );
+    CHECK( table.num_edges == 5 );
+    CHECK( table.high_mask == 0xFBu );
+    SoftPwm_RenderWindow( &table, window, 0, SOFT_PWM_WINDOW_SLOTS );
+    for( s = 0; s < SOFT_PWM_WINDOW_SLOTS; s++){
+        CHECK( window[s] == Expected_Port(widths, s) );
+    }
+
+    // Random changes, including turning channels on and off, and setting what they already have.
+    srand(3);
+    for( round = 0; round < 100000u; round++ ){
+        uint8 channel = (uint8)((uint32) rand() % SOFT_PWM_CHANNELS);
+        uint16 old_width = widths[channel];
+        uint16 width = (rand() % 10 == 0) ? 0u : (uint16)((uint32) rand() % 300u);
+        uint16 from;
+        uint16 to;
+        (void) SoftPwm_UpdateEdge( &table, channel, width );
+        widths[channel] = (width > SOFT_PWM_WINDOW_SLOTS) ? SOFT_PWM_WINDOW_SLOTS : width;
+        if( !Table_Is_Consistent(&table) || table.width[channel] != widths[channel] ){
+            bad_table++;
+        }
+        // The same partial re-draw that SoftPwm_SetWidth does.
+        from = (old_width < widths[channel]) ? old_width : widths[channel];
+        to = (old_width < widths[channel]) ? widths[channel] : old_width;
+        SoftPwm_RenderWindow( &table, window, from, to );
+        for( s = 0; s < SOFT_PWM_WINDOW_SLOTS; s++){
+            if( window[s] != Expected_Port(widths, s) ){
+                bad_window++;
+            }
+        }
+    }
+    CHECK( bad_table == 0 );
+    CHECK( bad_window == 0 );
+
+    // All off: no edges, nothing high.
+    memset( widths, 0, sizeof(widths) );
+    SoftPwm_BuildEdges( &table, widths );
+    CHECK( table.num_edges == 0 );
+    CHECK( table.high_mask == 0 );
+    // A channel that doesn't exist changes nothing.
+    CHECK( SoftPwm_UpdateEdge( &table, SOFT_PWM_CHANNELS, 100 ) == 0 );
+    CHECK( table.num_edges == 0 );
+
+    // There's no DMA_SoftPwm here, so it doesn't start, and the bank outputs only write the compare.
+    CHECK( SoftPwm_Start() == 0 );
+    CHECK( SoftPwm_GetOutput(0)->write_period == NULL );
+    CHECK( SoftPwm_GetOutput(7)->write_compare != NULL );
+    CHECK( SoftPwm_GetOutput(SOFT_PWM_CHANNELS) == NULL );
+
+    return Host_Done("soft_pwm");
+}
+
+/* [] END OF FILE */
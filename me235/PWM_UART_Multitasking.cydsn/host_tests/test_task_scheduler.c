@@ -0,0 +1,117 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// task_scheduler: the most urgent task runs first, events pile up into one run, the time accounting
+// adds up (even when the clock wraps), and an "ISR" on another thread never signals a task that doesn't run.
+#include "fake_psoc.h"
+#include "task_scheduler.h"
+#include <pthread.h>
+#include <sched.h>
+
+// A pretend clock. Each task uses up some of it when it runs.
+static uint32 clock_now;
+static uint32 Clock(void){
+    return clock_now;
+}
+
+static TaskScheduler scheduler;
+static uint8 order[16];
+static uint8 order_count = 0;
+static uint32 received[4];
+
+// Task N takes 10 * (N + 1) clock units.
+static void Record(uint8 task, uint32 events){
+    order[order_count++] = task;
+    received[task] |= events;
+    clock_now += 10u * (task + 1u);
+}
+static void Task_0(uint32 events){ Record(0, events); }
+static void Task_1(uint32 events){ Record(1, events); }
+static void Task_2(uint32 events){ Record(2, events); }
+static void Task_3(uint32 events){ Record(3, events); }
+
+// Every event bit the ISR thread sent, and every one the task got.
+#define SIGNALS 200000u
+static volatile uint32 signals_done = 0;
+static uint32 events_seen = 0;
+
+static void Task_Count(uint32 events){
+    events_seen |= events;
+}
+
+static void * Isr(void * unused){
+    uint32 i;
+    (void) unused;
+    for( i = 0; i < SIGNALS; i++){
+        TaskScheduler_Signal( &scheduler, 0, 1u << (i & 31u) );
+        if( (i & 63u) == 0 ){
+            sched_yield();
+        }
+    }
+    signals_done = 1;
+    return NULL;
+}
+
+int main(void){
+    pthread_t thread;
+
+    TaskScheduler_Init( &scheduler, Clock );
+    CHECK( TaskScheduler_Add( &scheduler, 0, "a", Task_0 ) );
+    CHECK( TaskScheduler_Add( &scheduler, 1, "b", Task_1 ) );
+    CHECK( TaskScheduler_Add( &scheduler, 2, "c", Task_2 ) );
+    CHECK( TaskScheduler_Add( &scheduler, 3, "d", Task_3 ) );
+    CHECK( !TaskScheduler_Add( &scheduler, TASK_SCHEDULER_MAX_TASKS, "too far", Task_0 ) );
+    CHECK( !TaskScheduler_RunNext(&scheduler) );
+
+    // Signaled in the wrong order, they run most urgent first, and task 1's two signals are one run.
+    TaskScheduler_Signal( &scheduler, 3, 1 );
+    TaskScheduler_Signal( &scheduler, 1, 2 );
+    TaskScheduler_Signal( &scheduler, 1, 4 );
+    TaskScheduler_Signal( &scheduler, 0, 8 );
+    while( TaskScheduler_RunNext(&scheduler) ){
+    }
+    CHECK( order_count == 3 && order[0] == 0 && order[1] == 1 && order[2] == 3 );
+    CHECK( received[1] == 6 );
+    CHECK( scheduler.tasks[1].runs == 1 );
+
+    // 10 + 20 + 40 busy, then 940 idle: task 3 had 40 of 1010.
+    clock_now += 940u;
+    (void) TaskScheduler_RunNext(&scheduler);
+    CHECK( TaskScheduler_SharePerMille( &scheduler, 3 ) == 39 );
+    CHECK( scheduler.tasks[3].max_time == 40 );
+
+    // Across the clock wrapping around.
+    clock_now = 0xFFFFFFF0u;
+    TaskScheduler_ResetStats(&scheduler);
+    TaskScheduler_Signal( &scheduler, 2, 1 );
+    (void) TaskScheduler_RunNext(&scheduler);
+    clock_now += 70u;
+    (void) TaskScheduler_RunNext(&scheduler);
+    CHECK( scheduler.tasks[2].max_time == 30 && scheduler.tasks[2].runs == 1 );
+    CHECK( scheduler.elapsed_time == 100 );
+    CHECK( TaskScheduler_SharePerMille( &scheduler, 2 ) == 300 );
+
+    // An ISR signaling while the main loop runs tasks: once it stops, nothing's left waiting, and every event got through.
+    CHECK( TaskScheduler_Add( &scheduler, 0, "isr", Task_Count ) );
+    (void) pthread_create( &thread, NULL, Isr, NULL );
+    while( !signals_done ){
+        while( TaskScheduler_RunNext(&scheduler) ){
+        }
+        sched_yield();
+    }
+    (void) pthread_join( thread, NULL );
+    while( TaskScheduler_RunNext(&scheduler) ){
+    }
+    CHECK( scheduler.ready == 0 && scheduler.tasks[0].events == 0 );
+    CHECK( events_seen == 0xFFFFFFFFu );
+    printf( "%u signals ran as %u runs\n", SIGNALS, (unsigned) scheduler.tasks[0].runs );
+
+    return Host_Done("task_scheduler");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,150 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// timer_service: every timer runs on its tick, however many share a slot of the wheel, and whatever the callbacks do.
+#include "fake_psoc.h"
+#include "timer_service.h"
+#include <stdlib.h>
+
+#define TIMERS 200u
+
+static TimerService_Timer timers[TIMERS];
+// When each timer should run next (0 = it shouldn't), and how many times it was late or early.
+static uint32 due[TIMERS];
+static uint32 wrong_tick = 0;
+static uint32 runs = 0;
+
+static void Record(void * context){
+    uint32 which = (uint32)(uintptr_t) context;
+    if( due[which] != TimerService_Now() ){
+        wrong_tick++;
+    }
+    runs++;
+    due[which] = (timers[which].period != 0) ? due[which] + timers[which].period : 0;
+}
+
+// Stops the timer after it in the array, which may be due in this same tick.
+static void Stop_Next(void * context){
+    uint32 which = (uint32)(uintptr_t) context;
+    Record(context);
+    TimerService_Stop( &timers[which + 1u] );
+    due[which + 1u] = 0;
+}
+
+static uint32 order[3];
+static uint32 order_count = 0;
+
+static void Note_Order(void * context){
+    order[order_count++] = (uint32)(uintptr_t) context;
+}
+
+int main(void){
+    uint32 i;
+    uint32 tick;
+    uint32 expected_runs = 0;
+
+    TimerService_Init();
+    CHECK( TimerService_Now() == 0 );
+
+    // Lots of timers, some much longer than one trip around the wheel, some periodic,
+    // started and stopped at random. Dispatch every tick, so each callback sees its own tick.
+    srand(1);
+    for( tick = 0; tick < 20000u; tick++ ){
+        uint32 which = (uint32) rand() % TIMERS;
+        if( rand() % 4 == 0 ){
+            uint32 ticks = (uint32) rand() % (5u * TIMER_SERVICE_WHEEL_SLOTS);
+            uint32 period = (rand() % 3 == 0) ? 1u + (uint32) rand() % 300u : 0u;
+            TimerService_Start( &timers[which], ticks, period, Record, (void *)(uintptr_t) which );
+            due[which] = TimerService_Now() + ((ticks == 0) ? 1u : ticks);
+        }
+        else if( rand() % 8 == 0 ){
+            TimerService_Stop( &timers[which] );
+            due[which] = 0;
+        }
+        Host_SysTick();
+        for( i = 0; i < TIMERS; i++ ){
+            if( due[i] == TimerService_Now() ){
+                expected_runs++;
+            }
+        }
+        TimerService_Dispatch();
+    }
+    CHECK( wrong_tick == 0 );
+    CHECK( runs == expected_runs );
+    CHECK( runs > 1000u );
+    // Nothing that was due got left behind.
+    for( i = 0; i < TIMERS; i++ ){
+        CHECK( due[i] == 0 || (int32)(due[i] - TimerService_Now()) > 0 );
+        CHECK( TimerService_IsActive(&timers[i]) == (due[i] != 0) );
+    }
+    for( i = 0; i < TIMERS; i++ ){
+        TimerService_Stop( &timers[i] );
+        due[i] = 0;
+    }
+
+    // A callback that stops another timer due in the same tick: that one never runs.
+    runs = 0;
+    TimerService_Start( &timers[0], 5, 0, Stop_Next, (void *) 0 );
+    TimerService_Start( &timers[1], 5, 0, Record, (void *) 1 );
+    due[0] = TimerService_Now() + 5u;
+    due[1] = TimerService_Now() + 5u;
+    // Timers go on the front of their slot, so restarting 0 puts it ahead of 1.
+    TimerService_Start( &timers[0], 5, 0, Stop_Next, (void *) 0 );
+    for( i = 0; i < 5u; i++ ){
+        Host_SysTick();
+    }
+    TimerService_Dispatch();
+    CHECK( runs == 1 );
+    CHECK( !TimerService_IsActive(&timers[1]) );
+
+    // The main loop was busy: Dispatch catches up, in the order the timers ran out.
+    TimerService_Start( &timers[2], 30, 0, Note_Order, (void *) 2 );
+    TimerService_Start( &timers[3], 10, 0, Note_Order, (void *) 3 );
+    TimerService_Start( &timers[4], 10 + TIMER_SERVICE_WHEEL_SLOTS, 0, Note_Order, (void *) 4 );
+    CHECK( TimerService_Remaining(&timers[4]) == 10 + TIMER_SERVICE_WHEEL_SLOTS );
+    for( i = 0; i < 100u; i++ ){
+        Host_SysTick();
+    }
+    TimerService_Dispatch();
+    CHECK( order_count == 3 );
+    CHECK( order[0] == 3 && order[1] == 2 && order[2] == 4 );
+    CHECK( TimerService_Remaining(&timers[4]) == 0 );
+
+    // A periodic timer doesn't drift, even when it's dispatched late.
+    runs = 0;
+    TimerService_Start( &timers[5], 7, 7, Record, (void *) 5 );
+    due[5] = TimerService_Now() + 7u;
+    for( i = 0; i < 700u; i++ ){
+        Host_SysTick();
+        // Only every 3rd tick, so most runs are a tick or two late.
+        if( i % 3 == 0 ){
+            TimerService_Dispatch();
+        }
+    }
+    TimerService_Dispatch();
+    CHECK( runs == 100 );
+    CHECK( TimerService_Remaining(&timers[5]) == 7 );
+
+    // Deadlines.
+    tick = TimerService_DeadlineIn(3);
+    CHECK( !TimerService_Expired(tick) );
+    Host_SysTick();
+    Host_SysTick();
+    CHECK( !TimerService_Expired(tick) );
+    Host_SysTick();
+    CHECK( TimerService_Expired(tick) );
+    CHECK( TimerService_Expired(tick - 0x7FFFFFFFu) );
+    CHECK( !TimerService_Expired(tick + 0x7FFFFFFFu) );
+
+    // Right at the start of a tick, the microseconds are just the milliseconds.
+    CHECK( TimerService_NowUs() == TimerService_Now() * 1000u );
+
+    return Host_Done("timer_service");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,148 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// trajectory: every table size and mode plays the points in the right order, and the position
+// it reports is the point that's playing.
+#include "fake_psoc.h"
+#include "trajectory.h"
+#include "servo_bank.h"
+#include "motion_limiter.h"
+#include "timer_service.h"
+
+// Which point should play in frame 'frame', worked out the slow way.
+static uint16 Expected_Point(uint32 frame, uint16 count, Trajectory_Mode mode){
+    uint32 cycle;
+    if( mode == TRAJECTORY_LOOP ){
+        return (uint16)(frame % count);
+    }
+    if( mode == TRAJECTORY_ONE_SHOT ){
+        return (uint16)((frame < count) ? frame : count - 1u);
+    }
+    // Ping-pong: 0 1 2 ... count-1 count-2 ... 1, over and over.
+    if( count == 1u ){
+        return 0;
+    }
+    cycle = frame % (2u * (count - 1u));
+    return (uint16)((cycle < count) ? cycle : 2u * (count - 1u) - cycle);
+}
+
+int main(void){
+    static uint16 points[TRAJECTORY_MAX_POINTS];
+    static uint16 expanded[TRAJECTORY_MAX_EXPANDED];
+    uint16 count;
+    uint8 mode;
+    uint32 frame;
+    uint32 wrong_point = 0;
+    uint32 wrong_value = 0;
+    uint32 wrong_stop = 0;
+
+    for( count = 0; count < TRAJECTORY_MAX_POINTS; count++ ){
+        // Different from their index, so a mix-up between the two shows.
+        points[count] = (uint16)(1000u + 3u * count);
+    }
+
+    // Every size of table, in every mode, for a few times around.
+    for( count = 1; count <= TRAJECTORY_MAX_POINTS; count++ ){
+        for( mode = TRAJECTORY_LOOP; mode <= TRAJECTORY_PING_PONG; mode++ ){
+            Trajectory_State state;
+            state.expanded_length = Trajectory_Expand( points, count, (Trajectory_Mode) mode, expanded );
+            state.offset = 0;
+            state.played = 0;
+            state.mode = mode;
+            state.running = 1;
+            CHECK( state.expanded_length <= TRAJECTORY_MAX_EXPANDED );
+            for( frame = 0; frame < 3u * 2u * count + 5u; frame++ ){
+                uint16 offset = Trajectory_Advance(&state);
+                uint16 point = Trajectory_PositionFromOffset( state.played, count, (Trajectory_Mode) mode );
+                if( point != Expected_Point(frame, count, (Trajectory_Mode) mode) ){
+                    wrong_point++;
+                }
+                if( expanded[offset] != points[point] ){
+                    wrong_value++;
+                }
+            }
+            // Only a one-shot stops by itself.
+            if( state.running != (mode != TRAJECTORY_ONE_SHOT) ){
+                wrong_stop++;
+            }
+        }
+    }
+    CHECK( wrong_point == 0 );
+    CHECK( wrong_value == 0 );
+    CHECK( wrong_stop == 0 );
+    CHECK( Trajectory_Expand( points, 0, TRAJECTORY_PING_PONG, expanded ) == 0 );
+    CHECK( Trajectory_Expand( points, 4, TRAJECTORY_PING_PONG, expanded ) == 6 );
+
+    // The whole thing, through the servo bank, with a limited move on channel 0 that playing has to stop.
+    host_pwm_period = 20000;
+    ServoBank_Init();
+    MotionLimiter_SetMaxVelocity( 0, 256 );
+    MotionLimiter_SetMaxAcceleration( 0, 64 );
+    MotionLimiter_SetTarget( 0, 5000 );
+    MotionLimiter_Step(1);
+    CHECK( MotionLimiter_InMotion(0) );
+
+    CHECK( Trajectory_Play(TRAJECTORY_LOOP) == 0 );
+    for( count = 0; count < 4u; count++ ){
+        CHECK( Trajectory_Append( points[count] ) );
+    }
+    CHECK( Trajectory_Play(TRAJECTORY_PING_PONG) );
+    CHECK( !MotionLimiter_InMotion(0) );
+    for( frame = 0; frame < 20u; frame++ ){
+        // The PWM task's order: the trajectory, then the limiter, then the commit.
+        Trajectory_Step(1);
+        MotionLimiter_Step(1);
+        (void) ServoBank_Commit();
+        CHECK( Trajectory_GetPosition() == Expected_Point(frame, 4, TRAJECTORY_PING_PONG) );
+        CHECK( host_pwm_compare == points[Trajectory_GetPosition()] );
+    }
+    // No new frame, no step.
+    Trajectory_Step(0);
+    CHECK( Trajectory_GetPosition() == Expected_Point(19, 4, TRAJECTORY_PING_PONG) );
+
+    // A slow pass of the main loop sees one TC bit for two frames. The time since the last one says it was two.
+    CHECK( Trajectory_FramesSince( 0, 20000u ) == 1 );
+    CHECK( Trajectory_FramesSince( 20900u, 20000u ) == 1 );
+    CHECK( Trajectory_FramesSince( 30000u, 20000u ) == 1 );
+    CHECK( Trajectory_FramesSince( 39000u, 20000u ) == 2 );
+    CHECK( Trajectory_FramesSince( 100000u, 20000u ) == 5 );
+    CHECK( Trajectory_FramesSince( 5000u, 0 ) == 1 );
+    // 1 MHz PWM clock, 20 ms frames.
+    host_clock_pwm_divider = 23;
+    host_pwm_period = 19999;
+    TimerService_Init();
+    CHECK( Trajectory_Play(TRAJECTORY_LOOP) );
+    for( frame = 0; frame < 40u; frame++ ){
+        uint32 ms;
+        for( ms = 0; ms < 20u; ms++ ){
+            Host_SysTick();
+        }
+        // Every 7th frame, the main loop is busy and misses the one before.
+        if( frame % 7u == 6u ){
+            continue;
+        }
+        Trajectory_Step(1);
+        (void) ServoBank_Commit();
+        CHECK( Trajectory_GetPosition() == Expected_Point(frame, 4, TRAJECTORY_LOOP) );
+        CHECK( host_pwm_compare == points[Trajectory_GetPosition()] );
+    }
+
+    // A "t" after playing starts a new table.
+    CHECK( Trajectory_Append(7) );
+    CHECK( Trajectory_GetCount() == 1 );
+    CHECK( !Trajectory_IsPlaying() );
+    for( count = 1; count < TRAJECTORY_MAX_POINTS; count++ ){
+        (void) Trajectory_Append(count);
+    }
+    CHECK( !Trajectory_Append(1) );
+    CHECK( Trajectory_GetCount() == TRAJECTORY_MAX_POINTS );
+
+    return Host_Done("trajectory");
+}
+
+/* [] END OF FILE */
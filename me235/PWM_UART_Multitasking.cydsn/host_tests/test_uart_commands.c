@@ -0,0 +1,87 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// uart_commands: every letter finds its own line of the table and nothing else does, and the error
+// messages built from the table's flags list the right commands (and fit in the transmit buffer).
+#include "fake_psoc.h"
+#include "uart_helper_fcns.h"
+#include "servo_bank.h"
+#include "timer_service.h"
+#include <string.h>
+
+// Types a line into the UART ISR, runs the line task on it, and returns just what the line task printed.
+// That's the reply from the transmit buffer, and a blank line after it.
+static const char * Type(const char * line){
+    while( *line != '\0' ){
+        Host_UartReceive( (uint8) *line, Interrupt_Handler_UART_Receive );
+        line++;
+    }
+    Host_UartReceive( '\r', Interrupt_Handler_UART_Receive );
+    Host_UartClear();
+    UART_Helper_ProcessLine();
+    return host_uart_out;
+}
+
+// How many commands the table has, counted the same way uart_helper_fcns.c does.
+#define ONE(letter, word, Name, lowest, highest, flags, help) + 1u
+#define COMMANDS (0u UART_COMMANDS(ONE))
+
+// The longest a reply can be: the transmit buffer, less the '\0', and the blank line.
+#define LONGEST_REPLY (127u + 2u)
+
+int main(void){
+    uint32 c;
+    uint32 found = 0;
+    const char * reply;
+
+    // Every character: the ones in the table find their own line, and all the others find nothing.
+    for( c = 0; c < 256u; c++){
+        const UART_Command * command = UART_Helper_FindCommand( (char) c );
+        if( command != NULL ){
+            CHECK( command->letter == (char) c );
+            CHECK( command->run != NULL && command->word != NULL && command->help != NULL );
+            CHECK( command->lowest <= command->highest );
+            found++;
+        }
+    }
+    CHECK( found == COMMANDS );
+    CHECK( UART_Helper_FindCommand('p')->highest == 0xFFFFu );
+    CHECK( UART_Helper_FindCommand('g')->highest == 2 );
+    CHECK( UART_Helper_FindCommand('x')->flags & UART_COMMAND_IMMEDIATE );
+    CHECK( UART_Helper_CheckCommands() );
+
+    // The error messages list commands by their flags.
+    host_pwm_period = 19999;
+    host_pwm_compare = 1000;
+    ServoBank_Init();
+    TimerService_Init();
+    // (No number either, so that's said first.)
+    reply = strstr( Type( "?" ), "Error! Try " );
+    CHECK( reply != NULL && strncmp( reply, "Error! Try p, d, f, w, %, r, ", 29 ) == 0 );
+    CHECK( reply != NULL && strstr( reply, "L or W. \r\n\r\n" ) != NULL );
+    CHECK( reply != NULL && strlen(reply) <= LONGEST_REPLY );
+    reply = Type( "k3 : 1500, 25" );
+    CHECK( strcmp( reply, "Error! f, w, %, r, k, i and z only work on channel 0. \r\n\r\n" ) == 0 );
+    reply = Type( "f : 50 @ 100" );
+    CHECK( strncmp( reply, "Error! Only p, d, w and % can wait for a tick,", 46 ) == 0 );
+    CHECK( strlen(reply) <= LONGEST_REPLY );
+    // The range, from the table.
+    reply = Type( "g : 3" );
+    CHECK( strcmp( reply, "Error! g takes a number from 0 to 2. \r\n\r\n" ) == 0 );
+    // And one that works.
+    reply = Type( "d : 1500" );
+    CHECK( strcmp( reply, "PWM 0 now has a duty cycle (in clock ticks) of: 1500 \r\n\r\n" ) == 0 );
+
+    // A report that only just fits, with nothing to report yet.
+    reply = Type( "power : 0" );
+    CHECK( strcmp( reply, "Idle 0%, 0 wakes (worst 0 cycles). Level 0, 0 changes of 0-0 cycles. \r\n\r\n" ) == 0 );
+
+    return Host_Done("uart_commands");
+}
+
+/* [] END OF FILE */
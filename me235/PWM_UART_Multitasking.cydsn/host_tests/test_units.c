@@ -0,0 +1,102 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// units: pulse widths and percents come out within about half a tick of the exact answer,
+// for every PWM clock, all the way up to where they saturate.
+#include "fake_psoc.h"
+#include "units.h"
+#include <math.h>
+
+int main(void){
+    Units_Scale scale;
+    uint32 divider;
+    uint32 us;
+    uint32 period;
+    uint32 milli;
+    double worst_us = 0;
+    double worst_percent = 0;
+    uint32 bad_saturate = 0;
+    uint32 parsed = 0;
+
+    // Pulse widths. Every divider up to 16, then every doubling up to the biggest one.
+    for( divider = 0; divider <= 0xFFFFu; divider = (divider < 16u) ? divider + 1u : 2u * divider + 1u ){
+        Units_ComputeScale( BCLK__BUS_CLK__HZ, (uint16) divider, &scale );
+        // Steps of 1 us at first, then getting bigger, so the slow clocks get to 0xFFFF ticks too.
+        for( us = 0; ; us += 1u + us / 5000u ){
+            double exact = (double) us * scale.pwm_hz / 1e6;
+            uint16 ticks = Units_UsToTicks( &scale, us );
+            if( exact >= 65535.5 ){
+                if( ticks != 0xFFFFu ){
+                    bad_saturate++;
+                }
+                if( exact > 70000.0 ){
+                    break;
+                }
+                continue;
+            }
+            if( fabs(ticks - exact) > worst_us ){
+                worst_us = fabs(ticks - exact);
+            }
+        }
+        // Way past it doesn't overflow into something small.
+        if( Units_UsToTicks( &scale, 0xFFFFFFFFu ) != 0xFFFFu ){
+            bad_saturate++;
+        }
+    }
+    // Half a tick from rounding, plus a little from the factor (most at the slowest clock).
+    CHECK( worst_us <= 0.52 );
+    CHECK( bad_saturate == 0 );
+    printf( "worst pulse width: %.4f ticks off\n", worst_us );
+
+    // The usual servo setup: a 100 kHz PWM clock, 1500 us is 150 ticks.
+    Units_ComputeScale( BCLK__BUS_CLK__HZ, 239, &scale );
+    CHECK( Units_UsToTicks( &scale, 1500 ) == 150 );
+    CHECK( Units_UsToTicks( &scale, 1504 ) == 150 );
+    CHECK( Units_UsToTicks( &scale, 1505 ) == 151 );
+
+    // Percents, for periods all the way up.
+    for( period = 0; period <= 0xFFFFu; period += 13u ){
+        for( milli = 0; milli <= UNITS_PERCENT_SCALE; milli += 977u ){
+            double exact = (period + 1.0) * milli / UNITS_PERCENT_SCALE;
+            uint16 ticks = Units_PercentToTicks( milli, (uint16) period );
+            if( exact >= 65535.5 ){
+                CHECK( ticks == 0xFFFFu );
+            }
+            else if( fabs(ticks - exact) > worst_percent ){
+                worst_percent = fabs(ticks - exact);
+            }
+        }
+    }
+    CHECK( worst_percent <= 0.502 );
+    printf( "worst percent: %.4f ticks off\n", worst_percent );
+    CHECK( Units_PercentToTicks( 7500, 1999 ) == 150 );
+    // Over 100% is 100%.
+    CHECK( Units_PercentToTicks( 200000, 1999 ) == 2000 );
+
+    // Reading numbers.
+    CHECK( Units_ParseMilli( "7.5", &parsed ) == 3 && parsed == 7500 );
+    CHECK( Units_ParseMilli( "50", &parsed ) == 2 && parsed == 50000 );
+    CHECK( Units_ParseMilli( "0.125", &parsed ) == 5 && parsed == 125 );
+    // Past 3 decimal places is skipped, not rounded.
+    CHECK( Units_ParseMilli( "1.23456us", &parsed ) == 7 && parsed == 1234 );
+    CHECK( Units_ParseMilli( "12.", &parsed ) == 3 && parsed == 12000 );
+    CHECK( Units_ParseMilli( "us", &parsed ) == 0 );
+    CHECK( Units_ParseMilli( ".5", &parsed ) == 0 );
+    // A huge number stops early, before times 1000 overflows.
+    CHECK( Units_ParseMilli( "99999999999", &parsed ) == 6 && parsed == 999999000u );
+
+    // The live scale follows Clock_PWM's divider.
+    host_clock_pwm_divider = 239;
+    CHECK( Units_GetScale()->pwm_hz == 100000u );
+    host_clock_pwm_divider = 119;
+    CHECK( Units_GetScale()->pwm_hz == 200000u );
+
+    return Host_Done("units");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,94 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// warm_restart: a snapshot only counts if it's whole, and a warm reset puts the PWM back the way it was.
+#include "fake_psoc.h"
+#include "warm_restart.h"
+#include <string.h>
+
+static WarmRestart_Snapshot Good_Snapshot(void){
+    WarmRestart_Snapshot snap;
+    // Zero the padding after the checksum too, so copies compare equal.
+    memset( &snap, 0, sizeof(snap) );
+    snap.magic = WARM_RESTART_MAGIC;
+    snap.period = 2000;
+    snap.compare = 150;
+    snap.pwm_divider = 7;
+    snap.enabled = 1;
+    snap.session_mode = 'd';
+    snap.checksum = WarmRestart_Checksum(&snap);
+    return snap;
+}
+
+int main(void){
+    WarmRestart_Snapshot snap = Good_Snapshot();
+    uint32 i;
+    uint8 bit;
+    uint32 missed = 0;
+
+    CHECK( WarmRestart_IsValid(&snap) );
+
+    // Every single flipped bit before the checksum is caught. (There's no padding in there: the fields add up to 12 bytes.)
+    CHECK( offsetof(WarmRestart_Snapshot, checksum) == 12 );
+    for( i = 0; i < offsetof(WarmRestart_Snapshot, checksum); i++ ){
+        for( bit = 0; bit < 8; bit++ ){
+            WarmRestart_Snapshot broken = snap;
+            ((uint8 *) &broken)[i] ^= (uint8)(1u << bit);
+            if( WarmRestart_IsValid(&broken) ){
+                missed++;
+            }
+        }
+    }
+    CHECK( missed == 0 );
+
+    // A flipped checksum bit is caught too.
+    snap.checksum ^= 0x0100u;
+    CHECK( !WarmRestart_IsValid(&snap) );
+    snap = Good_Snapshot();
+
+    // The wrong magic number, a period of 0, or a compare past the period aren't trusted even with a good checksum.
+    snap.magic = 0;
+    snap.checksum = WarmRestart_Checksum(&snap);
+    CHECK( !WarmRestart_IsValid(&snap) );
+    snap = Good_Snapshot();
+    snap.period = 0;
+    snap.compare = 0;
+    snap.checksum = WarmRestart_Checksum(&snap);
+    CHECK( !WarmRestart_IsValid(&snap) );
+    snap = Good_Snapshot();
+    snap.compare = 2001;
+    snap.checksum = WarmRestart_Checksum(&snap);
+    CHECK( !WarmRestart_IsValid(&snap) );
+
+    // Save, then a software reset: the PWM comes back with the same settings, without starting from the defaults.
+    WarmRestart_Invalidate();
+    host_pwm_period = 2000;
+    host_pwm_compare = 150;
+    host_pwm_control = PWM_Servo_CTRL_ENABLE;
+    WarmRestart_Save('d');
+    host_pwm_period = 0;
+    host_pwm_compare = 0;
+    host_pwm_control = 0;
+    CyResetStatus = CY_RESET_SW;
+    CHECK( WarmRestart_Restore() == 1 );
+    CHECK( host_pwm_period == 2000 );
+    CHECK( host_pwm_compare == 150 );
+    CHECK( host_pwm_control & PWM_Servo_CTRL_ENABLE );
+    CHECK( WarmRestart_GetSessionMode() == 'd' );
+
+    // A power-on reset never restores, even with a good snapshot, and throws the snapshot away.
+    WarmRestart_Save('d');
+    CyResetStatus = 0;
+    CHECK( WarmRestart_Restore() == 0 );
+    CyResetStatus = CY_RESET_WD;
+    CHECK( WarmRestart_Restore() == 0 );
+
+    return Host_Done("warm_restart");
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,156 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See idle_manager.h for the big picture.
+#include "idle_manager.h"
+#include <project.h>
+// For handing the work flag over from the ISRs.
+#include "priority_section.h"
+// The time base for measuring idle time.
+#include "timer_service.h"
+
+// Set by ISRs when the main loop has something to do.
+static volatile uint8 work_pending = 0;
+// 1 while the CPU is between "about to WFI" and the first ISR after it.
+static volatile uint8 sleeping = 0;
+
+static IdleManager_Stats stats;
+
+IdleManager_Mode IdleManager_ChooseMode(const IdleManager_Inputs * inputs){
+    if( inputs->work_pending ){
+        return IDLE_MODE_NONE;
+    }
+    // Sleep stops the master clock, so only if nothing needs it, and only if it's worth it.
+    if( !inputs->pwm_running && !inputs->uart_must_not_drop && inputs->sleep_wake_available
+        && inputs->next_deadline_us >= IDLE_MANAGER_SLEEP_BREAK_EVEN_US ){
+        return IDLE_MODE_SLEEP;
+    }
+    return IDLE_MODE_ALT_ACTIVE;
+}
+
+void IdleManager_Account(IdleManager_Stats * s, uint32 idle_us, uint32 awake_us){
+    // Halve both totals instead of overflowing. The percentage stays the same,
+    // and newer intervals end up counting a bit more than old ones.
+    while( s->total_us > (0xFFFFFFFFu - idle_us - awake_us) ){
+        s->total_us /= 2u;
+        s->idle_us /= 2u;
+    }
+    s->idle_us += idle_us;
+    s->total_us += idle_us + awake_us;
+}
+
+void IdleManager_AccountWake(IdleManager_Stats * s, uint32 latency_cycles){
+    s->wakeups++;
+    if( latency_cycles == IDLE_MANAGER_LATENCY_UNKNOWN ){
+        return;
+    }
+    s->last_wake_cycles = latency_cycles;
+    if( latency_cycles > s->max_wake_cycles ){
+        s->max_wake_cycles = latency_cycles;
+    }
+    s->timed_wakeups++;
+}
+
+uint32 IdleManager_TickLatency(uint32 reload, uint32 count){
+    // The SysTick counts down from reload, and went pending as it reloaded.
+    return (count <= reload) ? reload - count : IDLE_MANAGER_LATENCY_UNKNOWN;
+}
+
+uint8 IdleManager_IdlePercent(const IdleManager_Stats * s){
+    if( s->total_us == 0 ){
+        return 0;
+    }
+    // Divide the total first so the multiply can't overflow.
+    return (uint8)(s->idle_us / ((s->total_us / 100u) ? (s->total_us / 100u) : 1u));
+}
+
+void IdleManager_Init(void){
+    IdleManager_Stats empty = { 0 };
+    stats = empty;
+    sleeping = 0;
+}
+
+void IdleManager_NotifyWake(void){
+    IdleManager_NotifyTickWake(IDLE_MANAGER_LATENCY_UNKNOWN);
+}
+
+void IdleManager_NotifyTickWake(uint32 latency_cycles){
+    // Only the first ISR after the WFI is a wakeup. The SysTick is more urgent than the UART,
+    // so when both are pending it's the one that gets timed.
+    if( sleeping ){
+        sleeping = 0;
+        IdleManager_AccountWake(&stats, latency_cycles);
+    }
+}
+
+void IdleManager_NotifyWork(void){
+    work_pending = 1;
+}
+
+uint8 IdleManager_TakeWork(void){
+    uint8 had_work;
+    uint8 interrupt_state = PrioritySection_Enter();
+    had_work = work_pending;
+    work_pending = 0;
+    PrioritySection_Exit(interrupt_state);
+    return had_work;
+}
+
+void IdleManager_Idle(uint8 pwm_running){
+    static uint32 last_wake_us = 0;
+    IdleManager_Inputs inputs;
+    IdleManager_Mode mode;
+    uint32 sleep_start_us;
+    uint32 sleep_end_us;
+
+    // Interrupts off between checking for work and the WFI. Otherwise an ISR could sneak in
+    // right after the check, and we'd sleep with its work not done. WFI still wakes up on a
+    // pending interrupt with interrupts masked, and the ISR runs as soon as we unmask them.
+    CyGlobalIntDisable;
+    inputs.work_pending = work_pending;
+    inputs.pwm_running = pwm_running;
+    inputs.uart_must_not_drop = 1;
+    inputs.sleep_wake_available = (IDLE_MANAGER_SLEEP_WAKE_SOURCE != PM_SLEEP_SRC_NONE) ? 1 : 0;
+    inputs.next_deadline_us = 0xFFFFFFFFu;
+    mode = IdleManager_ChooseMode(&inputs);
+    if( mode == IDLE_MODE_NONE ){
+        CyGlobalIntEnable;
+        return;
+    }
+
+    sleep_start_us = TimerService_NowUs();
+    sleeping = 1;
+    if( mode == IDLE_MODE_SLEEP ){
+        // Save everything that Sleep turns off, then put it back afterward.
+        UART_for_USB_Sleep();
+        PWM_Servo_Sleep();
+        CyPmSaveClocks();
+        CyPmSleep( PM_SLEEP_TIME_NONE, IDLE_MANAGER_SLEEP_WAKE_SOURCE );
+        CyPmRestoreClocks();
+        PWM_Servo_Wakeup();
+        UART_for_USB_Wakeup();
+    }
+    else {
+        CyPmAltAct( PM_ALT_ACT_TIME_NONE, PM_ALT_ACT_SRC_NONE );
+    }
+    sleep_end_us = TimerService_NowUs();
+    // Whatever woke us runs its ISR right here.
+    CyGlobalIntEnable;
+    // If it wasn't an ISR that calls IdleManager_NotifyWake, don't let the next one
+    // count as a wakeup.
+    sleeping = 0;
+
+    IdleManager_Account(&stats, sleep_end_us - sleep_start_us, sleep_start_us - last_wake_us);
+    last_wake_us = sleep_end_us;
+}
+
+const IdleManager_Stats * IdleManager_GetStats(void){
+    return &stats;
+}
+
+/* [] END OF FILE */
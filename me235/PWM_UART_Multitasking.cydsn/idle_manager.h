@@ -0,0 +1,132 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * idle_manager.h
+ * Puts the CPU to sleep in the main loop when there's nothing to do,
+ * instead of spinning around an empty for(;;) loop.
+ *
+ * Which sleep? The PSoC 5LP has a few power modes (see cyPm.h):
+ * - Alternate Active: the CPU stops (WFI instruction), but every clock and
+ *   peripheral keeps running. The .cydwr sets it up as a copy of Active mode.
+ *   Any interrupt wakes the CPU, and the UART keeps receiving, so no bytes are lost.
+ * - Sleep: the master clock stops too. That stops the PWM, and the UART can't
+ *   receive the byte that wakes it up.
+ * So with the PWM running, or with the UART needing every byte, Alternate Active is the deepest we can go.
+ * IdleManager_ChooseMode decides, and it doesn't touch any hardware, so the policy
+ * can be checked on a regular computer with a made-up list of events.
+ *
+ * It also keeps track of how much of the time the CPU was asleep, and how long
+ * it took from waking up to the ISR running.
+ *
+ * Wakeup latency: from the moment an interrupt goes pending to its ISR starting.
+ * The cycle counter is no good for this, since it stops while the CPU sleeps.
+ * The SysTick keeps counting, though, and it went pending the moment it reloaded.
+ * So the first thing its callback does is read the SysTick count: (reload - count)
+ * cycles ago is when it went pending (see IdleManager_TickLatency). That's the one
+ * wakeup we can time exactly. The UART can't tell when its byte arrived, so its wakeups
+ * are counted but not timed. Both come through the same WFI and the same masked
+ * window after it, so the SysTick's number stands for both.
+ */
+
+#ifndef IDLE_MANAGER_H
+#define IDLE_MANAGER_H
+
+#include <project.h>
+
+// Sleep mode (with its clock save/restore) only pays off if we'll be asleep at least this long.
+#define IDLE_MANAGER_SLEEP_BREAK_EVEN_US 2000u
+// Sleep mode needs a wakeup source (PM_SLEEP_SRC_PICU on the UART Rx pin, for example)
+// wired up in the schematic. This project doesn't have one, so Sleep is never used by default.
+#ifndef IDLE_MANAGER_SLEEP_WAKE_SOURCE
+    #define IDLE_MANAGER_SLEEP_WAKE_SOURCE PM_SLEEP_SRC_NONE
+#endif
+
+typedef enum
+{
+    // Don't sleep: there's work to do.
+    IDLE_MODE_NONE = 0,
+    // Alternate Active: CPU off, everything else on.
+    IDLE_MODE_ALT_ACTIVE,
+    // Sleep: master clock off too.
+    IDLE_MODE_SLEEP
+} IdleManager_Mode;
+
+// Everything the policy needs to know to pick a mode.
+typedef struct
+{
+    uint8 work_pending;
+    uint8 pwm_running;
+    // 1 if the UART must not lose the byte that wakes us up
+    uint8 uart_must_not_drop;
+    // 1 if there's a wakeup source for Sleep mode (IDLE_MANAGER_SLEEP_WAKE_SOURCE)
+    uint8 sleep_wake_available;
+    // how long until something is scheduled to happen, in microseconds. 0xFFFFFFFF for "nothing scheduled".
+    uint32 next_deadline_us;
+} IdleManager_Inputs;
+
+typedef struct
+{
+    // total time asleep and total time measured, in microseconds
+    uint32 idle_us;
+    uint32 total_us;
+    // longest and latest time from the SysTick going pending during sleep to its ISR, in CPU cycles
+    uint32 max_wake_cycles;
+    uint32 last_wake_cycles;
+    // how many wakeups there were, and how many of those were timed
+    uint32 wakeups;
+    uint32 timed_wakeups;
+} IdleManager_Stats;
+
+// For a wakeup whose ISR can't tell how long it was pending.
+#define IDLE_MANAGER_LATENCY_UNKNOWN 0xFFFFFFFFu
+
+// The policy: picks the deepest mode that's allowed.
+IdleManager_Mode IdleManager_ChooseMode(const IdleManager_Inputs * inputs);
+
+// Adds one sleep/awake interval to the stats. Also pure, so it can be checked off-chip.
+void IdleManager_Account(IdleManager_Stats * stats, uint32 idle_us, uint32 awake_us);
+
+// Adds one wakeup to the stats. latency_cycles is how long the interrupt was pending
+// before its ISR started, or IDLE_MANAGER_LATENCY_UNKNOWN. Also pure.
+void IdleManager_AccountWake(IdleManager_Stats * stats, uint32 latency_cycles);
+
+// How long the SysTick has been pending, from its reload value and its count read in the ISR.
+// The count only goes above reload right after the reload was changed, and then we can't tell.
+uint32 IdleManager_TickLatency(uint32 reload, uint32 count);
+
+// Idle percentage (0 to 100) from the stats.
+uint8 IdleManager_IdlePercent(const IdleManager_Stats * stats);
+
+// Clears the stats. Idle time is measured with TimerService_NowUs, so call TimerService_Init too.
+void IdleManager_Init(void);
+
+// Call at the start of every ISR that can wake the CPU, but can't tell how long it was pending.
+// Counts the wakeup.
+void IdleManager_NotifyWake(void);
+
+// The SysTick's IdleManager_NotifyWake: call first thing in its callback, with IdleManager_TickLatency.
+// Counts the wakeup, and times it.
+void IdleManager_NotifyTickWake(uint32 latency_cycles);
+
+// Call from the ISRs (or anywhere) when there's work for the main loop.
+void IdleManager_NotifyWork(void);
+
+// Call from the main loop when the work it was told about is done.
+// Returns 1 if there was work pending (and clears it), 0 otherwise.
+uint8 IdleManager_TakeWork(void);
+
+// Call at the end of each pass of the main loop. Sleeps if the policy allows it.
+// pwm_running tells the policy whether the PWM must keep going.
+void IdleManager_Idle(uint8 pwm_running);
+
+const IdleManager_Stats * IdleManager_GetStats(void);
+
+#endif //IDLE_MANAGER_H
+
+/* [] END OF FILE */
@@ -0,0 +1,123 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See interrupt_plan.h for the rules.
+#include "interrupt_plan.h"
+#include <project.h>
+// The ceiling the plan is checked against.
+#include "priority_section.h"
+
+InterruptPlan_Result InterruptPlan_Check(const InterruptPlan_Entry * plan, uint8 count, uint8 ceiling, uint8 * where){
+    uint8 i;
+    uint8 j;
+    uint32 written = 0;
+    *where = 0;
+    if( ceiling == 0 || ceiling >= (1u << __NVIC_PRIO_BITS) ){
+        return INTERRUPT_PLAN_BAD_CEILING;
+    }
+    for( i = 0; i < count; i++){
+        *where = i;
+        if( plan[i].priority >= (1u << __NVIC_PRIO_BITS) ){
+            return INTERRUPT_PLAN_BAD_PRIORITY;
+        }
+        if( (plan[i].resources & INTERRUPT_PLAN_SECTION_RESOURCES) != 0 && plan[i].priority < ceiling ){
+            return INTERRUPT_PLAN_ABOVE_CEILING;
+        }
+        if( (plan[i].resources & INTERRUPT_PLAN_SINGLE_WRITER_RESOURCES & written) != 0 ){
+            return INTERRUPT_PLAN_SECOND_WRITER;
+        }
+        written |= plan[i].resources & INTERRUPT_PLAN_SINGLE_WRITER_RESOURCES;
+        if( plan[i].plan_class != INTERRUPT_PLAN_SERIAL ){
+            continue;
+        }
+        // The same number can't preempt either, so a tie is a problem too.
+        for( j = 0; j < count; j++){
+            if( plan[j].plan_class == INTERRUPT_PLAN_MOTION && plan[i].priority <= plan[j].priority ){
+                return INTERRUPT_PLAN_SERIAL_BEFORE_MOTION;
+            }
+        }
+    }
+    return INTERRUPT_PLAN_OK;
+}
+
+const char * InterruptPlan_Describe(InterruptPlan_Result result){
+    switch( result ){
+        case INTERRUPT_PLAN_OK:
+            return "ok";
+        case INTERRUPT_PLAN_BAD_PRIORITY:
+            return "priority is more than 7";
+        case INTERRUPT_PLAN_BAD_CEILING:
+            return "priority section ceiling isn't 1 to 7";
+        case INTERRUPT_PLAN_ABOVE_CEILING:
+            return "shares data with a priority section, but is above its ceiling";
+        case INTERRUPT_PLAN_SERIAL_BEFORE_MOTION:
+            return "serial ISR can't be preempted by a motion ISR";
+        case INTERRUPT_PLAN_SECOND_WRITER:
+            return "second writer to a single-producer queue";
+        case INTERRUPT_PLAN_NOT_APPLIED:
+            return "priority didn't stick";
+        default:
+            return "unknown";
+    }
+}
+
+// The SysTick isn't a component, so it gets its functions here.
+static void InterruptPlan_SetSysTickPriority(uint8 priority){
+    NVIC_SetPriority(SysTick_IRQn, priority);
+}
+
+static uint8 InterruptPlan_GetSysTickPriority(void){
+    return (uint8) NVIC_GetPriority(SysTick_IRQn);
+}
+
+/**
+ * The plan. Smaller numbers are more urgent.
+ * The UART receive ISR collects lines for the UART line task (app_tasks.h), through a single-producer queue. Only x and e act right away,
+ * and save the warm restart snapshot, and a preset recall byte leaves a request for the PWM task.
+ * The SysTick counts the timer service's tick, signals the tasks, runs scheduled commands (servo bank and motion limiter),
+ * and runs the PID loop (its gains and status, and the servo bank).
+ * A PWM terminal count or DMA done ISR would be above the ceiling, so it must only talk to the main loop through a queue.
+ */
+static const InterruptPlan_Entry plan[] = {
+    { "PWM terminal count", 2u, INTERRUPT_PLAN_MOTION, 0, NULL, NULL },
+    { "DMA done", 3u, INTERRUPT_PLAN_OTHER, 0, NULL, NULL },
+    { "SysTick", PRIORITY_SECTION_CEILING, INTERRUPT_PLAN_MOTION,
+        INTERRUPT_PLAN_COMMAND_SCHEDULE | INTERRUPT_PLAN_SERVO_BANK | INTERRUPT_PLAN_MOTION_LIMITER | INTERRUPT_PLAN_PID_LOOP,
+        InterruptPlan_SetSysTickPriority, InterruptPlan_GetSysTickPriority },
+    { "UART receive", 7u, INTERRUPT_PLAN_SERIAL, INTERRUPT_PLAN_WARM_RESTART | INTERRUPT_PLAN_PRESETS | INTERRUPT_PLAN_UART_LINES,
+        Interrupt_UART_Receive_SetPriority, Interrupt_UART_Receive_GetPriority },
+    { "UART transmit", 7u, INTERRUPT_PLAN_SERIAL, 0, NULL, NULL }
+};
+
+const InterruptPlan_Entry * InterruptPlan_Get(uint8 * count){
+    *count = (uint8)(sizeof(plan) / sizeof(plan[0]));
+    return plan;
+}
+
+InterruptPlan_Result InterruptPlan_Apply(uint8 * where){
+    uint8 count;
+    uint8 i;
+    const InterruptPlan_Entry * entries = InterruptPlan_Get(&count);
+    InterruptPlan_Result result = InterruptPlan_Check(entries, count, PRIORITY_SECTION_CEILING, where);
+    if( result != INTERRUPT_PLAN_OK ){
+        return result;
+    }
+    for( i = 0; i < count; i++){
+        if( entries[i].set_priority == NULL ){
+            continue;
+        }
+        entries[i].set_priority(entries[i].priority);
+        if( entries[i].get_priority != NULL && entries[i].get_priority() != entries[i].priority ){
+            *where = i;
+            return INTERRUPT_PLAN_NOT_APPLIED;
+        }
+    }
+    return INTERRUPT_PLAN_OK;
+}
+
+/* [] END OF FILE */
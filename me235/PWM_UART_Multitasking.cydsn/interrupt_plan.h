@@ -0,0 +1,107 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * interrupt_plan.h
+ * Every interrupt's priority, in one table (interrupt_plan.c), instead of whatever the fitter picked.
+ *
+ * On the Cortex-M3, a more urgent interrupt (smaller number, 0 to 7) can interrupt a less urgent one
+ * that's already running ("nested preemption"). The reset value of the priority grouping puts all 3 bits
+ * into the preemption group, so every different number can preempt. The plan is:
+ *   - motion (the SysTick, which runs scheduled commands, and anything that commits a PWM frame)
+ *     is more urgent than
+ *   - serial (parsing the UART's lines, which can take a while for a long command).
+ * Each entry also says which shared data its ISR touches, so the plan can be checked for mistakes:
+ *   1) Every priority is 0 to 7, and the priority section ceiling (priority_section.h) is 1 to 7.
+ *   2) An ISR that touches data guarded by a priority section has to be at the ceiling or below,
+ *      or the section can't hold it off (that's a race, and a priority inversion: the main loop's
+ *      section would protect nothing from it).
+ *   3) Every motion ISR is more urgent than every serial ISR.
+ *   4) Data that's written through a single-producer queue (lockfree_queue.h) has only one ISR writing it.
+ * InterruptPlan_Check does that, without touching the hardware, so it can be checked on a regular computer.
+ *
+ * InterruptPlan_Apply sets each priority with the component's own _SetPriority, then reads it back.
+ * Call it after the _StartEx calls, since those put the fitter's priority back.
+ *
+ * Some entries don't have an interrupt in the schematic yet (the UART's TX, a PWM terminal count, a DMA done).
+ * Their priorities are planned and checked anyway, so whoever adds one just fills in its functions.
+ */
+
+#ifndef INTERRUPT_PLAN_H
+#define INTERRUPT_PLAN_H
+
+#include <project.h>
+
+// Shared data an ISR can touch. One bit each.
+#define INTERRUPT_PLAN_SERVO_BANK       (1u << 0)
+#define INTERRUPT_PLAN_MOTION_LIMITER   (1u << 1)
+#define INTERRUPT_PLAN_COMMAND_SCHEDULE (1u << 2)
+#define INTERRUPT_PLAN_WARM_RESTART     (1u << 3)
+#define INTERRUPT_PLAN_PWM_FREQUENCY    (1u << 4)
+#define INTERRUPT_PLAN_KEYFRAMES        (1u << 5)
+#define INTERRUPT_PLAN_PRESETS          (1u << 6)
+#define INTERRUPT_PLAN_PID_LOOP         (1u << 7)
+#define INTERRUPT_PLAN_UART_LINES       (1u << 8)
+// The ones guarded by priority sections (PrioritySection_Enter).
+#define INTERRUPT_PLAN_SECTION_RESOURCES (INTERRUPT_PLAN_SERVO_BANK | INTERRUPT_PLAN_MOTION_LIMITER | \
+    INTERRUPT_PLAN_COMMAND_SCHEDULE | INTERRUPT_PLAN_WARM_RESTART | INTERRUPT_PLAN_PWM_FREQUENCY | INTERRUPT_PLAN_PRESETS | \
+    INTERRUPT_PLAN_PID_LOOP)
+// The ones written through a single-producer queue.
+#define INTERRUPT_PLAN_SINGLE_WRITER_RESOURCES (INTERRUPT_PLAN_KEYFRAMES | INTERRUPT_PLAN_UART_LINES)
+
+typedef enum
+{
+    INTERRUPT_PLAN_MOTION = 0,
+    INTERRUPT_PLAN_SERIAL,
+    // Neither: no ordering rule.
+    INTERRUPT_PLAN_OTHER
+} InterruptPlan_Class;
+
+typedef struct
+{
+    const char * name;
+    uint8 priority;
+    uint8 plan_class;
+    // INTERRUPT_PLAN_ bits for the data this ISR touches.
+    uint32 resources;
+    // The component's _SetPriority and _GetPriority. NULL if it's not in the schematic.
+    void (*set_priority)(uint8 priority);
+    uint8 (*get_priority)(void);
+} InterruptPlan_Entry;
+
+typedef enum
+{
+    INTERRUPT_PLAN_OK = 0,
+    // Rule 1.
+    INTERRUPT_PLAN_BAD_PRIORITY,
+    INTERRUPT_PLAN_BAD_CEILING,
+    // Rule 2.
+    INTERRUPT_PLAN_ABOVE_CEILING,
+    // Rule 3: the entry is a serial ISR at least as urgent as some motion ISR.
+    INTERRUPT_PLAN_SERIAL_BEFORE_MOTION,
+    // Rule 4: the entry is a second writer.
+    INTERRUPT_PLAN_SECOND_WRITER,
+    // From InterruptPlan_Apply: the priority didn't stick.
+    INTERRUPT_PLAN_NOT_APPLIED
+} InterruptPlan_Result;
+
+// Checks a plan against rules 1 to 4. If there's a problem, *where is the entry it's about.
+InterruptPlan_Result InterruptPlan_Check(const InterruptPlan_Entry * plan, uint8 count, uint8 ceiling, uint8 * where);
+
+// This project's plan.
+const InterruptPlan_Entry * InterruptPlan_Get(uint8 * count);
+
+// Checks this project's plan, then sets and reads back every priority. Stops at the first problem.
+InterruptPlan_Result InterruptPlan_Apply(uint8 * where);
+
+// A few words about a result, for the startup report.
+const char * InterruptPlan_Describe(InterruptPlan_Result result);
+
+#endif //INTERRUPT_PLAN_H
+
+/* [] END OF FILE */
@@ -0,0 +1,188 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See keyframes.h for how this works.
+#include "keyframes.h"
+#include <project.h>
+// Writes go through the servo bank, like the trajectory's software path.
+#include "servo_bank.h"
+// Keyframes and a trajectory would both be writing channel 0, so starting one stops the other.
+#include "trajectory.h"
+// And a limited move on channel 0 would write over the curve, later in the same PWM task.
+#include "motion_limiter.h"
+// The ring the UART line task passes keyframes through.
+#include "lockfree_queue.h"
+
+#if (KEYFRAMES_RING_SIZE & (KEYFRAMES_RING_SIZE - 1u)) != 0
+    #error "KEYFRAMES_RING_SIZE has to be a power of two"
+#endif
+
+// The ring. The UART line task pushes, the PWM task pops, so no interrupts need turning off.
+// Each keyframe is packed into one item: the compare in the low 16 bits, the periods in the high 16.
+static uint32 ring_items[KEYFRAMES_RING_SIZE];
+static LockFreeQueue_Spsc ring = { 0, 0, KEYFRAMES_RING_SIZE - 1u, ring_items };
+// Keyframes_Clear runs on the pushing side, which isn't allowed to pop, so it asks Keyframes_Step to.
+// It also notes where the ring's head was, so only keyframes from before the clear get dropped,
+// and any that come in after it (before Keyframes_Step gets around to it) still play.
+static volatile uint8 clear_requested = 0;
+static volatile uint32 clear_head = 0;
+
+static Keyframes_Segment segment;
+static volatile uint8 playing = 0;
+static volatile uint8 interpolation = KEYFRAMES_LINEAR;
+// Where the current segment ends (Q8), which is where the next one starts.
+static int32 position_q8 = 0;
+// The slope the next segment has to start with, to match the end of this one.
+static int32 start_tangent_q8 = 0;
+
+void Keyframes_BeginSegment(Keyframes_Segment * s, int32 start_q8, int32 end_q8, uint16 periods,
+    int32 start_tangent_q8, int32 end_tangent_q8, uint8 linear){
+    if( linear ){
+        s->a = 0;
+        s->b = 0;
+        s->c = end_q8 - start_q8;
+    }
+    else {
+        // The cubic Hermite polynomial, multiplied out so it can be evaluated with Horner's rule.
+        s->a = 2 * start_q8 - 2 * end_q8 + start_tangent_q8 + end_tangent_q8;
+        s->b = -3 * start_q8 + 3 * end_q8 - 2 * start_tangent_q8 - end_tangent_q8;
+        s->c = start_tangent_q8;
+    }
+    s->d = start_q8;
+    s->periods = (periods == 0) ? 1u : periods;
+    s->elapsed = 0;
+}
+
+int32 Keyframes_Evaluate(const Keyframes_Segment * s, uint16 elapsed){
+    int32 u;
+    int32 value;
+    if( elapsed >= s->periods ){
+        // Right on the keyframe, with no rounding.
+        return s->a + s->b + s->c + s->d;
+    }
+    // How far along, 0 to 65536, rounded.
+    u = (int32)((((uint32) elapsed << KEYFRAMES_U_BITS) + (s->periods >> 1)) / s->periods);
+    // Horner's rule: ((a u + b) u + c) u + d. Each multiply is 32 x 32 -> 64 bits, one instruction on the M3.
+    value = (int32)(((int64) s->a * u) >> KEYFRAMES_U_BITS) + s->b;
+    value = (int32)(((int64) value * u) >> KEYFRAMES_U_BITS) + s->c;
+    value = (int32)(((int64) value * u) >> KEYFRAMES_U_BITS) + s->d;
+    return value;
+}
+
+/**
+ * Takes the next keyframe out of the ring and starts the segment to it. Returns 0 if there isn't one.
+ */
+static uint8 Keyframes_Next(void){
+    uint32 packed;
+    Keyframes_Point target;
+    Keyframes_Point after;
+    uint8 has_after;
+    int32 end_q8;
+    int32 end_tangent_q8 = 0;
+    int32 following_q8 = 0;
+    if( !LockFreeQueue_SpscPop(&ring, &packed) ){
+        return 0;
+    }
+    target.compare = (uint16) packed;
+    target.periods = (uint16)(packed >> 16);
+    // The one after, if it's here already, for the slope at the end.
+    has_after = LockFreeQueue_SpscPeek(&ring, 0, &packed);
+    after.compare = (uint16) packed;
+    after.periods = (uint16)(packed >> 16);
+
+    end_q8 = (int32) target.compare << KEYFRAMES_FRAC_BITS;
+    if( interpolation == KEYFRAMES_CUBIC && has_after ){
+        // Catmull-Rom: the slope at this keyframe points from the one before to the one after.
+        // Times each segment's length, since u runs 0 to 1 over a whole segment.
+        // These stay under 16 bits of ticks, so the Q8 results fit easily.
+        int32 difference = ((int32) after.compare << KEYFRAMES_FRAC_BITS) - position_q8;
+        int32 span = (int32) target.periods + (int32) after.periods;
+        end_tangent_q8 = (int32)(((int64) difference * target.periods) / span);
+        following_q8 = (int32)(((int64) difference * after.periods) / span);
+    }
+    Keyframes_BeginSegment(&segment, position_q8, end_q8, target.periods,
+        start_tangent_q8, end_tangent_q8, interpolation == KEYFRAMES_LINEAR);
+    start_tangent_q8 = following_q8;
+    position_q8 = end_q8;
+    return 1;
+}
+
+uint8 Keyframes_Append(uint16 compare, uint16 periods){
+    if( periods == 0 ){
+        return 0;
+    }
+    return LockFreeQueue_SpscPush(&ring, (uint32) compare | ((uint32) periods << 16));
+}
+
+void Keyframes_SetMode(Keyframes_Mode mode){
+    interpolation = (uint8) mode;
+}
+
+void Keyframes_Clear(void){
+    clear_head = ring.head;
+    // The head has to be there before Keyframes_Step sees the request.
+    __DMB();
+    clear_requested = 1;
+}
+
+uint8 Keyframes_GetQueued(void){
+    return (uint8) LockFreeQueue_SpscCount(&ring);
+}
+
+uint8 Keyframes_IsPlaying(void){
+    return playing;
+}
+
+void Keyframes_Step(uint8 new_frame){
+    int32 value;
+    uint32 dropped;
+    if( !new_frame ){
+        return;
+    }
+    if( clear_requested ){
+        uint32 drop_until;
+        // Take the request first, then read the head. If another clear comes in between, we see
+        // its (later) head now, and its request again next frame, which then has nothing left to drop.
+        clear_requested = 0;
+        __DMB();
+        drop_until = clear_head;
+        // Stop where we are, and drop the keyframes that were waiting when the clear came in.
+        // The indexes keep counting up, so "before" is a signed difference, and it still works when they wrap.
+        while( (int32)(drop_until - ring.tail) > 0 && LockFreeQueue_SpscPop(&ring, &dropped) ){
+        }
+        playing = 0;
+        return;
+    }
+    if( !playing ){
+        if( LockFreeQueue_SpscCount(&ring) == 0 ){
+            return;
+        }
+        // Start from wherever the servo is now, standing still.
+        position_q8 = (int32) ServoBank_GetCompare(0) << KEYFRAMES_FRAC_BITS;
+        start_tangent_q8 = 0;
+        Trajectory_Stop();
+        MotionLimiter_Stop(0);
+        playing = Keyframes_Next();
+    }
+    segment.elapsed++;
+    value = Keyframes_Evaluate(&segment, segment.elapsed);
+    if( segment.elapsed >= segment.periods ){
+        // On the keyframe: on to the next one, or stay here if there isn't one yet.
+        playing = Keyframes_Next();
+    }
+    // The curve can swing a little past the keyframes. The servo bank clamps the top end.
+    if( value < 0 ){
+        value = 0;
+    }
+    else if( value > ((int32) 0xFFFF << KEYFRAMES_FRAC_BITS) ){
+        value = (int32) 0xFFFF << KEYFRAMES_FRAC_BITS;
+    }
+    (void) ServoBank_SetCompare(0, (uint16)((value + (1 << (KEYFRAMES_FRAC_BITS - 1u))) >> KEYFRAMES_FRAC_BITS));
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * keyframes.h
+ * Smooth motion on PWM_Servo from just a few points.
+ *
+ * A trajectory (trajectory.h) needs one value for every PWM period: 50 of them for one second at 50 Hz.
+ * A keyframe is just "be at this compare value, this many periods after the last keyframe".
+ * Every period, the PSoC works out the in-between value itself, either on a straight line (linear),
+ * or on a smooth curve (cubic Hermite) that also keeps the speed continuous through each keyframe,
+ * so the servo doesn't jerk at the corners. The curve's slope at each keyframe is "Catmull-Rom":
+ * it points from the keyframe before to the keyframe after.
+ *
+ * Keyframes go into a small ring buffer (a lock-free queue, see lockfree_queue.h), so the PC can keep adding
+ * more while the motion plays.
+ * For the curve, the slope at the end of a segment needs the keyframe after it, so send keyframes
+ * at least one ahead. If it's not there in time, the servo slows down to a stop at the end of the segment.
+ *
+ * The math is fixed point. At the start of each segment, Keyframes_BeginSegment works out the curve's
+ * four coefficients (one division). After that, every period is the same amount of work,
+ * linear or cubic: one division to get how far along the segment we are, and three multiply-adds.
+ * Positions and slopes are Q8 (times 256), and "how far along" is Q16 (0 to 65536).
+ *
+ * Keyframes_BeginSegment and Keyframes_Evaluate are just arithmetic, so they can be checked on a regular computer.
+ */
+
+#ifndef KEYFRAMES_H
+#define KEYFRAMES_H
+
+#include <project.h>
+
+// How many keyframes can be waiting. Must be a power of two.
+#define KEYFRAMES_RING_SIZE 16u
+#define KEYFRAMES_FRAC_BITS 8u
+#define KEYFRAMES_U_BITS 16u
+
+typedef enum
+{
+    KEYFRAMES_LINEAR = 0,
+    KEYFRAMES_CUBIC = 1
+} Keyframes_Mode;
+
+// One keyframe: where to be, and how many PWM periods after the previous one.
+typedef struct
+{
+    uint16 compare;
+    uint16 periods;
+} Keyframes_Point;
+
+// The segment being played: p(u) = ((a u + b) u + c) u + d, with u going from 0 to 1 over 'periods'.
+typedef struct
+{
+    int32 a;
+    int32 b;
+    int32 c;
+    int32 d;
+    uint16 periods;
+    uint16 elapsed;
+} Keyframes_Segment;
+
+// Sets up a segment from start to end (Q8), over 'periods', leaving start with slope start_tangent
+// and arriving at end with slope end_tangent. The tangents are Q8 ticks per segment (slope times periods).
+// For linear, pass 0 for both and linear = 1.
+void Keyframes_BeginSegment(Keyframes_Segment * segment, int32 start_q8, int32 end_q8, uint16 periods,
+    int32 start_tangent_q8, int32 end_tangent_q8, uint8 linear);
+
+// The position (Q8) 'elapsed' periods into the segment. elapsed = periods gives the end exactly.
+int32 Keyframes_Evaluate(const Keyframes_Segment * segment, uint16 elapsed);
+
+// Adds a keyframe. periods has to be at least 1. Returns 0 if the ring is full (or periods is 0).
+uint8 Keyframes_Append(uint16 compare, uint16 periods);
+
+// Linear or cubic, from the next segment on.
+void Keyframes_SetMode(Keyframes_Mode mode);
+
+// Stops at the next frame, and throws away the keyframes that were waiting when this was called.
+// Any appended after it still play. The servo stays where it is.
+void Keyframes_Clear(void);
+
+// How many keyframes are waiting (not counting the one being played to).
+uint8 Keyframes_GetQueued(void);
+
+// 1 while moving toward a keyframe.
+uint8 Keyframes_IsPlaying(void);
+
+// Call from the main loop with ServoBank_PollFrame's result.
+void Keyframes_Step(uint8 new_frame);
+
+#endif //KEYFRAMES_H
+
+/* [] END OF FILE */
@@ -0,0 +1,115 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See lockfree_queue.h for how this works.
+#include "lockfree_queue.h"
+#include <project.h>
+
+uint8 LockFreeQueue_SpscInit(LockFreeQueue_Spsc * q, uint32 * storage, uint32 size){
+    if( size == 0 || (size & (size - 1u)) != 0 ){
+        return 0;
+    }
+    q->head = 0;
+    q->tail = 0;
+    q->mask = size - 1u;
+    q->items = storage;
+    return 1;
+}
+
+uint8 LockFreeQueue_SpscPush(LockFreeQueue_Spsc * q, uint32 item){
+    uint32 head = q->head;
+    if( head - q->tail > q->mask ){
+        return 0;
+    }
+    q->items[head & q->mask] = item;
+    // The item has to be in the slot before the consumer can see the new head.
+    __DMB();
+    q->head = head + 1u;
+    return 1;
+}
+
+uint8 LockFreeQueue_SpscPop(LockFreeQueue_Spsc * q, uint32 * item){
+    uint32 tail = q->tail;
+    if( tail == q->head ){
+        return 0;
+    }
+    // Don't read the slot before we've seen head move past it.
+    __DMB();
+    *item = q->items[tail & q->mask];
+    // And don't give the slot back before we're done reading it.
+    __DMB();
+    q->tail = tail + 1u;
+    return 1;
+}
+
+uint8 LockFreeQueue_SpscPeek(LockFreeQueue_Spsc * q, uint32 index, uint32 * item){
+    uint32 tail = q->tail;
+    if( q->head - tail <= index ){
+        return 0;
+    }
+    __DMB();
+    *item = q->items[(tail + index) & q->mask];
+    return 1;
+}
+
+uint32 LockFreeQueue_SpscCount(const LockFreeQueue_Spsc * q){
+    return q->head - q->tail;
+}
+
+uint8 LockFreeQueue_MpscInit(LockFreeQueue_Mpsc * q, LockFreeQueue_Slot * storage, uint32 size){
+    uint32 i;
+    if( size == 0 || (size & (size - 1u)) != 0 ){
+        return 0;
+    }
+    // Slot i starts out empty, waiting for position i.
+    for( i = 0; i < size; i++){
+        storage[i].sequence = i;
+    }
+    q->reserve = 0;
+    q->tail = 0;
+    q->mask = size - 1u;
+    q->slots = storage;
+    return 1;
+}
+
+uint8 LockFreeQueue_MpscPush(LockFreeQueue_Mpsc * q, uint32 item){
+    uint32 position;
+    LockFreeQueue_Slot * slot;
+    // Claim a position. If anything (an interrupt, another producer) gets in between the
+    // LDREX and the STREX, the STREX fails and we go around again with the new value.
+    do {
+        position = __LDREXW(&q->reserve);
+        slot = &q->slots[position & q->mask];
+        if( slot->sequence != position ){
+            // Still holding the item from one lap ago: full.
+            __CLREX();
+            return 0;
+        }
+    } while( __STREXW(position + 1u, &q->reserve) != 0 );
+    slot->item = item;
+    // The item has to be in before the slot says it's full.
+    __DMB();
+    slot->sequence = position + 1u;
+    return 1;
+}
+
+uint8 LockFreeQueue_MpscPop(LockFreeQueue_Mpsc * q, uint32 * item){
+    LockFreeQueue_Slot * slot = &q->slots[q->tail & q->mask];
+    if( slot->sequence != q->tail + 1u ){
+        return 0;
+    }
+    __DMB();
+    *item = slot->item;
+    __DMB();
+    // Empty again, waiting for the position one lap later.
+    slot->sequence = q->tail + q->mask + 1u;
+    q->tail++;
+    return 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,94 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * lockfree_queue.h
+ * Queues for passing 32-bit items from ISRs to the main loop, without turning interrupts off.
+ *
+ * The usual way to share data with an ISR is CyEnterCriticalSection / CyExitCriticalSection.
+ * That works, but it masks EVERY interrupt, so while the main loop holds it, the UART, the SysTick
+ * and everyone else has to wait. These queues don't need that:
+ *
+ * 1) SPSC ("single producer, single consumer"): one ISR pushes, the main loop pops.
+ *    The producer only ever writes head, and the consumer only ever writes tail, so they never fight
+ *    over a variable. The only rule is the ORDER: write the item, then move head (and read the item, then move tail).
+ *    __DMB (a "data memory barrier") makes sure neither the compiler nor the CPU swaps those around.
+ *
+ * 2) MPSC ("multiple producers"): several ISRs (at different priorities, so one can interrupt another)
+ *    push, one consumer pops. Now two producers could grab the same slot, so the slot is claimed with
+ *    __LDREXW / __STREXW (core_cmInstr.h), the Cortex-M3's "load exclusive / store exclusive":
+ *    LDREX reads the index and starts watching it, and STREX only writes the new index if nothing
+ *    else happened in between. Any interrupt in between makes the STREX fail (taking or returning from an
+ *    exception clears the watch), and we just try again. Each slot also has a sequence number that says
+ *    whether it's empty or full, so the consumer never reads a slot that was claimed but not written yet.
+ *    (This is the "bounded MPMC queue" idea by Dmitry Vyukov, cut down to one consumer.)
+ *
+ * Sizes must be powers of two, so "index mod size" is just "index & (size - 1)". The indexes are
+ * 32 bits and just keep counting up, so head - tail is always how many items are in the queue.
+ * You provide the storage (usually a static array), so nothing is malloc'd.
+ */
+
+#ifndef LOCKFREE_QUEUE_H
+#define LOCKFREE_QUEUE_H
+
+#include <project.h>
+
+typedef struct
+{
+    // next slot to write (only the producer changes it)
+    volatile uint32 head;
+    // next slot to read (only the consumer changes it)
+    volatile uint32 tail;
+    uint32 mask;
+    uint32 * items;
+} LockFreeQueue_Spsc;
+
+// One slot of an MPSC queue.
+typedef struct
+{
+    // == the position + 1 when it's full, == the position when it's empty and waiting for that position.
+    volatile uint32 sequence;
+    uint32 item;
+} LockFreeQueue_Slot;
+
+typedef struct
+{
+    // next position a producer can claim. uint32_t, since that's what __LDREXW and __STREXW take.
+    volatile uint32_t reserve;
+    // next position to read (only the consumer uses it)
+    uint32 tail;
+    uint32 mask;
+    LockFreeQueue_Slot * slots;
+} LockFreeQueue_Mpsc;
+
+// Sets up a queue on 'storage', which has 'size' items. Returns 0 if size isn't a power of two.
+uint8 LockFreeQueue_SpscInit(LockFreeQueue_Spsc * queue, uint32 * storage, uint32 size);
+
+// Producer only. Returns 0 if the queue is full.
+uint8 LockFreeQueue_SpscPush(LockFreeQueue_Spsc * queue, uint32 item);
+
+// Consumer only. Returns 0 if the queue is empty.
+uint8 LockFreeQueue_SpscPop(LockFreeQueue_Spsc * queue, uint32 * item);
+
+// Consumer only. Looks at the item 'index' places from the front without taking it. Returns 0 if there isn't one.
+uint8 LockFreeQueue_SpscPeek(LockFreeQueue_Spsc * queue, uint32 index, uint32 * item);
+
+// How many items are in the queue. From either side, it's right as of when it's read.
+uint32 LockFreeQueue_SpscCount(const LockFreeQueue_Spsc * queue);
+
+uint8 LockFreeQueue_MpscInit(LockFreeQueue_Mpsc * queue, LockFreeQueue_Slot * storage, uint32 size);
+
+// Any producer, from any ISR or the main loop. Returns 0 if the queue is full.
+uint8 LockFreeQueue_MpscPush(LockFreeQueue_Mpsc * queue, uint32 item);
+
+// The one consumer. Returns 0 if the queue is empty (or the next item is claimed but not written yet).
+uint8 LockFreeQueue_MpscPop(LockFreeQueue_Mpsc * queue, uint32 * item);
+
+#endif //LOCKFREE_QUEUE_H
+
+/* [] END OF FILE */
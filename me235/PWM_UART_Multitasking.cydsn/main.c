@@ -9,30 +9,142 @@
 #include <project.h>
 // Some code that Drew wrote to make the UART communication more easy to read.
 #include "uart_helper_fcns.h"
+// Keeps the PWM settings alive across a software or watchdog reset.
+#include "warm_restart.h"
+// Zeroes the big buffers with DMA while the CPU starts the hardware.
+#include "dma_init.h"
+// Slows the clock down when idle, without changing the UART baud or PWM timing.
+#include "clock_governor.h"
+// Sleeps the CPU between interrupts instead of spinning.
+#include "idle_manager.h"
+// Software timers on the SysTick, instead of CyDelay busy loops.
+#include "timer_service.h"
+// Keeps the settings of every servo channel, and writes the changed ones once per PWM frame.
+#include "servo_bank.h"
+// Up to 8 more servos on one port, with the DMA making the pulses.
+#include "soft_pwm.h"
+// Commands that wait for a given tick.
+#include "command_schedule.h"
+// Critical sections that leave the more urgent interrupts running.
+#include "priority_section.h"
+// Every interrupt's priority, from one table.
+#include "interrupt_plan.h"
+// What the main loop runs.
+#include "app_tasks.h"
+// The motion script, saved in the EEPROM.
+#include "eeprom_store.h"
+#include "motion_script.h"
+#include "presets.h"
+// Closed-loop control on a servo bank channel, from the SysTick.
+#include "pid_loop.h"
+// sprintf, for the startup timing report.
+#include "stdio.h"
 
 int main()
 {
+    // Before anything else: if this was a software or watchdog reset, put the PWM back
+    // the way it was, so the servo doesn't twitch. See warm_restart.h.
+    uint8 warm_restart = WarmRestart_Restore();
     
-    // Start the interrupt for the UART
-    CyGlobalIntEnable;
-    Interrupt_UART_Receive_StartEx( Interrupt_Handler_UART_Receive );
+    // Kick off the DMA to zero the UART buffers. It runs on its own while we start up the hardware below.
+    DmaInit_Region dma_regions[UART_HELPER_NUM_DMA_REGIONS];
+    uint8 num_dma_regions = UART_Helper_GetDmaInitRegions( dma_regions );
+    DmaInit_Start( dma_regions, num_dma_regions );
     
     // Start the UART itself
     UART_for_USB_Start();
     
-    // Start the PWM component
-    PWM_Servo_Start();
+    // On a warm restart the PWM is already running.
+    if( !warm_restart ){
+        // Start the PWM component
+        PWM_Servo_Start();
+        // and remember its settings in case of a reset later.
+        WarmRestart_Save(0);
+    }
+    
+    // The UART ISR uses the buffers, so they have to be zeroed before it can run.
+    DmaInit_Wait();
+    
+    // Channel 0 of the servo bank picks up the PWM's settings, warm restart or not.
+    ServoBank_Init();
+    // The software PWM needs a DMA_SoftPwm and a Pins_SoftPwm that this schematic doesn't have (see soft_pwm.h),
+    // so SoftPwm_Start returns 0 and only channel 0 has an output. Once they're added, the bank's next
+    // SOFT_PWM_CHANNELS channels go to it, with compare values in SOFT_PWM_SLOT_US slots.
+    if( SoftPwm_Start() ){
+        uint8 soft_channel;
+        for( soft_channel = 0; soft_channel < SOFT_PWM_CHANNELS; soft_channel++){
+            (void) ServoBank_SetPeriod( soft_channel + 1u, SOFT_PWM_WINDOW_SLOTS );
+            ServoBank_AttachOutput( soft_channel + 1u, SoftPwm_GetOutput(soft_channel) );
+        }
+    }
+    
+    // Starts the SysTick time base, which the idle manager and the governor also use to measure idle time.
+    TimerService_Init();
+    // Now that the UART and PWM clocks are set up, the governor can read their dividers.
+    ClockGovernor_Init();
+    // Gets the priority sections' timing going.
+    PrioritySection_Init();
+    // Runs waiting commands from the SysTick, right on their tick.
+    CommandSchedule_Init();
+    // Loads the motion script and the preset slots saved in the EEPROM, if there are any.
+    EepromStore_Init();
+    MotionScript_Init();
+    Presets_Init();
+    IdleManager_Init();
+    // The main loop's tasks, and their tick on the SysTick.
+    AppTasks_Init();
+    // The PID loop, stopped until L starts it. There's no sensor in the schematic, so L says Error!,
+    // unless this was built with PID_LOOP_LOOPBACK for the pretend one (see pid_loop.h).
+    PidLoop_Init();
+#if PID_LOOP_LOOPBACK
+    PidLoop_SetInput( PidLoop_LoopbackInput );
+#endif
     
-    // Send an initial message over the UART / USB com port
-    UART_for_USB_PutString("\r\n\r\nPWM on. Use one of the following commands:\r\n");
-    UART_for_USB_PutString("Set the duty cycle, as number of clock ticks, by typing d : then the number. \r\n");
-    UART_for_USB_PutString("Set the period by typing p : then a new period. \r\n");
-    UART_for_USB_PutString("For example, p : 2000 sets the period to 2000. \r\n");
-    UART_for_USB_PutString("Or, x stops the PWM, and e re-enables the PWM. \r\n\r\n");
+    // Start the interrupt for the UART
+    Interrupt_UART_Receive_StartEx( Interrupt_Handler_UART_Receive );
+    // StartEx used the fitter's priority. Now give every interrupt the one from the plan,
+    // before any of them can run.
+    uint8 plan_where;
+    InterruptPlan_Result plan_result = InterruptPlan_Apply( &plan_where );
+    CyGlobalIntEnable;
+    
+    // On a warm restart the terminal already saw the banner.
+    if( !warm_restart ){
+        // Send an initial message over the UART / USB com port
+        UART_for_USB_PutString("\r\n\r\nPWM on. Use one of the following commands:\r\n");
+        // One line per command, from the command table (uart_commands.h).
+        UART_Helper_PrintHelp();
+        UART_for_USB_PutString("\r\n");
+        
+        // How much the DMA startup helped, in CPU cycles, against the CPU zeroing the same buffers (an estimate, see dma_init.h).
+        char startup_report[80];
+        sprintf( startup_report, "DMA init saved %lu cycles (a CPU loop takes about %lu).\r\n\r\n",
+            (unsigned long) DmaInit_GetStats()->saved_cycles, (unsigned long) DmaInit_GetStats()->cpu_cycles);
+        UART_for_USB_PutString( startup_report );
+    }
+    // Two commands with the same letter, or words the hash doesn't know about, means some can't be typed.
+    if( !UART_Helper_CheckCommands() ){
+        UART_for_USB_PutString("Two commands in uart_commands.h have the same letter, or uart_command_hash.h is out of date.\r\n");
+    }
+    // A broken plan gets reported even on a warm restart, since the priorities are wrong until it's fixed.
+    if( plan_result != INTERRUPT_PLAN_OK ){
+        uint8 plan_count;
+        char plan_report[128];
+        sprintf( plan_report, "Interrupt plan problem at %s: %s.\r\n", InterruptPlan_Get( &plan_count )[plan_where].name,
+            InterruptPlan_Describe( plan_result ));
+        UART_for_USB_PutString( plan_report );
+    }
     
     for(;;)
     {
-        /* Place your application code here. */
+        // The ISRs flag that there's something to do.
+        (void) IdleManager_TakeWork();
+        // Run the tasks the ISRs signaled, most urgent first (see app_tasks.h).
+        while( AppTasks_RunNext() ){
+        }
+        // Nothing left to do: sleep until the next interrupt.
+        // The PWM has to keep running while it's enabled, which limits how deep we can sleep.
+        IdleManager_Idle( (PWM_Servo_ReadControlRegister() & PWM_Servo_CTRL_ENABLE) != 0 );
     }
 }
 
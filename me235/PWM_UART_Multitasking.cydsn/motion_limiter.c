@@ -0,0 +1,217 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See motion_limiter.h for how this works.
+#include "motion_limiter.h"
+#include <project.h>
+// Scheduled targets come in from the SysTick.
+#include "priority_section.h"
+
+static MotionLimiter_Axis axes[SERVO_BANK_MAX_CHANNELS];
+// Bit N = channel N is moving. Only these get stepped.
+static volatile uint32 moving = 0;
+
+/**
+ * Integer square root, rounded down. Bit by bit, 16 steps for a 32-bit number.
+ */
+static uint32 MotionLimiter_Sqrt(uint32 x){
+    uint32 root = 0;
+    uint32 bit = 1uL << 30;
+    while( bit > x ){
+        bit >>= 2;
+    }
+    while( bit != 0 ){
+        if( x >= root + bit ){
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+ * How far we'd still go after this period, braking as hard as allowed from 'speed':
+ * (speed - accel) + (speed - 2 accel) + ... down to 0. That's n * speed - accel * n (n + 1) / 2, with n = speed / accel.
+ */
+static uint64 MotionLimiter_StopDistance(uint32 speed, uint32 accel){
+    uint64 n = speed / accel;
+    return n * speed - (uint64) accel * n * (n + 1u) / 2u;
+}
+
+/**
+ * 1 if moving 'speed' this period still leaves room to brake to a stop before the target.
+ */
+static uint8 MotionLimiter_CanStop(uint32 speed, uint32 accel, uint32 remaining){
+    return (speed <= remaining && (uint64)(remaining - speed) >= MotionLimiter_StopDistance(speed, accel)) ? 1 : 0;
+}
+
+uint8 MotionLimiter_StepAxis(MotionLimiter_Axis * a){
+    int32 distance = a->target - a->position;
+    int32 direction = (distance > 0) ? 1 : -1;
+    uint32 remaining = (uint32)((distance > 0) ? distance : -distance);
+    uint32 speed = (uint32)((a->velocity > 0) ? a->velocity : -a->velocity);
+    uint32 accel = (uint32) a->max_acceleration;
+    uint32 vmax = (uint32) a->max_velocity;
+    // How much faster (toward the target) this step is allowed to be than 'speed'.
+    uint32 speed_up = accel;
+    uint32 next_speed;
+
+    // A limit got turned off in the middle of a move: velocity without acceleration (or the other way)
+    // can't make a profile, so just finish the move.
+    if( vmax == 0 || accel == 0 ){
+        a->position = a->target;
+        a->velocity = 0;
+        return 0;
+    }
+    // Close enough, and slow enough to stop within one step: land on the target.
+    // (That last step can't be longer than the velocity limit either.)
+    if( remaining <= accel && remaining <= vmax && speed <= accel ){
+        a->position = a->target;
+        a->velocity = 0;
+        return 0;
+    }
+    if( (a->velocity * direction) < 0 ){
+        // Going the wrong way (the target moved behind us): slow down...
+        if( speed > accel ){
+            a->velocity += direction * (int32) accel;
+            a->position += a->velocity;
+            return 1;
+        }
+        // ...and turn around. Stopping uses up 'speed' of this step's acceleration, and only
+        // the rest is left for heading back. (Just adding accel could go past the velocity limit.)
+        speed_up = accel - speed;
+        speed = 0;
+    }
+    // Going the right way (or standing still). Pick the fastest of speed up / keep going / brake
+    // that still leaves room to stop on the target. Each is at most accel away from the current speed.
+    next_speed = (speed + speed_up < vmax) ? speed + speed_up : vmax;
+    if( !MotionLimiter_CanStop(next_speed, accel, remaining) ){
+        next_speed = (speed < vmax) ? speed : vmax;
+        if( !MotionLimiter_CanStop(next_speed, accel, remaining) ){
+            next_speed = (speed > accel) ? speed - accel : 0;
+        }
+    }
+    a->velocity = direction * (int32) next_speed;
+    a->position += a->velocity;
+    return 1;
+}
+
+uint32 MotionLimiter_EstimateAxis(const MotionLimiter_Axis * a){
+    int32 distance = a->target - a->position;
+    uint32 remaining = (uint32)((distance > 0) ? distance : -distance);
+    uint32 vmax = (uint32) a->max_velocity;
+    uint32 accel = (uint32) a->max_acceleration;
+    if( remaining == 0 ){
+        return 0;
+    }
+    if( vmax == 0 || accel == 0 ){
+        return 1;
+    }
+    // Getting up to full speed and back down covers vmax^2 / accel.
+    if( (uint64) remaining * accel >= (uint64) vmax * vmax ){
+        // Trapezoid: ramp up, cruise, ramp down.
+        return (remaining + vmax - 1u) / vmax + (vmax + accel - 1u) / accel;
+    }
+    // Triangle: never reaches full speed. Half the distance speeding up, half slowing down: 2 * sqrt(d / a).
+    return 2u * MotionLimiter_Sqrt(remaining / accel) + 1u;
+}
+
+void MotionLimiter_SetMaxVelocity(uint8 channel, uint32 max_velocity_q8){
+    if( channel < SERVO_BANK_MAX_CHANNELS ){
+        axes[channel].max_velocity = (int32) max_velocity_q8;
+    }
+}
+
+void MotionLimiter_SetMaxAcceleration(uint8 channel, uint32 max_acceleration_q8){
+    if( channel < SERVO_BANK_MAX_CHANNELS ){
+        axes[channel].max_acceleration = (int32) max_acceleration_q8;
+    }
+}
+
+uint16 MotionLimiter_SetTarget(uint8 channel, uint16 target){
+    MotionLimiter_Axis * a;
+    uint8 interrupt_state;
+    if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        return 0;
+    }
+    a = &axes[channel];
+    target = ServoBank_ClampCompare(channel, target);
+    if( a->max_velocity == 0 || a->max_acceleration == 0 ){
+        return ServoBank_SetCompare(channel, target);
+    }
+    interrupt_state = PrioritySection_Enter();
+    // A new move from standing still starts where the servo is now.
+    // A move that's already going keeps its position and speed, and just heads somewhere else.
+    if( (moving & (1uL << channel)) == 0 ){
+        a->position = (int32) ServoBank_GetCompare(channel) << MOTION_LIMITER_FRAC_BITS;
+        a->velocity = 0;
+    }
+    a->target = (int32) target << MOTION_LIMITER_FRAC_BITS;
+    moving |= (1uL << channel);
+    PrioritySection_Exit(interrupt_state);
+    return target;
+}
+
+void MotionLimiter_Stop(uint8 channel){
+    uint8 interrupt_state;
+    if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        return;
+    }
+    // A scheduled command on the SysTick can start a move, so held off like MotionLimiter_SetTarget.
+    interrupt_state = PrioritySection_Enter();
+    moving &= ~(1uL << channel);
+    axes[channel].velocity = 0;
+    PrioritySection_Exit(interrupt_state);
+}
+
+uint8 MotionLimiter_InMotion(uint8 channel){
+    return (channel < SERVO_BANK_MAX_CHANNELS && (moving & (1uL << channel)) != 0) ? 1 : 0;
+}
+
+uint32 MotionLimiter_EstimatedArrival(uint8 channel){
+    if( !MotionLimiter_InMotion(channel) ){
+        return 0;
+    }
+    return MotionLimiter_EstimateAxis(&axes[channel]);
+}
+
+void MotionLimiter_Step(uint8 new_frame){
+    uint32 pending;
+    uint8 interrupt_state;
+    if( !new_frame || moving == 0 ){
+        return;
+    }
+    pending = moving;
+    // Same trick as ServoBank_Commit: only visit the channels that are moving.
+    while( pending != 0 ){
+        uint8 channel = (uint8)(31u - __CLZ(pending & (0u - pending)));
+        uint8 still_moving;
+        int32 position;
+        pending &= pending - 1u;
+        // A scheduled command (on the SysTick) can change the target, so step with it held off. It's a few dozen cycles.
+        interrupt_state = PrioritySection_Enter();
+        still_moving = MotionLimiter_StepAxis(&axes[channel]);
+        position = axes[channel].position;
+        if( !still_moving ){
+            moving &= ~(1uL << channel);
+        }
+        PrioritySection_Exit(interrupt_state);
+        // Braking can overshoot by a fraction of a tick, even below 0.
+        if( position < 0 ){
+            position = 0;
+        }
+        // Round to the nearest tick.
+        (void) ServoBank_SetCompare(channel, (uint16)((position + (1 << (MOTION_LIMITER_FRAC_BITS - 1u))) >> MOTION_LIMITER_FRAC_BITS));
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,78 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * motion_limiter.h
+ * Limits how fast (velocity) and how suddenly (acceleration) each servo's compare value changes.
+ *
+ * Without this, "d : 200" jumps the compare from wherever it was straight to 200. The servo tries
+ * to get there instantly and pulls a big spike of current. With limits set, "d : 200" only sets a
+ * target, and every PWM period MotionLimiter_Step moves the compare a little closer: speeding up by at most
+ * the acceleration limit, up to the velocity limit, then slowing down in time to stop right on the target
+ * (a "trapezoid" velocity profile). So one command per move is all the PC needs to send.
+ *
+ * Units: velocity is compare ticks per PWM period, acceleration is ticks per period, per period.
+ * Both are Q8 fixed point (times 256), so slow moves like 0.25 ticks per period work. The position
+ * is kept in Q8 too, and rounded to a whole tick when it's written to the servo bank.
+ * Integer math only: the one square root (for the arrival estimate) is done with integers too.
+ *
+ * A limit of 0 means "no limit": the channel jumps straight to its target like before.
+ * It takes both limits to make a profile, so with only one of them set, it jumps too.
+ *
+ * MotionLimiter_StepAxis and MotionLimiter_EstimateAxis are just arithmetic, so they can be checked on a regular computer.
+ */
+
+#ifndef MOTION_LIMITER_H
+#define MOTION_LIMITER_H
+
+#include <project.h>
+#include "servo_bank.h"
+
+#define MOTION_LIMITER_FRAC_BITS 8u
+
+// The state of one channel's move, with everything in Q8.
+typedef struct
+{
+    int32 position;
+    int32 velocity;
+    int32 target;
+    int32 max_velocity;
+    int32 max_acceleration;
+} MotionLimiter_Axis;
+
+// One step (one PWM period) of the profile. Returns 1 while still moving, 0 once it's on the target.
+uint8 MotionLimiter_StepAxis(MotionLimiter_Axis * axis);
+
+// How many more periods until the axis gets to its target, roughly (assumes it's starting from rest).
+uint32 MotionLimiter_EstimateAxis(const MotionLimiter_Axis * axis);
+
+// Set a channel's limits, in Q8. 0 for no limit. The profile only runs once both are set.
+void MotionLimiter_SetMaxVelocity(uint8 channel, uint32 max_velocity_q8);
+void MotionLimiter_SetMaxAcceleration(uint8 channel, uint32 max_acceleration_q8);
+
+// Where the channel should go. With limits, it moves there over the next periods; without, right away.
+// Returns the target, after the servo bank's clamping.
+uint16 MotionLimiter_SetTarget(uint8 channel, uint16 target);
+
+// Stops the channel's move where it is, without writing it. For things that write the channel themselves
+// (a trajectory, keyframes, the PID loop), so MotionLimiter_Step doesn't write over them.
+// The next MotionLimiter_SetTarget starts a new move from wherever the channel is by then.
+void MotionLimiter_Stop(uint8 channel);
+
+// 1 if the channel is still moving toward its target.
+uint8 MotionLimiter_InMotion(uint8 channel);
+
+// Periods until the channel gets to its target (0 if it's there). Roughly, see MotionLimiter_EstimateAxis.
+uint32 MotionLimiter_EstimatedArrival(uint8 channel);
+
+// Call from the main loop with ServoBank_PollFrame's result. Steps every moving channel once per frame.
+void MotionLimiter_Step(uint8 new_frame);
+
+#endif //MOTION_LIMITER_H
+
+/* [] END OF FILE */
@@ -0,0 +1,416 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See motion_script.h for the opcodes.
+#include "motion_script.h"
+#include <project.h>
+// Channels are servo bank channels, and compares go through the motion limiter.
+#include "servo_bank.h"
+#include "motion_limiter.h"
+// The ticks.
+#include "timer_service.h"
+// Saving the script.
+#include "eeprom_store.h"
+// memcpy, to and from the EEPROM.
+#include <string.h>
+
+// How many operands each opcode has.
+#define MOTION_SCRIPT_OPERANDS(name, operands) operands,
+static const uint8 operand_count[MOTION_SCRIPT_NUM_OPCODES] = { MOTION_SCRIPT_OPCODES(MOTION_SCRIPT_OPERANDS) };
+
+MotionScript_Error MotionScript_Check(const uint16 * program, uint16 length, uint16 * where){
+    // 1 for each place an instruction starts, so jumps can be checked.
+    uint8 starts[(MOTION_SCRIPT_MAX_LENGTH + 7u) / 8u] = { 0 };
+    uint16 pc = 0;
+    uint16 op;
+    *where = 0;
+    if( length == 0 ){
+        return MOTION_SCRIPT_EMPTY;
+    }
+    if( length > MOTION_SCRIPT_MAX_LENGTH ){
+        *where = MOTION_SCRIPT_MAX_LENGTH;
+        return MOTION_SCRIPT_TOO_LONG;
+    }
+    // First, the opcodes, and their operands that aren't addresses.
+    while( pc < length ){
+        *where = pc;
+        op = program[pc];
+        if( op >= MOTION_SCRIPT_NUM_OPCODES ){
+            return MOTION_SCRIPT_BAD_OPCODE;
+        }
+        if( (uint32) pc + operand_count[op] >= length ){
+            return MOTION_SCRIPT_MISSING_OPERAND;
+        }
+        if( (op == MOTION_SCRIPT_OP_COMPARE || op == MOTION_SCRIPT_OP_PERIOD || op == MOTION_SCRIPT_OP_RAMP)
+            && program[pc + 1u] >= SERVO_BANK_MAX_CHANNELS ){
+            return MOTION_SCRIPT_BAD_CHANNEL;
+        }
+        if( (op == MOTION_SCRIPT_OP_COUNT || op == MOTION_SCRIPT_OP_LOOP || op == MOTION_SCRIPT_OP_IFZERO)
+            && program[pc + 1u] >= MOTION_SCRIPT_COUNTERS ){
+            return MOTION_SCRIPT_BAD_COUNTER;
+        }
+        starts[pc / 8u] |= (uint8)(1u << (pc % 8u));
+        pc += 1u + operand_count[op];
+    }
+    // Then, now that we know where every instruction starts, the jumps.
+    pc = 0;
+    while( pc < length ){
+        *where = pc;
+        op = program[pc];
+        if( op == MOTION_SCRIPT_OP_LOOP || op == MOTION_SCRIPT_OP_IFZERO || op == MOTION_SCRIPT_OP_JUMP ){
+            // The address is always the last operand.
+            uint16 address = program[pc + operand_count[op]];
+            if( address >= length || (starts[address / 8u] & (1u << (address % 8u))) == 0 ){
+                return MOTION_SCRIPT_BAD_ADDRESS;
+            }
+        }
+        pc += 1u + operand_count[op];
+    }
+    *where = 0;
+    return MOTION_SCRIPT_OK;
+}
+
+void MotionScript_Begin(MotionScript_Vm * vm, const uint16 * program, uint16 length, const MotionScript_Output * output){
+    uint8 i;
+    vm->program = program;
+    vm->length = length;
+    vm->output = output;
+    vm->pc = 0;
+    vm->state = MOTION_SCRIPT_RUNNING;
+    vm->error = MOTION_SCRIPT_OK;
+    vm->error_pc = 0;
+    vm->depth = 0;
+    for( i = 0; i < MOTION_SCRIPT_COUNTERS; i++){
+        vm->counters[i] = 0;
+    }
+    vm->waiting = 0;
+    vm->ramp_ticks = 0;
+    vm->executed = 0;
+}
+
+static MotionScript_State MotionScript_Fail(MotionScript_Vm * vm, uint16 pc, MotionScript_Error error){
+    vm->state = MOTION_SCRIPT_FAILED;
+    vm->error = error;
+    vm->error_pc = pc;
+    return MOTION_SCRIPT_FAILED;
+}
+
+// Numbers on the stack are 32 bits, but a compare or a period is 16.
+static uint16 MotionScript_Clamp(int32 value){
+    if( value < 0 ){
+        return 0;
+    }
+    return (value > 0xFFFF) ? 0xFFFFu : (uint16) value;
+}
+
+/**
+ * One tick of a ramp: a straight line from ramp_from to ramp_to. Returns 1 once it's there.
+ */
+static uint8 MotionScript_Ramp(MotionScript_Vm * vm, uint32 now){
+    uint32 elapsed = now - vm->ramp_start;
+    int32 difference;
+    if( elapsed >= vm->ramp_ticks ){
+        vm->output->set_compare( vm->ramp_channel, vm->ramp_to );
+        vm->ramp_ticks = 0;
+        return 1;
+    }
+    difference = (int32) vm->ramp_to - (int32) vm->ramp_from;
+    // 64 bits, since a 16-bit difference times a long ramp can be more than 32.
+    vm->output->set_compare( vm->ramp_channel,
+        (uint16)((int32) vm->ramp_from + (int32)(((int64) difference * (int64) elapsed) / (int64) vm->ramp_ticks)) );
+    return 0;
+}
+
+MotionScript_State MotionScript_Execute(MotionScript_Vm * vm, uint32 now, uint16 budget){
+    const uint16 * program = vm->program;
+    int32 * stack = vm->stack;
+    uint16 pc;
+    uint16 op;
+    uint8 depth;
+    if( vm->state != MOTION_SCRIPT_RUNNING ){
+        return (MotionScript_State) vm->state;
+    }
+    // Still waiting, or ramping?
+    if( vm->waiting ){
+        if( (int32)(now - vm->wait_until) < 0 ){
+            return MOTION_SCRIPT_RUNNING;
+        }
+        vm->waiting = 0;
+    }
+    if( vm->ramp_ticks != 0 && !MotionScript_Ramp( vm, now ) ){
+        return MOTION_SCRIPT_RUNNING;
+    }
+    // Local copies, so the compiler can keep them in registers.
+    pc = vm->pc;
+    depth = vm->depth;
+    while( budget > 0 ){
+        budget--;
+        if( pc >= vm->length ){
+            // Running off the end is the same as END.
+            vm->state = MOTION_SCRIPT_DONE;
+            break;
+        }
+        op = program[pc];
+        vm->executed++;
+        // Each instruction checks there are enough numbers on the stack (or room for one more) first.
+        switch( op ){
+            case MOTION_SCRIPT_OP_END:
+                vm->state = MOTION_SCRIPT_DONE;
+                budget = 0;
+                break;
+            case MOTION_SCRIPT_OP_PUSH:
+                if( depth >= MOTION_SCRIPT_STACK_DEPTH ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_FULL );
+                }
+                stack[depth++] = program[pc + 1u];
+                pc += 2u;
+                break;
+            case MOTION_SCRIPT_OP_DUP:
+                if( depth == 0 || depth >= MOTION_SCRIPT_STACK_DEPTH ){
+                    return MotionScript_Fail( vm, pc, (depth == 0) ? MOTION_SCRIPT_STACK_EMPTY : MOTION_SCRIPT_STACK_FULL );
+                }
+                stack[depth] = stack[depth - 1u];
+                depth++;
+                pc++;
+                break;
+            case MOTION_SCRIPT_OP_DROP:
+                if( depth < 1u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                depth--;
+                pc++;
+                break;
+            case MOTION_SCRIPT_OP_ADD:
+                if( depth < 2u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                depth--;
+                stack[depth - 1u] += stack[depth];
+                pc++;
+                break;
+            case MOTION_SCRIPT_OP_SUB:
+                if( depth < 2u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                depth--;
+                stack[depth - 1u] -= stack[depth];
+                pc++;
+                break;
+            case MOTION_SCRIPT_OP_COMPARE:
+                if( depth < 1u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                vm->output->set_compare( (uint8) program[pc + 1u], MotionScript_Clamp( stack[--depth] ) );
+                pc += 2u;
+                break;
+            case MOTION_SCRIPT_OP_PERIOD:
+                if( depth < 1u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                vm->output->set_period( (uint8) program[pc + 1u], MotionScript_Clamp( stack[--depth] ) );
+                pc += 2u;
+                break;
+            case MOTION_SCRIPT_OP_WAIT:
+                if( depth < 1u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                depth--;
+                pc++;
+                if( stack[depth] > 0 ){
+                    vm->waiting = 1;
+                    vm->wait_until = now + (uint32) stack[depth];
+                    budget = 0;
+                }
+                break;
+            case MOTION_SCRIPT_OP_RAMP:
+                if( depth < 2u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                vm->ramp_channel = (uint8) program[pc + 1u];
+                vm->ramp_ticks = (stack[depth - 1u] > 0) ? (uint32) stack[depth - 1u] : 0;
+                vm->ramp_to = MotionScript_Clamp( stack[depth - 2u] );
+                depth -= 2u;
+                pc += 2u;
+                if( vm->ramp_ticks == 0 ){
+                    vm->output->set_compare( vm->ramp_channel, vm->ramp_to );
+                }
+                else {
+                    // The first step is on the next tick.
+                    vm->ramp_from = vm->output->get_compare( vm->ramp_channel );
+                    vm->ramp_start = now;
+                    budget = 0;
+                }
+                break;
+            case MOTION_SCRIPT_OP_COUNT:
+                if( depth < 1u ){
+                    return MotionScript_Fail( vm, pc, MOTION_SCRIPT_STACK_EMPTY );
+                }
+                vm->counters[program[pc + 1u]] = MotionScript_Clamp( stack[--depth] );
+                pc += 2u;
+                break;
+            case MOTION_SCRIPT_OP_LOOP:
+                // A counter that's already 0 stays 0, and doesn't loop.
+                if( vm->counters[program[pc + 1u]] != 0 && --vm->counters[program[pc + 1u]] != 0 ){
+                    pc = program[pc + 2u];
+                }
+                else {
+                    pc += 3u;
+                }
+                break;
+            case MOTION_SCRIPT_OP_IFZERO:
+                pc = (vm->counters[program[pc + 1u]] == 0) ? program[pc + 2u] : (uint16)(pc + 3u);
+                break;
+            case MOTION_SCRIPT_OP_JUMP:
+                pc = program[pc + 1u];
+                break;
+            default:
+                // MotionScript_Check already made sure this can't happen.
+                return MotionScript_Fail( vm, pc, MOTION_SCRIPT_BAD_OPCODE );
+        }
+    }
+    vm->pc = pc;
+    vm->depth = depth;
+    return (MotionScript_State) vm->state;
+}
+
+const char * MotionScript_Describe(MotionScript_Error error){
+    switch( error ){
+        case MOTION_SCRIPT_OK:
+            return "ok";
+        case MOTION_SCRIPT_EMPTY:
+            return "there's no script";
+        case MOTION_SCRIPT_TOO_LONG:
+            return "the script is too long";
+        case MOTION_SCRIPT_BAD_OPCODE:
+            return "not an opcode";
+        case MOTION_SCRIPT_MISSING_OPERAND:
+            return "the script ends in the middle of an instruction";
+        case MOTION_SCRIPT_BAD_CHANNEL:
+            return "no such channel";
+        case MOTION_SCRIPT_BAD_COUNTER:
+            return "there are only 4 counters";
+        case MOTION_SCRIPT_BAD_ADDRESS:
+            return "jumps to somewhere that isn't an instruction";
+        case MOTION_SCRIPT_STACK_EMPTY:
+            return "not enough numbers on the stack";
+        case MOTION_SCRIPT_STACK_FULL:
+            return "too many numbers on the stack";
+        default:
+            return "unknown";
+    }
+}
+
+// The script on the PSoC.
+static uint16 program[MOTION_SCRIPT_MAX_LENGTH];
+static uint16 program_length = 0;
+// 1 once the script was started, so the next MotionScript_Append starts a new one.
+static uint8 sealed = 0;
+static MotionScript_Vm vm;
+
+// What's saved in the EEPROM: this, then the script.
+typedef struct
+{
+    uint16 magic;
+    uint16 length;
+    // EepromStore_Checksum of the script
+    uint16 checksum;
+    uint16 reserved;
+} MotionScript_Header;
+
+#define MOTION_SCRIPT_MAGIC 0x4D53u
+
+static void MotionScript_SetCompare(uint8 channel, uint16 compare){
+    (void) MotionLimiter_SetTarget( channel, compare );
+}
+
+static void MotionScript_SetPeriod(uint8 channel, uint16 period){
+    (void) ServoBank_SetPeriod( channel, period );
+}
+
+static const MotionScript_Output output = { MotionScript_SetCompare, MotionScript_SetPeriod, ServoBank_GetCompare };
+
+void MotionScript_Init(void){
+    vm.state = MOTION_SCRIPT_IDLE;
+    (void) MotionScript_Load();
+}
+
+uint8 MotionScript_Append(uint16 value){
+    if( sealed ){
+        MotionScript_Clear();
+    }
+    if( program_length >= MOTION_SCRIPT_MAX_LENGTH ){
+        return 0;
+    }
+    program[program_length] = value;
+    program_length++;
+    return 1;
+}
+
+void MotionScript_Clear(void){
+    MotionScript_Stop();
+    program_length = 0;
+    sealed = 0;
+}
+
+MotionScript_Error MotionScript_Start(uint16 * where){
+    MotionScript_Error result = MotionScript_Check( program, program_length, where );
+    if( result != MOTION_SCRIPT_OK ){
+        return result;
+    }
+    sealed = 1;
+    MotionScript_Begin( &vm, program, program_length, &output );
+    return MOTION_SCRIPT_OK;
+}
+
+void MotionScript_Stop(void){
+    if( vm.state == MOTION_SCRIPT_RUNNING ){
+        vm.state = MOTION_SCRIPT_IDLE;
+    }
+}
+
+uint16 MotionScript_GetLength(void){
+    return program_length;
+}
+
+const MotionScript_Vm * MotionScript_GetVm(void){
+    return &vm;
+}
+
+uint8 MotionScript_Save(void){
+    MotionScript_Header header;
+    header.magic = MOTION_SCRIPT_MAGIC;
+    header.length = program_length;
+    header.checksum = EepromStore_Checksum( program, program_length * sizeof(uint16) );
+    header.reserved = 0;
+    // The script first, so a reset in the middle leaves the old header, which won't match it.
+    if( !EepromStore_Write( EEPROM_STORE_SCRIPT_ADDRESS + sizeof(header), program, program_length * sizeof(uint16) ) ){
+        return 0;
+    }
+    return EepromStore_Write( EEPROM_STORE_SCRIPT_ADDRESS, &header, sizeof(header) );
+}
+
+uint8 MotionScript_Load(void){
+    MotionScript_Header header;
+    const uint8 * saved = EepromStore_Get( EEPROM_STORE_SCRIPT_ADDRESS );
+    memcpy( &header, saved, sizeof(header) );
+    if( header.magic != MOTION_SCRIPT_MAGIC || header.length > MOTION_SCRIPT_MAX_LENGTH
+        || EepromStore_Checksum( saved + sizeof(header), header.length * sizeof(uint16) ) != header.checksum ){
+        return 0;
+    }
+    MotionScript_Stop();
+    memcpy( program, saved + sizeof(header), header.length * sizeof(uint16) );
+    program_length = header.length;
+    sealed = 0;
+    return 1;
+}
+
+void MotionScript_Step(void){
+    (void) MotionScript_Execute( &vm, TimerService_Now(), MOTION_SCRIPT_BUDGET );
+}
+
+/* [] END OF FILE */
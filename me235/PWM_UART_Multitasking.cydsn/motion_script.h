@@ -0,0 +1,201 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * motion_script.h
+ * A tiny interpreter for motion scripts, so "sweep, pause, come back, do it again" runs on the PSoC
+ * instead of the PC sending (and timing) every step over the UART.
+ *
+ * A script is a list of 16-bit numbers: an opcode, then its operands, then the next opcode, and so on.
+ * Write it as text, and motion_script_asm.py turns it into "c : N" lines to send.
+ * "y : 1" runs it.
+ *
+ * The interpreter is a stack machine: "push 1500" puts a number on the stack, and most other instructions
+ * take their numbers off it. For example, to go to 2000 over half a second and wait a quarter second there:
+ *     push 2000
+ *     push 500
+ *     ramp 0          ; servo 0, to 2000, over 500 ticks
+ *     push 250
+ *     wait            ; 250 ticks
+ * The opcodes are in MOTION_SCRIPT_OPCODES below. There are also four counters for loops:
+ * "count 0" takes the number of times around off the stack, and "loop 0 label" goes back to the label
+ * until it's been around that many times.
+ *
+ * Time is in timer service ticks (1 ms, see timer_service.h). The PWM task (app_tasks.h) runs the script
+ * every tick, for at most MOTION_SCRIPT_BUDGET instructions, so a script that forgets to wait can't hog the CPU.
+ * A wait, or a ramp that's still going, ends the tick's turn early.
+ * Before a script runs, MotionScript_Check goes through all of it once: every opcode, channel, counter and
+ * jump has to make sense. After that, the interpreter only has to watch the stack.
+ *
+ * Compares go through the motion limiter, like d does, and periods through the servo bank.
+ * A script can also be saved to the EEPROM (eeprom_store.h). The saved one is loaded at startup, but doesn't run by itself.
+ *
+ * MotionScript_Check, MotionScript_Begin and MotionScript_Execute don't touch the hardware
+ * (the output goes through the functions in MotionScript_Output), so they can be checked on a regular computer.
+ */
+
+#ifndef MOTION_SCRIPT_H
+#define MOTION_SCRIPT_H
+
+#include <project.h>
+
+// The longest script, in 16-bit numbers. Saved, it has to fit in EEPROM_STORE_SCRIPT_SIZE (with its header).
+#define MOTION_SCRIPT_MAX_LENGTH 240u
+#define MOTION_SCRIPT_STACK_DEPTH 8u
+#define MOTION_SCRIPT_COUNTERS 4u
+// Most instructions per tick.
+#define MOTION_SCRIPT_BUDGET 32u
+
+/**
+ * X( NAME, operands ): the opcodes, numbered from 0 in this order. "operands" is how many numbers come right
+ * after the opcode in the script. motion_script_asm.py reads this list, so keep it one opcode per line.
+ */
+#define MOTION_SCRIPT_OPCODES(X) \
+    /* Stop. */ \
+    X( END,     0 ) \
+    /* Put the operand on the stack. */ \
+    X( PUSH,    1 ) \
+    /* Put another copy of the top number on the stack. */ \
+    X( DUP,     0 ) \
+    /* Throw the top number away. */ \
+    X( DROP,    0 ) \
+    /* Take two numbers, put back their sum. */ \
+    X( ADD,     0 ) \
+    /* Take b, then a, put back a - b. */ \
+    X( SUB,     0 ) \
+    /* Take a compare value, and move the operand's servo there. */ \
+    X( COMPARE, 1 ) \
+    /* Take a period for the operand's servo. */ \
+    X( PERIOD,  1 ) \
+    /* Take a number of ticks, and wait that long. */ \
+    X( WAIT,    0 ) \
+    /* Take a number of ticks, then a compare value, and go there in a straight line over that many ticks. */ \
+    X( RAMP,    1 ) \
+    /* Take a number for the operand's counter. */ \
+    X( COUNT,   1 ) \
+    /* Count the first operand's counter down, and jump to the second operand unless it got to 0. */ \
+    X( LOOP,    2 ) \
+    /* Jump to the second operand if the first operand's counter is 0. */ \
+    X( IFZERO,  2 ) \
+    /* Jump to the operand. */ \
+    X( JUMP,    1 )
+
+#define MOTION_SCRIPT_OPCODE_ENUM(name, operands) MOTION_SCRIPT_OP_##name,
+typedef enum
+{
+    MOTION_SCRIPT_OPCODES(MOTION_SCRIPT_OPCODE_ENUM)
+    MOTION_SCRIPT_NUM_OPCODES
+} MotionScript_Opcode;
+
+typedef enum
+{
+    MOTION_SCRIPT_IDLE = 0,
+    MOTION_SCRIPT_RUNNING,
+    // Got to an END (or the end of the script).
+    MOTION_SCRIPT_DONE,
+    MOTION_SCRIPT_FAILED
+} MotionScript_State;
+
+typedef enum
+{
+    MOTION_SCRIPT_OK = 0,
+    // From MotionScript_Check:
+    MOTION_SCRIPT_EMPTY,
+    MOTION_SCRIPT_TOO_LONG,
+    MOTION_SCRIPT_BAD_OPCODE,
+    MOTION_SCRIPT_MISSING_OPERAND,
+    MOTION_SCRIPT_BAD_CHANNEL,
+    MOTION_SCRIPT_BAD_COUNTER,
+    // A jump to past the end, or into the middle of an instruction.
+    MOTION_SCRIPT_BAD_ADDRESS,
+    // While running:
+    MOTION_SCRIPT_STACK_EMPTY,
+    MOTION_SCRIPT_STACK_FULL
+} MotionScript_Error;
+
+// Where the script's output goes. On the PSoC, the motion limiter and the servo bank.
+typedef struct
+{
+    void (*set_compare)(uint8 channel, uint16 compare);
+    void (*set_period)(uint8 channel, uint16 period);
+    uint16 (*get_compare)(uint8 channel);
+} MotionScript_Output;
+
+typedef struct
+{
+    const uint16 * program;
+    uint16 length;
+    const MotionScript_Output * output;
+    // the next instruction
+    uint16 pc;
+    uint8 state;
+    uint8 error;
+    // where the error was
+    uint16 error_pc;
+    int32 stack[MOTION_SCRIPT_STACK_DEPTH];
+    uint8 depth;
+    uint16 counters[MOTION_SCRIPT_COUNTERS];
+    // waiting until this tick, if waiting is 1
+    uint8 waiting;
+    uint32 wait_until;
+    // a ramp that's going, if ramp_ticks isn't 0
+    uint8 ramp_channel;
+    uint16 ramp_from;
+    uint16 ramp_to;
+    uint32 ramp_start;
+    uint32 ramp_ticks;
+    // how many instructions have run
+    uint32 executed;
+} MotionScript_Vm;
+
+// Goes through the whole script once. Returns MOTION_SCRIPT_OK, or what's wrong and where (in *where).
+MotionScript_Error MotionScript_Check(const uint16 * program, uint16 length, uint16 * where);
+
+// Gets vm ready to run a checked script from the start.
+void MotionScript_Begin(MotionScript_Vm * vm, const uint16 * program, uint16 length, const MotionScript_Output * output);
+
+// Runs at most 'budget' instructions, at tick 'now'. Returns the state afterward.
+MotionScript_State MotionScript_Execute(MotionScript_Vm * vm, uint32 now, uint16 budget);
+
+// Words for a MotionScript_Error, for the UART.
+const char * MotionScript_Describe(MotionScript_Error error);
+
+// The script on the PSoC.
+// Loads the script saved in the EEPROM, if there is one. Call after EepromStore_Init.
+void MotionScript_Init(void);
+
+// Adds one number to the script. The first one after a script was started begins a new script.
+// Returns 0 if it's full.
+uint8 MotionScript_Append(uint16 value);
+
+// Stops the script and throws it away.
+void MotionScript_Clear(void);
+
+// Checks the script and starts it from the top. Returns MOTION_SCRIPT_OK if it started.
+MotionScript_Error MotionScript_Start(uint16 * where);
+
+void MotionScript_Stop(void);
+
+// How long the script is.
+uint16 MotionScript_GetLength(void);
+
+// The interpreter, for its state, where it's up to, and any error.
+const MotionScript_Vm * MotionScript_GetVm(void);
+
+// Saves the script in the EEPROM. Returns 0 if that didn't work.
+uint8 MotionScript_Save(void);
+
+// Replaces the script with the saved one. Returns 0 if there's no saved script (or it's damaged).
+uint8 MotionScript_Load(void);
+
+// Call from the PWM task, every tick.
+void MotionScript_Step(void);
+
+#endif //MOTION_SCRIPT_H
+
+/* [] END OF FILE */
@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+# ========================================
+#
+# Copyright Andrew P. Sabelhaus, 2018
+# See README and LICENSE for more details.
+#
+# ========================================
+
+"""
+motion_script_asm.py
+Turns a motion script (see motion_script.h) from text into the lines to type into the terminal:
+    python motion_script_asm.py sweep.txt
+prints "y : 3" (clear the old script), then one "c : N" line per number. Paste them into TeraTerm
+(or send the file), then type "y : 1" to run it. With --numbers, it prints just the numbers instead.
+
+The text is one instruction per line, like "push 1500" or "loop 0 again".
+Anything after a ; is a comment. "name:" at the start of a line is a label, to jump to.
+For example, sweep servo 0 back and forth 5 times, with a rest at each end:
+            push 5
+            count 0
+    again:  push 2000
+            push 500
+            ramp 0          ; to 2000 over 500 ticks
+            push 250
+            wait
+            push 1000
+            push 500
+            ramp 0          ; and back
+            push 250
+            wait
+            loop 0 again
+            end
+
+The opcodes and how many operands they take come from MOTION_SCRIPT_OPCODES in motion_script.h,
+so this always matches the PSoC's code.
+"""
+
+import os
+import re
+import sys
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'motion_script.h')
+
+
+def read_opcodes(path):
+    # Each line of the list looks like:   X( PUSH,    1 ) \
+    text = open(path).read()
+    found = re.findall(r"X\(\s*([A-Z]+),\s*(\d+)\s*\)", text)
+    return dict((name.lower(), (number, int(operands))) for number, (name, operands) in enumerate(found))
+
+
+def assemble(lines, opcodes):
+    # Two passes: the first finds where each label is, the second writes the numbers.
+    labels = {}
+    instructions = []
+    address = 0
+    for line_number, line in enumerate(lines, 1):
+        line = line.split(';')[0].strip()
+        match = re.match(r'^(\w+):\s*(.*)$', line)
+        if match:
+            if match.group(1) in labels:
+                raise SyntaxError('line %d: %s is already a label' % (line_number, match.group(1)))
+            labels[match.group(1)] = address
+            line = match.group(2)
+        if not line:
+            continue
+        words = line.split()
+        name = words[0].lower()
+        if name not in opcodes:
+            raise SyntaxError('line %d: there is no "%s" instruction' % (line_number, words[0]))
+        number, operands = opcodes[name]
+        if len(words) - 1 != operands:
+            raise SyntaxError('line %d: %s takes %d operand(s)' % (line_number, name, operands))
+        instructions.append((line_number, number, words[1:]))
+        address += 1 + operands
+    out = []
+    for line_number, number, operands in instructions:
+        out.append(number)
+        for operand in operands:
+            if operand in labels:
+                out.append(labels[operand])
+                continue
+            try:
+                value = int(operand, 0)
+            except ValueError:
+                raise SyntaxError('line %d: "%s" isn\'t a number or a label' % (line_number, operand))
+            if value < 0 or value > 0xFFFF:
+                raise SyntaxError('line %d: %d doesn\'t fit in 16 bits (push a smaller one and use add or sub)' % (line_number, value))
+            out.append(value)
+    return out
+
+
+def main():
+    args = sys.argv[1:]
+    numbers_only = '--numbers' in args
+    args = [a for a in args if a != '--numbers']
+    if len(args) != 1:
+        sys.exit('usage: python motion_script_asm.py [--numbers] script.txt')
+    try:
+        program = assemble(open(args[0]).read().splitlines(), read_opcodes(HEADER))
+    except SyntaxError as error:
+        sys.exit('%s: %s' % (args[0], error))
+    if numbers_only:
+        print(' '.join('%d' % n for n in program))
+        return
+    print('y : 3')
+    for n in program:
+        print('c : %d' % n)
+
+
+if __name__ == '__main__':
+    main()
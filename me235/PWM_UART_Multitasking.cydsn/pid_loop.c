@@ -0,0 +1,243 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See pid_loop.h for how the controller works.
+#include "pid_loop.h"
+#include <project.h>
+#include "servo_bank.h"
+// The loop writes its channel itself, so the motion limiter has to leave it alone.
+#include "motion_limiter.h"
+// The loop runs on its tick.
+#include "timer_service.h"
+// The gains and the setpoint are shared with the SysTick.
+#include "priority_section.h"
+// For the cycles per time around the loop.
+#include "cycle_counter.h"
+
+// Clamps a to lowest..highest.
+static int32 PidLoop_Clamp(int32 a, int32 lowest, int32 highest){
+    if( a < lowest ){
+        return lowest;
+    }
+    if( a > highest ){
+        return highest;
+    }
+    return a;
+}
+
+// gain (Q16) * value (Q15), back to Q15, saturated to an int16.
+// The gain is at most 2^31 and the value 2^15, so after the shift it always fits in an int32 for __SSAT.
+static int32 PidLoop_Scale(int32 gain, int32 value){
+    return __SSAT( (int32)(((int64) gain * value) >> 16), 16 );
+}
+
+void PidLoop_Configure(PidLoop_Controller * pid, int16 out_min, int16 out_max){
+    pid->kp = 0;
+    pid->ki = 0;
+    pid->kd = 0;
+    pid->alpha = PID_LOOP_Q15_ONE;
+    pid->out_min = out_min;
+    pid->out_max = out_max;
+    PidLoop_Reset( pid );
+}
+
+void PidLoop_Reset(PidLoop_Controller * pid){
+    pid->integral = 0;
+    pid->derivative = 0;
+    pid->last_feedback = 0;
+    pid->primed = 0;
+}
+
+int16 PidLoop_Update(PidLoop_Controller * pid, int16 setpoint, int16 feedback){
+    // The I part can't go past the output's limits, in its Q31.
+    int64 integral_min = (int64) pid->out_min << 16;
+    int64 integral_max = (int64) pid->out_max << 16;
+    int32 error = __SSAT( (int32) setpoint - feedback, 16 );
+    int32 p = PidLoop_Scale( pid->kp, error );
+    int32 d;
+    int64 integral;
+    int32 output;
+    // D: from the feedback, which is going the other way from the error. Nothing to compare the first sample to.
+    if( pid->primed ){
+        int32 change = (int32) pid->last_feedback - feedback;
+        pid->derivative += (int32)(((int64)(change - pid->derivative) * pid->alpha) >> 15);
+    }
+    pid->last_feedback = feedback;
+    pid->primed = 1;
+    d = PidLoop_Scale( pid->kd, __SSAT( pid->derivative, 16 ) );
+    // I: ki * error is Q16 * Q15, so it adds straight onto the Q31.
+    integral = pid->integral + (int64) pid->ki * error;
+    if( integral < integral_min ){
+        integral = integral_min;
+    }
+    else if( integral > integral_max ){
+        integral = integral_max;
+    }
+    output = p + (int32)(integral >> 16) + d;
+    // Anti-windup: if that's past a limit, and the error is pushing it further past, don't add this sample's error.
+    if( (output > pid->out_max && error > 0) || (output < pid->out_min && error < 0) ){
+        integral = pid->integral;
+        output = p + (int32)(integral >> 16) + d;
+    }
+    pid->integral = (int32) integral;
+    return (int16) PidLoop_Clamp( output, pid->out_min, pid->out_max );
+}
+
+/**
+ * The loop on the PSoC.
+ */
+
+static PidLoop_Controller controller;
+static PidLoop_Input input = NULL;
+static volatile int16 setpoint = 0;
+// These are all written with the SysTick held off, or by the SysTick itself.
+static volatile uint8 running = 0;
+static uint8 channel = 0;
+static uint16 ticks_per_sample = 1;
+static uint16 countdown = 1;
+static PidLoop_Status status;
+// The pretend plant's output, Q15 with 16 more bits so the slow end of the lag doesn't round away.
+static int32 loopback_q31 = 0;
+
+// A gain in thousandths, times 'multiply' and over 'divide', as Q16. Big ones stop at the largest int32.
+static int32 PidLoop_GainQ16(uint32 milli, uint32 multiply, uint32 divide){
+    uint64 q16 = ((uint64) milli * multiply * PID_LOOP_Q16_ONE) / ((uint64) divide * 1000u);
+    return (q16 > 0x7FFFFFFFu) ? 0x7FFFFFFF : (int32) q16;
+}
+
+// Puts the gains into the controller, per sample at the loop's rate. Call with the SysTick held off.
+// The status keeps them as they were set, in thousandths, so they can be redone for a new rate.
+static void PidLoop_ApplyGains(void){
+    uint32 rate_hz = TIMER_SERVICE_TICK_HZ / ticks_per_sample;
+    controller.kp = PidLoop_GainQ16( status.gain_milli[PID_LOOP_P], 1u, 1u );
+    // ki per second is ki / rate per sample, and kd in seconds is kd * rate per sample.
+    controller.ki = PidLoop_GainQ16( status.gain_milli[PID_LOOP_I], 1u, rate_hz );
+    controller.kd = PidLoop_GainQ16( status.gain_milli[PID_LOOP_D], rate_hz, 1u );
+}
+
+// Runs every tick, after the timer service, the command schedule and the app tasks' signals.
+static void PidLoop_SysTickCallback(void){
+    uint32 start;
+    int16 feedback;
+    int16 output;
+    uint16 period;
+    if( !running || --countdown != 0 ){
+        return;
+    }
+    countdown = ticks_per_sample;
+    start = CycleCounter_Now();
+    feedback = input();
+    output = PidLoop_Update( &controller, setpoint, feedback );
+    // The output is a duty cycle, 0 to 32767 for 0 to 100% of the channel's period.
+    // The servo bank holds it until the PWM task commits the next frame.
+    period = ServoBank_GetPeriod( channel );
+    // A d on this channel with speed limits would start a move, and MotionLimiter_Step would write over the loop
+    // every frame. The loop owns the channel, so that move stops here.
+    if( MotionLimiter_InMotion( channel ) ){
+        MotionLimiter_Stop( channel );
+    }
+    (void) ServoBank_SetCompare( channel, (uint16)(((uint32) period * (uint32) __USAT( output, 15 )) >> 15) );
+    status.last_cycles = CycleCounter_Now() - start;
+    if( status.last_cycles > status.max_cycles ){
+        status.max_cycles = status.last_cycles;
+    }
+    status.setpoint = setpoint;
+    status.feedback = feedback;
+    status.output = output;
+    status.iterations++;
+}
+
+void PidLoop_Init(void){
+    PidLoop_Configure( &controller, 0, PID_LOOP_Q15_ONE );
+    controller.alpha = PID_LOOP_DERIVATIVE_ALPHA;
+    running = 0;
+    status.running = 0;
+    CycleCounter_Start();
+    // Slots 0 to 2 are the timer service, the command schedule and the app tasks.
+    (void) CySysTickSetCallback( 3u, PidLoop_SysTickCallback );
+}
+
+void PidLoop_SetInput(PidLoop_Input new_input){
+    // Only while stopped, so the SysTick never calls half of a pointer.
+    if( !running ){
+        input = new_input;
+    }
+}
+
+void PidLoop_SetGain(PidLoop_Term term, uint32 milli){
+    uint8 interrupt_state;
+    if( term >= PID_LOOP_NUM_TERMS ){
+        return;
+    }
+    interrupt_state = PrioritySection_Enter();
+    status.gain_milli[term] = milli;
+    PidLoop_ApplyGains();
+    PrioritySection_Exit(interrupt_state);
+}
+
+void PidLoop_SetSetpoint(int16 new_setpoint){
+    // One halfword, so the SysTick sees the old one or the new one, never half of each.
+    setpoint = new_setpoint;
+}
+
+int16 PidLoop_LoopbackInput(void){
+    uint16 period = ServoBank_GetPeriod( channel );
+    int32 duty = 0;
+    if( period != 0 ){
+        duty = (int32) __USAT( (int32)(((uint32) ServoBank_GetCompare( channel ) << 15) / period), 15 );
+    }
+    // A first-order lag: move a fraction of the way to where it's being driven.
+    loopback_q31 += ((duty << 16) - loopback_q31) >> PID_LOOP_LOOPBACK_SHIFT;
+    return (int16)(loopback_q31 >> 16);
+}
+
+uint8 PidLoop_Start(uint8 new_channel, uint16 rate_hz){
+    uint8 interrupt_state;
+    uint16 period;
+    uint32 duty;
+    if( input == NULL || new_channel >= SERVO_BANK_MAX_CHANNELS || rate_hz == 0 || rate_hz > PID_LOOP_MAX_HZ ){
+        return 0;
+    }
+    interrupt_state = PrioritySection_Enter();
+    // Stop any limited move first, so the duty cycle below is where the channel stays.
+    MotionLimiter_Stop( new_channel );
+    channel = new_channel;
+    ticks_per_sample = (uint16)((TIMER_SERVICE_TICK_HZ + rate_hz / 2u) / rate_hz);
+    countdown = ticks_per_sample;
+    PidLoop_ApplyGains();
+    PidLoop_Reset( &controller );
+    // Bumpless: start the I part at the duty cycle the channel has now.
+    period = ServoBank_GetPeriod( channel );
+    if( period != 0 ){
+        duty = ((uint32) ServoBank_GetCompare( channel ) << 15) / period;
+        controller.integral = (int32)(__USAT( (int32) duty, 15 ) << 16);
+    }
+    status.running = 1;
+    status.channel = channel;
+    status.rate_hz = (uint16)(TIMER_SERVICE_TICK_HZ / ticks_per_sample);
+    status.iterations = 0;
+    status.max_cycles = 0;
+    running = 1;
+    PrioritySection_Exit(interrupt_state);
+    return 1;
+}
+
+void PidLoop_Stop(void){
+    uint8 interrupt_state = PrioritySection_Enter();
+    running = 0;
+    status.running = 0;
+    PrioritySection_Exit(interrupt_state);
+}
+
+void PidLoop_GetStatus(PidLoop_Status * copy){
+    uint8 interrupt_state = PrioritySection_Enter();
+    *copy = status;
+    PrioritySection_Exit(interrupt_state);
+}
+
+/* [] END OF FILE */
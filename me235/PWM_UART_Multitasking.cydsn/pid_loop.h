@@ -0,0 +1,154 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * pid_loop.h
+ * Closed-loop control: instead of writing whatever number the PC sends, read a sensor (the "feedback"),
+ * compare it to where we want it (the "setpoint"), and set the PWM from the difference, hundreds of times a second.
+ *
+ * This is a PID controller. Each time, with error = setpoint - feedback:
+ *   P: kp * error, pushes harder the further off we are.
+ *   I: ki * (all the error so far), gets rid of an error that P alone leaves behind.
+ *   D: kd * (how fast the feedback is changing), slows things down before they overshoot.
+ *      That's the feedback's change, not the error's, so a new setpoint doesn't give the output a kick.
+ *      It's also smoothed (a low-pass filter), since a derivative makes sensor noise much bigger.
+ * "Anti-windup": while the output is stuck at its limit, the I part stops growing in that direction,
+ * so it doesn't take ages to unwind once the error changes sign.
+ *
+ * The Cortex-M3 has no floating point, so it's all fixed point:
+ *   - the feedback, setpoint and output are Q15: 32767 means 1.0 (full scale), like the int16 math in DSP books.
+ *   - the gains are Q16: 65536 means 1.0. ki and kd are per sample here (PidLoop_SetGain converts from per second).
+ *   - the I part keeps 16 extra bits, so even a small ki * error still adds up.
+ * Anything that could overflow is saturated (clamped) with the Cortex-M3's SSAT and USAT instructions,
+ * __SSAT and __USAT from core_cmInstr.h, so a big number ends up at the limit instead of wrapping around to a small one.
+ *
+ * On the PSoC, the loop runs in the SysTick, every 1 to 1000 ticks (so 1 Hz to 1 kHz).
+ * It reads the feedback with a function you give it (PidLoop_SetInput): for an ADC, that function would start
+ * a conversion and scale the result to 0 to 32767.
+ * This project's schematic doesn't have a sensor. To try the loop anyway, build with PID_LOOP_LOOPBACK set to 1:
+ * main.c then gives it PidLoop_LoopbackInput, a pretend plant (a first-order lag, driven by the channel's own
+ * duty cycle), so L, P, I, D and U all work on a bare board. Otherwise L answers Error! until you add a sensor.
+ * The output is the duty cycle of one servo bank channel, 0 to 100% of its period, committed at the next PWM frame.
+ * A faster loop needs its own hardware timer; its ISR would do the same thing as PidLoop_SysTickCallback.
+ *
+ * PidLoop_Configure, PidLoop_Reset and PidLoop_Update are just arithmetic, so they can be checked on a regular computer.
+ */
+
+#ifndef PID_LOOP_H
+#define PID_LOOP_H
+
+#include <project.h>
+
+// 1 to build with the pretend plant as the loop's input (see above).
+#ifndef PID_LOOP_LOOPBACK
+    #define PID_LOOP_LOOPBACK 0
+#endif
+// The pretend plant's time constant, as a shift: it moves 1/32 of the way to the duty cycle each sample.
+#define PID_LOOP_LOOPBACK_SHIFT 5u
+
+// 1.0 in Q15, and in Q16.
+#define PID_LOOP_Q15_ONE 32767
+#define PID_LOOP_Q16_ONE 65536
+// The fastest rate, once every SysTick.
+#define PID_LOOP_MAX_HZ 1000u
+// The loop's derivative smoothing (alpha, below): a quarter of each new derivative, which is a low-pass filter
+// with a time constant of about 3.5 samples.
+#define PID_LOOP_DERIVATIVE_ALPHA 8192
+
+typedef struct
+{
+    // Q16. ki and kd are per sample.
+    int32 kp;
+    int32 ki;
+    int32 kd;
+    // How much of each new derivative goes into the smoothed one, Q15. PID_LOOP_Q15_ONE is no smoothing.
+    int16 alpha;
+    // The output's limits, Q15.
+    int16 out_min;
+    int16 out_max;
+    // The I part, Q15 with 16 more bits (so it's Q31).
+    int32 integral;
+    // The smoothed derivative of the feedback, Q15.
+    int32 derivative;
+    int16 last_feedback;
+    // 0 until the first sample, which has nothing to take a derivative from.
+    uint8 primed;
+} PidLoop_Controller;
+
+// Which gain.
+typedef enum
+{
+    PID_LOOP_P = 0,
+    PID_LOOP_I,
+    PID_LOOP_D,
+    PID_LOOP_NUM_TERMS
+} PidLoop_Term;
+
+// The feedback, Q15 (0 to 32767 for a sensor that's never negative).
+typedef int16 (*PidLoop_Input)(void);
+
+// What the loop has been doing, for the L command.
+typedef struct
+{
+    uint8 running;
+    uint8 channel;
+    uint16 rate_hz;
+    int16 setpoint;
+    int16 feedback;
+    int16 output;
+    // The gains, as they were set (see PidLoop_SetGain).
+    uint32 gain_milli[PID_LOOP_NUM_TERMS];
+    uint32 iterations;
+    // CPU cycles for one time around the loop (feedback, PID, servo bank), and the most it's taken.
+    uint32 last_cycles;
+    uint32 max_cycles;
+} PidLoop_Status;
+
+// Sets the output limits, no gains, no smoothing, and starts over.
+void PidLoop_Configure(PidLoop_Controller * pid, int16 out_min, int16 out_max);
+
+// Forgets the I part and the derivative, for a fresh start.
+void PidLoop_Reset(PidLoop_Controller * pid);
+
+// One sample: returns the output, between out_min and out_max.
+int16 PidLoop_Update(PidLoop_Controller * pid, int16 setpoint, int16 feedback);
+
+// The loop on the PSoC.
+// Hooks the loop onto the SysTick. Call after TimerService_Init.
+void PidLoop_Init(void);
+
+// Where the feedback comes from. The loop won't start without one.
+void PidLoop_SetInput(PidLoop_Input input);
+
+// The pretend plant, for PidLoop_SetInput: each call is one sample. It lags behind the loop channel's
+// duty cycle (0 to 32767 for 0 to 100%), with a time constant of 2^PID_LOOP_LOOPBACK_SHIFT samples.
+int16 PidLoop_LoopbackInput(void);
+
+// Sets one gain, in thousandths: kp, ki per second, or kd in seconds. They're turned into per sample
+// for the rate the loop runs at, now and whenever it's started again.
+void PidLoop_SetGain(PidLoop_Term term, uint32 milli);
+
+// Where to hold the feedback, Q15.
+void PidLoop_SetSetpoint(int16 setpoint);
+
+// Starts the loop on a servo bank channel, 'rate_hz' times a second (1 to PID_LOOP_MAX_HZ).
+// The rate is rounded to a whole number of ticks. The I part starts at the channel's duty cycle as it is now,
+// so the output doesn't jump. While the loop runs it owns the channel: a speed-limited move on it is stopped
+// (see MotionLimiter_Stop), and anything else that writes it (d, presets, a script) is overwritten at the next sample.
+// Returns 0 if there's no input, or the channel or rate is wrong.
+uint8 PidLoop_Start(uint8 channel, uint16 rate_hz);
+
+// Stops the loop. The output stays where it was.
+void PidLoop_Stop(void);
+
+// Copies what the loop has been doing into 'status', all from the same sample.
+void PidLoop_GetStatus(PidLoop_Status * status);
+
+#endif //PID_LOOP_H
+
+/* [] END OF FILE */
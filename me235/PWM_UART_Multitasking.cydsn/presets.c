@@ -0,0 +1,129 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See presets.h for how the slots are used.
+#include "presets.h"
+#include <project.h>
+#include "servo_bank.h"
+// Compares go through the motion limiter, like d.
+#include "motion_limiter.h"
+// The request from the UART ISR is handed over in a priority section.
+#include "priority_section.h"
+#include "eeprom_store.h"
+// memcpy, to and from the EEPROM.
+#include <string.h>
+
+// What's saved in the EEPROM for each slot.
+typedef struct
+{
+    uint16 magic;
+    // EepromStore_Checksum of the pose
+    uint16 checksum;
+    Presets_Pose pose;
+} Presets_Record;
+
+#define PRESETS_MAGIC 0x5053u
+
+// If this line doesn't compile, the slots don't fit in the EEPROM's part for them (see eeprom_store.h).
+typedef char presets_fit_in_eeprom[(sizeof(Presets_Record) <= EEPROM_STORE_PRESET_SIZE
+    && PRESETS_MAX_SLOTS * EEPROM_STORE_PRESET_SIZE <= EEPROM_STORE_PRESETS_SIZE) ? 1 : -1];
+
+static Presets_Pose poses[PRESETS_MAX_SLOTS];
+// Bit n is 1 if slot n has a pose in it.
+static uint32 stored = 0;
+// The slot the UART ISR asked for, + 1. 0 for none.
+static volatile uint8 requested = 0;
+
+static uint16 Presets_Address(uint8 slot){
+    return (uint16)(EEPROM_STORE_PRESETS_ADDRESS + slot * EEPROM_STORE_PRESET_SIZE);
+}
+
+void Presets_Init(void){
+    Presets_Record record;
+    uint8 slot;
+    stored = 0;
+    requested = 0;
+    for( slot = 0; slot < PRESETS_MAX_SLOTS; slot++){
+        memcpy( &record, EepromStore_Get( Presets_Address( slot ) ), sizeof(record) );
+        if( record.magic == PRESETS_MAGIC && EepromStore_Checksum( &record.pose, sizeof(record.pose) ) == record.checksum ){
+            poses[slot] = record.pose;
+            stored |= (1uL << slot);
+        }
+    }
+}
+
+uint8 Presets_Store(uint8 slot){
+    uint8 channel;
+    if( slot >= PRESETS_MAX_SLOTS ){
+        return 0;
+    }
+    for( channel = 0; channel < SERVO_BANK_MAX_CHANNELS; channel++){
+        poses[slot].period[channel] = ServoBank_GetPeriod( channel );
+        poses[slot].compare[channel] = ServoBank_GetCompare( channel );
+    }
+    stored |= (1uL << slot);
+    return 1;
+}
+
+uint8 Presets_Save(uint8 slot){
+    Presets_Record record;
+    if( !Presets_IsStored( slot ) ){
+        return 0;
+    }
+    record.magic = PRESETS_MAGIC;
+    record.pose = poses[slot];
+    record.checksum = EepromStore_Checksum( &record.pose, sizeof(record.pose) );
+    return EepromStore_Write( Presets_Address( slot ), &record, sizeof(record) );
+}
+
+uint8 Presets_IsStored(uint8 slot){
+    return (slot < PRESETS_MAX_SLOTS && (stored & (1uL << slot)) != 0) ? 1 : 0;
+}
+
+const Presets_Pose * Presets_Get(uint8 slot){
+    return Presets_IsStored( slot ) ? &poses[slot] : NULL;
+}
+
+uint8 Presets_Recall(uint8 slot){
+    const Presets_Pose * pose = Presets_Get( slot );
+    uint8 channel;
+    if( pose == NULL ){
+        return 0;
+    }
+    // The period first, since the bank clamps the compare to it.
+    // Nothing is committed until the PWM task's ServoBank_CommitAtFrame, which runs after this.
+    for( channel = 0; channel < SERVO_BANK_MAX_CHANNELS; channel++){
+        (void) ServoBank_SetPeriod( channel, pose->period[channel] );
+        (void) MotionLimiter_SetTarget( channel, pose->compare[channel] );
+    }
+    return 1;
+}
+
+void Presets_Request(uint8 slot){
+    // If two come in before the PWM task runs, the last one wins.
+    requested = slot + 1u;
+}
+
+uint8 Presets_ApplyRequest(void){
+    uint8 interrupt_state;
+    uint8 slot;
+    if( requested == 0 ){
+        return 0;
+    }
+    // Take it and clear it without the UART ISR getting in between.
+    interrupt_state = PrioritySection_Enter();
+    slot = requested;
+    requested = 0;
+    PrioritySection_Exit(interrupt_state);
+    if( slot == 0 || !Presets_Recall( slot - 1u ) ){
+        return 0;
+    }
+    return slot;
+}
+
+/* [] END OF FILE */
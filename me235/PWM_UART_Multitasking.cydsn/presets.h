@@ -0,0 +1,72 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * presets.h
+ * Poses you use over and over, saved in slots, so switching to one is a single byte instead of
+ * a p and a d line for every servo.
+ *
+ * "S : 2" stores every servo bank channel's period and compare value, as they are now, in slot 2.
+ * Then sending the single byte PRESETS_RECALL_BYTE + 2 (0x82) puts them all back. That byte isn't a character
+ * you can type, so it's meant for a program on the PC; from a terminal, "R : 2" does the same thing.
+ * "K : 2" also saves slot 2 in the EEPROM (eeprom_store.h), and the saved slots come back at startup.
+ *
+ * The recall byte is handled right in the UART ISR, which just notes the slot and signals the PWM task.
+ * The PWM task writes the whole pose into the servo bank in one go, and the bank commits it at the start
+ * of the next PWM frame, so the servos all change in the same frame, never half way.
+ * Compares go through the motion limiter like d does, so a servo with a speed limit (v, a) still moves at that speed.
+ *
+ * This only uses the servo bank, the motion limiter and eeprom_store, so with those on a regular computer
+ * (and an EEPROM in memory), it can be checked there too.
+ */
+
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include <project.h>
+#include "servo_bank.h"
+
+#define PRESETS_MAX_SLOTS 8u
+// Bytes PRESETS_RECALL_BYTE to PRESETS_RECALL_BYTE + PRESETS_MAX_SLOTS - 1 recall slots 0 and up.
+#define PRESETS_RECALL_BYTE 0x80u
+
+typedef struct
+{
+    uint16 period[SERVO_BANK_MAX_CHANNELS];
+    uint16 compare[SERVO_BANK_MAX_CHANNELS];
+} Presets_Pose;
+
+// Forgets all the slots, then loads the ones saved in the EEPROM. Call after EepromStore_Init and ServoBank_Init.
+void Presets_Init(void);
+
+// Stores the servo bank's pose in a slot. Returns 0 if there's no such slot.
+uint8 Presets_Store(uint8 slot);
+
+// Saves a stored slot in the EEPROM. Returns 0 if it's empty, or the EEPROM didn't take it.
+uint8 Presets_Save(uint8 slot);
+
+// 1 if the slot has a pose in it.
+uint8 Presets_IsStored(uint8 slot);
+
+// The pose in a slot, or NULL if it's empty.
+const Presets_Pose * Presets_Get(uint8 slot);
+
+// Writes a slot's pose into the servo bank. It's committed at the next PWM frame.
+// Returns 0 if the slot is empty.
+uint8 Presets_Recall(uint8 slot);
+
+// From the UART ISR: recall this slot from the PWM task, as soon as it runs.
+void Presets_Request(uint8 slot);
+
+// From the PWM task: recalls the slot Presets_Request asked for, if any.
+// Returns the slot + 1, or 0 if there wasn't one (or it was empty).
+uint8 Presets_ApplyRequest(void);
+
+#endif //PRESETS_H
+
+/* [] END OF FILE */
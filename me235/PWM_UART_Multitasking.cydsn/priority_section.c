@@ -0,0 +1,72 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See priority_section.h for how this works.
+#include "priority_section.h"
+#include <project.h>
+// The DWT cycle counter, to time the sections.
+#include "cycle_counter.h"
+
+uint8 PrioritySection_Raise(uint8 current, uint8 ceiling){
+    // A smaller BASEPRI masks more, except for 0, which masks nothing.
+    if( current != 0 && current <= ceiling ){
+        return current;
+    }
+    return ceiling;
+}
+
+void PrioritySection_NoteEnter(PrioritySection_Stats * stats, uint8 previous, uint32 now_cycles){
+    if( previous == 0 ){
+        stats->opened_at = now_cycles;
+    }
+}
+
+void PrioritySection_NoteExit(PrioritySection_Stats * stats, uint8 previous, uint32 now_cycles){
+    uint32 cycles;
+    if( previous != 0 ){
+        // Still inside an outer section.
+        return;
+    }
+    cycles = now_cycles - stats->opened_at;
+    stats->last_cycles = cycles;
+    if( cycles > stats->longest_cycles ){
+        stats->longest_cycles = cycles;
+    }
+    stats->windows++;
+}
+
+static PrioritySection_Stats stats;
+
+void PrioritySection_Init(void){
+    #if PRIORITY_SECTION_MEASURE
+        CycleCounter_Start();
+    #endif
+}
+
+uint8 PrioritySection_Enter(void){
+    uint8 previous = (uint8) __get_BASEPRI();
+    __set_BASEPRI(PrioritySection_Raise(previous, PRIORITY_SECTION_BASEPRI(PRIORITY_SECTION_CEILING)));
+    // Nothing that could touch stats can come in now, so this is safe.
+    #if PRIORITY_SECTION_MEASURE
+        PrioritySection_NoteEnter(&stats, previous, CycleCounter_Now());
+    #endif
+    return previous;
+}
+
+void PrioritySection_Exit(uint8 previous){
+    #if PRIORITY_SECTION_MEASURE
+        PrioritySection_NoteExit(&stats, previous, CycleCounter_Now());
+    #endif
+    __set_BASEPRI(previous);
+}
+
+const PrioritySection_Stats * PrioritySection_GetStats(void){
+    return &stats;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,85 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * priority_section.h
+ * Critical sections that only hold off the interrupts that need holding off.
+ *
+ * CyEnterCriticalSection sets PRIMASK, which turns off EVERY interrupt. But the data our sections
+ * protect is only shared with a few ISRs (the UART receive and the SysTick), and those are low priority.
+ * The Cortex-M3 has a register just for this, BASEPRI: while it's not 0, any interrupt with
+ * that priority or lower (a bigger number) waits, and anything more urgent still runs.
+ * So PrioritySection_Enter raises BASEPRI to PRIORITY_SECTION_CEILING, and a time-critical ISR
+ * above the ceiling never waits for the main loop.
+ *
+ * The rule that goes with it: an ISR with a priority above the ceiling (smaller number) must NOT touch
+ * anything protected by a priority section, and must not use one itself. Anything that does
+ * has to sit at the ceiling or below.
+ *
+ * Priorities: 3 bits on the PSoC 5LP (__NVIC_PRIO_BITS), so 0 (most urgent) to 7, and BASEPRI holds
+ * the priority in its top 3 bits. BASEPRI = 0 means "nothing masked", so priority 0 can't be a ceiling:
+ * the ceiling has to be 1 to 7. The SysTick starts out at priority 0, so the interrupt plan (interrupt_plan.h)
+ * moves it down to the ceiling, where a section can hold it off.
+ *
+ * Sections nest: Enter only ever raises BASEPRI, and returns what it was, for Exit to put back.
+ * With PRIORITY_SECTION_MEASURE on, the outermost section of each nest is timed with the DWT cycle counter
+ * (cycle_counter.h), and the longest one is kept: that's the longest the UART or the SysTick could have had to wait.
+ *
+ * PrioritySection_Raise and the PrioritySection_Note functions are just bookkeeping, so they can be checked on a regular computer.
+ */
+
+#ifndef PRIORITY_SECTION_H
+#define PRIORITY_SECTION_H
+
+#include <project.h>
+
+// The most urgent priority of any ISR that shares data with a priority section. 1 to 7.
+// The UART receive is at 7, and the SysTick at this one (see interrupt_plan.c).
+#ifndef PRIORITY_SECTION_CEILING
+    #define PRIORITY_SECTION_CEILING 6u
+#endif
+// 1 to time the sections. It's two reads of the cycle counter per section.
+#ifndef PRIORITY_SECTION_MEASURE
+    #define PRIORITY_SECTION_MEASURE 1u
+#endif
+
+// The BASEPRI value that masks 'priority' and everything below it.
+#define PRIORITY_SECTION_BASEPRI(priority) ((uint8)((priority) << (8u - __NVIC_PRIO_BITS)))
+
+typedef struct
+{
+    // When the outermost section started, in CPU cycles.
+    uint32 opened_at;
+    // The longest and the latest section, in CPU cycles.
+    uint32 longest_cycles;
+    uint32 last_cycles;
+    // How many (outermost) sections there have been.
+    uint32 windows;
+} PrioritySection_Stats;
+
+// The BASEPRI to go to from 'current' to mask at least 'ceiling' (both BASEPRI values).
+// It never lowers it: if more is masked already, that stays.
+uint8 PrioritySection_Raise(uint8 current, uint8 ceiling);
+
+// Bookkeeping for the timing. 'previous' is the BASEPRI from before the section, so 0 means it's the outermost one.
+void PrioritySection_NoteEnter(PrioritySection_Stats * stats, uint8 previous, uint32 now_cycles);
+void PrioritySection_NoteExit(PrioritySection_Stats * stats, uint8 previous, uint32 now_cycles);
+
+// Starts the cycle counter, for the timing.
+void PrioritySection_Init(void);
+
+// Holds off the interrupts at the ceiling and below. Returns what to pass to PrioritySection_Exit.
+uint8 PrioritySection_Enter(void);
+
+void PrioritySection_Exit(uint8 previous);
+
+const PrioritySection_Stats * PrioritySection_GetStats(void);
+
+#endif //PRIORITY_SECTION_H
+
+/* [] END OF FILE */
@@ -0,0 +1,132 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See pwm_frequency.h for how this works.
+#include "pwm_frequency.h"
+#include <project.h>
+// For handing a new frequency over to the next frame.
+#include "priority_section.h"
+// The governor owns Clock_PWM's divider, since it scales it for each clock speed.
+#include "clock_governor.h"
+// Channel 0 of the bank is PWM_Servo, and has to know about the new period and compare.
+#include "servo_bank.h"
+
+// If the main loop gets to a frame too late (the pulse already started), it's allowed to
+// wait this long for the next tc, with interrupts off. Longer than that, it waits a frame instead.
+#define PWM_FREQUENCY_MAX_SPIN_US 100u
+
+// The change waiting for the next frame. Written by the UART line task, read by the PWM task.
+static PwmFrequency_Solution pending_solution;
+static volatile uint8 pending = 0;
+
+uint8 PwmFrequency_Solve(uint32 full_hz, uint32 hz, PwmFrequency_Solution * solution){
+    uint32 frame_clocks;
+    uint32 total;
+    uint32 counts;
+    if( hz == 0 ){
+        return 0;
+    }
+    // Bus clocks in one frame, rounded. Each PWM tick is 'total' of these.
+    frame_clocks = (full_hz + hz / 2u) / hz;
+    if( frame_clocks < 2u ){
+        return 0;
+    }
+    // The smallest division that fits: ceil(frame_clocks / 65536). Rounding the counts
+    // below can still push it over by one, so then try the next divider up.
+    total = (frame_clocks + PWM_FREQUENCY_MAX_COUNTS - 1u) / PWM_FREQUENCY_MAX_COUNTS;
+    for(;;){
+        counts = (frame_clocks + total / 2u) / total;
+        if( counts <= PWM_FREQUENCY_MAX_COUNTS ){
+            break;
+        }
+        total++;
+    }
+    if( total > PWM_FREQUENCY_MAX_DIVISION || counts < 2u ){
+        return 0;
+    }
+    solution->divider = (uint16)(total - 1u);
+    solution->period = (uint16)(counts - 1u);
+    solution->actual_millihz = ((uint64) full_hz * 1000u + (uint64) total * counts / 2u) / ((uint64) total * counts);
+    return 1;
+}
+
+uint16 PwmFrequency_RescaleCompare(uint16 compare, uint16 old_divider, uint16 new_divider, uint16 new_period){
+    // Pulse width in bus clocks stays the same: compare * (divider + 1).
+    uint32 new_total = (uint32) new_divider + 1u;
+    uint32 width_clocks = (uint32) compare * ((uint32) old_divider + 1u);
+    uint32 rescaled = (width_clocks + new_total / 2u) / new_total;
+    return (rescaled > new_period) ? new_period : (uint16) rescaled;
+}
+
+uint8 PwmFrequency_Request(uint32 hz, PwmFrequency_Solution * solution){
+    uint8 interrupt_state;
+    if( !PwmFrequency_Solve(BCLK__BUS_CLK__HZ, hz, solution) ){
+        return 0;
+    }
+    interrupt_state = PrioritySection_Enter();
+    pending_solution = *solution;
+    pending = 1;
+    PrioritySection_Exit(interrupt_state);
+    return 1;
+}
+
+uint8 PwmFrequency_ApplyAtFrame(uint8 new_frame){
+    uint8 interrupt_state;
+    uint8 running;
+    uint16 compare;
+    PwmFrequency_Solution solution;
+    if( !pending ){
+        return 0;
+    }
+    running = ((PWM_Servo_ReadControlRegister() & PWM_Servo_CTRL_ENABLE) != 0) ? 1 : 0;
+    if( running && !new_frame ){
+        return 0;
+    }
+
+    interrupt_state = CyEnterCriticalSection();
+    if( running ){
+        // The output is low while the counter is at or above the compare. If we're already
+        // past that (a short frame, or the main loop was slow), the pulse is going out right now.
+        uint16 old_compare = PWM_Servo_ReadCompare();
+        uint16 counter = PWM_Servo_ReadCounter();
+        if( counter < old_compare ){
+            // Bus clocks until tc: counter ticks of (divider + 1) each.
+            uint32 clocks_left = (uint32) counter * ((uint32) Clock_PWM_GetDividerRegister() + 1u);
+            if( clocks_left > PWM_FREQUENCY_MAX_SPIN_US * (ClockGovernor_GetBusHz() / 1000000u) ){
+                // Too long to wait here: try again next frame.
+                CyExitCriticalSection(interrupt_state);
+                return 0;
+            }
+            // Short enough: wait for tc (the counter reloads, so it jumps up).
+            for(;;){
+                uint16 now = PWM_Servo_ReadCounter();
+                if( now > counter ){
+                    break;
+                }
+                counter = now;
+            }
+        }
+    }
+    solution = pending_solution;
+    pending = 0;
+    // Rescale the bank's value, which is the newest one (it may not be committed yet).
+    compare = PwmFrequency_RescaleCompare(ServoBank_GetCompare(0), ClockGovernor_GetPwmBaseDivider(),
+        solution.divider, solution.period);
+    ClockGovernor_SetPwmBaseDivider(solution.divider);
+    PWM_Servo_WritePeriod(solution.period);
+    PWM_Servo_WriteCompare(compare);
+    if( running ){
+        // Start this frame over with the new period, instead of finishing the old one at the new tick rate.
+        PWM_Servo_WriteCounter(solution.period);
+    }
+    ServoBank_Adopt(0, solution.period, compare);
+    CyExitCriticalSection(interrupt_state);
+    return 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,68 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * pwm_frequency.h
+ * Sets the PWM frequency by picking the Clock_PWM divider too, instead of only the period.
+ *
+ * Why? The PWM counter is 16 bits, so a frame can be at most 65536 ticks. With the fitter's
+ * fixed 100 kHz Clock_PWM, a 50 Hz servo frame is only 2000 ticks (so only 2000 possible duty cycles),
+ * and anything under 2 Hz doesn't fit at all. The fastest tick that still fits the frame into 16 bits
+ * gives the most duty cycle steps: that's the smallest divider that works, which is what PwmFrequency_Solve finds.
+ *
+ * Changing the tick size changes what the compare value means, so the compare gets rescaled to keep
+ * the same pulse width in microseconds.
+ *
+ * "Glitch-free": the change is applied by the main loop right after the PWM's terminal count.
+ * The counter counts down and the output is high at the end of the frame (counter below compare), so right
+ * after tc the output is low. The new divider, period, and compare go in then, and the counter is
+ * restarted from the new period, so the next pulse is the first one with the new settings, and there are no
+ * half-length pulses in between.
+ *
+ * PwmFrequency_Solve and PwmFrequency_RescaleCompare are just arithmetic, so they can be checked on a regular computer.
+ */
+
+#ifndef PWM_FREQUENCY_H
+#define PWM_FREQUENCY_H
+
+#include <project.h>
+
+// The biggest total division for Clock_PWM (register value 0xFFFF + 1) and PWM counts per frame.
+#define PWM_FREQUENCY_MAX_DIVISION 65536uL
+#define PWM_FREQUENCY_MAX_COUNTS 65536uL
+
+typedef struct
+{
+    // Clock_PWM divider register value (divide by divider + 1), at full speed
+    uint16 divider;
+    // PWM period register value (period + 1 ticks per frame)
+    uint16 period;
+    // the frequency we actually get, in thousandths of a Hz. 64 bits: anything over 4.29 MHz doesn't fit in 32.
+    uint64 actual_millihz;
+} PwmFrequency_Solution;
+
+// Finds the smallest divider that fits a frame of 'hz' into 16 bits, and the period to go with it.
+// full_hz is the bus clock at full speed. Returns 0 if hz can't be done (0, or a frame that rounds to under 2 bus clocks,
+// which is anything over 2/3 of full_hz: between full_hz / 2 and that, it rounds to full_hz / 2).
+uint8 PwmFrequency_Solve(uint32 full_hz, uint32 hz, PwmFrequency_Solution * solution);
+
+// The compare value that gives the same pulse width after the divider changes from
+// old_divider to new_divider (register values). Never more than new_period.
+uint16 PwmFrequency_RescaleCompare(uint16 compare, uint16 old_divider, uint16 new_divider, uint16 new_period);
+
+// Works out the settings for 'hz' and queues them up for the next frame. Safe to call from the UART ISR.
+// Returns 0 (and queues nothing) if the frequency can't be done.
+uint8 PwmFrequency_Request(uint32 hz, PwmFrequency_Solution * solution);
+
+// Call from the main loop with ServoBank_PollFrame's result. Applies a queued change at the start of a frame
+// (or right away if the PWM is stopped). Returns 1 if it applied one.
+uint8 PwmFrequency_ApplyAtFrame(uint8 new_frame);
+
+#endif //PWM_FREQUENCY_H
+
+/* [] END OF FILE */
@@ -0,0 +1,183 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See servo_bank.h for the big picture.
+#include "servo_bank.h"
+#include <project.h>
+// The dirty mask is shared with the SysTick's scheduled commands.
+#include "priority_section.h"
+
+// The settings, one array per field (see servo_bank.h).
+static uint16 period[SERVO_BANK_MAX_CHANNELS];
+static uint16 compare[SERVO_BANK_MAX_CHANNELS];
+static uint16 min_compare[SERVO_BANK_MAX_CHANNELS];
+static uint16 max_compare[SERVO_BANK_MAX_CHANNELS];
+// Where each channel goes. NULL = nowhere yet.
+static const ServoBank_Output * outputs[SERVO_BANK_MAX_CHANNELS];
+
+// Bit N = channel N changed since the last commit. The UART line task and the SysTick set bits, the PWM task clears them.
+static volatile uint32 dirty = 0;
+
+// Channel 0: the PWM block in the schematic.
+static const ServoBank_Output pwm_servo_output = { PWM_Servo_WritePeriod, PWM_Servo_WriteCompare };
+
+/**
+ * Keeps the compare inside the channel's limits, and no bigger than the period
+ * (past the period, the output would just stay high).
+ */
+static uint16 ServoBank_Clamp(uint8 channel, uint16 value){
+    uint16 upper = max_compare[channel];
+    if( upper > period[channel] ){
+        upper = period[channel];
+    }
+    if( value > upper ){
+        value = upper;
+    }
+    if( value < min_compare[channel] ){
+        value = min_compare[channel];
+    }
+    return value;
+}
+
+static void ServoBank_MarkDirty(uint8 channel){
+    uint8 interrupt_state = PrioritySection_Enter();
+    dirty |= (1uL << channel);
+    PrioritySection_Exit(interrupt_state);
+}
+
+void ServoBank_Init(void){
+    uint8 i;
+    for( i = 0; i < SERVO_BANK_MAX_CHANNELS; i++){
+        period[i] = 0xFFFFu;
+        compare[i] = 0;
+        min_compare[i] = 0;
+        max_compare[i] = 0xFFFFu;
+        outputs[i] = NULL;
+    }
+    // Channel 0 starts out with whatever the PWM has now (the schematic's values, or a warm restart's).
+    period[0] = PWM_Servo_ReadPeriod();
+    compare[0] = PWM_Servo_ReadCompare();
+    outputs[0] = &pwm_servo_output;
+    // Nothing to write: the hardware already matches.
+    dirty = 0;
+}
+
+void ServoBank_AttachOutput(uint8 channel, const ServoBank_Output * output){
+    if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        return;
+    }
+    outputs[channel] = output;
+    ServoBank_MarkDirty(channel);
+}
+
+uint16 ServoBank_SetPeriod(uint8 channel, uint16 new_period){
+    if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        return 0;
+    }
+    period[channel] = new_period;
+    // A shorter period may push the compare out of range.
+    compare[channel] = ServoBank_Clamp(channel, compare[channel]);
+    ServoBank_MarkDirty(channel);
+    return period[channel];
+}
+
+uint16 ServoBank_SetCompare(uint8 channel, uint16 new_compare){
+    if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        return 0;
+    }
+    compare[channel] = ServoBank_Clamp(channel, new_compare);
+    ServoBank_MarkDirty(channel);
+    return compare[channel];
+}
+
+uint16 ServoBank_ClampCompare(uint8 channel, uint16 value){
+    return (channel < SERVO_BANK_MAX_CHANNELS) ? ServoBank_Clamp(channel, value) : 0;
+}
+
+void ServoBank_SetLimits(uint8 channel, uint16 min_value, uint16 max_value){
+    if( channel >= SERVO_BANK_MAX_CHANNELS || min_value > max_value ){
+        return;
+    }
+    min_compare[channel] = min_value;
+    max_compare[channel] = max_value;
+    (void) ServoBank_SetCompare(channel, compare[channel]);
+}
+
+void ServoBank_Adopt(uint8 channel, uint16 new_period, uint16 new_compare){
+    uint8 interrupt_state;
+    if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        return;
+    }
+    interrupt_state = PrioritySection_Enter();
+    period[channel] = new_period;
+    compare[channel] = new_compare;
+    dirty &= ~(1uL << channel);
+    PrioritySection_Exit(interrupt_state);
+}
+
+uint16 ServoBank_GetPeriod(uint8 channel){
+    return (channel < SERVO_BANK_MAX_CHANNELS) ? period[channel] : 0;
+}
+
+uint16 ServoBank_GetCompare(uint8 channel){
+    return (channel < SERVO_BANK_MAX_CHANNELS) ? compare[channel] : 0;
+}
+
+uint32 ServoBank_DirtyMask(void){
+    return dirty;
+}
+
+uint32 ServoBank_Commit(void){
+    uint32 pending;
+    uint32 written = 0;
+    // Take the whole mask at once. A channel changed by the SysTick during the loop below
+    // gets its bit set again, and goes out with the next commit.
+    uint8 interrupt_state = PrioritySection_Enter();
+    pending = dirty;
+    dirty = 0;
+    PrioritySection_Exit(interrupt_state);
+
+    while( pending != 0 ){
+        // (pending & -pending) keeps only the lowest set bit, and CLZ tells us where it is.
+        // One instruction each, no matter how many channels there are.
+        uint8 channel = (uint8)(31u - __CLZ(pending & (0u - pending)));
+        pending &= pending - 1u;
+        if( outputs[channel] == NULL ){
+            continue;
+        }
+        // Period first, so the compare is never written bigger than the period it goes with.
+        if( outputs[channel]->write_period != NULL ){
+            outputs[channel]->write_period( period[channel] );
+        }
+        if( outputs[channel]->write_compare != NULL ){
+            outputs[channel]->write_compare( compare[channel] );
+        }
+        written |= (1uL << channel);
+    }
+    return written;
+}
+
+uint8 ServoBank_PollFrame(void){
+    // The TC bit is sticky: it stays set until the status register is read, and reading clears it.
+    // Polled every pass of the main loop, a set bit means a frame started since the last pass.
+    return ((PWM_Servo_ReadStatusRegister() & PWM_Servo_STATUS_TC) != 0) ? 1 : 0;
+}
+
+uint32 ServoBank_CommitAtFrame(uint8 new_frame){
+    if( dirty == 0 ){
+        return 0;
+    }
+    // While it's running, wait for the terminal count, so the new values go in at
+    // the start of a frame and no servo sees a pulse made of half old, half new settings.
+    if( !new_frame && (PWM_Servo_ReadControlRegister() & PWM_Servo_CTRL_ENABLE) != 0 ){
+        return 0;
+    }
+    return ServoBank_Commit();
+}
+
+/* [] END OF FILE */
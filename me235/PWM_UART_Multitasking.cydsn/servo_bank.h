@@ -0,0 +1,83 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * servo_bank.h
+ * Keeps the settings for many servo channels (period, compare, and limits on the compare),
+ * and writes the ones that changed out to their PWM blocks once per PWM frame.
+ *
+ * "Structure of arrays": instead of an array of structs (one struct per servo), there's one
+ * array per setting (all the periods next to each other, all the compares next to each other...).
+ * The commit loop only walks the compare and period arrays, so it touches less memory.
+ *
+ * Each channel that gets a new setting is marked in a "dirty" bitmask (bit N = channel N).
+ * ServoBank_Commit only visits the set bits, using the CLZ (count leading zeros) instruction
+ * to jump straight to each one. So a frame where one servo changed costs the same with 32 channels as with 1.
+ *
+ * Channel 0 is the PWM_Servo block on the schematic. The other channels keep their settings
+ * but only go anywhere once an output is attached with ServoBank_AttachOutput
+ * (another PWM block, or the port-based software PWM).
+ */
+
+#ifndef SERVO_BANK_H
+#define SERVO_BANK_H
+
+#include <project.h>
+
+// At most 32, since the dirty mask is a uint32.
+#define SERVO_BANK_MAX_CHANNELS 32u
+
+// How a channel's settings get to the hardware. Either function can be NULL.
+typedef struct
+{
+    void (*write_period)(uint16 period);
+    void (*write_compare)(uint16 compare);
+} ServoBank_Output;
+
+// Reads channel 0 back from PWM_Servo (so a warm restart carries over) and attaches it.
+// Call after the PWM is started.
+void ServoBank_Init(void);
+
+// Connects a channel to its hardware. Marks it dirty so it gets the current settings.
+void ServoBank_AttachOutput(uint8 channel, const ServoBank_Output * output);
+
+// Sets the period/compare for a channel. It's clamped to the limits and written at the next commit.
+// Returns the value that will actually be written, or 0 if the channel doesn't exist.
+uint16 ServoBank_SetPeriod(uint8 channel, uint16 period);
+uint16 ServoBank_SetCompare(uint8 channel, uint16 compare);
+
+// What ServoBank_SetCompare would turn 'compare' into, without setting anything.
+uint16 ServoBank_ClampCompare(uint8 channel, uint16 compare);
+
+// The allowed range for the compare value. Re-clamps the current compare.
+void ServoBank_SetLimits(uint8 channel, uint16 min_compare, uint16 max_compare);
+
+// For code that wrote the hardware itself (see pwm_frequency.c): records the values it wrote,
+// and drops any change that was waiting for this channel.
+void ServoBank_Adopt(uint8 channel, uint16 period, uint16 compare);
+
+uint16 ServoBank_GetPeriod(uint8 channel);
+uint16 ServoBank_GetCompare(uint8 channel);
+
+// Bit N set = channel N has changes waiting.
+uint32 ServoBank_DirtyMask(void);
+
+// Writes every dirty channel out to its output, in one pass. Returns the mask of channels written.
+uint32 ServoBank_Commit(void);
+
+// Call once per pass of the main loop. Returns 1 if PWM_Servo hit its terminal count
+// (the start of a new frame) since the last call.
+uint8 ServoBank_PollFrame(void);
+
+// Call from the main loop with what ServoBank_PollFrame said. Commits right after a new frame
+// starts, or right away if the PWM is stopped. Returns the mask of channels written.
+uint32 ServoBank_CommitAtFrame(uint8 new_frame);
+
+#endif //SERVO_BANK_H
+
+/* [] END OF FILE */
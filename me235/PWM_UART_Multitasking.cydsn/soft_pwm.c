@@ -0,0 +1,234 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See soft_pwm.h for how this works.
+#include "soft_pwm.h"
+#include <project.h>
+
+static SoftPwm_EdgeTable table;
+// What the DMA writes to the port, one byte per slot. The extra byte at the end is always 0:
+// the second TD writes it over and over for the rest of the frame. Both TDs read from this
+// array, and a DMA channel only has one upper-16-bits source address, so they must share it.
+static uint8 window[SOFT_PWM_WINDOW_SLOTS + 1u];
+static uint8 running = 0;
+
+static uint16 SoftPwm_ClampWidth(uint16 width){
+    return (width > SOFT_PWM_WINDOW_SLOTS) ? SOFT_PWM_WINDOW_SLOTS : width;
+}
+
+/**
+ * Re-computes port_after for edges 'first' and up. Each edge's value is the one before
+ * it, minus the pins that fall there.
+ */
+static void SoftPwm_RecomputePort(SoftPwm_EdgeTable * t, uint8 first){
+    uint8 port = (first == 0) ? t->high_mask : t->edges[first - 1u].port_after;
+    uint8 i;
+    for( i = first; i < t->num_edges; i++){
+        port &= (uint8) ~t->edges[i].falling_mask;
+        t->edges[i].port_after = port;
+    }
+}
+
+/**
+ * Finds where an edge at 'slot' is or would go: the first edge at or after it.
+ */
+static uint8 SoftPwm_FindSlot(const SoftPwm_EdgeTable * t, uint16 slot){
+    uint8 i = 0;
+    while( i < t->num_edges && t->edges[i].slot < slot ){
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Adds 'channel' to the falling edge at 'slot', making a new edge if there isn't one.
+ * Returns the edge's index. Doesn't fix up port_after.
+ */
+static uint8 SoftPwm_InsertEdge(SoftPwm_EdgeTable * t, uint8 channel, uint16 slot){
+    uint8 i = SoftPwm_FindSlot(t, slot);
+    uint8 j;
+    if( i < t->num_edges && t->edges[i].slot == slot ){
+        t->edges[i].falling_mask |= (uint8)(1u << channel);
+        return i;
+    }
+    // Shift the later edges over by one, like one step of insertion sort.
+    for( j = t->num_edges; j > i; j--){
+        t->edges[j] = t->edges[j - 1u];
+    }
+    t->edges[i].slot = slot;
+    t->edges[i].falling_mask = (uint8)(1u << channel);
+    t->num_edges++;
+    return i;
+}
+
+/**
+ * Takes 'channel' out of the falling edge at 'slot', dropping the edge if nobody else falls there.
+ * Returns the index it was at. Doesn't fix up port_after.
+ */
+static uint8 SoftPwm_RemoveEdge(SoftPwm_EdgeTable * t, uint8 channel, uint16 slot){
+    uint8 i = SoftPwm_FindSlot(t, slot);
+    uint8 j;
+    if( i >= t->num_edges || t->edges[i].slot != slot ){
+        return i;
+    }
+    t->edges[i].falling_mask &= (uint8) ~(1u << channel);
+    if( t->edges[i].falling_mask == 0 ){
+        for( j = i; j + 1u < t->num_edges; j++){
+            t->edges[j] = t->edges[j + 1u];
+        }
+        t->num_edges--;
+    }
+    return i;
+}
+
+void SoftPwm_BuildEdges(SoftPwm_EdgeTable * t, const uint16 * widths){
+    uint8 c;
+    t->num_edges = 0;
+    t->high_mask = 0;
+    for( c = 0; c < SOFT_PWM_CHANNELS; c++){
+        t->width[c] = SoftPwm_ClampWidth(widths[c]);
+        if( t->width[c] != 0 ){
+            t->high_mask |= (uint8)(1u << c);
+            (void) SoftPwm_InsertEdge(t, c, t->width[c]);
+        }
+    }
+    SoftPwm_RecomputePort(t, 0);
+}
+
+uint8 SoftPwm_UpdateEdge(SoftPwm_EdgeTable * t, uint8 channel, uint16 width){
+    uint8 first = 0xFFu;
+    uint8 was_on;
+    uint8 i;
+    width = SoftPwm_ClampWidth(width);
+    if( channel >= SOFT_PWM_CHANNELS || width == t->width[channel] ){
+        return t->num_edges;
+    }
+    was_on = (t->width[channel] != 0) ? 1 : 0;
+    if( was_on ){
+        first = SoftPwm_RemoveEdge(t, channel, t->width[channel]);
+    }
+    if( width != 0 ){
+        i = SoftPwm_InsertEdge(t, channel, width);
+        if( i < first ){
+            first = i;
+        }
+        t->high_mask |= (uint8)(1u << channel);
+    }
+    else {
+        // 0 means off: the pin doesn't go high at all.
+        t->high_mask &= (uint8) ~(1u << channel);
+    }
+    t->width[channel] = width;
+    // Turning on or off changes high_mask, which every edge depends on.
+    if( !was_on || width == 0 ){
+        first = 0;
+    }
+    SoftPwm_RecomputePort(t, first);
+    return first;
+}
+
+void SoftPwm_RenderWindow(const SoftPwm_EdgeTable * t, uint8 * out, uint16 from, uint16 to){
+    uint8 port = t->high_mask;
+    uint8 e = 0;
+    uint16 s;
+    for( s = from; s < to; s++){
+        // The edge at slot N means the pin is low starting at slot N.
+        // On the first pass, this also skips ahead to the port value in effect at 'from'.
+        while( e < t->num_edges && t->edges[e].slot <= s ){
+            port = t->edges[e].port_after;
+            e++;
+        }
+        out[s] = port;
+    }
+}
+
+#if SOFT_PWM_HARDWARE
+    static uint8 dma_channel = CY_DMA_INVALID_CHANNEL;
+    static uint8 td_window = CY_DMA_INVALID_TD;
+    static uint8 td_rest = CY_DMA_INVALID_TD;
+#endif
+
+uint8 SoftPwm_Start(void){
+    uint16 widths[SOFT_PWM_CHANNELS] = {0};
+    SoftPwm_BuildEdges(&table, widths);
+    SoftPwm_RenderWindow(&table, window, 0, SOFT_PWM_WINDOW_SLOTS);
+    window[SOFT_PWM_WINDOW_SLOTS] = 0;
+#if SOFT_PWM_HARDWARE
+    if( HI16((uint32) &window[0]) != HI16((uint32) &window[SOFT_PWM_WINDOW_SLOTS]) ){
+        // The array crosses a 64 KB line, so the TDs can't reach all of it. (Very unlikely for 256 bytes.)
+        return 0;
+    }
+    // One byte per request, one request per slot.
+    dma_channel = DMA_SoftPwm_DmaInitialize(1u, 1u, HI16((uint32) window), HI16(Pins_SoftPwm__DR));
+    td_window = CyDmaTdAllocate();
+    td_rest = CyDmaTdAllocate();
+    if( td_window == CY_DMA_INVALID_TD || td_rest == CY_DMA_INVALID_TD ){
+        return 0;
+    }
+    // The window, one byte per slot, then on to the rest of the frame...
+    (void) CyDmaTdSetConfiguration(td_window, SOFT_PWM_WINDOW_SLOTS, td_rest, CY_DMA_TD_INC_SRC_ADR);
+    (void) CyDmaTdSetAddress(td_window, LO16((uint32) window), LO16(Pins_SoftPwm__DR));
+    // ...which writes the same 0 byte until the frame is over, then back to the window. Forever.
+    (void) CyDmaTdSetConfiguration(td_rest, SOFT_PWM_FRAME_SLOTS - SOFT_PWM_WINDOW_SLOTS, td_window, 0u);
+    (void) CyDmaTdSetAddress(td_rest, LO16((uint32) &window[SOFT_PWM_WINDOW_SLOTS]), LO16(Pins_SoftPwm__DR));
+    (void) CyDmaChSetInitialTd(dma_channel, td_window);
+    (void) CyDmaChEnable(dma_channel, 1u);
+    running = 1;
+#endif
+    return running;
+}
+
+void SoftPwm_SetWidth(uint8 channel, uint16 width){
+    uint16 old_width;
+    uint16 from;
+    uint16 to;
+    if( channel >= SOFT_PWM_CHANNELS ){
+        return;
+    }
+    old_width = table.width[channel];
+    (void) SoftPwm_UpdateEdge(&table, channel, width);
+    width = table.width[channel];
+    if( width == old_width ){
+        return;
+    }
+    // Only the slots between the old and new edge change. (Turning a channel on or off is
+    // the same thing with one of the widths being 0.)
+    from = (old_width < width) ? old_width : width;
+    to = (old_width < width) ? width : old_width;
+    // The DMA keeps reading while we write, one byte at a time. At worst, one frame gets a pulse
+    // whose length is somewhere between the old and new widths.
+    SoftPwm_RenderWindow(&table, window, from, to);
+}
+
+// ServoBank_Output only passes the value, not the channel, so each channel gets its own little function.
+#define SOFT_PWM_WRITER(n) static void SoftPwm_WriteCompare##n(uint16 compare){ SoftPwm_SetWidth(n, compare); }
+SOFT_PWM_WRITER(0)
+SOFT_PWM_WRITER(1)
+SOFT_PWM_WRITER(2)
+SOFT_PWM_WRITER(3)
+SOFT_PWM_WRITER(4)
+SOFT_PWM_WRITER(5)
+SOFT_PWM_WRITER(6)
+SOFT_PWM_WRITER(7)
+
+static const ServoBank_Output outputs[SOFT_PWM_CHANNELS] = {
+    { NULL, SoftPwm_WriteCompare0 },
+    { NULL, SoftPwm_WriteCompare1 },
+    { NULL, SoftPwm_WriteCompare2 },
+    { NULL, SoftPwm_WriteCompare3 },
+    { NULL, SoftPwm_WriteCompare4 },
+    { NULL, SoftPwm_WriteCompare5 },
+    { NULL, SoftPwm_WriteCompare6 },
+    { NULL, SoftPwm_WriteCompare7 },
+};
+
+const ServoBank_Output * SoftPwm_GetOutput(uint8 channel){
+    return (channel < SOFT_PWM_CHANNELS) ? &outputs[channel] : NULL;
+}
+
+/* [] END OF FILE */
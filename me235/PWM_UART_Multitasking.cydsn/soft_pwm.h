@@ -0,0 +1,95 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * soft_pwm.h
+ * Up to 8 servo PWMs on one GPIO port, made by the DMA instead of by PWM blocks.
+ * Each PWM_Servo instance takes up UDBs, and there aren't many of those. A port is 8 pins that can
+ * all be written at once with a single byte (like Pin_Servo_Control_Write does for its one pin).
+ *
+ * How it works: the frame (20 ms for a servo) is cut into "slots" of SOFT_PWM_SLOT_US each.
+ * A clock in the schematic requests one DMA transfer per slot. Every request, the DMA writes
+ * the next byte of the "window" (what all 8 pins should be, for one slot) to the port.
+ * Servo pulses are all at the start of the frame, so the window only covers the first
+ * SOFT_PWM_WINDOW_SLOTS slots; for the rest of the frame, the DMA writes the same 0 byte over and over.
+ * Two TDs, linked in a loop: the CPU does nothing per edge, or even per frame.
+ *
+ * The window is made from the "edge table": the list of times when pins go low, sorted by time.
+ * All the pins go high together at slot 0, and each falling edge lists the pins that go low then
+ * and what the port looks like afterward. When one channel changes, SoftPwm_UpdateEdge moves just
+ * that channel's edge, and only the slots between its old and new edge get re-drawn.
+ *
+ * The edge table functions don't touch hardware, so they can be checked on a regular computer.
+ *
+ * What's here is the edge table and the window it draws, which host_tests checks. The hardware half isn't:
+ * it needs a DMA component called DMA_SoftPwm with its drq driven by a clock at 1 / SOFT_PWM_SLOT_US,
+ * and an 8-pin "Pins_SoftPwm" component that has its port all to itself, and TopDesign.cysch has neither.
+ * So on this project SoftPwm_Start returns 0, nothing comes out of any pins, and the servo bank's
+ * channels past 0 have no output.
+ */
+
+#ifndef SOFT_PWM_H
+#define SOFT_PWM_H
+
+#include <project.h>
+#include "servo_bank.h"
+
+#define SOFT_PWM_CHANNELS 8u
+// 10 us per slot: a 100 kHz DMA request clock.
+#define SOFT_PWM_SLOT_US 10u
+// 20 ms servo frame.
+#define SOFT_PWM_FRAME_SLOTS 2000u
+// Pulses can be up to 2.55 ms long. With the trailing 0 byte (see soft_pwm.c), the window is 256 bytes.
+#define SOFT_PWM_WINDOW_SLOTS 255u
+
+#if defined(DMA_SoftPwm__DRQ_NUMBER) && defined(Pins_SoftPwm__DR)
+    #define SOFT_PWM_HARDWARE 1
+#else
+    #define SOFT_PWM_HARDWARE 0
+#endif
+
+// One falling edge: the pins that go low at 'slot', and the whole port after that.
+typedef struct
+{
+    uint16 slot;
+    uint8 falling_mask;
+    uint8 port_after;
+} SoftPwm_Edge;
+
+// The edge table for one port, always sorted by slot, with at most one edge per slot.
+typedef struct
+{
+    // pulse width of each channel, in slots. 0 = that pin stays low.
+    uint16 width[SOFT_PWM_CHANNELS];
+    SoftPwm_Edge edges[SOFT_PWM_CHANNELS];
+    uint8 num_edges;
+    // pins that go high at slot 0 (the ones with a width that's not 0)
+    uint8 high_mask;
+} SoftPwm_EdgeTable;
+
+// Builds the whole table from scratch. Widths past the window get clamped to it.
+void SoftPwm_BuildEdges(SoftPwm_EdgeTable * table, const uint16 * widths);
+
+// Changes one channel's width, moving only its edge. Returns the first edge index that changed.
+uint8 SoftPwm_UpdateEdge(SoftPwm_EdgeTable * table, uint8 channel, uint16 width);
+
+// Draws slots [from, to) of the window from the edge table.
+void SoftPwm_RenderWindow(const SoftPwm_EdgeTable * table, uint8 * window, uint16 from, uint16 to);
+
+// Sets up the DMA loop and starts it. Returns 1 if running, 0 if the hardware isn't there.
+uint8 SoftPwm_Start(void);
+
+// Sets one channel's pulse width, in slots. Re-draws only what changed.
+void SoftPwm_SetWidth(uint8 channel, uint16 width);
+
+// For ServoBank_AttachOutput: the compare value of the bank channel becomes the width in slots.
+const ServoBank_Output * SoftPwm_GetOutput(uint8 channel);
+
+#endif //SOFT_PWM_H
+
+/* [] END OF FILE */
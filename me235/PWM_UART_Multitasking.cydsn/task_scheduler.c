@@ -0,0 +1,119 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See task_scheduler.h for how this works.
+#include "task_scheduler.h"
+#include <project.h>
+
+/**
+ * *word |= bits, even if an ISR does the same thing in between.
+ * If anything happens between the LDREX and the STREX, the STREX fails and we go around again.
+ */
+static void TaskScheduler_AtomicOr(volatile uint32_t * word, uint32 bits){
+    uint32_t value;
+    do {
+        value = __LDREXW(word);
+    } while( __STREXW(value | bits, word) != 0 );
+}
+
+static void TaskScheduler_AtomicClear(volatile uint32_t * word, uint32 bits){
+    uint32_t value;
+    do {
+        value = __LDREXW(word);
+    } while( __STREXW(value & ~bits, word) != 0 );
+}
+
+// Takes *word and leaves 0 behind.
+static uint32 TaskScheduler_AtomicTake(volatile uint32_t * word){
+    uint32_t value;
+    do {
+        value = __LDREXW(word);
+    } while( __STREXW(0u, word) != 0 );
+    return value;
+}
+
+void TaskScheduler_Init(TaskScheduler * s, TaskScheduler_Clock clock){
+    uint8 i;
+    for( i = 0; i < TASK_SCHEDULER_MAX_TASKS; i++){
+        s->tasks[i].name = NULL;
+        s->tasks[i].run = NULL;
+        s->tasks[i].events = 0;
+    }
+    s->ready = 0;
+    s->clock = clock;
+    TaskScheduler_ResetStats(s);
+}
+
+uint8 TaskScheduler_Add(TaskScheduler * s, uint8 task, const char * name, TaskScheduler_Function run){
+    if( task >= TASK_SCHEDULER_MAX_TASKS ){
+        return 0;
+    }
+    s->tasks[task].name = name;
+    s->tasks[task].run = run;
+    return 1;
+}
+
+void TaskScheduler_Signal(TaskScheduler * s, uint8 task, uint32 events){
+    // The events first: once the ready bit is up, the task can run right away.
+    TaskScheduler_AtomicOr(&s->tasks[task].events, events);
+    TaskScheduler_AtomicOr(&s->ready, 1uL << task);
+}
+
+uint8 TaskScheduler_RunNext(TaskScheduler * s){
+    uint32 now = s->clock();
+    uint32 ready;
+    uint32 events;
+    uint32 took;
+    uint8 task;
+    TaskScheduler_Task * t;
+    // Keep track of the time here too, so it doesn't get lost when the clock wraps around.
+    s->elapsed_time += now - s->last_clock;
+    s->last_clock = now;
+    ready = s->ready;
+    if( ready == 0 ){
+        return 0;
+    }
+    // The lowest set bit is the most urgent task.
+    task = (uint8)(31u - __CLZ(ready & (0u - ready)));
+    t = &s->tasks[task];
+    // The ready bit goes down BEFORE the events are taken. An event signaled in between
+    // puts the bit back up, so it can't be missed (at worst, the task is ready with nothing to do).
+    TaskScheduler_AtomicClear(&s->ready, 1uL << task);
+    events = TaskScheduler_AtomicTake(&t->events);
+    if( events == 0 || t->run == NULL ){
+        return 1;
+    }
+    t->run(events);
+    took = s->clock() - now;
+    t->runs++;
+    t->busy_time += took;
+    if( took > t->max_time ){
+        t->max_time = took;
+    }
+    return 1;
+}
+
+uint16 TaskScheduler_SharePerMille(const TaskScheduler * s, uint8 task){
+    if( task >= TASK_SCHEDULER_MAX_TASKS || s->elapsed_time == 0 ){
+        return 0;
+    }
+    return (uint16)((s->tasks[task].busy_time * 1000u) / s->elapsed_time);
+}
+
+void TaskScheduler_ResetStats(TaskScheduler * s){
+    uint8 i;
+    for( i = 0; i < TASK_SCHEDULER_MAX_TASKS; i++){
+        s->tasks[i].runs = 0;
+        s->tasks[i].max_time = 0;
+        s->tasks[i].busy_time = 0;
+    }
+    s->last_clock = (s->clock != NULL) ? s->clock() : 0;
+    s->elapsed_time = 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,87 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * task_scheduler.h
+ * A small "run to completion" scheduler for the main loop.
+ *
+ * Instead of doing the work inside the ISRs (where nothing else at that priority can run until it's done),
+ * an ISR just signals a task: "event X happened". The main loop then runs the tasks that have events,
+ * one at a time, most urgent first. Each task is a plain function that gets the events it was sent,
+ * does its work, and returns. No task ever waits inside, so they can all share one stack, and a task
+ * never has to worry about another task cutting in (only the ISRs can).
+ *
+ * - Priority: a task's number is its priority. Task 0 runs first. One bit per task in 'ready'
+ *   says which tasks have events, and the most urgent one is found with CLZ, like ServoBank_Commit does.
+ * - Events: 32 flags per task, meant to be set from ISRs (of any priority). Several of the same event
+ *   before the task runs turn into one run, so a task should check its state, not count events.
+ *   Setting the flags uses __LDREXW / __STREXW, like the MPSC queue (lockfree_queue.h), so no interrupts get turned off.
+ * - Accounting: every run is timed with the clock you give TaskScheduler_Init. Each task keeps how many times
+ *   it ran, the longest run, and its total, so it's easy to see who's using the CPU.
+ *
+ * The scheduler itself doesn't touch any hardware (the clock is a function you pass in), so it can
+ * be checked, and timed, on a regular computer.
+ */
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <project.h>
+
+// At most 32: one bit each in 'ready'.
+#define TASK_SCHEDULER_MAX_TASKS 8u
+
+// A task. 'events' has the flags that were signaled since its last run (never 0).
+typedef void (*TaskScheduler_Function)(uint32 events);
+// Any free-running 32-bit clock that wraps around, like TimerService_NowUs.
+typedef uint32 (*TaskScheduler_Clock)(void);
+
+typedef struct
+{
+    const char * name;
+    TaskScheduler_Function run;
+    // Flags waiting for the next run. uint32_t, for __LDREXW and __STREXW.
+    volatile uint32_t events;
+    uint32 runs;
+    // The longest run, and all of them together, in clock units.
+    uint32 max_time;
+    uint64 busy_time;
+} TaskScheduler_Task;
+
+typedef struct
+{
+    TaskScheduler_Task tasks[TASK_SCHEDULER_MAX_TASKS];
+    // Bit N = task N has events waiting.
+    volatile uint32_t ready;
+    TaskScheduler_Clock clock;
+    // All the time since the stats were reset, to compare the tasks' busy_time against.
+    uint32 last_clock;
+    uint64 elapsed_time;
+} TaskScheduler;
+
+void TaskScheduler_Init(TaskScheduler * scheduler, TaskScheduler_Clock clock);
+
+// Sets up task number 'task' (its priority, 0 runs first). Returns 0 if that's past TASK_SCHEDULER_MAX_TASKS.
+uint8 TaskScheduler_Add(TaskScheduler * scheduler, uint8 task, const char * name, TaskScheduler_Function run);
+
+// Sets event flags for a task. OK from any ISR.
+void TaskScheduler_Signal(TaskScheduler * scheduler, uint8 task, uint32 events);
+
+// Runs the most urgent task with events, if there is one. Returns 1 if a task ran.
+// Call it until it returns 0, then sleep.
+uint8 TaskScheduler_RunNext(TaskScheduler * scheduler);
+
+// The share of the time task 'task' was running, in tenths of a percent.
+uint16 TaskScheduler_SharePerMille(const TaskScheduler * scheduler, uint8 task);
+
+// Starts the counts, longest runs, and shares over.
+void TaskScheduler_ResetStats(TaskScheduler * scheduler);
+
+#endif //TASK_SCHEDULER_H
+
+/* [] END OF FILE */
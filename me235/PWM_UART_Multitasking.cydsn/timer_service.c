@@ -0,0 +1,187 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See timer_service.h for how this works.
+#include "timer_service.h"
+#include <project.h>
+// A tick with a timer due in it means the main loop has work.
+// And the tick can time how long the CPU took to wake up for it.
+#include "idle_manager.h"
+
+#define TIMER_SERVICE_WHEEL_MASK (TIMER_SERVICE_WHEEL_SLOTS - 1u)
+
+// Ticks counted by the SysTick callback. volatile since an ISR writes it.
+static volatile uint32 now_ticks = 0;
+// The last tick that TimerService_Dispatch has finished with.
+static uint32 dispatched_ticks = 0;
+// SysTick reload value, for the part-of-a-millisecond in TimerService_NowUs.
+static uint32 systick_reload = 0;
+
+// The wheel: one list of timers per slot.
+static TimerService_Timer * wheel[TIMER_SERVICE_WHEEL_SLOTS];
+
+/**
+ * Runs every tick, from CySysTickServiceCallbacks in CyLib.c.
+ * Only counts: the timers themselves are handled in the main loop.
+ */
+static void TimerService_SysTickCallback(void){
+    // First thing, so the wakeup latency is as close to the ISR entry as we can get.
+    IdleManager_NotifyTickWake( IdleManager_TickLatency( systick_reload, CySysTickGetValue() ) );
+    now_ticks++;
+    // Wake the main loop up only if this tick's slot has something in it.
+    if( wheel[now_ticks & TIMER_SERVICE_WHEEL_MASK] != NULL ){
+        IdleManager_NotifyWork();
+    }
+}
+
+void TimerService_Init(void){
+    uint8 i;
+    for( i = 0; i < TIMER_SERVICE_WHEEL_SLOTS; i++){
+        wheel[i] = NULL;
+    }
+    now_ticks = 0;
+    dispatched_ticks = 0;
+    CySysTickStart();
+    TimerService_SetBusHz( BCLK__BUS_CLK__HZ );
+    (void) CySysTickSetCallback(0u, TimerService_SysTickCallback);
+}
+
+void TimerService_SetBusHz(uint32 bus_hz){
+    // SysTick counts CPU clocks, so this many per tick. The counter goes from reload down to 0, inclusive.
+    systick_reload = bus_hz / TIMER_SERVICE_TICK_HZ - 1u;
+    CySysTickSetReload( systick_reload );
+}
+
+uint32 TimerService_Now(void){
+    return now_ticks;
+}
+
+uint32 TimerService_NowUs(void){
+    uint32 ms;
+    uint32 ms_read;
+    uint32 count;
+    // If the tick changes while we read, try again.
+    do {
+        ms_read = now_ticks;
+        ms = ms_read;
+        count = CySysTickGetValue();
+        // With interrupts masked (like around a WFI), the SysTick can wrap without the
+        // callback running yet. Then the tick is pending: count it, and re-read the counter
+        // so it's definitely from after the wrap.
+        if( (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0 ){
+            count = CySysTickGetValue();
+            ms++;
+        }
+    } while( ms_read != now_ticks );
+    // The SysTick counts down, so (reload - count) cycles of this tick have gone by.
+    return ms * 1000u + ((systick_reload - count) * 1000u) / (systick_reload + 1u);
+}
+
+/**
+ * Links a timer into the slot for its expiry tick. O(1).
+ */
+static void TimerService_Link(TimerService_Timer * timer){
+    TimerService_Timer ** slot = &wheel[timer->expires & TIMER_SERVICE_WHEEL_MASK];
+    timer->prev = NULL;
+    timer->next = *slot;
+    if( *slot != NULL ){
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+    timer->active = 1;
+}
+
+/**
+ * Unlinks a timer from its slot. O(1), thanks to the prev pointer.
+ */
+static void TimerService_Unlink(TimerService_Timer * timer){
+    if( timer->prev != NULL ){
+        timer->prev->next = timer->next;
+    }
+    else {
+        wheel[timer->expires & TIMER_SERVICE_WHEEL_MASK] = timer->next;
+    }
+    if( timer->next != NULL ){
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->active = 0;
+}
+
+void TimerService_Start(TimerService_Timer * timer, uint32 ticks, uint32 period, TimerService_Callback callback, void * context){
+    if( timer->active ){
+        TimerService_Unlink(timer);
+    }
+    // A 0-tick timer still has to wait for the next tick: this one's slot may already be dispatched.
+    if( ticks == 0 ){
+        ticks = 1;
+    }
+    timer->expires = now_ticks + ticks;
+    timer->period = period;
+    timer->callback = callback;
+    timer->context = context;
+    TimerService_Link(timer);
+}
+
+void TimerService_Stop(TimerService_Timer * timer){
+    if( timer->active ){
+        TimerService_Unlink(timer);
+    }
+}
+
+uint8 TimerService_IsActive(const TimerService_Timer * timer){
+    return timer->active;
+}
+
+uint32 TimerService_Remaining(const TimerService_Timer * timer){
+    uint32 now = now_ticks;
+    if( !timer->active || TimerService_Expired(timer->expires) ){
+        return 0;
+    }
+    return timer->expires - now;
+}
+
+uint32 TimerService_DeadlineIn(uint32 ticks){
+    return now_ticks + ticks;
+}
+
+uint8 TimerService_Expired(uint32 deadline){
+    // Subtracting and looking at the sign handles the counter wrapping around,
+    // as long as deadlines are less than 2^31 ticks (about 24 days) away.
+    return ((int32)(now_ticks - deadline) >= 0) ? 1 : 0;
+}
+
+void TimerService_Dispatch(void){
+    uint32 now = now_ticks;
+    // Catch up one tick at a time, in case the main loop was busy for a few ticks.
+    while( dispatched_ticks != now ){
+        TimerService_Timer * timer;
+        dispatched_ticks++;
+        timer = wheel[dispatched_ticks & TIMER_SERVICE_WHEEL_MASK];
+        while( timer != NULL ){
+            // Timers more than one trip around the wheel away share the slot, but aren't due yet.
+            if( timer->expires != dispatched_ticks ){
+                timer = timer->next;
+                continue;
+            }
+            TimerService_Unlink(timer);
+            if( timer->period != 0 ){
+                // Based on the old expiry, not 'now', so periodic timers don't drift.
+                timer->expires += timer->period;
+                TimerService_Link(timer);
+            }
+            timer->callback(timer->context);
+            // The callback may have started or stopped any timer, so our place in the list
+            // can't be trusted anymore. Start over: the ones already run aren't due in this tick.
+            timer = wheel[dispatched_ticks & TIMER_SERVICE_WHEEL_MASK];
+        }
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,92 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * timer_service.h
+ * Software timers, driven by the SysTick (a timer that's built into every Cortex-M3).
+ *
+ * Why not just CyDelay? CyDelay burns CPU cycles in a loop (CyDelayCycles), so nothing
+ * else can happen while it waits, and (as CyLib.c says) it silently takes twice as long if the
+ * instruction cache is off. Here, the SysTick interrupts every millisecond, and you can either:
+ * 1) start a timer, which calls your function from the main loop when it runs out
+ *    (once, or over and over for a periodic timer), or
+ * 2) get a deadline, keep doing other things, and check TimerService_Expired(deadline) when you want.
+ *
+ * How are the timers kept track of? A "timing wheel": an array of TIMER_SERVICE_WHEEL_SLOTS lists.
+ * A timer that runs out at tick T goes in list number (T mod number of slots). Every tick,
+ * only that tick's list needs checking. Starting and stopping a timer are O(1), and so is
+ * each tick, as long as most timers are shorter than one trip around the wheel.
+ *
+ * Timers are structs that YOU own (usually static), so nothing is ever malloc'd.
+ * Start/stop/dispatch timers from the main loop only, not from ISRs.
+ */
+
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <project.h>
+
+// One tick = 1 ms.
+#define TIMER_SERVICE_TICK_HZ 1000u
+// Must be a power of two.
+#define TIMER_SERVICE_WHEEL_SLOTS 64u
+
+typedef void (*TimerService_Callback)(void * context);
+
+// One software timer. Treat the fields as private; use the functions below.
+typedef struct TimerService_Timer
+{
+    struct TimerService_Timer * next;
+    struct TimerService_Timer * prev;
+    // tick when it runs out
+    uint32 expires;
+    // 0 for one-shot, otherwise restart with this many ticks
+    uint32 period;
+    TimerService_Callback callback;
+    void * context;
+    uint8 active;
+} TimerService_Timer;
+
+// Takes over the SysTick (with CySysTickStart/CySysTickSetCallback from CyLib.c) and starts ticking.
+void TimerService_Init(void);
+
+// The bus clock changed (see clock_governor.h): the SysTick counts bus clocks, so its reload changes.
+void TimerService_SetBusHz(uint32 bus_hz);
+
+// Ticks (milliseconds) since TimerService_Init. Wraps after about 49 days.
+uint32 TimerService_Now(void);
+
+// Microseconds since TimerService_Init, using the SysTick count for the part of a millisecond.
+// Wraps after about 71 minutes.
+uint32 TimerService_NowUs(void);
+
+// Runs callback(context) from TimerService_Dispatch after 'ticks' ticks. If period is not 0,
+// it keeps running every 'period' ticks after that. Restarts the timer if it was already running.
+void TimerService_Start(TimerService_Timer * timer, uint32 ticks, uint32 period, TimerService_Callback callback, void * context);
+
+// Stops a timer. OK to call on a timer that isn't running.
+void TimerService_Stop(TimerService_Timer * timer);
+
+// 1 if the timer is running.
+uint8 TimerService_IsActive(const TimerService_Timer * timer);
+
+// Ticks until the timer runs out (0 if it's not running or is already due).
+uint32 TimerService_Remaining(const TimerService_Timer * timer);
+
+// A deadline 'ticks' from now, for use with TimerService_Expired.
+uint32 TimerService_DeadlineIn(uint32 ticks);
+
+// 1 once the deadline has passed. Works across the counter wrapping around.
+uint8 TimerService_Expired(uint32 deadline);
+
+// Call from the main loop. Runs the callbacks of every timer that ran out since the last call.
+void TimerService_Dispatch(void);
+
+#endif //TIMER_SERVICE_H
+
+/* [] END OF FILE */
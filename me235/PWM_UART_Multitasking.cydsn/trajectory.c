@@ -0,0 +1,247 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See trajectory.h for how this works.
+#include "trajectory.h"
+#include <project.h>
+// The software path writes through the servo bank, so the bank (and 'd' replies) stay up to date.
+#include "servo_bank.h"
+// Playback writes channel 0 itself, so a limited move there has to stop first.
+#include "motion_limiter.h"
+// How long a frame is, and what time it is, for counting the frames the TC bit missed.
+#include "units.h"
+#include "timer_service.h"
+
+// The uploaded points, and the table that actually gets played (the DMA reads this one).
+static uint16 points[TRAJECTORY_MAX_POINTS];
+static uint16 expanded[TRAJECTORY_MAX_EXPANDED];
+static uint16 num_points = 0;
+// 1 once a playback started from this upload, so the next "t" starts a new table.
+static uint8 sealed = 0;
+static Trajectory_State state;
+
+#if TRAJECTORY_HARDWARE
+    static uint8 dma_channel = CY_DMA_INVALID_CHANNEL;
+    static uint8 dma_td = CY_DMA_INVALID_TD;
+    // 1 once a frame went by since Trajectory_Play, so the DMA has loaded its working TD.
+    static uint8 dma_started = 0;
+#else
+    // TimerService_NowUs when Trajectory_Step last saw a frame.
+    static uint32 last_frame_us = 0;
+#endif
+
+uint16 Trajectory_Expand(const uint16 * in, uint16 count, Trajectory_Mode mode, uint16 * out){
+    uint16 i;
+    uint16 length = count;
+    for( i = 0; i < count; i++){
+        out[i] = in[i];
+    }
+    // Ping-pong: add the way back, without repeating either end (those would play twice in a row).
+    if( mode == TRAJECTORY_PING_PONG && count > 2u ){
+        for( i = count - 2u; i > 0; i--){
+            out[length] = in[i];
+            length++;
+        }
+    }
+    return length;
+}
+
+uint16 Trajectory_PositionFromOffset(uint16 offset, uint16 count, Trajectory_Mode mode){
+    if( mode == TRAJECTORY_PING_PONG && offset >= count ){
+        // On the way back: offset count is point count - 2, and so on.
+        return (uint16)(2u * (count - 1u) - offset);
+    }
+    return offset;
+}
+
+uint16 Trajectory_Advance(Trajectory_State * s){
+    uint16 now = s->offset;
+    if( !s->running || s->expanded_length == 0 ){
+        return now;
+    }
+    s->played = now;
+    s->offset++;
+    if( s->offset >= s->expanded_length ){
+        if( s->mode == TRAJECTORY_ONE_SHOT ){
+            // Hold the last point.
+            s->offset = s->expanded_length - 1u;
+            s->running = 0;
+        }
+        else {
+            s->offset = 0;
+        }
+    }
+    return now;
+}
+
+uint16 Trajectory_FramesSince(uint32 elapsed_us, uint32 frame_us){
+    uint32 frames;
+    if( frame_us == 0 ){
+        return 1;
+    }
+    // A half rounds down: a frame seen exactly half a frame late is still the earlier one (see Trajectory_Play).
+    frames = (elapsed_us + (frame_us - 1u) / 2u) / frame_us;
+    if( frames == 0 ){
+        return 1;
+    }
+    return (frames > 0xFFFFu) ? 0xFFFFu : (uint16) frames;
+}
+
+#if TRAJECTORY_HARDWARE
+/**
+ * Reads where the DMA is up to into state. With the TDs preserved, the channel works on a copy of its TD
+ * in the TD slot with the channel's own number (see CyDmaChEnable), and that copy's source address moves
+ * along as it goes.
+ */
+static void Trajectory_ReadDma(void){
+    uint16 source;
+    uint16 destination;
+    uint16 next;
+    if( !state.running || !dma_started ){
+        return;
+    }
+    (void) CyDmaTdGetAddress(dma_channel, &source, &destination);
+    next = (uint16)((uint16)(source - LO16((uint32) expanded)) / 2u);
+    if( next >= state.expanded_length ){
+        // Past the end: a one-shot that finished holds the last point, and a loop is about to start over.
+        state.played = state.expanded_length - 1u;
+        if( state.mode == TRAJECTORY_ONE_SHOT ){
+            state.offset = state.played;
+            state.running = 0;
+        }
+        else {
+            state.offset = 0;
+        }
+        return;
+    }
+    state.offset = next;
+    state.played = (next == 0) ? (state.expanded_length - 1u) : (next - 1u);
+}
+#else
+/**
+ * How long one frame of PWM_Servo is, in microseconds.
+ */
+static uint32 Trajectory_FrameUs(void){
+    const Units_Scale * scale = Units_GetScale();
+    if( scale->pwm_hz == 0 ){
+        return 0;
+    }
+    return (uint32)((((uint64) PWM_Servo_ReadPeriod() + 1u) * 1000000u + scale->pwm_hz / 2u) / scale->pwm_hz);
+}
+#endif
+
+void Trajectory_Clear(void){
+    Trajectory_Stop();
+    num_points = 0;
+    state.expanded_length = 0;
+    sealed = 0;
+}
+
+uint8 Trajectory_Append(uint16 compare){
+    if( sealed ){
+        Trajectory_Clear();
+    }
+    if( num_points >= TRAJECTORY_MAX_POINTS ){
+        return 0;
+    }
+    points[num_points] = compare;
+    num_points++;
+    return 1;
+}
+
+uint8 Trajectory_Play(Trajectory_Mode mode){
+    if( num_points == 0 ){
+        return 0;
+    }
+    Trajectory_Stop();
+    // Otherwise MotionLimiter_Step, later in the same PWM task, would write its own position over every point.
+    MotionLimiter_Stop(0);
+    sealed = 1;
+    state.expanded_length = Trajectory_Expand(points, num_points, mode, expanded);
+    state.offset = 0;
+    state.played = 0;
+    state.mode = (uint8) mode;
+    state.running = 1;
+#if TRAJECTORY_HARDWARE
+    // Each tc from the PWM requests one 2-byte burst: the next compare value, straight into the register.
+    if( dma_channel == CY_DMA_INVALID_CHANNEL ){
+        dma_channel = DMA_Trajectory_DmaInitialize(2u, 1u, HI16((uint32) expanded), HI16((uint32) PWM_Servo_COMPARE1_LSB_PTR));
+        dma_td = CyDmaTdAllocate();
+    }
+    // The TD points back at itself to loop. For one-shot, it ends the chain instead.
+    (void) CyDmaTdSetConfiguration(dma_td, state.expanded_length * 2u,
+        (mode == TRAJECTORY_ONE_SHOT) ? CY_DMA_DISABLE_TD : dma_td, CY_DMA_TD_INC_SRC_ADR);
+    (void) CyDmaTdSetAddress(dma_td, LO16((uint32) expanded), LO16((uint32) PWM_Servo_COMPARE1_LSB_PTR));
+    (void) CyDmaChSetInitialTd(dma_channel, dma_td);
+    // Preserve the TD, so the loop starts over from the original and not the used-up copy.
+    (void) CyDmaChEnable(dma_channel, 1u);
+    dma_started = 0;
+#else
+    // Half a frame back, so the first frame seen rounds to 1 however soon after this it comes.
+    last_frame_us = TimerService_NowUs() - Trajectory_FrameUs() / 2u;
+#endif
+    return 1;
+}
+
+void Trajectory_Stop(void){
+#if TRAJECTORY_HARDWARE
+    if( dma_channel != CY_DMA_INVALID_CHANNEL ){
+        (void) CyDmaChDisable(dma_channel);
+    }
+#endif
+    state.running = 0;
+}
+
+uint8 Trajectory_IsPlaying(void){
+    return state.running;
+}
+
+uint16 Trajectory_GetPosition(void){
+    if( state.expanded_length == 0 ){
+        return 0;
+    }
+#if TRAJECTORY_HARDWARE
+    Trajectory_ReadDma();
+#endif
+    return Trajectory_PositionFromOffset(state.played, num_points, (Trajectory_Mode) state.mode);
+}
+
+uint16 Trajectory_GetCount(void){
+    return num_points;
+}
+
+void Trajectory_Step(uint8 new_frame){
+#if TRAJECTORY_HARDWARE
+    if( !new_frame || !state.running ){
+        return;
+    }
+    // The DMA does the writing. This only notices a one-shot that finished.
+    dma_started = 1;
+    Trajectory_ReadDma();
+#else
+    uint16 offset;
+    uint16 frames;
+    uint32 now;
+    if( !new_frame || !state.running ){
+        return;
+    }
+    // The TC bit only says "at least one frame". The time says how many, if this pass of the main loop was slow.
+    now = TimerService_NowUs();
+    frames = Trajectory_FramesSince(now - last_frame_us, Trajectory_FrameUs());
+    last_frame_us = now;
+    // The points for the frames we missed are gone: skip them, and play the one that's due now.
+    do {
+        offset = Trajectory_Advance(&state);
+        frames--;
+    } while( frames > 0 && state.running );
+    // Goes out with this same frame's ServoBank_CommitAtFrame.
+    (void) ServoBank_SetCompare(0, expanded[offset]);
+#endif
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,108 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * trajectory.h
+ * Plays back a table of compare values into PWM_Servo, one per PWM period.
+ * Instead of the PC sending "d : N" lines over and over (and the PSoC parsing every one of them),
+ * the PC uploads the whole motion once with "t : N" lines, then starts it with "g : mode".
+ *
+ * With a DMA channel wired to the PWM's terminal count (tc) in the schematic, the DMA copies
+ * the next value into the compare register (PWM_Servo_COMPARE1_LSB_PTR) every period,
+ * with no CPU at all. The DMA can only count addresses up, not down, so for ping-pong
+ * the table gets a mirrored copy added to the end (1 2 3 4 -> 1 2 3 4 3 2) and is played as a loop.
+ *
+ * Without that DMA channel (this project's schematic doesn't have one yet), the main loop does
+ * the same thing: on each new frame, Trajectory_Step writes the next value through the servo bank.
+ *
+ * Where is playback up to? The PWM's terminal count bit is sticky, so if a pass of the main loop takes
+ * longer than a frame, two frames look like one. Counting those polls would fall behind.
+ * With the DMA, the position comes from the DMA itself: the source address in the channel's working TD.
+ * Without it, Trajectory_Step times the gap since the last frame it saw, and moves on by that many frames
+ * (skipping a point it missed), so playback stays on time.
+ *
+ * The table/mode logic (Trajectory_Expand, Trajectory_PositionFromOffset, Trajectory_Advance)
+ * doesn't touch the hardware, so it can be checked on a regular computer.
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <project.h>
+
+// Most points that can be uploaded. The expanded (ping-pong) table is almost twice this.
+#define TRAJECTORY_MAX_POINTS 256u
+#define TRAJECTORY_MAX_EXPANDED (2u * TRAJECTORY_MAX_POINTS - 2u)
+
+#if defined(DMA_Trajectory__DRQ_NUMBER)
+    #define TRAJECTORY_HARDWARE 1
+#else
+    #define TRAJECTORY_HARDWARE 0
+#endif
+
+typedef enum
+{
+    // start over from the first point after the last
+    TRAJECTORY_LOOP = 0,
+    // play once, then hold the last point
+    TRAJECTORY_ONE_SHOT = 1,
+    // forward, then backward, then forward...
+    TRAJECTORY_PING_PONG = 2
+} Trajectory_Mode;
+
+// Where playback is, for the software path.
+typedef struct
+{
+    // index into the expanded table of the next value to write
+    uint16 offset;
+    // index of the last value written (what's playing now)
+    uint16 played;
+    uint16 expanded_length;
+    uint8 mode;
+    uint8 running;
+} Trajectory_State;
+
+// Builds the table the DMA plays from 'count' points. Returns its length (0 if count is 0).
+uint16 Trajectory_Expand(const uint16 * points, uint16 count, Trajectory_Mode mode, uint16 * expanded);
+
+// Turns a place in the expanded table back into a point number (0 to count - 1).
+uint16 Trajectory_PositionFromOffset(uint16 offset, uint16 count, Trajectory_Mode mode);
+
+// Software playback: returns the offset to write this frame and moves on. Stops at the end of a one-shot.
+uint16 Trajectory_Advance(Trajectory_State * state);
+
+// How many frames went by in elapsed_us, to the nearest frame (a half rounds down), and at least 1 (a frame was just seen).
+uint16 Trajectory_FramesSince(uint32 elapsed_us, uint32 frame_us);
+
+// Stops playback and throws away the uploaded points.
+void Trajectory_Clear(void);
+
+// Adds a point to the upload. The first point after a playback was started begins a new table.
+// Returns 0 if the table is full.
+uint8 Trajectory_Append(uint16 compare);
+
+// Starts playing the uploaded table. Returns 0 if there's nothing to play.
+uint8 Trajectory_Play(Trajectory_Mode mode);
+
+void Trajectory_Stop(void);
+
+// 1 while playing (a one-shot stops by itself at the end).
+uint8 Trajectory_IsPlaying(void);
+
+// Which point is playing now (0 to count - 1).
+uint16 Trajectory_GetPosition(void);
+
+// How many points were uploaded.
+uint16 Trajectory_GetCount(void);
+
+// Call from the main loop with ServoBank_PollFrame's result. Does nothing when the DMA is doing the work.
+void Trajectory_Step(uint8 new_frame);
+
+#endif //TRAJECTORY_H
+
+/* [] END OF FILE */
@@ -0,0 +1,77 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * uart_command_hash.h
+ * DON'T EDIT THIS FILE: uart_command_hash.py writes it from the words in uart_commands.h.
+ * The perfect hash tables for UART_Helper_FindWord. Only uart_helper_fcns.c includes this,
+ * after the UART_COMMAND_ID_ enum.
+ */
+
+#ifndef UART_COMMAND_HASH_H
+#define UART_COMMAND_HASH_H
+
+#include <project.h>
+
+// How many words the tables were made for.
+#define UART_COMMAND_HASH_COUNT 37u
+// The first hash starts from this.
+#define UART_COMMAND_HASH_BASIS 0x811C9DC5u
+
+// For each bucket: the starting value for the second hash, or -(slot + 1).
+static const int16 command_hash_displace[UART_COMMAND_HASH_COUNT] = {
+    3, -37, 1, 0, 0, 2, 0, -36, -35, 0,
+    -33, 0, -32, -30, -27, 4, 0, 1, 1, 0,
+    0, 0, -25, -20, -19, -17, 1, 0, 0, 2,
+    -15, -12, -8, -6, -5, 0, 3
+};
+
+// The command in each slot.
+static const uint8 command_hash_slot[UART_COMMAND_HASH_COUNT] = {
+    UART_COMMAND_ID_Offset, // offset
+    UART_COMMAND_ID_StopKeyframes, // stopkeys
+    UART_COMMAND_ID_TrajectoryPoint, // point
+    UART_COMMAND_ID_RecallPreset, // recall
+    UART_COMMAND_ID_PidLoop, // loop
+    UART_COMMAND_ID_SavePreset, // save
+    UART_COMMAND_ID_StorePreset, // store
+    UART_COMMAND_ID_Blocked, // blocked
+    UART_COMMAND_ID_StartPwm, // start
+    UART_COMMAND_ID_Now, // now
+    UART_COMMAND_ID_PidTarget, // target
+    UART_COMMAND_ID_StopPwm, // stop
+    UART_COMMAND_ID_PidI, // ki
+    UART_COMMAND_ID_Duty, // duty
+    UART_COMMAND_ID_MaxVelocity, // velocity
+    UART_COMMAND_ID_Code, // code
+    UART_COMMAND_ID_Keyframe, // keyframe
+    UART_COMMAND_ID_MaxAcceleration, // accel
+    UART_COMMAND_ID_Tasks, // tasks
+    UART_COMMAND_ID_Dither, // dither
+    UART_COMMAND_ID_Lateness, // late
+    UART_COMMAND_ID_Sync, // sync
+    UART_COMMAND_ID_Go, // go
+    UART_COMMAND_ID_Query, // query
+    UART_COMMAND_ID_Period, // period
+    UART_COMMAND_ID_Power, // power
+    UART_COMMAND_ID_Window, // window
+    UART_COMMAND_ID_Interpolation, // interpolate
+    UART_COMMAND_ID_Moving, // moving
+    UART_COMMAND_ID_Percent, // percent
+    UART_COMMAND_ID_Cancel, // cancel
+    UART_COMMAND_ID_Script, // script
+    UART_COMMAND_ID_PidD, // kd
+    UART_COMMAND_ID_Frequency, // frequency
+    UART_COMMAND_ID_PidP, // kp
+    UART_COMMAND_ID_Halt, // halt
+    UART_COMMAND_ID_PulseWidth  // width
+};
+
+#endif //UART_COMMAND_HASH_H
+
+/* [] END OF FILE */
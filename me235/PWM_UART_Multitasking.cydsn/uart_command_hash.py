@@ -0,0 +1,137 @@
+#!/usr/bin/env python
+# ========================================
+#
+# Copyright Andrew P. Sabelhaus, 2018
+# See README and LICENSE for more details.
+#
+# ========================================
+
+"""
+uart_command_hash.py
+Writes uart_command_hash.h, the perfect hash for the command words in uart_commands.h.
+Run it from this folder whenever a command is added or a word changes:
+    python uart_command_hash.py
+
+How the hash works (this is "hash and displace"):
+  1) Hash the word once, with the usual starting value. That picks one of N buckets, where N is the number of commands.
+  2) Each bucket has a number in the displace table.
+     If it's negative, the bucket only had one word in it, and the word is in slot -number - 1.
+     Otherwise, hash the word again, starting from that number. That picks the slot.
+  3) This script tries numbers for each bucket until every word has a slot to itself.
+So there are exactly as many slots as words (it's a MINIMAL perfect hash), and finding a word is two hashes and one compare.
+The hash is FNV-1a, the same one UART_Helper_HashWord in uart_helper_fcns.c uses. The two have to match!
+"""
+
+import re
+import sys
+
+FNV_BASIS = 0x811C9DC5
+FNV_PRIME = 16777619
+# The displace table is int16.
+MAX_DISPLACE = 0x7FFF
+
+
+def fnv1a(word, seed):
+    value = seed
+    for c in word.encode('ascii'):
+        value = ((value ^ c) * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def read_commands(path):
+    # Each line of the table looks like:   X( 'p', "period",      Period, ...
+    text = open(path).read()
+    return re.findall(r"X\(\s*'.',\s*\"([^\"]*)\",\s*(\w+)\s*,", text)
+
+
+def build(words):
+    count = len(words)
+    buckets = [[] for _ in range(count)]
+    for word in words:
+        buckets[fnv1a(word, FNV_BASIS) % count].append(word)
+    displace = [0] * count
+    slots = [None] * count
+    # The crowded buckets first, while there are lots of free slots.
+    order = sorted(range(count), key=lambda b: -len(buckets[b]))
+    for b in order:
+        if len(buckets[b]) <= 1:
+            continue
+        for seed in range(1, MAX_DISPLACE + 1):
+            taken = [fnv1a(word, seed) % count for word in buckets[b]]
+            if len(set(taken)) == len(taken) and all(slots[t] is None for t in taken):
+                break
+        else:
+            sys.exit("No displacement works for bucket %d. Try renaming a command." % b)
+        displace[b] = seed
+        for word, t in zip(buckets[b], taken):
+            slots[t] = word
+    # Then the words that are alone in their bucket just take any free slot.
+    free = [t for t in range(count) if slots[t] is None]
+    for b in order:
+        if len(buckets[b]) == 1:
+            t = free.pop()
+            displace[b] = -t - 1
+            slots[t] = buckets[b][0]
+    return displace, slots
+
+
+def main():
+    commands = read_commands('uart_commands.h')
+    words = [word for word, name in commands]
+    names = dict(commands)
+    for word in words:
+        if not re.match(r'^[a-z]{1,15}$', word):
+            sys.exit('"%s": words are 1 to 15 lowercase letters.' % word)
+    if len(set(words)) != len(words):
+        sys.exit('Two commands have the same word.')
+    displace, slots = build(words)
+
+    out = []
+    out.append('/* ========================================')
+    out.append(' *')
+    out.append(' * Copyright Andrew P. Sabelhaus, 2018')
+    out.append(' * See README and LICENSE for more details.')
+    out.append(' *')
+    out.append(' * ========================================')
+    out.append('*/')
+    out.append('')
+    out.append('/**')
+    out.append(' * uart_command_hash.h')
+    out.append(' * DON\'T EDIT THIS FILE: uart_command_hash.py writes it from the words in uart_commands.h.')
+    out.append(' * The perfect hash tables for UART_Helper_FindWord. Only uart_helper_fcns.c includes this,')
+    out.append(' * after the UART_COMMAND_ID_ enum.')
+    out.append(' */')
+    out.append('')
+    out.append('#ifndef UART_COMMAND_HASH_H')
+    out.append('#define UART_COMMAND_HASH_H')
+    out.append('')
+    out.append('#include <project.h>')
+    out.append('')
+    out.append('// How many words the tables were made for.')
+    out.append('#define UART_COMMAND_HASH_COUNT %du' % len(words))
+    out.append('// The first hash starts from this.')
+    out.append('#define UART_COMMAND_HASH_BASIS 0x%08Xu' % FNV_BASIS)
+    out.append('')
+    out.append('// For each bucket: the starting value for the second hash, or -(slot + 1).')
+    out.append('static const int16 command_hash_displace[UART_COMMAND_HASH_COUNT] = {')
+    for row in range(0, len(displace), 10):
+        out.append('    ' + ', '.join('%d' % d for d in displace[row:row + 10]) + ',')
+    out[-1] = out[-1].rstrip(',')
+    out.append('};')
+    out.append('')
+    out.append('// The command in each slot.')
+    out.append('static const uint8 command_hash_slot[UART_COMMAND_HASH_COUNT] = {')
+    for word in slots:
+        out.append('    UART_COMMAND_ID_%s, // %s' % (names[word], word))
+    out[-1] = out[-1].replace(',', ' ', 1)
+    out.append('};')
+    out.append('')
+    out.append('#endif //UART_COMMAND_HASH_H')
+    out.append('')
+    out.append('/* [] END OF FILE */')
+    open('uart_command_hash.h', 'w').write('\n'.join(out) + '\n')
+    print('Wrote uart_command_hash.h for %d words.' % len(words))
+
+
+if __name__ == '__main__':
+    main()
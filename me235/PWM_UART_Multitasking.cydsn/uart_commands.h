@@ -0,0 +1,160 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * uart_commands.h
+ * Every UART command, in one table. To add a command, add a line here and write its UART_Command_ function
+ * in uart_helper_fcns.c. Everything else comes from this table:
+ * the lookup from the letter to the function, the range check on the number, which commands work on
+ * other channels or with "@", and the help text in the startup banner and the error messages.
+ *
+ * How? This is an "X macro": UART_COMMANDS takes the name of ANOTHER macro, X, and calls it once per command.
+ * uart_helper_fcns.c defines a few different X's, and calls UART_COMMANDS with each one to build:
+ *   1) an enum with a number for each command,
+ *   2) the table of UART_Command structs (in flash, since it's const), and
+ *   3) a 128-entry table from the letter to the command's number + 1 (0 = no such command).
+ *      Finding a command is just one array read, and the tables are built by the compiler, so there's
+ *      nothing to set up at startup, and no RAM used.
+ * A letter that isn't plain ASCII won't compile. Two commands with the same letter do compile (the second one wins,
+ * though GCC's -Wextra warns about it),
+ * so UART_Helper_CheckCommands checks for that at startup.
+ *
+ * Every command has a word too, so "duty3 : 150" is the same as "d3 : 150". Words are found with a perfect hash:
+ * each word lands in its own slot, so finding one takes the same few steps however many commands there are.
+ * The C preprocessor can't look inside strings, so the hash's tables are in uart_command_hash.h, which
+ * uart_command_hash.py writes from this file. IF YOU ADD A COMMAND OR CHANGE A WORD, run
+ *     python uart_command_hash.py
+ * in this folder. (If you forget, it won't compile when the number of commands changed,
+ * and UART_Helper_CheckCommands catches a changed word at startup.)
+ *
+ * X( letter, word, Name, lowest, highest, flags, help ):
+ *   letter: the command's character.
+ *   word: the same command, spelled out. Lowercase letters only, at most UART_COMMAND_WORD_LENGTH of them,
+ *     and not starting with the letter of an immediate command (that would happen as soon as it was typed).
+ *   Name: the function is UART_Command_Name.
+ *   lowest, highest: the number after the colon has to be in this range.
+ *   flags: UART_COMMAND_ bits, below.
+ *   help: one line for the banner.
+ *
+ * UART_Command_Name( quiet ) writes its reply into the transmit buffer, and returns COMMAND_ACKS_OK, or
+ * COMMAND_ACKS_FAILED if it couldn't do it (that's the status in a numbered line's ack, see command_acks.h).
+ * quiet is 1 for a numbered line, whose only reply is the ack: a command that prints by itself has to check it.
+ */
+
+#ifndef UART_COMMANDS_H
+#define UART_COMMANDS_H
+
+#include <project.h>
+// The number of preset slots, for S, R and K.
+#include "presets.h"
+// The PID loop's fastest rate, for L.
+#include "pid_loop.h"
+// What a command returns.
+#include "command_acks.h"
+
+// Only on channel 0 (PWM_Servo): the unit conversions use Clock_PWM, and keyframes only play there.
+#define UART_COMMAND_CHANNEL_0   (1u << 0)
+// Can wait for a tick: "d : 150 @ 52000" (see command_schedule.h).
+#define UART_COMMAND_AT          (1u << 1)
+// Happens right as the letter is typed at the start of a line, in the UART ISR, instead of at the end of the line.
+// (Typing the word instead, and pressing enter, works too.)
+#define UART_COMMAND_IMMEDIATE   (1u << 2)
+
+// The longest word.
+#define UART_COMMAND_WORD_LENGTH 15
+
+#define UART_COMMANDS(X) \
+    X( 'p', "period",      Period,          0u, 0xFFFFu, UART_COMMAND_AT, \
+        "p : 2000 sets the period to 2000 clock ticks. Only servo 0 has a pin on this board: p3 : 2000 sets up bank channel 3, with no output." ) \
+    X( 'd', "duty",        Duty,            0u, 0xFFFFu, UART_COMMAND_AT, \
+        "d : 150 sets the duty cycle, as a number of clock ticks." ) \
+    X( 'f', "frequency",   Frequency,       0u, 0xFFFFu, UART_COMMAND_CHANNEL_0, \
+        "f : 50hz sets the frequency (this picks the best PWM clock too)." ) \
+    X( 'w', "width",       PulseWidth,      0u, 0xFFFFu, UART_COMMAND_CHANNEL_0 | UART_COMMAND_AT, \
+        "w : 1500us sets the pulse width." ) \
+    X( '%', "percent",     Percent,         0u, 100u,    UART_COMMAND_CHANNEL_0 | UART_COMMAND_AT, \
+        "% : 7.5 sets the duty cycle in percent." ) \
+    X( 'r', "dither",      Dither,          0u, 0xFFFFu, UART_COMMAND_CHANNEL_0, \
+        "r : 150.25 sets a duty cycle in between clock ticks, by alternating 150 and 151." ) \
+    X( 'v', "velocity",    MaxVelocity,     0u, 0xFFFFu, 0u, \
+        "v : 2 limits how fast the servo moves, in ticks per period (0 for no limit)." ) \
+    X( 'a', "accel",       MaxAcceleration, 0u, 0xFFFFu, 0u, \
+        "a : 0.25 limits how fast it speeds up, in ticks per period per period. Then d moves it smoothly." ) \
+    X( 'm', "moving",      Moving,          0u, 0xFFFFu, 0u, \
+        "m : 0 asks if the servo is where it's going yet." ) \
+    X( 'k', "keyframe",    Keyframe,        0u, 0xFFFFu, UART_COMMAND_CHANNEL_0, \
+        "k : 1500, 25 is a keyframe: be at 1500, 25 periods after the last one." ) \
+    X( 'i', "interpolate", Interpolation,   0u, 1u,      UART_COMMAND_CHANNEL_0, \
+        "i : 0 goes in straight lines between keyframes, i : 1 in smooth curves." ) \
+    X( 'z', "stopkeys",    StopKeyframes,   0u, 0xFFFFu, UART_COMMAND_CHANNEL_0, \
+        "z : 0 stops the keyframes." ) \
+    X( 'n', "now",         Now,             0u, 0xFFFFu, 0u, \
+        "n : 0 says what tick it is. Add @ tick to a p, d, w or % to do it at that tick, like d : 150 @ 52000." ) \
+    X( 'l', "late",        Lateness,        0u, 0xFFFFu, 0u, \
+        "l : 0 says how late the waiting commands ran, l : id for one of them." ) \
+    X( 'j', "cancel",      Cancel,          0u, 0xFFFFu, 0u, \
+        "j : 0 cancels the waiting commands." ) \
+    X( 's', "sync",        Sync,            0u, 0xFFFFu, 0u, \
+        "s : your time in us syncs the clocks (send the reply's arrival time too, s : T1, T4). Then @h time uses your clock." ) \
+    X( 'o', "offset",      Offset,          0u, 0xFFFFu, 0u, \
+        "o : 0 shows the clock offset." ) \
+    X( 'b', "blocked",     Blocked,         0u, 0xFFFFu, 0u, \
+        "b : 0 tells you the longest the UART and SysTick had to wait for a critical section." ) \
+    X( 'T', "tasks",       Tasks,           0u, 0xFFFFu, 0u, \
+        "T : 0 shows how much of the CPU each task uses, T : 1000 shows it every second, T : 1 starts the numbers over." ) \
+    X( 'u', "power",       Power,           0u, 0xFFFFu, 0u, \
+        "u : 0 shows how much of the time the CPU was idle, how long it took to wake up, and how the clock speed changed." ) \
+    X( 't', "point",       TrajectoryPoint, 0u, 0xFFFFu, 0u, \
+        "t : 150 adds a point to the motion table." ) \
+    X( 'g', "go",          Go,              0u, 2u,      0u, \
+        "g : 0 plays the table in a loop, g : 1 once, g : 2 back and forth." ) \
+    X( 'h', "halt",        Halt,            0u, 0xFFFFu, 0u, \
+        "h : 0 stops playing the table." ) \
+    X( 'q', "query",       Query,           0u, 0xFFFFu, 0u, \
+        "q : 0 tells you where the table is up to." ) \
+    X( 'c', "code",        Code,            0u, 0xFFFFu, 0u, \
+        "c : 1 adds a number to the motion script (motion_script_asm.py writes these lines for you)." ) \
+    X( 'y', "script",      Script,          0u, 5u,      0u, \
+        "y : 1 runs the motion script, y : 0 says where it's up to, y : 2 stops it, y : 3 clears it, y : 4 saves it, y : 5 loads it." ) \
+    X( 'S', "store",       StorePreset,     0u, PRESETS_MAX_SLOTS - 1u, 0u, \
+        "S : 2 stores where every servo is now in preset slot 2." ) \
+    X( 'R', "recall",      RecallPreset,    0u, PRESETS_MAX_SLOTS - 1u, 0u, \
+        "R : 2 puts them all back at the next PWM frame. (A program can send the single byte 0x82 instead.)" ) \
+    X( 'K', "save",        SavePreset,      0u, PRESETS_MAX_SLOTS - 1u, 0u, \
+        "K : 2 keeps slot 2 in the EEPROM, so it's still there after the power goes off." ) \
+    X( 'P', "kp",          PidP,            0u, 0xFFFFu, 0u, \
+        "P : 1.5 sets the PID loop's proportional gain." ) \
+    X( 'I', "ki",          PidI,            0u, 0xFFFFu, 0u, \
+        "I : 2 sets its integral gain, per second." ) \
+    X( 'D', "kd",          PidD,            0u, 0xFFFFu, 0u, \
+        "D : 0.01 sets its derivative gain, in seconds." ) \
+    X( 'U', "target",      PidTarget,       0u, 0xFFFFu, 0u, \
+        "U : 0.5 sets where it holds the feedback, 0 to 1 of full scale." ) \
+    X( 'L', "loop",        PidLoop,         0u, PID_LOOP_MAX_HZ, 0u, \
+        "L : 500 runs the PID loop on servo 0, 500 times a second. L : 0 stops it. Needs a sensor, or a build with PID_LOOP_LOOPBACK for a pretend one." ) \
+    X( 'W', "window",      Window,          0u, 0xFFFFu, 0u, \
+        "W : 0 says how many numbered lines (#5 d : 150) a program can send before it hears back, and starts the numbering over." ) \
+    X( 'x', "stop",        StopPwm,         0u, 0xFFFFu, UART_COMMAND_IMMEDIATE, \
+        "x stops the PWM." ) \
+    X( 'e', "start",       StartPwm,        0u, 0xFFFFu, UART_COMMAND_IMMEDIATE, \
+        "e re-enables the PWM." )
+
+typedef struct
+{
+    char letter;
+    const char * word;
+    uint8 flags;
+    uint16 lowest;
+    uint16 highest;
+    CommandAcks_Status (*run)(uint8 quiet);
+    const char * help;
+} UART_Command;
+
+#endif //UART_COMMANDS_H
+
+/* [] END OF FILE */
@@ -20,6 +20,52 @@
 #include <project.h>
 // stdio.h provides the sprintf and sscanf functions for working with strings.
 #include "stdio.h"
+// Every time the PWM changes, we save a copy that survives a software reset.
+#include "warm_restart.h"
+// Each received byte tells the clock governor that there's work to do.
+#include "clock_governor.h"
+// The UART wakes the CPU up from idle, so it tells the idle manager.
+#include "idle_manager.h"
+// p and d commands go to a channel of the servo bank, which writes them to the PWM at the next frame.
+#include "servo_bank.h"
+// t, g, h and q upload and play back a whole motion.
+#include "trajectory.h"
+// f, w and % take Hz, microseconds and percent instead of clock ticks.
+#include "units.h"
+// f picks the PWM clock divider along with the period.
+#include "pwm_frequency.h"
+// r sets a duty cycle in between two compare values.
+#include "dither.h"
+// strchr, to find the number after the colon for %.
+#include <string.h>
+// isalpha, to find where a command's word ends.
+#include <ctype.h>
+// d, w and % move the servo at a limited speed, if v and a have set one.
+#include "motion_limiter.h"
+// k, i and z play smooth motions from a few keyframes.
+#include "keyframes.h"
+// "@ tick" at the end of a line makes it wait for that tick.
+#include "command_schedule.h"
+// The tick that "@" counts in.
+#include "timer_service.h"
+// s lines up the PC's clock with the PSoC's, so "@h" can use the PC's time.
+#include "clock_sync.h"
+// b reports how long the critical sections held the interrupts off.
+#include "priority_section.h"
+// A finished line is handed to the UART line task, and T asks the telemetry task for its report.
+#include "app_tasks.h"
+// The slots of lines waiting for the UART line task.
+#include "lockfree_queue.h"
+// Numbered lines get acks instead of replies.
+#include "command_acks.h"
+// c uploads a motion script, and y runs it.
+#include "motion_script.h"
+// S, R and K store, recall and save presets. The ISR takes the single-byte recall.
+#include "presets.h"
+// P, I, D, U and L tune and run the PID loop.
+#include "pid_loop.h"
+// The table of commands.
+#include "uart_commands.h"
 
 // We're going to define the size of the character array for the transmission
 // back to the PC. This is in bytes: if a uint8 is one character, we can store
@@ -49,9 +95,30 @@ static uint8 num_chars_received = 0;
 
 // Also, keep the buffer as a global variable instead of creating it inside the ISR.
 // This is for efficiency, and since we'll need to send back a string of characters with numbers also inside it.
-static char transmit_buffer[TRANSMIT_LENGTH];
+// DMA_INIT_ZEROED means the startup code skips these, and the DMA zeroes them instead (see dma_init.h).
+DMA_INIT_ZEROED static char transmit_buffer[TRANSMIT_LENGTH];
 // similarly, we want a receive buffer, for taking in multiple characters as they are sent to the PSoC.
-static char receive_buffer[RECEIVE_LENGTH];
+DMA_INIT_ZEROED static char receive_buffer[RECEIVE_LENGTH];
+// When a line is done, the ISR copies it into one of these for the UART line task (see app_tasks.h),
+// so the next lines can come in while this one is being worked on. A program on the PC can send this many
+// numbered lines before it hears back (the "window", see command_acks.h). Must be a power of two.
+#define LINE_SLOTS 8u
+DMA_INIT_ZEROED static char lines[LINE_SLOTS][RECEIVE_LENGTH];
+// Which slots have a line in them, oldest first. The ISR pushes, the task pops once it's done with the line,
+// and the ISR doesn't touch a slot in between.
+static uint32 line_queue_items[LINE_SLOTS];
+static LockFreeQueue_Spsc line_queue = { 0, 0, LINE_SLOTS - 1u, line_queue_items };
+// The slot the ISR fills next.
+static uint8 line_next_slot = 0;
+// Lines that came in while every slot was full. They're thrown away.
+static uint16 lines_dropped = 0;
+// The line the task is working on (after the "#17 ", for a numbered one).
+static const char * line_buffer = lines[0];
+// 1 while the line being received started with '#': numbered lines aren't echoed.
+static uint8 receiving_numbered = 0;
+// 1 once the line being received didn't fit in receive_buffer. The rest of it is dropped.
+static uint8 receiving_too_long = 0;
+static CommandAcks acks = { LINE_SLOTS, 0, 0, 0, 0, 0 };
 
 // the data, as recorded in the helpers below. By declaring with global scope, we
 // increase efficiency. Used for both period and duty cycle.
@@ -61,6 +128,44 @@ static uint16 data = 0;
 // So, we need to store a character representing the mode.
 static char mode;
 
+// Which servo the command is for. "d : 1500" is channel 0, "d3 : 1500" is channel 3.
+static uint8 channel = 0;
+
+// "d : 1500 @ 52000" waits for tick 52000 (see command_schedule.h). Works with p, d, w and %.
+// 1 if the line had an "@", 2 once the command was handed to the schedule.
+static uint8 scheduled = 0;
+static uint32 at_tick = 0;
+// The id the schedule gave the command, 0 if it didn't fit.
+static uint16 schedule_id = 0;
+
+// When each slot's line ended (its newline arrived), on TimerService_NowUs,
+// and when the line being worked on ended. That's T2 for s.
+static uint32 line_end_times[LINE_SLOTS];
+static uint32 line_end_us = 0;
+// 1 for a slot whose line was cut short. It's reported instead of run, since the end might have changed what it meant.
+static uint8 line_too_long[LINE_SLOTS];
+
+/**
+ * Tells main() about the buffers above, so the DMA can zero them at startup.
+ * The addresses go through uintptr_t, so the cast is the same size as the pointer on a regular computer too
+ * (where only the host tests use these, and cutting them to 32 bits doesn't matter).
+ */
+uint8 UART_Helper_GetDmaInitRegions(DmaInit_Region * regions){
+    regions[0].src = 0;
+    regions[0].dst = (uint32)(uintptr_t) transmit_buffer;
+    regions[0].size = TRANSMIT_LENGTH;
+    regions[0].zero_fill = 1;
+    regions[1].src = 0;
+    regions[1].dst = (uint32)(uintptr_t) receive_buffer;
+    regions[1].size = RECEIVE_LENGTH;
+    regions[1].zero_fill = 1;
+    regions[2].src = 0;
+    regions[2].dst = (uint32)(uintptr_t) lines;
+    regions[2].size = sizeof(lines);
+    regions[2].zero_fill = 1;
+    return UART_HELPER_NUM_DMA_REGIONS;
+}
+
 /**
  * Definition of the UART ISR
  * We use the same line for the function definition, with the CY_ISR macro.
@@ -70,7 +175,14 @@ static char mode;
 CY_ISR( Interrupt_Handler_UART_Receive){
     // We assume this ISR is called when a byte is received.
     // See how the IDE doesn't give any errors, as long as we include project.h here.
+    // First thing, so the idle manager knows it was the UART that woke the CPU up.
+    IdleManager_NotifyWake();
     uint8 received_byte = UART_for_USB_GetChar();
+    uint32 newline_us;
+    const UART_Command * immediate;
+    // Characters are arriving, so the main loop should run at full speed.
+    ClockGovernor_NotifyActivity();
+    IdleManager_NotifyWork();
     
     //DEBUGGING
     /*
@@ -94,39 +206,74 @@ CY_ISR( Interrupt_Handler_UART_Receive){
         case '\n':
             // This code will run if the received byte is either a carriage return or a newline.
             // Since the PSoC received a new line...
-            // First, terminate the string. This is for the use of sscanf below.
+            // Note the time first, for clock syncing (see clock_sync.h).
+            newline_us = TimerService_NowUs();
             // Print back the newline/carriage return, to complete the "respond back to the terminal" code
-            UART_for_USB_PutString("\r\n");
+            if( !receiving_numbered ){
+                UART_for_USB_PutString("\r\n");
+            }
             // From George: strings in C are arrays of characters, and require an "end string" character at the end, 
             // so these library functions can know "how many characters are in the string."
             // So, append the end string character, which is:
             receive_buffer[num_chars_received] = '\0';
-            // Call the helper function to actually parse the whole received string, now
-            // that a newline has been received.
-            Write_PWM_and_UART();
-            // This helper will also reset the data we're tracking, and the num chars received.
-            // By "break"-ing, the next case is not executed.
-            break;
-        case 'x':
-            // Added functionality: if the user types an x, then the PWM stops.
-            UART_for_USB_PutString("\r\nStopping PWM.\r\n");
-            PWM_Servo_Stop();
-            // Reset the buffer. We'll just start writing from the start again.
-            num_chars_received = 0;
-            break;
-        case 'e':
-            // Similarly, type e to enable.
-            UART_for_USB_PutString("\r\nRestarting PWM.\r\n");
-            PWM_Servo_Start();
+            if( num_chars_received == 0 ){
+                // Nothing to do. (An empty line is usually just the other half of a \r\n.)
+            }
+            else if( LockFreeQueue_SpscCount( &line_queue ) < LINE_SLOTS ){
+                // Hand the line to the UART line task, which parses it with Write_PWM_and_UART.
+                // Parsing takes a while, and this way it doesn't hold up the ISRs.
+                line_end_times[line_next_slot] = newline_us;
+                line_too_long[line_next_slot] = receiving_too_long;
+                memcpy( lines[line_next_slot], receive_buffer, num_chars_received + 1u );
+                (void) LockFreeQueue_SpscPush( &line_queue, line_next_slot );
+                line_next_slot = (uint8)((line_next_slot + 1u) & (LINE_SLOTS - 1u));
+                AppTasks_Signal( APP_TASK_UART_LINE, APP_TASKS_EVENT_LINE );
+            }
+            else {
+                // Every slot is still waiting to be worked on.
+                lines_dropped++;
+            }
             // Reset the buffer. We'll just start writing from the start again.
             num_chars_received = 0;
+            receiving_numbered = 0;
+            receiving_too_long = 0;
+            // By "break"-ing, the next case is not executed.
             break;
         default:
+            // A preset recall byte (see presets.h) isn't part of a line: the PWM task recalls the slot right away.
+            if( received_byte >= PRESETS_RECALL_BYTE && received_byte < PRESETS_RECALL_BYTE + PRESETS_MAX_SLOTS ){
+                Presets_Request( received_byte - PRESETS_RECALL_BYTE );
+                AppTasks_Signal( APP_TASK_PWM, APP_TASKS_EVENT_PRESET );
+                break;
+            }
+            // Added functionality: some commands (x stops the PWM, e starts it) happen as soon as the letter is typed.
+            // The command table (uart_commands.h) says which ones.
+            // Only at the start of a line, though, so an e in the middle of a word like "period" is just a letter.
+            immediate = (num_chars_received == 0) ? UART_Helper_FindCommand( (char) received_byte ) : NULL;
+            if( immediate != NULL && (immediate->flags & UART_COMMAND_IMMEDIATE) != 0 ){
+                // Typed by a person, so it's not quiet.
+                (void) immediate->run( 0 );
+                // Reset the buffer. We'll just start writing from the start again.
+                num_chars_received = 0;
+                break;
+            }
             // The "default" case is "anything else", which is "store another character."
+            // But only if there's room for it and the '\0'. If not, the rest of the line is dropped (and not echoed),
+            // and the line task says it was too long, instead of running what was left.
+            if( num_chars_received >= RECEIVE_LENGTH - 1u ){
+                receiving_too_long = 1;
+                break;
+            }
             // Add to the received buffer.
             receive_buffer[num_chars_received] = received_byte;
+            // A numbered line (see command_acks.h) is from a program, so it doesn't need to see what it typed.
+            if( num_chars_received == 0 && received_byte == '#' ){
+                receiving_numbered = 1;
+            }
             // Respond back to the terminal
-            UART_for_USB_PutChar( received_byte );
+            if( !receiving_numbered ){
+                UART_for_USB_PutChar( received_byte );
+            }
             // We need to increment the counter. i++ does this without an equals sign for assignment
             num_chars_received++;
             break;
@@ -134,11 +281,799 @@ CY_ISR( Interrupt_Handler_UART_Receive){
     }
 }
 
+/**
+ * Reads the number after the colon, decimals and all, as thousandths.
+ * Returns 0 if there's no number.
+ */
+static uint8 Parse_Milli_After_Colon(uint32 * milli){
+    const char * number = strchr( line_buffer, ':' );
+    if( number == NULL ){
+        return 0;
+    }
+    number++;
+    while( *number == ' ' ){
+        number++;
+    }
+    return Units_ParseMilli( number, milli ) != 0;
+}
+
+/**
+ * For v and a: reads the number after the colon, decimals and all, as Q8 (times 256).
+ * Returns 0 if there's no number.
+ */
+static uint8 Parse_Q8_After_Colon(uint32 * value_q8){
+    uint32 milli;
+    if( !Parse_Milli_After_Colon( &milli ) ){
+        return 0;
+    }
+    // thousandths to 256ths, rounded, same as for r.
+    *value_q8 = ((milli / 1000u) << MOTION_LIMITER_FRAC_BITS)
+        + ((milli % 1000u) * (1u << MOTION_LIMITER_FRAC_BITS) + 500u) / 1000u;
+    return 1;
+}
+
+/**
+ * Sets the period of the command's channel now, or at the "@" tick.
+ * Returns the period it will have.
+ */
+static uint16 Set_Period(uint16 value){
+    if( scheduled ){
+        scheduled = 2;
+        schedule_id = CommandSchedule_Add( COMMAND_SCHEDULE_PERIOD, channel, value, at_tick );
+        return value;
+    }
+    return ServoBank_SetPeriod( channel, value );
+}
+
+/**
+ * Same for the compare value. Goes through the motion limiter either way.
+ * Returns the compare value it will have (after clamping to the channel's limits).
+ */
+static uint16 Set_Compare(uint16 value){
+    if( scheduled ){
+        value = ServoBank_ClampCompare( channel, value );
+        scheduled = 2;
+        schedule_id = CommandSchedule_Add( COMMAND_SCHEDULE_COMPARE, channel, value, at_tick );
+        return value;
+    }
+    return MotionLimiter_SetTarget( channel, value );
+}
+
+void UART_Helper_ProcessLine(void){
+    uint32 slot;
+    unsigned int sequence;
+    int prefix_length = 0;
+    uint8 numbered;
+    uint8 run = 1;
+    CommandAcks_Status status = COMMAND_ACKS_OK;
+    char ack[COMMAND_ACKS_TEXT_LENGTH];
+    if( !LockFreeQueue_SpscPeek( &line_queue, 0, &slot ) ){
+        return;
+    }
+    line_buffer = lines[slot];
+    line_end_us = line_end_times[slot];
+    // "#17 d3 : 150" is line 17 of a program's stream (see command_acks.h).
+    numbered = (line_buffer[0] == '#' && sscanf( line_buffer + 1, "%3u %n", &sequence, &prefix_length ) == 1
+        && sequence <= 0xFFu) ? 1 : 0;
+    if( numbered ){
+        line_buffer += 1 + prefix_length;
+        run = CommandAcks_Arrive( &acks, (uint8) sequence, ack );
+    }
+    else {
+        // Acks for the numbered lines before this one go first.
+        CommandAcks_Flush( &acks, ack );
+    }
+    UART_for_USB_PutString( ack );
+    if( run && line_too_long[slot] ){
+        // Whatever got cut off could have changed what the line meant, so it doesn't run.
+        status = COMMAND_ACKS_TOO_LONG;
+        if( !numbered ){
+            sprintf( transmit_buffer, "Error! That line was longer than %i characters, so it was ignored. \r\n", RECEIVE_LENGTH - 1 );
+            UART_for_USB_PutString( transmit_buffer );
+        }
+    }
+    else if( run ){
+        // A numbered line is quiet: its reply is an ack instead of a sentence.
+        status = Write_PWM_and_UART( numbered );
+    }
+    // Done with the line: the ISR can put the next one in its slot.
+    (void) LockFreeQueue_SpscPop( &line_queue, &slot );
+    if( numbered && run ){
+        CommandAcks_Done( &acks, (uint8) sequence, status, LockFreeQueue_SpscCount( &line_queue ) != 0, ack );
+        UART_for_USB_PutString( ack );
+    }
+    // One line per run, so the more urgent tasks get a turn in between. Come back for the next one.
+    if( LockFreeQueue_SpscCount( &line_queue ) != 0 ){
+        AppTasks_Signal( APP_TASK_UART_LINE, APP_TASKS_EVENT_LINE );
+    }
+}
+
+/**
+ * Now, set the period. The servo bank writes it to the PWM at the start of the next frame
+ * (see ServoBank_CommitAtFrame in the PWM task), and the warm restart snapshot is saved then too.
+ * Then send back the data that will be written, for confirmation.
+ */
+static CommandAcks_Status UART_Command_Period(uint8 quiet){
+    // In C, to concatenate a number (integer) and a string (characters), you need to...
+    // (1) store the result, as confirmed by the servo bank.
+    uint16 period_written = Set_Period( data );
+    // (2) Concatenate this data with a string of characters describing what we did
+    // Requires stdio.h (standard input/output) for the sprintf function.
+    sprintf( transmit_buffer, "PWM %i now has a period of: %i \r\n", channel, period_written);
+    // Records the mode now. The PWM registers get saved again once they're committed.
+    WarmRestart_Save( mode );
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Instead, set the compare value, the duty cycle in clock ticks.
+ * Like with the period (this one may be clamped to the channel's limits).
+ * If v and a set limits for this channel, it's a target, and the servo gets there over the next periods.
+ */
+static CommandAcks_Status UART_Command_Duty(uint8 quiet){
+    uint16 duty_written = Set_Compare( data );
+    sprintf( transmit_buffer, "PWM %i now has a duty cycle (in clock ticks) of: %i \r\n", channel, duty_written);
+    WarmRestart_Save( mode );
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Frequency in Hz, like f : 50hz. The "hz" is optional: sscanf stops at the number.
+ * This picks the Clock_PWM divider too, for the most duty cycle steps that fit in 16 bits,
+ * and keeps the pulse width the same. It all goes in at the start of the next frame.
+ */
+static CommandAcks_Status UART_Command_Frequency(uint8 quiet){
+    PwmFrequency_Solution solution;
+    if( !PwmFrequency_Request( data, &solution ) ){
+        sprintf( transmit_buffer, "Error! %i Hz is out of range. \r\n", data);
+        return COMMAND_ACKS_FAILED;
+    }
+    sprintf( transmit_buffer, "PWM %i will run at %lu.%03lu Hz: Clock_PWM divider %i, period %i \r\n", channel,
+        (unsigned long)(solution.actual_millihz / 1000u), (unsigned long)(solution.actual_millihz % 1000u),
+        solution.divider, solution.period);
+    WarmRestart_Save( mode );
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Pulse width in microseconds, like w : 1500us.
+ */
+static CommandAcks_Status UART_Command_PulseWidth(uint8 quiet){
+    uint16 duty_from_us = Set_Compare( Units_UsToTicks( Units_GetScale(), data ) );
+    sprintf( transmit_buffer, "PWM %i now has a pulse of %i us, a duty cycle (in clock ticks) of: %i \r\n", channel, data, duty_from_us);
+    WarmRestart_Save( mode );
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Duty cycle in percent, like % : 7.5. sscanf only got the 7, so read the number again, decimals and all.
+ */
+static CommandAcks_Status UART_Command_Percent(uint8 quiet){
+    uint32 milli_percent;
+    const char * number = strchr( line_buffer, ':' );
+    if( number == NULL ){
+        sprintf( transmit_buffer, "Error! Type the percent after a colon. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    number++;
+    while( *number == ' ' ){
+        number++;
+    }
+    if( Units_ParseMilli( number, &milli_percent ) == 0 || milli_percent > UNITS_PERCENT_SCALE ){
+        sprintf( transmit_buffer, "Error! The percent has to be between 0 and 100. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    uint16 duty_from_percent = Set_Compare(
+        Units_PercentToTicks( milli_percent, ServoBank_GetPeriod( channel ) ) );
+    sprintf( transmit_buffer, "PWM %i now has a duty cycle (in clock ticks) of: %i \r\n", channel, duty_from_percent);
+    WarmRestart_Save( mode );
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * A compare value with decimals, like r : 150.25. The PWM alternates between 150 and 151
+ * so the average comes out right (see dither.h). Takes over the trajectory player.
+ */
+static CommandAcks_Status UART_Command_Dither(uint8 quiet){
+    uint32 milli_compare;
+    const char * number = strchr( line_buffer, ':' );
+    if( number == NULL ){
+        sprintf( transmit_buffer, "Error! Type the compare value after a colon. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    number++;
+    while( *number == ' ' ){
+        number++;
+    }
+    if( Units_ParseMilli( number, &milli_compare ) == 0 ){
+        sprintf( transmit_buffer, "Error! That's not a number. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    // thousandths to 256ths, rounded, without overflowing 32 bits.
+    uint32 compare_q8 = ((milli_compare / 1000u) << DITHER_FRAC_BITS)
+        + ((milli_compare % 1000u) * DITHER_TABLE_LENGTH + 500u) / 1000u;
+    compare_q8 = Dither_SetCompareQ8( compare_q8 );
+    sprintf( transmit_buffer, "PWM %i now has a duty cycle (in clock ticks) of: %lu and %lu/256 \r\n", channel,
+        (unsigned long)(compare_q8 >> DITHER_FRAC_BITS), (unsigned long)(compare_q8 & (DITHER_TABLE_LENGTH - 1u)));
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Max velocity, in clock ticks per PWM period, like v2 : 1.5. 0 turns the limit off.
+ */
+static CommandAcks_Status UART_Command_MaxVelocity(uint8 quiet){
+    uint32 velocity_q8;
+    if( !Parse_Q8_After_Colon( &velocity_q8 ) ){
+        sprintf( transmit_buffer, "Error! Type the velocity after a colon. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    MotionLimiter_SetMaxVelocity( channel, velocity_q8 );
+    sprintf( transmit_buffer, "PWM %i now moves at most %lu and %lu/256 clock ticks per period. \r\n", channel,
+        (unsigned long)(velocity_q8 >> MOTION_LIMITER_FRAC_BITS), (unsigned long)(velocity_q8 & 0xFFu));
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Max acceleration, in clock ticks per period, per period, like a2 : 0.25. 0 turns the limit off.
+ */
+static CommandAcks_Status UART_Command_MaxAcceleration(uint8 quiet){
+    uint32 acceleration_q8;
+    if( !Parse_Q8_After_Colon( &acceleration_q8 ) ){
+        sprintf( transmit_buffer, "Error! Type the acceleration after a colon. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    MotionLimiter_SetMaxAcceleration( channel, acceleration_q8 );
+    sprintf( transmit_buffer, "PWM %i now speeds up by at most %lu and %lu/256 clock ticks per period, per period. \r\n", channel,
+        (unsigned long)(acceleration_q8 >> MOTION_LIMITER_FRAC_BITS), (unsigned long)(acceleration_q8 & 0xFFu));
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Is this channel still moving, and when will it get there?
+ */
+static CommandAcks_Status UART_Command_Moving(uint8 quiet){
+    if( MotionLimiter_InMotion( channel ) ){
+        sprintf( transmit_buffer, "PWM %i is moving, about %lu periods to go. \r\n", channel,
+            (unsigned long) MotionLimiter_EstimatedArrival( channel ));
+    }
+    else {
+        sprintf( transmit_buffer, "PWM %i is stopped at %i. \r\n", channel, ServoBank_GetCompare( channel ));
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * A keyframe, like k : 1500, 25: be at 1500 ticks, 25 PWM periods after the last keyframe.
+ */
+static CommandAcks_Status UART_Command_Keyframe(uint8 quiet){
+    uint16 periods = 0;
+    const char * comma = strchr( line_buffer, ',' );
+    if( comma == NULL || sscanf( comma + 1, "%hu", &periods ) != 1 || periods == 0 ){
+        sprintf( transmit_buffer, "Error! Type the number of periods after a comma, like k : 1500, 25. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    if( Keyframes_Append( data, periods ) ){
+        sprintf( transmit_buffer, "Keyframe %i in %i periods, %i waiting. \r\n", data, periods, Keyframes_GetQueued());
+    }
+    else {
+        sprintf( transmit_buffer, "Error! %i keyframes are already waiting. \r\n", (int) KEYFRAMES_RING_SIZE);
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Interpolation between keyframes: 0 = straight lines, 1 = smooth curves.
+ */
+static CommandAcks_Status UART_Command_Interpolation(uint8 quiet){
+    // The table already checked it's 0 or 1.
+    Keyframes_SetMode( (Keyframes_Mode) data );
+    sprintf( transmit_buffer, "Keyframes now use %s interpolation. \r\n", (data == KEYFRAMES_CUBIC) ? "cubic" : "linear");
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Stop the keyframes where they are, and forget the ones that were waiting.
+ */
+static CommandAcks_Status UART_Command_StopKeyframes(uint8 quiet){
+    Keyframes_Clear();
+    sprintf( transmit_buffer, "Keyframes stopped at %i. \r\n", ServoBank_GetCompare( channel ));
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Now: the tick that "@" counts in, so the PC can work out when to schedule things.
+ */
+static CommandAcks_Status UART_Command_Now(uint8 quiet){
+    sprintf( transmit_buffer, "It's tick %lu, and %i commands are waiting. \r\n",
+        (unsigned long) TimerService_Now(), CommandSchedule_GetPending());
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Lateness: l : 0 for all the scheduled commands so far, l : id for one of the latest.
+ */
+static CommandAcks_Status UART_Command_Lateness(uint8 quiet){
+    if( data == 0 ){
+        const CommandSchedule_Stats * schedule_stats = CommandSchedule_GetStats();
+        sprintf( transmit_buffer, "%lu commands ran, %lu a tick or more late. Last %lu us late, worst %lu us. %lu didn't fit.\r\n",
+            (unsigned long) schedule_stats->executed, (unsigned long) schedule_stats->late,
+            (unsigned long) schedule_stats->last_late_us, (unsigned long) schedule_stats->max_late_us,
+            (unsigned long) schedule_stats->dropped);
+    }
+    else {
+        uint32 late_us;
+        if( CommandSchedule_GetLateness( data, &late_us ) ){
+            sprintf( transmit_buffer, "Command %i ran %lu us after its tick. \r\n", data, (unsigned long) late_us);
+        }
+        else {
+            sprintf( transmit_buffer, "Command %i hasn't run, or was too long ago. \r\n", data);
+        }
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Clock sync (see clock_sync.h): s : T1, or s : T1, T4 of the last exchange. Replies with T1, T2 and T3.
+ * The times are in microseconds, so they need more than the 16 bits sscanf read above.
+ */
+static CommandAcks_Status UART_Command_Sync(uint8 quiet){
+    unsigned long host_t1 = 0;
+    unsigned long host_t4 = 0;
+    const char * number = strchr( line_buffer, ':' );
+    int times_filled = (number == NULL) ? 0 : sscanf( number + 1, "%lu , %lu", &host_t1, &host_t4 );
+    if( times_filled < 1 ){
+        sprintf( transmit_buffer, "Error! Type your clock's time after a colon, like s : 123456. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    // T3 is taken just before the reply goes out, so the sprintf is the only thing in between.
+    uint32 reply_us = ClockSync_Exchange( (uint32) host_t1, line_end_us, (times_filled == 2) ? 1 : 0, (uint32) host_t4 );
+    sprintf( transmit_buffer, "Sync %lu %lu %lu \r\n", host_t1, (unsigned long) line_end_us, (unsigned long) reply_us);
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * The PSoC's estimate of the clock offset.
+ */
+static CommandAcks_Status UART_Command_Offset(uint8 quiet){
+    const ClockSync_Estimate * sync = ClockSync_GetEstimate();
+    sprintf( transmit_buffer, "Offset %lu us, skew %ld ppb, round trip %lu us (best %lu), %u of %u samples used. \r\n",
+        (unsigned long) sync->offset_us, (long) ClockSync_SkewPpb( sync ), (unsigned long) sync->last_delay_us,
+        (unsigned long) sync->min_delay_us, sync->accepted, sync->samples);
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Blocked: how long the priority sections (see priority_section.h) held off the UART and SysTick, in CPU cycles.
+ */
+static CommandAcks_Status UART_Command_Blocked(uint8 quiet){
+    const PrioritySection_Stats * section_stats = PrioritySection_GetStats();
+    sprintf( transmit_buffer, "%lu sections, longest %lu cycles, latest %lu cycles. \r\n",
+        (unsigned long) section_stats->windows, (unsigned long) section_stats->longest_cycles,
+        (unsigned long) section_stats->last_cycles);
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Tasks: T : 0 prints how much of the CPU each task uses (see app_tasks.h), T : 1000 prints it every second,
+ * and T : 1 starts the numbers over. The report comes from the telemetry task, after this line is done.
+ */
+static CommandAcks_Status UART_Command_Tasks(uint8 quiet){
+    if( data == 1 ){
+        AppTasks_ResetStats();
+        sprintf( transmit_buffer, "Task numbers reset. %u lines were dropped so far. \r\n", lines_dropped);
+    }
+    else {
+        AppTasks_SetTelemetryPeriod( data );
+        if( data == 0 ){
+            AppTasks_Signal( APP_TASK_TELEMETRY, APP_TASKS_EVENT_REPORT );
+            sprintf( transmit_buffer, "Task report coming up. %u lines were dropped so far. \r\n", lines_dropped);
+        }
+        else {
+            sprintf( transmit_buffer, "Task report every %u ms, T : 0 stops it. \r\n", data);
+        }
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Power: u : 0 prints the idle manager's and the clock governor's numbers. Wakeups from the UART are counted,
+ * but only the SysTick's are timed (see idle_manager.h), so the worst is the SysTick's.
+ */
+static CommandAcks_Status UART_Command_Power(uint8 quiet){
+    const IdleManager_Stats * idle_stats = IdleManager_GetStats();
+    const ClockGovernor_Stats * clock_stats = ClockGovernor_GetStats();
+    sprintf( transmit_buffer, "Idle %u%%, %lu wakes (worst %lu cycles). Level %u, %lu changes of %lu-%lu cycles. \r\n",
+        (unsigned) IdleManager_IdlePercent(idle_stats), (unsigned long) idle_stats->wakeups,
+        (unsigned long) idle_stats->max_wake_cycles, (unsigned) clock_stats->level,
+        (unsigned long) clock_stats->transitions, (unsigned long) clock_stats->min_transition_cycles,
+        (unsigned long) clock_stats->max_transition_cycles);
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Junk everything that's waiting.
+ */
+static CommandAcks_Status UART_Command_Cancel(uint8 quiet){
+    CommandSchedule_Clear();
+    sprintf( transmit_buffer, "Cancelled the waiting commands. \r\n");
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Add one compare value to the trajectory table. Send a bunch of these, then a g.
+ */
+static CommandAcks_Status UART_Command_TrajectoryPoint(uint8 quiet){
+    if( Trajectory_Append( data ) ){
+        sprintf( transmit_buffer, "Trajectory point %i: %i \r\n", Trajectory_GetCount() - 1, data);
+    }
+    else {
+        sprintf( transmit_buffer, "Error! The trajectory table is full (%i points). \r\n", (int) TRAJECTORY_MAX_POINTS);
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Go: play the table, one point per PWM period. 0 = loop, 1 = once, 2 = back and forth.
+ */
+static CommandAcks_Status UART_Command_Go(uint8 quiet){
+    // The table already checked it's 0 to 2.
+    if( Trajectory_Play( (Trajectory_Mode) data ) ){
+        sprintf( transmit_buffer, "Playing %i points in mode %i. \r\n", Trajectory_GetCount(), data);
+    }
+    else {
+        sprintf( transmit_buffer, "Error! Upload some points with t first. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Halt the playback. The PWM keeps the last value.
+ */
+static CommandAcks_Status UART_Command_Halt(uint8 quiet){
+    Trajectory_Stop();
+    sprintf( transmit_buffer, "Trajectory stopped at point %i. \r\n", Trajectory_GetPosition());
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Query: where is the playback up to?
+ */
+static CommandAcks_Status UART_Command_Query(uint8 quiet){
+    sprintf( transmit_buffer, "Trajectory at point %i of %i, %s. \r\n", Trajectory_GetPosition(),
+        Trajectory_GetCount(), Trajectory_IsPlaying() ? "playing" : "stopped");
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Code: one more number for the motion script.
+ */
+static CommandAcks_Status UART_Command_Code(uint8 quiet){
+    if( MotionScript_Append( data ) ){
+        sprintf( transmit_buffer, "Script number %i: %i \r\n", MotionScript_GetLength() - 1, data);
+    }
+    else {
+        sprintf( transmit_buffer, "Error! The script is full (%i numbers). \r\n", (int) MOTION_SCRIPT_MAX_LENGTH);
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Script: run, stop, clear, save or load the motion script, or say what it's doing.
+ */
+static CommandAcks_Status UART_Command_Script(uint8 quiet){
+    const MotionScript_Vm * vm = MotionScript_GetVm();
+    MotionScript_Error error;
+    uint16 where;
+    // The table already checked it's 0 to 5.
+    switch( data ){
+        case 0:
+            if( vm->state == MOTION_SCRIPT_FAILED ){
+                sprintf( transmit_buffer, "Script stopped at %i: %s. \r\n", vm->error_pc, MotionScript_Describe( (MotionScript_Error) vm->error ));
+            }
+            else {
+                sprintf( transmit_buffer, "Script %s at %i of %i, %lu instructions so far. \r\n",
+                    (vm->state == MOTION_SCRIPT_RUNNING) ? "running" : ((vm->state == MOTION_SCRIPT_DONE) ? "done" : "stopped"),
+                    vm->pc, MotionScript_GetLength(), (unsigned long) vm->executed);
+            }
+            break;
+        case 1:
+            error = MotionScript_Start( &where );
+            if( error == MOTION_SCRIPT_OK ){
+                sprintf( transmit_buffer, "Running the script (%i numbers). \r\n", MotionScript_GetLength());
+            }
+            else {
+                sprintf( transmit_buffer, "Error! At %i: %s. \r\n", where, MotionScript_Describe( error ));
+                return COMMAND_ACKS_FAILED;
+            }
+            break;
+        case 2:
+            MotionScript_Stop();
+            sprintf( transmit_buffer, "Script stopped at %i. \r\n", vm->pc);
+            break;
+        case 3:
+            MotionScript_Clear();
+            sprintf( transmit_buffer, "Script cleared. \r\n");
+            break;
+        case 4:
+            if( !MotionScript_Save() ){
+                sprintf( transmit_buffer, "Error! The EEPROM didn't take it. \r\n");
+                return COMMAND_ACKS_FAILED;
+            }
+            sprintf( transmit_buffer, "Script saved. \r\n");
+            break;
+        default:
+            if( MotionScript_Load() ){
+                sprintf( transmit_buffer, "Loaded the saved script (%i numbers). \r\n", MotionScript_GetLength());
+            }
+            else {
+                sprintf( transmit_buffer, "Error! There's no saved script. \r\n");
+                return COMMAND_ACKS_FAILED;
+            }
+            break;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Store: the servo bank's pose, in a preset slot.
+ */
+static CommandAcks_Status UART_Command_StorePreset(uint8 quiet){
+    (void) Presets_Store( (uint8) data );
+    sprintf( transmit_buffer, "Stored preset %i (K : %i saves it in the EEPROM). \r\n", data, data);
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Recall: put a preset slot's pose back. Same as the single byte PRESETS_RECALL_BYTE + slot.
+ */
+static CommandAcks_Status UART_Command_RecallPreset(uint8 quiet){
+    if( Presets_Recall( (uint8) data ) ){
+        sprintf( transmit_buffer, "Recalled preset %i. \r\n", data);
+    }
+    else {
+        sprintf( transmit_buffer, "Error! Preset %i is empty. Store one with S first. \r\n", data);
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Save: keep a preset slot in the EEPROM.
+ */
+static CommandAcks_Status UART_Command_SavePreset(uint8 quiet){
+    if( !Presets_IsStored( (uint8) data ) ){
+        sprintf( transmit_buffer, "Error! Preset %i is empty. Store one with S first. \r\n", data);
+        return COMMAND_ACKS_FAILED;
+    }
+    else if( Presets_Save( (uint8) data ) ){
+        sprintf( transmit_buffer, "Saved preset %i in the EEPROM. \r\n", data);
+    }
+    else {
+        sprintf( transmit_buffer, "Error! The EEPROM didn't take preset %i. \r\n", data);
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * P, I and D: the PID loop's gains, decimals and all, like I : 2.5. See pid_loop.h.
+ */
+static CommandAcks_Status Set_Pid_Gain(PidLoop_Term term, const char * name, const char * unit){
+    uint32 milli;
+    if( !Parse_Milli_After_Colon( &milli ) ){
+        sprintf( transmit_buffer, "Error! Type %s after a colon. \r\n", name);
+        return COMMAND_ACKS_FAILED;
+    }
+    PidLoop_SetGain( term, milli );
+    sprintf( transmit_buffer, "%s is now %lu.%03lu%s. \r\n", name,
+        (unsigned long)(milli / 1000u), (unsigned long)(milli % 1000u), unit);
+    return COMMAND_ACKS_OK;
+}
+
+static CommandAcks_Status UART_Command_PidP(uint8 quiet){
+    return Set_Pid_Gain( PID_LOOP_P, "kp", "" );
+}
+
+static CommandAcks_Status UART_Command_PidI(uint8 quiet){
+    return Set_Pid_Gain( PID_LOOP_I, "ki", " per second" );
+}
+
+static CommandAcks_Status UART_Command_PidD(uint8 quiet){
+    return Set_Pid_Gain( PID_LOOP_D, "kd", " seconds" );
+}
+
+/**
+ * U: where the PID loop holds the feedback, from 0 to 1 (full scale), like U : 0.25.
+ */
+static CommandAcks_Status UART_Command_PidTarget(uint8 quiet){
+    uint32 milli;
+    if( !Parse_Milli_After_Colon( &milli ) || milli > 1000u ){
+        sprintf( transmit_buffer, "Error! Type a target from 0 to 1 after a colon. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    PidLoop_SetSetpoint( (int16)((milli * PID_LOOP_Q15_ONE + 500u) / 1000u) );
+    sprintf( transmit_buffer, "PID target is now %lu.%03lu of full scale. \r\n",
+        (unsigned long)(milli / 1000u), (unsigned long)(milli % 1000u));
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * L: L3 : 500 runs the PID loop 500 times a second on servo 3. L : 0 stops it, and says how it was doing.
+ */
+static CommandAcks_Status UART_Command_PidLoop(uint8 quiet){
+    PidLoop_Status pid;
+    if( data == 0 ){
+        PidLoop_Stop();
+        PidLoop_GetStatus( &pid );
+        sprintf( transmit_buffer, "PID stopped after %lu samples. Last: feedback %i, output %i. Cycles: %lu, most %lu. \r\n",
+            (unsigned long) pid.iterations, pid.feedback, pid.output,
+            (unsigned long) pid.last_cycles, (unsigned long) pid.max_cycles);
+    }
+    else if( PidLoop_Start( channel, data ) ){
+        PidLoop_GetStatus( &pid );
+        sprintf( transmit_buffer, "PID running on PWM %i at %u Hz. L : 0 stops it. \r\n", channel, pid.rate_hz);
+    }
+    else {
+        sprintf( transmit_buffer, "Error! The PID loop has no feedback: no sensor, and not built with PID_LOOP_LOOPBACK. \r\n");
+        return COMMAND_ACKS_FAILED;
+    }
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Window: how many numbered lines can be on their way at once (see command_acks.h).
+ * The next numbered line can have any number, so a program can start over.
+ */
+static CommandAcks_Status UART_Command_Window(uint8 quiet){
+    CommandAcks_Reset( &acks, LINE_SLOTS );
+    sprintf( transmit_buffer, "Window %u. Start numbering anywhere from 0 to 255, like #0 d : 150. \r\n", (unsigned) LINE_SLOTS);
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * x stops the PWM, right from the ISR.
+ */
+static CommandAcks_Status UART_Command_StopPwm(uint8 quiet){
+    // On a numbered line, the ack is the only reply.
+    if( !quiet ){
+        UART_for_USB_PutString("\r\nStopping PWM.\r\n");
+    }
+    PWM_Servo_Stop();
+    WarmRestart_Save( 'x' );
+    return COMMAND_ACKS_OK;
+}
+
+/**
+ * Similarly, e to enable.
+ */
+static CommandAcks_Status UART_Command_StartPwm(uint8 quiet){
+    if( !quiet ){
+        UART_for_USB_PutString("\r\nRestarting PWM.\r\n");
+    }
+    PWM_Servo_Start();
+    WarmRestart_Save( 'e' );
+    return COMMAND_ACKS_OK;
+}
+
+// The command table (see uart_commands.h), built from UART_COMMANDS three times over.
+// The number of each command.
+#define UART_COMMAND_ENUM(letter, word, name, lowest, highest, flags, help) UART_COMMAND_ID_##name,
+enum { UART_COMMANDS(UART_COMMAND_ENUM) UART_COMMAND_COUNT };
+// Each command's description, in flash.
+#define UART_COMMAND_ENTRY(letter, word, name, lowest, highest, flags, help) \
+    { letter, word, flags, lowest, highest, UART_Command_##name, help },
+static const UART_Command commands[UART_COMMAND_COUNT] = { UART_COMMANDS(UART_COMMAND_ENTRY) };
+// Letter to command number + 1, so every other letter is 0.
+#define UART_COMMAND_INDEX(letter, word, name, lowest, highest, flags, help) [letter] = UART_COMMAND_ID_##name + 1u,
+static const uint8 command_index[128] = { UART_COMMANDS(UART_COMMAND_INDEX) };
+
+// And the perfect hash for the words, which uart_command_hash.py writes from the same table.
+#include "uart_command_hash.h"
+// If this line doesn't compile, a command was added or removed since uart_command_hash.h was written.
+// Run uart_command_hash.py again (see uart_commands.h).
+typedef char uart_command_hash_is_out_of_date[(UART_COMMAND_HASH_COUNT == UART_COMMAND_COUNT) ? 1 : -1];
+
+// The "that's not a command" reply lists the letters, 3 characters each at most ("p, " and so on, and " or " is one more
+// than ", " with one less after the last letter), plus the start, ". \r\n" and the '\0'. If this line doesn't compile,
+// there are too many commands for the transmit buffer: make UART_HELPER_UNKNOWN_START shorter, or TRANSMIT_LENGTH bigger.
+#define UART_HELPER_UNKNOWN_START "Error! Try "
+typedef char uart_unknown_reply_is_too_long[
+    (sizeof(UART_HELPER_UNKNOWN_START) - 1u + 3u * UART_COMMAND_COUNT + 4u + 1u <= TRANSMIT_LENGTH) ? 1 : -1];
+
+const UART_Command * UART_Helper_FindCommand(char letter){
+    uint8 index = ((uint8) letter < 128u) ? command_index[(uint8) letter] : 0u;
+    return (index == 0) ? NULL : &commands[index - 1u];
+}
+
+/**
+ * FNV-1a, a simple hash that mixes in one character at a time.
+ * uart_command_hash.py has the same one, and they have to match.
+ */
+static uint32 UART_Helper_HashWord(const char * word, uint8 length, uint32 seed){
+    uint32 hash = seed;
+    uint8 i;
+    for( i = 0; i < length; i++){
+        hash = (hash ^ (uint8) word[i]) * 16777619u;
+    }
+    return hash;
+}
+
+const UART_Command * UART_Helper_FindWord(const char * word, uint8 length){
+    // Which bucket the word is in...
+    int16 displace = command_hash_displace[UART_Helper_HashWord( word, length, UART_COMMAND_HASH_BASIS ) % UART_COMMAND_HASH_COUNT];
+    // ...says which slot it's in: right there if the bucket had only one word, or from a second hash if not.
+    uint8 slot = (displace < 0) ? (uint8)(-displace - 1)
+        : (uint8)(UART_Helper_HashWord( word, length, (uint32) displace ) % UART_COMMAND_HASH_COUNT);
+    const UART_Command * command = &commands[command_hash_slot[slot]];
+    // Any word at all lands in some slot, so check it's really this one.
+    if( strncmp( command->word, word, length ) != 0 || command->word[length] != '\0' ){
+        return NULL;
+    }
+    return command;
+}
+
+uint8 UART_Helper_CheckCommands(void){
+    uint8 i;
+    for( i = 0; i < UART_COMMAND_COUNT; i++){
+        // If another command has the same letter, the index points there instead.
+        if( UART_Helper_FindCommand( commands[i].letter ) != &commands[i] ){
+            return 0;
+        }
+        // And if a word changed since uart_command_hash.h was written, it isn't in its slot.
+        if( UART_Helper_FindWord( commands[i].word, (uint8) strlen( commands[i].word ) ) != &commands[i] ){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void UART_Helper_PrintHelp(void){
+    uint8 i;
+    for( i = 0; i < UART_COMMAND_COUNT; i++){
+        UART_for_USB_PutString( commands[i].word );
+        UART_for_USB_PutString( " or " );
+        UART_for_USB_PutString( commands[i].help );
+        UART_for_USB_PutString( " \r\n" );
+    }
+}
+
+/**
+ * Writes the letters of the commands that have all of 'flags' into out, like "p, d, w or %".
+ * The ones that happen in the ISR are left out, since they're not really typed as lines.
+ * Returns the end of what it wrote.
+ */
+static char * UART_Helper_ListCommands(char * out, uint8 flags, const char * last_joiner){
+    uint8 i;
+    uint8 total = 0;
+    uint8 listed = 0;
+    for( i = 0; i < UART_COMMAND_COUNT; i++){
+        if( (commands[i].flags & (flags | UART_COMMAND_IMMEDIATE)) == flags ){
+            total++;
+        }
+    }
+    for( i = 0; i < UART_COMMAND_COUNT; i++){
+        if( (commands[i].flags & (flags | UART_COMMAND_IMMEDIATE)) != flags ){
+            continue;
+        }
+        if( listed != 0 ){
+            out += sprintf( out, (listed + 1u == total) ? " %s " : ", ", last_joiner );
+        }
+        *out++ = commands[i].letter;
+        listed++;
+    }
+    *out = '\0';
+    return out;
+}
+
 /**
  *Helper function that does the writing to the PWM and UART.
- * makes the ISR code easier to understand.
+ * makes the line task's code easier to understand.
  */
-void Write_PWM_and_UART(){
+CommandAcks_Status Write_PWM_and_UART(uint8 quiet){
     // OK, so now, we have a string in the receive buffer,
     // ideally of the form "(p/d) : somenumber".
     
@@ -146,62 +1081,156 @@ void Write_PWM_and_UART(){
     // the following lines to reply with the string that was received:
     /*
     UART_for_USB_PutString("Received the string: ");
-    UART_for_USB_PutString( receive_buffer );
+    UART_for_USB_PutString( line_buffer );
     UART_for_USB_PutString("\r\n");
     */
     
-    // Read in both the mode (p or d) and the integer afterward
-    // The %c specified is for a single character
+    // First, the command: a letter (p), or a word (period). The word is all the letters up to the
+    // channel number or the colon. Look it up in the command table (see uart_commands.h).
+    const UART_Command * command;
+    uint8 length = 0;
+    // How it went, for a numbered line's ack.
+    CommandAcks_Status status = COMMAND_ACKS_OK;
+    while( length <= UART_COMMAND_WORD_LENGTH && (isalpha( (unsigned char) line_buffer[length] ) || line_buffer[length] == '%') ){
+        length++;
+    }
+    if( length > 1 ){
+        command = UART_Helper_FindWord( line_buffer, length );
+    }
+    else {
+        // Anything else is one character, like it always was.
+        length = (line_buffer[0] != '\0') ? 1 : 0;
+        command = UART_Helper_FindCommand( line_buffer[0] );
+    }
+    // The mode is the letter, whichever way it was typed, so the rest of the code doesn't have to care.
+    mode = (command != NULL) ? command->letter : line_buffer[0];
+    
+    // Then the integer afterward.
     // The %hu specifier is for unsigned shorts (16 bit integers)
     // A good resource on scanf and printf specifiers is https://www.tutorialspoint.com/c_standard_library/c_function_sscanf.htm
-    // Let's also check: did we store both a char and a uint16? Check the number of 'things' pulled out of the string.
+    // Let's also check: did we store a uint16? Check the number of 'things' pulled out of the string.
     int num_var_filled;
-    // actually scan in the character and integer. See documentation for the sscanf function.
+    // actually scan in the integer. See documentation for the sscanf function.
     // sscanf requires the address-of (&) for the variable to be written.
-    num_var_filled = sscanf( receive_buffer, "%c : %hu", &mode, &data);
-    // Need to check: was anything received? Equivalently, did sscanf find exactly one character, and one uint16?
-    if( num_var_filled != 2){
-        UART_for_USB_PutString("Error! incorrect data. Did you type a number after a (p or d), a colon, and the spaces between?\r\n");
+    // First, try with a channel number right after the command (%hhu is an unsigned char, a uint8).
+    num_var_filled = sscanf( line_buffer + length, "%hhu : %hu", &channel, &data);
+    if( num_var_filled == 2 ){
+        // both found, so that's a channel-indexed command.
+        num_var_filled = 1;
+    }
+    else {
+        // Otherwise, it's the original form, for channel 0.
+        channel = 0;
+        num_var_filled = sscanf( line_buffer + length, " : %hu", &data);
+    }
+    // Need to check: was anything received? Equivalently, did sscanf find exactly one uint16?
+    // (stop and start don't need one.)
+    if( num_var_filled != 1 && (command == NULL || (command->flags & UART_COMMAND_IMMEDIATE) == 0) ){
+        if( !quiet ){
+            UART_for_USB_PutString("Error! incorrect data. Did you type a number after a (p or d), a colon, and the spaces between?\r\n");
+        }
+        status = COMMAND_ACKS_BAD_NUMBER;
         data = 0;
     }
     
-    // Depending on the mode, write either the period or the duty cycle:
-    switch( mode )
+    // 1 if there was an "@" that didn't work out.
+    uint8 at_error = 0;
+    
+    // Is there an "@ tick" at the end? Only the commands with UART_COMMAND_AT can wait.
+    // "@h" is a time on the PC's clock instead, in microseconds.
     {
-        case 'p':
-            // Now, set the period, 
-            PWM_Servo_WritePeriod( data );
-            // and send back the data that was just written, for confirmation.
-            // In C, to concatenate a number (integer) and a string (characters), you need to...
-            // (1) store the result, as confirmed by the PWM component.
-            uint16 period_written = PWM_Servo_ReadPeriod();
-            // (2) Concatenate this data with a string of characters describing what we did
-            // Requires stdio.h (standard input/output) for the sprintf function.
-            sprintf( transmit_buffer, "PWM now has a period of: %i \r\n", period_written);
-            break;
-        case 'd':
-            // Instead, set the compare value, the duty cycle in clock ticks.
-            PWM_Servo_WriteCompare( data );
-            // Like with the period:
-            uint16 duty_written = PWM_Servo_ReadCompare();
-            sprintf( transmit_buffer, "PWM now has a duty cycle (in clock ticks) of: %i \r\n", duty_written);
-            break;
-        default:
-            // Print an error message if any other character besides a p or d was typed
-            sprintf( transmit_buffer, "Error! You didn't type a p or d. \r\n");
-            mode = 0;
-            break;
-    } 
+        const char * at = strchr( line_buffer, '@' );
+        unsigned long tick;
+        uint8 host_time;
+        scheduled = 0;
+        if( at != NULL ){
+            at++;
+            while( *at == ' ' ){
+                at++;
+            }
+            host_time = (*at == 'h') ? 1 : 0;
+            if( command != NULL && (command->flags & UART_COMMAND_AT) != 0 && sscanf( at + host_time, "%lu", &tick ) == 1
+                && (!host_time || ClockSync_HostToTick( (uint32) tick, &at_tick )) ){
+                scheduled = 1;
+                if( !host_time ){
+                    at_tick = (uint32) tick;
+                }
+            }
+            else {
+                at_error = 1;
+            }
+        }
+    }
     
+    // Check the command against its line in the table, then run it.
+    if( command == NULL ){
+        // Print an error message if any other character was typed
+        status = COMMAND_ACKS_UNKNOWN;
+        char * end = transmit_buffer + sprintf( transmit_buffer, UART_HELPER_UNKNOWN_START );
+        end = UART_Helper_ListCommands( end, 0, "or" );
+        sprintf( end, ". \r\n" );
+    }
+    else if( channel >= SERVO_BANK_MAX_CHANNELS ){
+        // The servo bank only has so many channels.
+        status = COMMAND_ACKS_BAD_CHANNEL;
+        sprintf( transmit_buffer, "Error! There are only %i channels. \r\n", (int) SERVO_BANK_MAX_CHANNELS);
+    }
+    else if( (command->flags & UART_COMMAND_CHANNEL_0) != 0 && channel != 0 ){
+        status = COMMAND_ACKS_BAD_CHANNEL;
+        char * end = transmit_buffer + sprintf( transmit_buffer, "Error! " );
+        end = UART_Helper_ListCommands( end, UART_COMMAND_CHANNEL_0, "and" );
+        sprintf( end, " only work on channel 0. \r\n" );
+    }
+    else if( at_error ){
+        status = COMMAND_ACKS_BAD_AT;
+        char * end = transmit_buffer + sprintf( transmit_buffer, "Error! Only " );
+        end = UART_Helper_ListCommands( end, UART_COMMAND_AT, "and" );
+        sprintf( end, " can wait for a tick, like d : 150 @ 52000 (or @h for the PC's time, after syncing with s). \r\n" );
+    }
+    else if( data < command->lowest || data > command->highest ){
+        status = COMMAND_ACKS_BAD_NUMBER;
+        sprintf( transmit_buffer, "Error! %c takes a number from %u to %u. \r\n", mode, command->lowest, command->highest );
+    }
+    else if( quiet && status != COMMAND_ACKS_OK ){
+        // A numbered line doesn't run with a made-up number. The ack says what was wrong.
+    }
+    else {
+        // Most commands write their reply into transmit_buffer. stop and start print theirs right away,
+        // unless the line is quiet. Each one says how it went.
+        transmit_buffer[0] = '\0';
+        status = command->run( quiet );
+        // A command that was handed to the schedule worked, but only if the schedule had room for it.
+        if( status == COMMAND_ACKS_OK && scheduled == 2 && schedule_id == 0 ){
+            status = COMMAND_ACKS_FAILED;
+        }
+    }
+    
+    // A numbered line just gets its ack, from UART_Helper_ProcessLine.
+    if( quiet ){
+        scheduled = 0;
+        data = 0;
+        return status;
+    }
     // send the byte back to your PC so you know what you set
-    UART_for_USB_PutString( transmit_buffer );    
+    UART_for_USB_PutString( transmit_buffer );
+    // A command that's waiting for its tick hasn't happened yet, so say when it will.
+    if( scheduled == 2 ){
+        if( schedule_id != 0 ){
+            sprintf( transmit_buffer, "That's command %i, at tick %lu (it's %lu now). \r\n", schedule_id,
+                (unsigned long) at_tick, (unsigned long) TimerService_Now());
+        }
+        else {
+            sprintf( transmit_buffer, "Error! %i commands are already waiting, so that one was dropped. \r\n", (int) COMMAND_SCHEDULE_MAX_ENTRIES);
+        }
+        UART_for_USB_PutString( transmit_buffer );
+    }
+    scheduled = 0;
     // to make this easier to read, send another newline.
     UART_for_USB_PutString("\r\n");
-    // Reset the indexing into the array
-    num_chars_received = 0;
-    // and just in case let's do the data too.
+    // Reset the data, just in case. (The ISR already reset the indexing into the receive buffer.)
     data = 0;
     // Note that we don't have to reset the buffer here, since sscanf only reads up until the first '\0'.
+    return status;
 }
 
 /* [] END OF FILE */
@@ -41,19 +41,54 @@
 // And, you can look for lines in the files included in project.h, see things like "#if !defined(CYDEVICE_H)",
 // to convince yourself that Cypress also uses include guards.
 #include <project.h>
+// for DmaInit_Region
+#include "dma_init.h"
+// for UART_Command
+#include "uart_commands.h"
+// for CommandAcks_Status
+#include "command_acks.h"
+
+// How many buffers UART_Helper_GetDmaInitRegions describes.
+#define UART_HELPER_NUM_DMA_REGIONS 3
 
 // Handler for receiving UART data. Does the following:
+// 1) Echoes each character and stores it
+// 2) When a line is done, hands it to the UART line task (see app_tasks.h)
+// (x and e at the start of a line still stop and start the PWM right away.)
+// THIS IS ONLY A DECLARATION. The definition is in the .c file.
+CY_ISR( Interrupt_Handler_UART_Receive);
+
+// The UART line task: if the ISR handed over a line (it holds several), this does the following for the oldest one:
 // 1) Parses the command received
 // 2) Sets the PWM block parameters
 // 3) Sends a response back over UART, with the new settings confirmed.
-// THIS IS ONLY A DECLARATION. The definition is in the .c file.
-CY_ISR( Interrupt_Handler_UART_Receive);
+void UART_Helper_ProcessLine(void);
 
 // Another helper that does the writing to the PWM and UART upon receipt of a newline,
-// making the ISR cleaner.
+// called by UART_Helper_ProcessLine. Returns how it went, for a numbered line's ack (see command_acks.h).
+// 'quiet' is 1 for a numbered line: nothing gets printed, since the ack is its reply.
 // We don't need to pass in the period here since it's a global variable
 // DREW TO-DO: move the global variables into the header file not in the c file
-void Write_PWM_and_UART();
+CommandAcks_Status Write_PWM_and_UART(uint8 quiet);
+
+// The command for a letter, from the table in uart_commands.h. NULL if there isn't one.
+const UART_Command * UART_Helper_FindCommand(char letter);
+
+// The command for a word, like "period", from its first 'length' characters. NULL if there isn't one.
+// Takes the same time however many commands there are (see uart_commands.h).
+const UART_Command * UART_Helper_FindWord(const char * word, uint8 length);
+
+// 1 if every command in the table can be found by its letter and its word
+// (0 means two have the same letter, or uart_command_hash.h needs to be written again).
+uint8 UART_Helper_CheckCommands(void);
+
+// Prints every command's help line, for the startup banner.
+void UART_Helper_PrintHelp(void);
+
+// The transmit and receive buffers are zeroed by DMA at startup instead of by Start_c.
+// This fills in the regions array (which must have room for UART_HELPER_NUM_DMA_REGIONS)
+// and returns how many were filled in. See dma_init.h.
+uint8 UART_Helper_GetDmaInitRegions(DmaInit_Region * regions);
 
 #endif //UART_HELPER_FCNS_H
 
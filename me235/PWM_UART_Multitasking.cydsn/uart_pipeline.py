@@ -0,0 +1,184 @@
+#!/usr/bin/env python
+# ========================================
+#
+# Copyright Andrew P. Sabelhaus, 2018
+# See README and LICENSE for more details.
+#
+# ========================================
+
+"""
+uart_pipeline.py
+Sends a list of commands to the PSoC as numbered lines (see command_acks.h), keeping a window of them
+on their way at once, instead of waiting for each reply:
+    python uart_pipeline.py COM5 commands.txt
+    python uart_pipeline.py /dev/ttyACM0 commands.txt
+One command per line in the file, like "d3 : 150" (no # or number, this adds those). Blank lines and
+anything after a ; are skipped. It prints which commands didn't work, and how many commands a second it managed.
+
+It asks the PSoC for the window with W first, so the numbering starts over, and it uses the whole window unless
+--window says fewer. --window 1 waits for every ack, like a person typing (but with short replies).
+It uses pyserial if it's installed. Without it, the port has to be a POSIX tty (Linux or Mac).
+
+To use it from another program:
+    from uart_pipeline import Pipeline
+    link = Pipeline(open_port('COM5'))
+    failed = link.send(['d3 : 150', 'd4 : 200'])
+"""
+
+import collections
+import os
+import sys
+import time
+
+BAUD = 115200
+# The CommandAcks_Status numbers.
+STATUS = {1: 'no such command', 2: 'bad number', 3: 'bad channel', 4: 'bad @', 5: 'the command failed', 6: 'lost',
+          7: 'line too long'}
+LOST = 6
+
+
+class PosixPort(object):
+    # Just enough of pyserial's Serial, on a POSIX tty.
+    def __init__(self, path, baud=BAUD):
+        import termios
+        import tty
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        attributes = termios.tcgetattr(self.fd)
+        speed = getattr(termios, 'B%d' % baud)
+        attributes[4] = attributes[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attributes)
+
+    def write(self, data):
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def read_some(self, timeout):
+        import select
+        if not select.select([self.fd], [], [], timeout)[0]:
+            return b''
+        return os.read(self.fd, 4096)
+
+
+class SerialPort(object):
+    def __init__(self, path, baud=BAUD):
+        import serial
+        self.port = serial.Serial(path, baud, timeout=0)
+
+    def write(self, data):
+        self.port.write(data)
+
+    def read_some(self, timeout):
+        self.port.timeout = timeout
+        first = self.port.read(1)
+        return first + self.port.read(self.port.in_waiting) if first else b''
+
+
+def open_port(path, baud=BAUD):
+    try:
+        return SerialPort(path, baud)
+    except ImportError:
+        return PosixPort(path, baud)
+
+
+class Pipeline(object):
+    def __init__(self, port, window=None, timeout=1.0):
+        self.port = port
+        self.timeout = timeout
+        self.pending = b''
+        # W starts the numbering over, and says how big the window is.
+        self.port.write(b'W : 0\r')
+        reply = self._read_line(lambda line: line.startswith('Window '))
+        if reply is None:
+            raise IOError('no answer to W : 0. Is the PSoC running, and is the port right?')
+        self.window = int(reply.split()[1].rstrip('.'))
+        if window is not None:
+            self.window = max(1, min(window, self.window))
+        self.sequence = 0
+
+    def _read_line(self, wanted, timeout=None):
+        # The next line that 'wanted' says yes to. Anything else (the banner, a T report) is skipped.
+        deadline = time.time() + (self.timeout if timeout is None else timeout)
+        while True:
+            while b'\n' in self.pending:
+                line, self.pending = self.pending.split(b'\n', 1)
+                line = line.decode('ascii', 'replace').strip()
+                if wanted(line):
+                    return line
+            left = deadline - time.time()
+            if left <= 0:
+                return None
+            self.pending += self.port.read_some(left)
+
+    def send(self, commands):
+        # Returns a list of (command, reason) for the ones that didn't work.
+        failed = []
+        # (sequence, command) that are sent but not acked yet, oldest first.
+        in_flight = collections.deque()
+        queue = collections.deque(commands)
+        while queue or in_flight:
+            while queue and len(in_flight) < self.window:
+                command = queue.popleft()
+                in_flight.append((self.sequence, command))
+                self.port.write(('#%d %s\r' % (self.sequence, command)).encode('ascii'))
+                self.sequence = (self.sequence + 1) % 256
+            ack = self._read_line(lambda line: line[:1] in ('=', '!'))
+            if ack is None:
+                # Nothing for a while: send the oldest one again. If it already ran, the PSoC says which one
+                # it wants next, with a lost.
+                sequence, command = in_flight[0]
+                self.port.write(('#%d %s\r' % (sequence, command)).encode('ascii'))
+                continue
+            words = ack[1:].split()
+            sequence = int(words[0])
+            if ack[0] == '!' and int(words[1]) == LOST:
+                # Everything before 'sequence' ran. Send the rest again, from 'sequence'.
+                while in_flight and in_flight[0][0] != sequence:
+                    in_flight.popleft()
+                queue.extendleft(reversed([command for _, command in in_flight]))
+                in_flight.clear()
+                self.sequence = sequence
+                continue
+            # = or a !: everything up to 'sequence' is done.
+            if sequence not in [s for s, _ in in_flight]:
+                continue
+            while in_flight:
+                done, command = in_flight.popleft()
+                if done == sequence:
+                    if ack[0] == '!':
+                        failed.append((command, STATUS.get(int(words[1]), 'status %s' % words[1])))
+                    break
+        return failed
+
+
+def read_commands(path):
+    commands = []
+    for line in open(path):
+        line = line.split(';')[0].strip()
+        if line:
+            commands.append(line)
+    return commands
+
+
+def main():
+    args = sys.argv[1:]
+    window = None
+    if '--window' in args:
+        where = args.index('--window')
+        window = int(args[where + 1])
+        del args[where:where + 2]
+    if len(args) != 2:
+        sys.exit('usage: python uart_pipeline.py [--window N] port commands.txt')
+    commands = read_commands(args[1])
+    link = Pipeline(open_port(args[0]), window)
+    start = time.time()
+    failed = link.send(commands)
+    seconds = time.time() - start
+    for command, reason in failed:
+        print('%s: %s' % (command, reason))
+    print('%d commands (%d failed) in %.3f s with a window of %d: %.0f commands a second'
+          % (len(commands), len(failed), seconds, link.window, len(commands) / max(seconds, 1e-9)))
+
+
+if __name__ == '__main__':
+    main()
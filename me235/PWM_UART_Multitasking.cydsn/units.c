@@ -0,0 +1,87 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See units.h for the big picture.
+#include "units.h"
+#include <project.h>
+// The bus clock, which the governor changes.
+#include "clock_governor.h"
+
+static Units_Scale cached;
+
+void Units_ComputeScale(uint32 bus_hz, uint16 divider, Units_Scale * scale){
+    uint32 pwm_hz = bus_hz / ((uint32) divider + 1u);
+    scale->bus_hz = bus_hz;
+    scale->divider = divider;
+    scale->pwm_hz = pwm_hz;
+    // pwm_hz * 2^32 / 1000000, rounded.
+    scale->ticks_per_us_fixed = (((uint64) pwm_hz << UNITS_TICKS_PER_US_SHIFT) + 500000u) / 1000000u;
+    // 65536 ticks' worth of microseconds, rounded up. At least 2730 us (at 24 MHz), at most 179 seconds.
+    scale->saturate_us = (uint32)((65536uLL * 1000000u + pwm_hz - 1u) / pwm_hz);
+}
+
+const Units_Scale * Units_GetScale(void){
+    uint32 bus_hz = ClockGovernor_GetBusHz();
+    uint16 divider = Clock_PWM_GetDividerRegister();
+    if( bus_hz != cached.bus_hz || divider != cached.divider ){
+        Units_ComputeScale(bus_hz, divider, &cached);
+    }
+    return &cached;
+}
+
+uint16 Units_UsToTicks(const Units_Scale * scale, uint32 us){
+    uint64 ticks;
+    if( us >= scale->saturate_us ){
+        return 0xFFFFu;
+    }
+    ticks = (us * scale->ticks_per_us_fixed + (1uLL << (UNITS_TICKS_PER_US_SHIFT - 1u))) >> UNITS_TICKS_PER_US_SHIFT;
+    return (ticks > 0xFFFFu) ? 0xFFFFu : (uint16) ticks;
+}
+
+uint16 Units_PercentToTicks(uint32 milli_percent, uint16 period){
+    uint64 ticks;
+    if( milli_percent > UNITS_PERCENT_SCALE ){
+        milli_percent = UNITS_PERCENT_SCALE;
+    }
+    // (period + 1) ticks per frame, times the fraction. At most 2^16 * 100000 * 2^24, so 64 bits is plenty.
+    ticks = ((uint64)((uint32) period + 1u) * milli_percent * UNITS_PERCENT_RECIPROCAL
+        + (1uLL << (UNITS_PERCENT_SHIFT - 1u))) >> UNITS_PERCENT_SHIFT;
+    return (ticks > 0xFFFFu) ? 0xFFFFu : (uint16) ticks;
+}
+
+uint8 Units_ParseMilli(const char * text, uint32 * milli){
+    uint8 used = 0;
+    uint8 decimals = 0;
+    uint32 value = 0;
+    // whole part. Stops early enough that value * 1000 below still fits in 32 bits.
+    while( text[used] >= '0' && text[used] <= '9' && value < 400000u ){
+        value = value * 10u + (uint32)(text[used] - '0');
+        used++;
+    }
+    if( used == 0 ){
+        return 0;
+    }
+    value *= 1000u;
+    // up to 3 decimal places. More than that are skipped.
+    if( text[used] == '.' ){
+        uint32 place = 100u;
+        used++;
+        while( text[used] >= '0' && text[used] <= '9' ){
+            if( decimals < 3u ){
+                value += (uint32)(text[used] - '0') * place;
+                place /= 10u;
+                decimals++;
+            }
+            used++;
+        }
+    }
+    *milli = value;
+    return used;
+}
+
+/* [] END OF FILE */
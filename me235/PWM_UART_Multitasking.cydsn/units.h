@@ -0,0 +1,73 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * units.h
+ * Converts pulse widths (microseconds) and duty cycles (percent)
+ * into PWM clock ticks, so the PC doesn't have to know how fast Clock_PWM runs.
+ *
+ * How fast is a tick? The PWM clock is the bus clock divided by (Clock_PWM's divider register + 1).
+ * Both of those can change while running (see clock_governor.h), so the conversion factors are
+ * worked out from the live values, and saved (a "cache") until one of them changes.
+ * The conversions themselves are then just multiplies and shifts, with no division, using "fixed point":
+ * a number like 2.4 ticks/us is stored as 2.4 * 2^24, an integer, and the >> 24 at the end undoes that.
+ *
+ * Everything rounds to the nearest tick. (Frequencies are in pwm_frequency.h, since they pick the divider too.)
+ */
+
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <project.h>
+
+// Fraction bits for ticks-per-microsecond. Slow PWM clocks have a LOT of microseconds per tick
+// (a 366 Hz clock is 179 seconds for 0xFFFF ticks), and the rounding error of the factor adds up
+// once per microsecond, so it takes 32 bits of fraction to stay under 0.02 ticks off.
+// The PWM clock is at most the 24 MHz bus clock, so the factor is at most 24 * 2^32: it's kept in 64 bits.
+#define UNITS_TICKS_PER_US_SHIFT 32u
+// Percent comes in as thousandths of a percent ("7.5" = 7500), and 100% = 100000 of those.
+#define UNITS_PERCENT_SCALE 100000u
+// 2^40 / 100000, rounded: multiplying by this and shifting by 40 divides by 100000.
+// 40 bits so the rounding of the reciprocal itself is off by under 0.002 ticks at the biggest period.
+#define UNITS_PERCENT_SHIFT 40u
+#define UNITS_PERCENT_RECIPROCAL 10995116uL
+
+// The saved conversion factors.
+typedef struct
+{
+    // what they were computed from
+    uint32 bus_hz;
+    uint16 divider;
+    // PWM clock, in ticks per second
+    uint32 pwm_hz;
+    // ticks per microsecond, times 2^UNITS_TICKS_PER_US_SHIFT
+    uint64 ticks_per_us_fixed;
+    // the shortest pulse width that's 0xFFFF ticks or more. Anything shorter keeps
+    // us * ticks_per_us_fixed under 2^48, so it never overflows 64 bits.
+    uint32 saturate_us;
+} Units_Scale;
+
+// Works out the factors. The only place with a division.
+void Units_ComputeScale(uint32 bus_hz, uint16 divider, Units_Scale * scale);
+
+// The factors for the live clocks, recomputed only if the divider or bus clock changed.
+const Units_Scale * Units_GetScale(void);
+
+// Compare value for a pulse width in microseconds. Saturates at 0xFFFF.
+uint16 Units_UsToTicks(const Units_Scale * scale, uint32 us);
+
+// Compare value for a duty cycle in thousandths of a percent, for the given period register value.
+uint16 Units_PercentToTicks(uint32 milli_percent, uint16 period);
+
+// Reads a number like "7.5" or "50" (up to 3 decimal places) as thousandths: 7500, 50000.
+// Returns the number of characters used, or 0 if there was no number.
+uint8 Units_ParseMilli(const char * text, uint32 * milli);
+
+#endif //UNITS_H
+
+/* [] END OF FILE */
@@ -0,0 +1,85 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+// See warm_restart.h for what this is for.
+#include "warm_restart.h"
+#include <project.h>
+// Keeps the UART ISR out while the snapshot is written.
+#include "priority_section.h"
+// offsetof, so we know how many bytes come before the checksum.
+#include <stddef.h>
+// Knows Clock_PWM's full-speed divider, even while running slower.
+#include "clock_governor.h"
+// The checksum.
+#include "eeprom_store.h"
+
+// The snapshot itself. CY_NOINIT puts it in the .noinit section of the linker script,
+// so Start_c neither copies nor zeroes it when the chip resets.
+CY_NOINIT static WarmRestart_Snapshot snapshot;
+
+uint16 WarmRestart_Checksum(const WarmRestart_Snapshot * snap){
+    // The same Fletcher-16 the EEPROM records use.
+    return EepromStore_Checksum( snap, offsetof(WarmRestart_Snapshot, checksum) );
+}
+
+uint8 WarmRestart_IsValid(const WarmRestart_Snapshot * snap){
+    if( snap->magic != WARM_RESTART_MAGIC ){
+        return 0;
+    }
+    // a PWM with a period of 0 never makes sense, so don't trust it either.
+    if( snap->period == 0 || snap->compare > snap->period ){
+        return 0;
+    }
+    return (WarmRestart_Checksum(snap) == snap->checksum) ? 1 : 0;
+}
+
+uint8 WarmRestart_Restore(void){
+    // CyResetStatus is filled in by the startup code from RESET_SR0,
+    // which Reset() in Cm3Start.c preserved for us.
+    if( (CyResetStatus & WARM_RESTART_CAUSES) == 0 || !WarmRestart_IsValid(&snapshot) ){
+        WarmRestart_Invalidate();
+        return 0;
+    }
+    // Don't call PWM_Servo_Start() here, that would enable the PWM with the
+    // schematic's period and compare for a moment before we overwrite them.
+    // The period and compare are in ticks of Clock_PWM, so its divider goes back first.
+    Clock_PWM_SetDividerRegister( snapshot.pwm_divider, 1u );
+    PWM_Servo_Init();
+    PWM_Servo_initVar = 1u;
+    PWM_Servo_WritePeriod( snapshot.period );
+    PWM_Servo_WriteCompare( snapshot.compare );
+    if( snapshot.enabled ){
+        PWM_Servo_Enable();
+    }
+    return 1;
+}
+
+void WarmRestart_Save(char session_mode){
+    // The UART ISR and the main loop could both call this,
+    // so don't let the snapshot be half-written when an interrupt comes in.
+    uint8 interrupt_state = PrioritySection_Enter();
+    snapshot.magic = WARM_RESTART_MAGIC;
+    snapshot.period = PWM_Servo_ReadPeriod();
+    snapshot.compare = PWM_Servo_ReadCompare();
+    snapshot.pwm_divider = ClockGovernor_GetPwmBaseDivider();
+    snapshot.enabled = (PWM_Servo_ReadControlRegister() & PWM_Servo_CTRL_ENABLE) ? 1 : 0;
+    snapshot.session_mode = (uint8) session_mode;
+    snapshot.checksum = WarmRestart_Checksum(&snapshot);
+    PrioritySection_Exit(interrupt_state);
+}
+
+char WarmRestart_GetSessionMode(void){
+    return (char) snapshot.session_mode;
+}
+
+void WarmRestart_Invalidate(void){
+    snapshot.magic = 0;
+    snapshot.checksum = 0;
+}
+
+/* [] END OF FILE */
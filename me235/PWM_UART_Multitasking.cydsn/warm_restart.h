@@ -0,0 +1,75 @@
+/* ========================================
+ *
+ * Copyright Andrew P. Sabelhaus, 2018
+ * See README and LICENSE for more details.
+ *
+ * ========================================
+*/
+
+/**
+ * warm_restart.h
+ * Keeps a small snapshot of the PWM settings in a part of SRAM that the
+ * startup code does NOT wipe, so that after a software reset (CySoftwareReset)
+ * or a watchdog reset, main() can put the servo back exactly where it was,
+ * instead of restarting the PWM from the schematic defaults (which makes the servo twitch).
+ *
+ * How does this work?
+ * The linker script (cm3gcc.ld) already has a ".noinit" section, which is never
+ * copied or zeroed by Start_c in Cm3Start.c. Cypress gives us the CY_NOINIT macro
+ * to put a variable there. After a power-on reset that memory is garbage,
+ * so we protect the snapshot with a magic number and a checksum.
+ *
+ * The checksum functions don't touch any hardware, so they can be compiled and
+ * checked on a regular computer too.
+ */
+
+#ifndef WARM_RESTART_H
+#define WARM_RESTART_H
+
+#include <project.h>
+
+// Written into the snapshot so that random power-up SRAM contents are never mistaken for a snapshot.
+// Changes whenever the snapshot layout does ("WRM2").
+#define WARM_RESTART_MAGIC 0x57524D32u
+// Only these reset causes (see CyResetStatus in CyLib.h) are "warm": the chip
+// kept power the whole time, so the SRAM still holds what we wrote before.
+#define WARM_RESTART_CAUSES (CY_RESET_SW | CY_RESET_WD)
+
+// Everything we need to put the PWM back, plus a little protocol state.
+typedef struct
+{
+    uint32 magic;
+    uint16 period;
+    uint16 compare;
+    // Clock_PWM's full-speed divider register, which f commands can change (see pwm_frequency.h)
+    uint16 pwm_divider;
+    uint8 enabled;
+    // the last command letter that was accepted over the UART (p, d, ...)
+    uint8 session_mode;
+    // Fletcher-16 over all of the fields above.
+    uint16 checksum;
+} WarmRestart_Snapshot;
+
+// Fletcher-16 checksum over the snapshot, not counting the checksum field itself.
+uint16 WarmRestart_Checksum(const WarmRestart_Snapshot * snap);
+
+// Returns 1 if the snapshot has the right magic number and checksum, 0 otherwise.
+uint8 WarmRestart_IsValid(const WarmRestart_Snapshot * snap);
+
+// Call this FIRST in main(). If the last reset was warm and the snapshot is valid,
+// restarts the PWM with the saved period/compare/enable and returns 1.
+// Otherwise returns 0, and the caller should start things up normally.
+uint8 WarmRestart_Restore(void);
+
+// Copies the current PWM settings into the snapshot. Call after every change to the PWM.
+void WarmRestart_Save(char session_mode);
+
+// The last command letter that was saved, valid after WarmRestart_Restore returned 1.
+char WarmRestart_GetSessionMode(void);
+
+// Throws away the snapshot, so the next reset is always treated as a cold start.
+void WarmRestart_Invalidate(void);
+
+#endif //WARM_RESTART_H
+
+/* [] END OF FILE */